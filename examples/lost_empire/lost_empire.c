@@ -8,8 +8,10 @@
 int main(void)
 {
     PAppInfo app_info = {
-        .app_name    = "Lost Empire",
-        .app_version = PIGMENT_MAKE_VERSION(1, 0, 0)
+        .app_name            = "Lost Empire",
+        .app_version         = PIGMENT_MAKE_VERSION(1, 0, 0),
+        .pack_texture_arrays = true,
+        .merge_block_faces   = true
     };
 
     PWindowInfo window_info = {
@@ -40,7 +42,6 @@ int main(void)
     {
         goto FREE;
     }
-    add_textures_dir_to_load(textures_to_load, "examples/" MODEL_NAME "/textures");
 
     model = create_model();
     if(model == NULL)
@@ -2,17 +2,36 @@
 
 #extension GL_EXT_nonuniform_qualifier : require
 #define MAX_SAMPLERS 2
+#define ALPHA_CUTOFF 0.8
 
-layout (binding = 1) uniform sampler _sampler[MAX_SAMPLERS];
-layout (binding = 2) uniform texture2D _texture[];
+layout (set = 0, binding = 0) uniform sampler _sampler[MAX_SAMPLERS];
+layout (set = 0, binding = 1) uniform texture2DArray _texture[];
 
+#ifdef TEXTURE_FEEDBACK
+#define FEEDBACK_LOD_BIAS 16.0
+
+layout (set = 1, binding = 4) buffer TextureFeedback
+{
+    uint requestedLevels[];
+} feedback;
+#endif
+
+#ifndef DEPTH_PREPASS
 layout (location = 0) in vec3 fragColor;
+#endif
 layout (location = 1) in vec2 fragTexCoord;
 layout (location = 2) flat in int inTexIndex;
 layout (location = 3) flat in int inSamplerIndex;
+layout (location = 4) flat in int inTexLayer;
+layout (location = 5) flat in uint inDescriptorIndex;
 
 layout (location = 0) out vec4 outColor;
 
+#if defined(DEPTH_EQUAL) || (defined(OPAQUE_MATERIAL) && !defined(DEPTH_PREPASS))
+// Nothing is discarded past this point, force the test before the shader even with the feedback writes
+layout (early_fragment_tests) in;
+#endif
+
 void main()
 {
     int samplerIndex;
@@ -24,9 +43,31 @@ void main()
     {
         samplerIndex = inSamplerIndex;
     }
-    outColor = texture(sampler2D(_texture[nonuniformEXT(inTexIndex)], _sampler[samplerIndex]), fragTexCoord);
-    if (outColor.w < 0.8)
+#ifdef DEPTH_PREPASS
+#ifndef OPAQUE_MATERIAL
+    // Only the alpha test runs here, the main pass shades what is left on the same depth
+    if (texture(sampler2DArray(_texture[nonuniformEXT(inDescriptorIndex)], _sampler[samplerIndex]), vec3(fragTexCoord, inTexLayer)).a < ALPHA_CUTOFF)
+    {
+        discard;
+    }
+#endif
+#else
+    outColor = vec4(fragColor, 1.0) * texture(sampler2DArray(_texture[nonuniformEXT(inDescriptorIndex)], _sampler[samplerIndex]), vec3(fragTexCoord, inTexLayer));
+#ifdef TEXTURE_FEEDBACK
+    // Report the finest level wanted, biased so that magnified textures still ask for more detail
+    float lod = textureQueryLod(sampler2DArray(_texture[nonuniformEXT(inDescriptorIndex)], _sampler[samplerIndex]), fragTexCoord).y;
+    uint requestedLevel = uint(clamp(floor(lod) + FEEDBACK_LOD_BIAS, 0.0, 31.0));
+    if (requestedLevel < feedback.requestedLevels[inTexIndex])
+    {
+        atomicMin(feedback.requestedLevels[inTexIndex], requestedLevel);
+    }
+#endif
+#if !defined(DEPTH_EQUAL) && !defined(OPAQUE_MATERIAL)
+    // Without a pre-pass the discard stays here, which prevents early depth testing
+    if (outColor.w < ALPHA_CUTOFF)
     {
         discard;
     }
+#endif
+#endif
 }
\ No newline at end of file
@@ -1,27 +1,88 @@
 #version 450
 
-layout (binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout (set = 1, binding = 0) uniform UniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
 
+struct Instance
+{
+    mat4 model;
+    vec4 color;
+    uint textureIndex;
+    uint textureLayer;
+    uint meshIndex;
+    uint batchOffset;
+};
+
+layout (set = 1, binding = 2) readonly buffer InstanceBuffer
+{
+    Instance instances[];
+} instanceBuffer;
+
+#ifdef GPU_CULLING
+layout (set = 1, binding = 3) readonly buffer VisibleBuffer
+{
+    uint visibleInstances[];
+} visibleBuffer;
+#endif
+
+layout (push_constant) uniform ModelConstants
+{
+    mat4 model;
+} constants;
+
+layout (set = 1, binding = 1) readonly buffer TextureTable
+{
+    uint descriptorIndices[];
+} textureTable;
+
 layout (location = 0) in vec3 inPosition;
+#ifndef DEPTH_PREPASS
 layout (location = 1) in vec3 inColor;
+#endif
 layout (location = 2) in vec2 inTexCoord;
 layout (location = 3) in int inTextureIndex;
 layout (location = 4) in int inSamplerIndex;
+layout (location = 5) in int inTextureLayer;
 
+#ifndef DEPTH_PREPASS
 layout (location = 0) out vec3 fragColor;
+#endif
 layout (location = 1) out vec2 fragTexCoord;
 layout (location = 2) flat out int fragTexIndex;
 layout (location = 3) flat out int fragSamplerIndex;
+layout (location = 4) flat out int fragTexLayer;
+layout (location = 5) flat out uint fragDescriptorIndex;
+
+// The depth pre-pass and the main pass must compute the exact same depth for the EQUAL test
+invariant gl_Position;
 
 void main()
 {
-    fragColor = inColor;
+#ifdef GPU_CULLING
+    // Instances that passed culling are listed by mesh, the first entry stays on the static model
+    Instance instance = instanceBuffer.instances[visibleBuffer.visibleInstances[gl_InstanceIndex]];
+#else
+    Instance instance = instanceBuffer.instances[gl_InstanceIndex];
+#endif
+
+    // Instances of a shared mesh pick their texture, the static model keeps the one of each vertex
+    int textureIndex = inTextureIndex;
+    int textureLayer = inTextureLayer;
+    if (instance.textureIndex != 0xFFFFFFFFu)
+    {
+        textureIndex = int(instance.textureIndex);
+        textureLayer = int(instance.textureLayer);
+    }
+
+#ifndef DEPTH_PREPASS
+    fragColor = inColor * instance.color.rgb;
+#endif
     fragTexCoord = inTexCoord;
-    fragTexIndex = inTextureIndex;
+    fragTexIndex = textureIndex;
     fragSamplerIndex = inSamplerIndex;
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    fragTexLayer = textureLayer;
+    fragDescriptorIndex = textureTable.descriptorIndices[max(textureIndex, 0)];
+    gl_Position = ubo.proj * ubo.view * constants.model * instance.model * vec4(inPosition, 1.0);
 }
\ No newline at end of file
@@ -16,13 +16,29 @@
 
 #include "buffers.h"
 #include "structs.h"
+#include "uniform.h"
+#include "meshlets.h"
+#include "geometry_pool.h"
+#include "models.h"
+#include "lod.h"
+
+#include "lib/array.h"
+
+extern int allocate_device_memory(const VkMemoryRequirements* memory_requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkDeviceMemory* memory, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+extern MemoryCategory get_buffer_memory_category(VkBufferUsageFlags usage);
+
+#define SMALL_BAR_HEAP_SIZE (256ull * 1024ull * 1024ull)
 
 int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
 uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
-void copy_buffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkCommandPool command_pool, PDevice* device);
-int create_vertex_buffer(PBuffers* buffers, Vertex* vertices, uint32_t vertices_size, PDevice* device, VkCommandPool command_pool);
-int create_index_buffer(PBuffers* buffers, const uint32_t* indices, uint32_t indices_size, PDevice* device, VkCommandPool command_pool);
+bool has_direct_upload_memory(VkPhysicalDevice physical_device);
+void copy_buffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkDeviceSize size, VkCommandPool command_pool, PDevice* device);
+int create_device_local_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, void** buffer_mapped, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkCommandPool command_pool, PDevice* device);
+int update_device_local_buffer(VkBuffer buffer, void* buffer_mapped, const void* data, VkDeviceSize offset, VkDeviceSize size, VkCommandPool command_pool, PDevice* device);
 int create_uniform_buffers(PBuffers* buffers, PDevice* device, const uint32_t uniform_buffers_numbers);
+int create_geometry_buffers(PBuffers* buffers, PModel* model, uint32_t mesh_capacity, uint32_t reserved_vertices, uint32_t reserved_indices, PDevice* device, PCommands* commands, uint32_t frame_count);
+int place_mesh(PBuffers* buffers, const PModel* model, uint32_t model_mesh, uint32_t mesh_index, uint32_t* mesh_indices, bool queued, PCommands* commands, PDevice* device);
 VkCommandBuffer start_single_usage_commands(VkCommandPool command_pool, PDevice* device);
 void end_single_usage_commands(VkCommandBuffer* command_buffer, VkCommandPool command_pool, PDevice* device);
 
@@ -31,133 +47,336 @@ uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_filter
     VkPhysicalDeviceMemoryProperties memory_properties;
     vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
 
+    // Rank the matching types by the number of flags they carry on top of the requested ones,
+    // so that plain staging memory does not eat into the small device local host visible heap
+    // and plain device local memory is picked over host visible aliases of the same heap.
+    uint32_t best_type  = UINT32_MAX;
+    uint32_t best_extra = UINT32_MAX;
+
     for(uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
     {
-        if((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+        VkMemoryPropertyFlags type_properties = memory_properties.memoryTypes[i].propertyFlags;
+
+        if(!(type_filter & (1u << i)) || (type_properties & properties) != properties)
         {
-            return i;
+            continue;
+        }
+
+        uint32_t extra = (uint32_t) __builtin_popcount(type_properties & ~properties);
+        if(extra < best_extra)
+        {
+            best_type  = i;
+            best_extra = extra;
         }
     }
 
-    fprintf(stderr, "Failed to find suitable memory type!\n");
-    return 0;
+    if(best_type == UINT32_MAX)
+    {
+        fprintf(stderr, "Failed to find suitable memory type!\n");
+    }
+
+    return best_type;
 }
 
-int create_vertex_buffer(PBuffers* buffers, Vertex* vertices, uint32_t vertices_size, PDevice* device, VkCommandPool command_pool)
+bool has_direct_upload_memory(VkPhysicalDevice physical_device)
 {
-    VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices_size;
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
 
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
 
-    if(create_buffer(&staging_buffer, &staging_buffer_memory, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+    VkMemoryPropertyFlags direct_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for(uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
     {
-        goto ERROR;
+        if((memory_properties.memoryTypes[i].propertyFlags & direct_properties) != direct_properties)
+        {
+            continue;
+        }
+
+        // On UMA every heap is system memory, on ReBAR the whole VRAM is mapped instead of the legacy 256 MiB window
+        VkDeviceSize heap_size = memory_properties.memoryHeaps[memory_properties.memoryTypes[i].heapIndex].size;
+        if(device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || heap_size > SMALL_BAR_HEAP_SIZE)
+        {
+            return true;
+        }
     }
 
-    void* data;
-    vkMapMemory(device->logical_device, staging_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy(data, vertices, (size_t) buffer_size);
-    vkUnmapMemory(device->logical_device, staging_buffer_memory);
+    return false;
+}
+
+int create_device_local_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, void** buffer_mapped, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkCommandPool command_pool, PDevice* device)
+{
+    *buffer_mapped = NULL;
 
-    if(create_buffer(&buffers->vertex_buffer, &buffers->vertex_buffer_memory, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    if(device->direct_buffer_upload)
     {
-        goto ERROR;
-    }
+        if(create_buffer(buffer, buffer_memory, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) == PIGMENT_SUCCESS)
+        {
+            if(vkMapMemory(device->logical_device, *buffer_memory, 0, size, 0, buffer_mapped) == VK_SUCCESS)
+            {
+                memcpy(*buffer_mapped, data, (size_t) size);
+                return PIGMENT_SUCCESS;
+            }
 
-    copy_buffer(staging_buffer, buffers->vertex_buffer, buffer_size, command_pool, device);
+            *buffer_mapped = NULL;
+            vkDestroyBuffer(device->logical_device, *buffer, NULL);
+            free_device_memory(*buffer_memory, device);
+        }
 
-    vkDestroyBuffer(device->logical_device, staging_buffer, NULL);
-    vkFreeMemory(device->logical_device, staging_buffer_memory, NULL);
+        // The mappable device local heap is full, go through a staging copy instead
+    }
 
-    return PIGMENT_SUCCESS;
+    if(create_buffer(buffer, buffer_memory, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
 
-ERROR:
-    return PIGMENT_ERROR;
+    return update_device_local_buffer(*buffer, NULL, data, 0, size, command_pool, device);
 }
 
-int create_index_buffer(PBuffers* buffers, const uint32_t* indices, uint32_t indices_size, PDevice* device, VkCommandPool command_pool)
+int update_device_local_buffer(VkBuffer buffer, void* buffer_mapped, const void* data, VkDeviceSize offset, VkDeviceSize size, VkCommandPool command_pool, PDevice* device)
 {
-    VkDeviceSize buffer_size = sizeof(indices[0]) * indices_size;
+    if(buffer_mapped != NULL)
+    {
+        memcpy((char*) buffer_mapped + offset, data, (size_t) size);
+        return PIGMENT_SUCCESS;
+    }
 
     VkBuffer staging_buffer;
     VkDeviceMemory staging_buffer_memory;
 
-    if(create_buffer(&staging_buffer, &staging_buffer_memory, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+    if(create_buffer(&staging_buffer, &staging_buffer_memory, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
     {
-        goto ERROR;
+        return PIGMENT_ERROR;
     }
 
-    void* data;
-    vkMapMemory(device->logical_device, staging_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy(data, indices, (size_t) buffer_size);
+    void* staging_data;
+    vkMapMemory(device->logical_device, staging_buffer_memory, 0, size, 0, &staging_data);
+    memcpy(staging_data, data, (size_t) size);
     vkUnmapMemory(device->logical_device, staging_buffer_memory);
 
-    if(create_buffer(&buffers->index_buffer, &buffers->index_buffer_memory, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
-    {
-        goto ERROR;
-    }
-
-    copy_buffer(staging_buffer, buffers->index_buffer, buffer_size, command_pool, device);
+    copy_buffer(staging_buffer, buffer, offset, size, command_pool, device);
 
     vkDestroyBuffer(device->logical_device, staging_buffer, NULL);
-    vkFreeMemory(device->logical_device, staging_buffer_memory, NULL);
+    free_device_memory(staging_buffer_memory, device);
 
     return PIGMENT_SUCCESS;
-
-ERROR:
-    return PIGMENT_ERROR;
 }
 
 int create_uniform_buffers(PBuffers* buffers, PDevice* device, const uint32_t uniform_buffers_numbers)
 {
-    VkDeviceSize buffer_size = sizeof(UniformBufferObject);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device->physical_device, &properties);
+
+    // Every frame in flight owns one slice of a single mapped buffer, bound with a dynamic offset
+    buffers->uniform_alignment  = properties.limits.minUniformBufferOffsetAlignment > 0 ? properties.limits.minUniformBufferOffsetAlignment : 1;
+    buffers->uniform_arena_size = (UNIFORM_ARENA_SIZE + buffers->uniform_alignment - 1) & ~(buffers->uniform_alignment - 1);
 
-    buffers->uniform_buffers = NULL;
-    buffers->uniform_buffers_memory = NULL;
-    buffers->uniform_buffers_mapped = NULL;
+    VkDeviceSize buffer_size = buffers->uniform_arena_size * uniform_buffers_numbers;
 
-    buffers->uniform_buffers = malloc(uniform_buffers_numbers * sizeof(*buffers->uniform_buffers));
-    if(buffers->uniform_buffers == NULL)
+    if(create_buffer(&buffers->uniform_buffer, &buffers->uniform_buffer_memory, buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
     {
-        goto ERROR;
+        return PIGMENT_ERROR;
     }
 
-    buffers->uniform_buffers_memory = malloc(uniform_buffers_numbers * sizeof(*buffers->uniform_buffers_memory));
-    if(buffers->uniform_buffers_memory == NULL)
+    if(vkMapMemory(device->logical_device, buffers->uniform_buffer_memory, 0, buffer_size, 0, &buffers->uniform_buffer_mapped) != VK_SUCCESS)
     {
-        goto ERROR;
+        fprintf(stderr, "Failed to map uniform buffer!\n");
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+int create_geometry_buffers(PBuffers* buffers, PModel* model, uint32_t mesh_capacity, uint32_t reserved_vertices, uint32_t reserved_indices, PDevice* device, PCommands* commands, uint32_t frame_count)
+{
+    uint32_t vertices_total = model->vertices_number + model->mesh_vertices_number + reserved_vertices + GEOMETRY_POOL_SPARE_VERTICES;
+    uint32_t indices_total  = model->indices_number + model->mesh_indices_number + reserved_indices + GEOMETRY_POOL_SPARE_INDICES;
+    uint32_t* mesh_indices  = NULL;
+    int result              = PIGMENT_ERROR;
+
+    buffers->static_geometry = GEOMETRY_NO_ALLOCATION;
+    buffers->geometry_pool   = create_geometry_pool(vertices_total, indices_total, device, frame_count);
+    if(buffers->geometry_pool == NULL)
+    {
+        return PIGMENT_ERROR;
     }
 
-    buffers->uniform_buffers_mapped = malloc(uniform_buffers_numbers * sizeof(*buffers->uniform_buffers_mapped));
-    if(buffers->uniform_buffers_mapped == NULL)
+    // The static model is allocated first, so that its meshlets address the pool from its start
+    if(model->indices_number > 0)
     {
-        goto ERROR;
+        buffers->static_geometry = allocate_geometry(buffers->geometry_pool, model->vertices_number, model->indices_number, false);
+        if(buffers->static_geometry == GEOMETRY_NO_ALLOCATION ||
+           write_geometry(buffers->geometry_pool, buffers->static_geometry, model->vertices, model->indices, commands, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+    }
+
+    if(mesh_capacity == 0)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    // Mesh slots are sized once, meshes added while running take the slots left after the model's meshes
+    buffers->meshes          = calloc(mesh_capacity, sizeof(*buffers->meshes));
+    buffers->mesh_geometries = malloc(mesh_capacity * sizeof(*buffers->mesh_geometries));
+    mesh_indices             = malloc((model->mesh_indices_number > 0 ? model->mesh_indices_number : 1) * sizeof(*mesh_indices));
+    if(buffers->meshes == NULL || buffers->mesh_geometries == NULL || mesh_indices == NULL)
+    {
+        perror("create_geometry_buffers");
+        goto FREE;
     }
 
-    for(size_t i = 0; i < uniform_buffers_numbers; i++)
+    buffers->mesh_capacity = mesh_capacity;
+    for(uint32_t i = 0; i < mesh_capacity; i++)
     {
-        if(create_buffer(&buffers->uniform_buffers[i], &buffers->uniform_buffers_memory[i], buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+        buffers->mesh_geometries[i] = GEOMETRY_NO_ALLOCATION;
+    }
+
+    for(uint32_t i = 0; i < model->mesh_number; i++)
+    {
+        if(place_mesh(buffers, model, i, i, mesh_indices, false, commands, device) != PIGMENT_SUCCESS)
         {
-            goto ERROR;
+            goto FREE;
         }
+        buffers->mesh_number++;
+    }
 
-        vkMapMemory(device->logical_device, buffers->uniform_buffers_memory[i], 0, buffer_size, 0, &buffers->uniform_buffers_mapped[i]);
+    result = PIGMENT_SUCCESS;
+
+FREE:
+    free(mesh_indices);
+    return result;
+}
+
+// Gives a mesh of the model its own allocation, holding its levels of detail one after the other
+int place_mesh(PBuffers* buffers, const PModel* model, uint32_t model_mesh, uint32_t mesh_index, uint32_t* mesh_indices, bool queued, PCommands* commands, PDevice* device)
+{
+    PMesh* mesh          = &buffers->meshes[mesh_index];
+    uint32_t index_count = 0;
+
+    *mesh = model->meshes[model_mesh];
+    for(uint32_t i = 0; i < mesh->lod_count; i++)
+    {
+        memcpy(&mesh_indices[index_count], &model->mesh_indices[mesh->lods[i].first_index], mesh->lods[i].index_count * sizeof(*mesh_indices));
+        mesh->lods[i].first_index = index_count;
+        index_count              += mesh->lods[i].index_count;
     }
 
+    uint32_t geometry = allocate_geometry(buffers->geometry_pool, mesh->vertex_count, index_count, false);
+    if(geometry == GEOMETRY_NO_ALLOCATION)
+    {
+        fprintf(stderr, "Failed to allocate mesh geometry, the geometry pool is full!\n");
+        memset(mesh, 0, sizeof(*mesh));
+        return PIGMENT_ERROR;
+    }
+
+    // Meshes that do not fit in a staging buffer are written right away, waiting for the device unless the pool is mapped
+    const Vertex* vertices = &model->mesh_vertices[mesh->vertex_offset];
+    size_t upload_size     = mesh->vertex_count * sizeof(Vertex) + index_count * sizeof(uint32_t);
+    int result             = queued && upload_size <= GEOMETRY_STAGING_SIZE ? queue_geometry_upload(buffers->geometry_pool, geometry, vertices, mesh_indices)
+                                                                            : write_geometry(buffers->geometry_pool, geometry, vertices, mesh_indices, commands, device);
+    if(result != PIGMENT_SUCCESS)
+    {
+        release_geometry(buffers->geometry_pool, geometry);
+        memset(mesh, 0, sizeof(*mesh));
+        return PIGMENT_ERROR;
+    }
+
+    const PGeometryAllocation* allocation = &buffers->geometry_pool->allocations[geometry];
+    mesh->vertex_offset                   = (int32_t) allocation->vertex_offset;
+    for(uint32_t i = 0; i < mesh->lod_count; i++)
+    {
+        mesh->lods[i].first_index += allocation->first_index;
+    }
+    buffers->mesh_geometries[mesh_index] = geometry;
+
     return PIGMENT_SUCCESS;
+}
 
-ERROR:
-    free(buffers->uniform_buffers_mapped);
-    buffers->uniform_buffers_mapped = NULL;
-    free(buffers->uniform_buffers_memory);
-    buffers->uniform_buffers_memory = NULL;
-    free(buffers->uniform_buffers);
-    buffers->uniform_buffers = NULL;
-    return PIGMENT_ERROR;
+uint32_t insert_mesh(PBuffers* buffers, const Vertex* vertices, uint32_t vertices_number, const uint32_t* indices, uint32_t indices_number, PCommands* commands, PDevice* device)
+{
+    if(buffers->free_mesh_number == 0 && buffers->mesh_number >= buffers->mesh_capacity)
+    {
+        fprintf(stderr, "Failed to add mesh, all %u mesh slots are used!\n", buffers->mesh_capacity);
+        return UINT32_MAX;
+    }
+
+    // The mesh goes through the same model path as the meshes registered before init, levels of detail included
+    uint32_t mesh_index    = UINT32_MAX;
+    uint32_t* mesh_indices = NULL;
+    uint32_t slot          = buffers->free_mesh_number > 0 ? buffers->free_meshes[buffers->free_mesh_number - 1] : buffers->mesh_number;
+    PModel* model          = create_model();
+    if(model == NULL || add_mesh(vertices, vertices_number, indices, indices_number, model) == UINT32_MAX)
+    {
+        goto FREE;
+    }
+    if(build_mesh_lods(model) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to build mesh levels of detail, drawing the mesh at full detail!\n");
+    }
+
+    mesh_indices = malloc(model->mesh_indices_number * sizeof(*mesh_indices));
+    if(mesh_indices == NULL)
+    {
+        perror("insert_mesh");
+        goto FREE;
+    }
+
+    if(place_mesh(buffers, model, 0, slot, mesh_indices, true, commands, device) != PIGMENT_SUCCESS)
+    {
+        goto FREE;
+    }
+
+    if(buffers->free_mesh_number > 0)
+    {
+        buffers->free_mesh_number--;
+    }
+    else
+    {
+        buffers->mesh_number++;
+    }
+    mesh_index = slot;
+
+FREE:
+    free(mesh_indices);
+    destroy_model(model);
+    return mesh_index;
+}
+
+void remove_mesh(PBuffers* buffers, uint32_t mesh_index)
+{
+    if(!has_mesh(buffers, mesh_index))
+    {
+        return;
+    }
+
+    if(push_free_index(&buffers->free_meshes, &buffers->free_mesh_number, &buffers->free_mesh_size, mesh_index) != PIGMENT_SUCCESS)
+    {
+        perror("remove_mesh");
+        return;
+    }
+
+    // The geometry stays in place until the frames in flight are done drawing it
+    release_geometry(buffers->geometry_pool, buffers->mesh_geometries[mesh_index]);
+    buffers->mesh_geometries[mesh_index] = GEOMETRY_NO_ALLOCATION;
+    memset(&buffers->meshes[mesh_index], 0, sizeof(buffers->meshes[mesh_index]));
 }
 
-PBuffers* create_buffers(PModel* model, PDevice* device, PCommands* commands, const uint32_t uniform_buffers_numbers)
+bool has_mesh(const PBuffers* buffers, uint32_t mesh_index)
+{
+    return mesh_index < buffers->mesh_number && buffers->mesh_geometries[mesh_index] != GEOMETRY_NO_ALLOCATION;
+}
+
+bool is_mesh_ready(const PBuffers* buffers, uint32_t mesh_index)
+{
+    return has_mesh(buffers, mesh_index) && buffers->geometry_pool->allocations[buffers->mesh_geometries[mesh_index]].uploaded;
+}
+
+PBuffers* create_buffers(PModel* model, uint32_t mesh_capacity, uint32_t reserved_vertices, uint32_t reserved_indices, PDevice* device, PCommands* commands, const uint32_t uniform_buffers_numbers)
 {
     PBuffers* buffers = calloc(1, sizeof(*buffers));
     if(buffers == NULL)
@@ -165,18 +384,26 @@ PBuffers* create_buffers(PModel* model, PDevice* device, PCommands* commands, co
         goto ERROR;
     }
 
-    buffers->vertices_size = model->vertices_number;
-    buffers->indices_size  = model->indices_number;
-
-    if(create_vertex_buffer(buffers, model->vertices, model->vertices_number, device, commands->command_pool) != PIGMENT_SUCCESS)
+    if(create_geometry_buffers(buffers, model, mesh_capacity, reserved_vertices, reserved_indices, device, commands, uniform_buffers_numbers) != PIGMENT_SUCCESS)
     {
         goto ERROR;
     }
-    if(create_index_buffer(buffers, model->indices, model->indices_number, device, commands->command_pool) != PIGMENT_SUCCESS)
+    if(create_uniform_buffers(buffers, device, uniform_buffers_numbers) != PIGMENT_SUCCESS)
     {
         goto ERROR;
     }
-    if(create_uniform_buffers(buffers, device, uniform_buffers_numbers) != PIGMENT_SUCCESS)
+
+    mat4 model_matrix  = GLM_MAT4_IDENTITY_INIT;
+    vec3 pivot         = {0.0f, 0.0f, 0.0f};
+    vec3 rotation_axis = {0.0f, 1.0f, 0.0f};
+    glm_rotate_at(model_matrix, pivot, glm_rad(90.0f), rotation_axis);
+
+    vec3 rotation_axis2 = {0.0f, 0.0f, 1.0f};
+    glm_rotate_at(model_matrix, pivot, glm_rad(90.0f), rotation_axis2);
+
+    glm_mat4_ucopy(model_matrix, buffers->model_matrix);
+
+    if(create_meshlets(buffers, model, device, uniform_buffers_numbers) != PIGMENT_SUCCESS)
     {
         goto ERROR;
     }
@@ -193,34 +420,18 @@ void destroy_buffers(PBuffers* buffers, PDevice* device, const uint32_t uniform_
 {
     if(buffers != NULL)
     {
-        if(buffers->uniform_buffers != NULL)
-        {
-            for(size_t i = 0; i < uniform_buffers_numbers; i++)
-            {
-                vkDestroyBuffer(device->logical_device, buffers->uniform_buffers[i], NULL);
-            }
-        }
-        if(buffers->uniform_buffers_memory != NULL)
+        if(buffers->uniform_buffer_mapped != NULL)
         {
-            for(size_t i = 0; i < uniform_buffers_numbers; i++)
-            {
-                vkFreeMemory(device->logical_device, buffers->uniform_buffers_memory[i], NULL);
-            }
+            vkUnmapMemory(device->logical_device, buffers->uniform_buffer_memory);
         }
-
-        free(buffers->uniform_buffers_mapped);
-        buffers->uniform_buffers_mapped = NULL;
-        free(buffers->uniform_buffers_memory);
-        buffers->uniform_buffers_memory = NULL;
-        free(buffers->uniform_buffers);
-        buffers->uniform_buffers = NULL;
-
-        vkDestroyBuffer(device->logical_device, buffers->vertex_buffer, NULL);
-        vkFreeMemory(device->logical_device, buffers->vertex_buffer_memory, NULL);
-
-        vkDestroyBuffer(device->logical_device, buffers->index_buffer, NULL);
-        vkFreeMemory(device->logical_device, buffers->index_buffer_memory, NULL);
-
+        vkDestroyBuffer(device->logical_device, buffers->uniform_buffer, NULL);
+        free_device_memory(buffers->uniform_buffer_memory, device);
+
+        destroy_geometry_pool(buffers->geometry_pool, device);
+        destroy_meshlets(buffers, device, uniform_buffers_numbers);
+        free(buffers->free_meshes);
+        free(buffers->mesh_geometries);
+        free(buffers->meshes);
         free(buffers);
     }
 }
@@ -243,13 +454,7 @@ int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize
     VkMemoryRequirements memory_requirements;
     vkGetBufferMemoryRequirements(device->logical_device, *buffer, &memory_requirements);
 
-    VkMemoryAllocateInfo allocate_info = {
-        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize  = memory_requirements.size,
-        .memoryTypeIndex = find_memory_type(device->physical_device, memory_requirements.memoryTypeBits, properties)
-    };
-
-    if(vkAllocateMemory(device->logical_device, &allocate_info, NULL, buffer_memory) != VK_SUCCESS)
+    if(allocate_device_memory(&memory_requirements, properties, get_buffer_memory_category(usage), buffer_memory, device) != PIGMENT_SUCCESS)
     {
         fprintf(stderr, "Failed to allocate buffer memory!");
         goto ERROR;
@@ -264,11 +469,14 @@ ERROR:
     return PIGMENT_ERROR;
 }
 
-void copy_buffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize size, VkCommandPool command_pool, PDevice* device)
+void copy_buffer(VkBuffer src_buffer, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkDeviceSize size, VkCommandPool command_pool, PDevice* device)
 {
     VkCommandBuffer command_buffer = start_single_usage_commands(command_pool, device);
 
-    VkBufferCopy copy_region = {.size = size};
+    VkBufferCopy copy_region = {
+        .dstOffset = dst_offset,
+        .size      = size
+    };
     vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
 
     end_single_usage_commands(&command_buffer, command_pool, device);
@@ -16,10 +16,15 @@
 
 #ifndef BUFFERS_H
 #define BUFFERS_H
+#define DEFAULT_MESH_CAPACITY 1024
 
 #include "defines.h"
 
-PBuffers* create_buffers(PModel* model, PDevice* device, PCommands* commands, const uint32_t uniform_buffers_numbers);
+PBuffers* create_buffers(PModel* model, uint32_t mesh_capacity, uint32_t reserved_vertices, uint32_t reserved_indices, PDevice* device, PCommands* commands, const uint32_t uniform_buffers_numbers);
 void destroy_buffers(PBuffers* buffers, PDevice* device, const uint32_t uniform_buffers_numbers);
+uint32_t insert_mesh(PBuffers* buffers, const Vertex* vertices, uint32_t vertices_number, const uint32_t* indices, uint32_t indices_number, PCommands* commands, PDevice* device);
+void remove_mesh(PBuffers* buffers, uint32_t mesh_index);
+bool has_mesh(const PBuffers* buffers, uint32_t mesh_index);
+bool is_mesh_ready(const PBuffers* buffers, uint32_t mesh_index);
 
 #endif
@@ -16,9 +16,11 @@
 
 #include "defines.h"
 #include "structs.h"
+#include "lod.h"
 #include <cglm/quat.h>
 
 void get_view_matrix(PCamera* camera, UniformBufferObject* ubo);
+float get_lod_scale(PCamera* camera, float viewport_height);
 
 PCamera* create_camera(void)
 {
@@ -43,6 +45,10 @@ PCamera* create_camera(void)
     camera->pitch = 0.0f;
     camera->yaw   = 0.0f;
 
+    camera->fov               = 45.0f;
+    camera->projection_fov    = 0.0f;
+    camera->projection_aspect = 0.0f;
+
     return camera;
 }
 
@@ -63,3 +69,9 @@ void get_view_matrix(PCamera* camera, UniformBufferObject* ubo)
 
     glm_lookat(camera->position, target, camera->up, ubo->view);
 }
+
+// Pixels covered by one unit at distance one, divided by the error tolerated on screen
+float get_lod_scale(PCamera* camera, float viewport_height)
+{
+    return viewport_height / (2.0f * tanf(glm_rad(camera->fov) * 0.5f)) / LOD_PIXEL_ERROR;
+}
@@ -0,0 +1,577 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chunks.h"
+#include "structs.h"
+#include "instancing.h"
+#include "geometry_pool.h"
+
+#include "lib/array.h"
+
+extern void compute_mesh_bounds(const Vertex* vertices, uint32_t vertices_number, vec4 bounds);
+
+typedef struct ChunkTriangle {
+    int32_t cell[3];
+    uint32_t triangle;
+} ChunkTriangle;
+
+int compare_chunk_triangles(const void* a, const void* b);
+int compare_chunk_candidates(const void* a, const void* b);
+int split_model_into_chunks(PChunks* chunks, const PModel* model, float chunk_size);
+int write_chunk(PChunks* chunks, uint32_t* chunk_size, const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, uint32_t opaque_index_count);
+void* load_chunk_data(PChunks* chunks, uint32_t chunk_index);
+void* stream_chunks(void* arg);
+bool upload_chunk(PChunk* chunk, PGeometryPool* pool);
+void get_chunk_sphere(const PChunk* chunk, mat4 model_matrix, vec4 sphere);
+bool chunk_is_visible(const vec4 sphere, vec4* frustum_planes);
+void record_chunk_draws(VkCommandBuffer command_buffer, PChunks* chunks, PGeometryPool* pool, uint32_t material);
+uint32_t write_chunk_cull_entries(const PChunks* chunks, const PGeometryPool* pool, mat4 model_matrix, uint32_t first_visibility, uint32_t alpha_draw_offset, CullMeshlet* entries);
+
+PChunks* create_chunks(PModel* model, float chunk_size, float radius)
+{
+    PChunks* chunks = calloc(1, sizeof(*chunks));
+    if(chunks == NULL)
+    {
+        perror("create_chunks");
+        return NULL;
+    }
+
+    chunks->radius = radius;
+    pthread_mutex_init(&chunks->mutex, NULL);
+    pthread_cond_init(&chunks->condition, NULL);
+
+    // Chunks wait on disk until the camera gets close to them, in a file removed when it is closed
+    chunks->file = tmpfile();
+    if(chunks->file == NULL)
+    {
+        perror("tmpfile");
+        goto ERROR;
+    }
+
+    if(split_model_into_chunks(chunks, model, chunk_size) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+
+    chunks->completed      = malloc(chunks->chunk_number * sizeof(*chunks->completed));
+    chunks->candidates     = malloc(chunks->chunk_number * sizeof(*chunks->candidates));
+    chunks->visible_chunks = malloc(chunks->chunk_number * sizeof(*chunks->visible_chunks));
+    chunks->distances      = malloc(chunks->chunk_number * sizeof(*chunks->distances));
+    if(chunks->completed == NULL || chunks->candidates == NULL || chunks->visible_chunks == NULL || chunks->distances == NULL)
+    {
+        perror("create_chunks");
+        goto ERROR;
+    }
+
+    chunks->worker_started = pthread_create(&chunks->worker, NULL, stream_chunks, chunks) == 0;
+    if(!chunks->worker_started)
+    {
+        fprintf(stderr, "Failed to start chunk streaming thread, loading chunks on the render thread!\n");
+    }
+
+    // Everything now goes through the chunks, nothing of the static model is uploaded up front
+    model->vertices_number       = 0;
+    model->indices_number        = 0;
+    model->opaque_indices_number = 0;
+
+    return chunks;
+
+ERROR:
+    destroy_chunks(chunks);
+    return NULL;
+}
+
+// Allocations are left to the geometry pool, which is destroyed with the buffers
+void destroy_chunks(PChunks* chunks)
+{
+    if(chunks == NULL)
+    {
+        return;
+    }
+
+    if(chunks->worker_started)
+    {
+        pthread_mutex_lock(&chunks->mutex);
+        chunks->stopping = true;
+        pthread_cond_signal(&chunks->condition);
+        pthread_mutex_unlock(&chunks->mutex);
+        pthread_join(chunks->worker, NULL);
+    }
+    pthread_mutex_destroy(&chunks->mutex);
+    pthread_cond_destroy(&chunks->condition);
+
+    for(uint32_t i = 0; chunks->chunks != NULL && i < chunks->chunk_number; i++)
+    {
+        free(chunks->chunks[i].data);
+    }
+
+    if(chunks->file != NULL)
+    {
+        fclose(chunks->file);
+    }
+
+    free(chunks->visible_chunks);
+    free(chunks->candidates);
+    free(chunks->distances);
+    free(chunks->completed);
+    free(chunks->chunks);
+    free(chunks);
+}
+
+int compare_chunk_triangles(const void* a, const void* b)
+{
+    const ChunkTriangle* first  = a;
+    const ChunkTriangle* second = b;
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        if(first->cell[i] != second->cell[i])
+        {
+            return first->cell[i] < second->cell[i] ? -1 : 1;
+        }
+    }
+
+    return (first->triangle > second->triangle) - (first->triangle < second->triangle);
+}
+
+int compare_chunk_candidates(const void* a, const void* b)
+{
+    const ChunkCandidate* first  = a;
+    const ChunkCandidate* second = b;
+
+    return (first->distance > second->distance) - (first->distance < second->distance);
+}
+
+int split_model_into_chunks(PChunks* chunks, const PModel* model, float chunk_size)
+{
+    uint32_t triangle_number = model->indices_number / 3;
+    uint32_t chunk_size_used = 0;
+    int result               = PIGMENT_ERROR;
+
+    ChunkTriangle* triangles = malloc(triangle_number * sizeof(*triangles));
+    uint32_t* stamps         = malloc(model->vertices_number * sizeof(*stamps));
+    uint32_t* local_indices  = malloc(model->vertices_number * sizeof(*local_indices));
+    Vertex* chunk_vertices   = malloc(CHUNK_MAX_VERTICES * sizeof(*chunk_vertices));
+    uint32_t* chunk_indices  = malloc(CHUNK_MAX_INDICES * sizeof(*chunk_indices));
+    if(triangles == NULL || stamps == NULL || local_indices == NULL || chunk_vertices == NULL || chunk_indices == NULL)
+    {
+        perror("split_model_into_chunks");
+        goto FREE;
+    }
+
+    for(uint32_t i = 0; i < triangle_number; i++)
+    {
+        vec3 centroid = {0.0f, 0.0f, 0.0f};
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            glm_vec3_add(centroid, model->vertices[model->indices[i * 3 + j]].pos, centroid);
+        }
+        glm_vec3_scale(centroid, 1.0f / 3.0f, centroid);
+
+        triangles[i].triangle = i;
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            triangles[i].cell[j] = (int32_t) floorf(centroid[j] / chunk_size);
+        }
+    }
+    for(uint32_t i = 0; i < model->vertices_number; i++)
+    {
+        stamps[i] = UINT32_MAX;
+    }
+
+    // Triangles of a cell keep their order, opaque ones stay in front of alpha tested ones
+    qsort(triangles, triangle_number, sizeof(*triangles), compare_chunk_triangles);
+
+    uint32_t vertex_count       = 0;
+    uint32_t index_count        = 0;
+    uint32_t opaque_index_count = 0;
+
+    for(uint32_t i = 0; i <= triangle_number; i++)
+    {
+        // A crowded cell is split into several chunks sharing the same place
+        bool flush = i == triangle_number || (index_count > 0 && (memcmp(triangles[i].cell, triangles[i - 1].cell, sizeof(triangles[i].cell)) != 0 ||
+                                                                  vertex_count + 3 > CHUNK_MAX_VERTICES || index_count + 3 > CHUNK_MAX_INDICES));
+        if(flush && index_count > 0)
+        {
+            if(write_chunk(chunks, &chunk_size_used, chunk_vertices, vertex_count, chunk_indices, index_count, opaque_index_count) != PIGMENT_SUCCESS)
+            {
+                goto FREE;
+            }
+            vertex_count       = 0;
+            index_count        = 0;
+            opaque_index_count = 0;
+        }
+        if(i == triangle_number)
+        {
+            break;
+        }
+
+        uint32_t triangle = triangles[i].triangle;
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            uint32_t vertex = model->indices[triangle * 3 + j];
+            if(stamps[vertex] != chunks->chunk_number)
+            {
+                stamps[vertex]                 = chunks->chunk_number;
+                local_indices[vertex]          = vertex_count;
+                chunk_vertices[vertex_count++] = model->vertices[vertex];
+            }
+            chunk_indices[index_count++] = local_indices[vertex];
+        }
+        if(triangle * 3 < model->opaque_indices_number)
+        {
+            opaque_index_count += 3;
+        }
+    }
+
+    result = PIGMENT_SUCCESS;
+
+FREE:
+    free(triangles);
+    free(stamps);
+    free(local_indices);
+    free(chunk_vertices);
+    free(chunk_indices);
+    return result;
+}
+
+int write_chunk(PChunks* chunks, uint32_t* chunk_size, const Vertex* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count, uint32_t opaque_index_count)
+{
+    if(reserve_array((void**) &chunks->chunks, chunk_size, chunks->chunk_number + 1, sizeof(*chunks->chunks)) != PIGMENT_SUCCESS)
+    {
+        perror("write_chunk");
+        return PIGMENT_ERROR;
+    }
+
+    PChunk* chunk = &chunks->chunks[chunks->chunk_number];
+    *chunk = (PChunk) {
+        .file_offset        = ftell(chunks->file),
+        .vertex_count       = vertex_count,
+        .index_count        = index_count,
+        .opaque_index_count = opaque_index_count,
+        .geometry           = GEOMETRY_NO_ALLOCATION,
+        .state              = CHUNK_UNLOADED
+    };
+    compute_mesh_bounds(vertices, vertex_count, chunk->bounds);
+
+    // Vertices and indices follow each other, they are read back in a single call
+    if(fwrite(vertices, sizeof(*vertices), vertex_count, chunks->file) != vertex_count || fwrite(indices, sizeof(*indices), index_count, chunks->file) != index_count)
+    {
+        perror("write_chunk");
+        return PIGMENT_ERROR;
+    }
+
+    chunks->chunk_number++;
+    return PIGMENT_SUCCESS;
+}
+
+void* load_chunk_data(PChunks* chunks, uint32_t chunk_index)
+{
+    const PChunk* chunk = &chunks->chunks[chunk_index];
+    size_t size         = chunk->vertex_count * sizeof(Vertex) + chunk->index_count * sizeof(uint32_t);
+
+    void* data = malloc(size);
+    if(data == NULL)
+    {
+        perror("load_chunk_data");
+        return NULL;
+    }
+
+    if(fseek(chunks->file, chunk->file_offset, SEEK_SET) != 0 || fread(data, 1, size, chunks->file) != size)
+    {
+        perror("load_chunk_data");
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+void* stream_chunks(void* arg)
+{
+    PChunks* chunks = arg;
+
+    pthread_mutex_lock(&chunks->mutex);
+    while(!chunks->stopping)
+    {
+        if(chunks->request_number == 0)
+        {
+            pthread_cond_wait(&chunks->condition, &chunks->mutex);
+            continue;
+        }
+
+        // The camera moved since the older requests were queued, their distances are refreshed every frame
+        uint32_t nearest = 0;
+        for(uint32_t i = 1; i < chunks->request_number; i++)
+        {
+            if(chunks->requests[i].distance < chunks->requests[nearest].distance)
+            {
+                nearest = i;
+            }
+        }
+
+        uint32_t chunk_index      = chunks->requests[nearest].chunk;
+        chunks->requests[nearest] = chunks->requests[--chunks->request_number];
+
+        pthread_mutex_unlock(&chunks->mutex);
+        void* data = load_chunk_data(chunks, chunk_index);
+        pthread_mutex_lock(&chunks->mutex);
+
+        chunks->chunks[chunk_index].data              = data;
+        chunks->completed[chunks->completed_number++] = chunk_index;
+    }
+    pthread_mutex_unlock(&chunks->mutex);
+
+    return NULL;
+}
+
+void get_chunk_sphere(const PChunk* chunk, mat4 model_matrix, vec4 sphere)
+{
+    glm_mat4_mulv3(model_matrix, (float*) chunk->bounds, 1.0f, sphere);
+    float scale = fmaxf(glm_vec3_norm(model_matrix[0]), fmaxf(glm_vec3_norm(model_matrix[1]), glm_vec3_norm(model_matrix[2])));
+    sphere[3]   = chunk->bounds[3] * scale;
+}
+
+bool chunk_is_visible(const vec4 sphere, vec4* frustum_planes)
+{
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        if(glm_vec3_dot(frustum_planes[i], (float*) sphere) + frustum_planes[i][3] < -sphere[3])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// The pool copies the data, it is uploaded with the next frame
+bool upload_chunk(PChunk* chunk, PGeometryPool* pool)
+{
+    chunk->geometry = allocate_geometry(pool, chunk->vertex_count, chunk->index_count, true);
+    if(chunk->geometry == GEOMETRY_NO_ALLOCATION)
+    {
+        return false;
+    }
+
+    const Vertex* vertices = chunk->data;
+    if(queue_geometry_upload(pool, chunk->geometry, vertices, (const uint32_t*) &vertices[chunk->vertex_count]) != PIGMENT_SUCCESS)
+    {
+        release_geometry(pool, chunk->geometry);
+        chunk->geometry = GEOMETRY_NO_ALLOCATION;
+        return false;
+    }
+
+    free(chunk->data);
+    chunk->data  = NULL;
+    chunk->state = CHUNK_RESIDENT;
+    return true;
+}
+
+void update_chunks(PChunks* chunks, PBuffers* buffers)
+{
+    if(chunks == NULL)
+    {
+        return;
+    }
+
+    PGeometryPool* pool          = buffers->geometry_pool;
+    uint32_t upload_number       = 0;
+    chunks->visible_chunk_number = 0;
+
+    // Chunks ahead of the camera are requested as if it had already travelled a bit further
+    vec3 movement = {0.0f, 0.0f, 0.0f};
+    if(chunks->has_position)
+    {
+        glm_vec3_sub(buffers->camera_position, chunks->last_position, movement);
+        glm_vec3_scale(movement, CHUNK_PREFETCH_FRAMES, movement);
+        float length = glm_vec3_norm(movement);
+        if(length > chunks->radius)
+        {
+            glm_vec3_scale(movement, chunks->radius / length, movement);
+        }
+    }
+    vec3 prefetch_position;
+    glm_vec3_add(buffers->camera_position, movement, prefetch_position);
+    glm_vec3_copy(buffers->camera_position, chunks->last_position);
+    chunks->has_position = true;
+
+    if(!chunks->worker_started)
+    {
+        for(uint32_t i = 0; i < chunks->request_number; i++)
+        {
+            chunks->chunks[chunks->requests[i].chunk].data = load_chunk_data(chunks, chunks->requests[i].chunk);
+            chunks->completed[chunks->completed_number++]  = chunks->requests[i].chunk;
+        }
+        chunks->request_number = 0;
+    }
+
+    pthread_mutex_lock(&chunks->mutex);
+    for(uint32_t i = 0; i < chunks->completed_number; i++)
+    {
+        PChunk* chunk = &chunks->chunks[chunks->completed[i]];
+        chunk->state  = chunk->data != NULL ? CHUNK_LOADED : CHUNK_UNLOADED;
+        if(chunk->data == NULL)
+        {
+            chunks->pending_number--;
+        }
+    }
+    chunks->completed_number = 0;
+    pthread_mutex_unlock(&chunks->mutex);
+
+    uint32_t candidate_number = 0;
+    for(uint32_t i = 0; i < chunks->chunk_number; i++)
+    {
+        PChunk* chunk = &chunks->chunks[i];
+        vec4 sphere;
+        get_chunk_sphere(chunk, buffers->model_matrix, sphere);
+
+        float distance       = fminf(glm_vec3_distance(sphere, buffers->camera_position), glm_vec3_distance(sphere, prefetch_position)) - sphere[3];
+        chunks->distances[i] = distance;
+
+        // Chunks are kept a bit past the radius, so that moving back and forth along its edge does not reload them
+        bool evicted = distance > chunks->radius * CHUNK_EVICTION_MARGIN;
+
+        if(chunk->state == CHUNK_RESIDENT && evicted)
+        {
+            release_geometry(pool, chunk->geometry);
+            chunk->geometry = GEOMETRY_NO_ALLOCATION;
+            chunk->state    = CHUNK_UNLOADED;
+        }
+        else if(chunk->state == CHUNK_RESIDENT && chunk_is_visible(sphere, buffers->frustum_planes))
+        {
+            chunks->visible_chunks[chunks->visible_chunk_number++] = i;
+        }
+        else if(chunk->state == CHUNK_LOADED && evicted)
+        {
+            free(chunk->data);
+            chunk->data  = NULL;
+            chunk->state = CHUNK_UNLOADED;
+            chunks->pending_number--;
+        }
+        else if(chunk->state == CHUNK_LOADED || (chunk->state == CHUNK_UNLOADED && distance <= chunks->radius))
+        {
+            chunks->candidates[candidate_number++] = (ChunkCandidate) {
+                .distance = distance,
+                .chunk    = i
+            };
+        }
+    }
+
+    // The closest chunks are uploaded and requested first
+    qsort(chunks->candidates, candidate_number, sizeof(*chunks->candidates), compare_chunk_candidates);
+
+    uint32_t request_number = 0;
+    ChunkCandidate requests[CHUNK_QUEUE_SIZE];
+
+    for(uint32_t i = 0; i < candidate_number; i++)
+    {
+        PChunk* chunk = &chunks->chunks[chunks->candidates[i].chunk];
+
+        // A full pool keeps the chunk in memory until evicted chunks make room for it
+        if(chunk->state == CHUNK_LOADED && upload_number < CHUNK_UPLOADS_PER_FRAME && upload_chunk(chunk, pool))
+        {
+            upload_number++;
+            chunks->pending_number--;
+
+            vec4 sphere;
+            get_chunk_sphere(chunk, buffers->model_matrix, sphere);
+            if(chunk_is_visible(sphere, buffers->frustum_planes))
+            {
+                chunks->visible_chunks[chunks->visible_chunk_number++] = chunks->candidates[i].chunk;
+            }
+        }
+        else if(chunk->state == CHUNK_UNLOADED && chunks->pending_number < CHUNK_QUEUE_SIZE)
+        {
+            chunk->state               = CHUNK_QUEUED;
+            requests[request_number++] = chunks->candidates[i];
+            chunks->pending_number++;
+        }
+    }
+
+    pthread_mutex_lock(&chunks->mutex);
+    for(uint32_t i = 0; i < chunks->request_number; i++)
+    {
+        chunks->requests[i].distance = chunks->distances[chunks->requests[i].chunk];
+    }
+    if(request_number > 0)
+    {
+        memcpy(&chunks->requests[chunks->request_number], requests, request_number * sizeof(*requests));
+        chunks->request_number += request_number;
+        pthread_cond_signal(&chunks->condition);
+    }
+    pthread_mutex_unlock(&chunks->mutex);
+}
+
+// Allocations are read when the draws are recorded, after the pool was compacted and its uploads recorded for the frame
+void record_chunk_draws(VkCommandBuffer command_buffer, PChunks* chunks, PGeometryPool* pool, uint32_t material)
+{
+    for(uint32_t i = 0; chunks != NULL && i < chunks->visible_chunk_number; i++)
+    {
+        const PChunk* chunk                   = &chunks->chunks[chunks->visible_chunks[i]];
+        const PGeometryAllocation* allocation = &pool->allocations[chunk->geometry];
+        uint32_t first                        = material == MATERIAL_OPAQUE ? 0 : chunk->opaque_index_count;
+        uint32_t count                        = material == MATERIAL_OPAQUE ? chunk->opaque_index_count : chunk->index_count - chunk->opaque_index_count;
+        if(allocation->uploaded && count > 0)
+        {
+            vkCmdDrawIndexed(command_buffer, count, 1, allocation->first_index + first, (int32_t) allocation->vertex_offset, STATIC_INSTANCE);
+        }
+    }
+}
+
+// With GPU culling the chunks left by the frustum test go through the meshlet pass, which adds occlusion culling
+// Each chunk keeps its own visibility entry, after the static meshlets, since chunk indices never change
+uint32_t write_chunk_cull_entries(const PChunks* chunks, const PGeometryPool* pool, mat4 model_matrix, uint32_t first_visibility, uint32_t alpha_draw_offset, CullMeshlet* entries)
+{
+    uint32_t entry_number = 0;
+    for(uint32_t i = 0; chunks != NULL && i < chunks->visible_chunk_number; i++)
+    {
+        const PChunk* chunk                   = &chunks->chunks[chunks->visible_chunks[i]];
+        const PGeometryAllocation* allocation = &pool->allocations[chunk->geometry];
+        if(!allocation->uploaded)
+        {
+            continue;
+        }
+
+        vec4 sphere;
+        get_chunk_sphere(chunk, model_matrix, sphere);
+
+        for(uint32_t material = 0; material < MATERIAL_COUNT; material++)
+        {
+            uint32_t first = material == MATERIAL_OPAQUE ? 0 : chunk->opaque_index_count;
+            uint32_t count = material == MATERIAL_OPAQUE ? chunk->opaque_index_count : chunk->index_count - chunk->opaque_index_count;
+            if(count == 0)
+            {
+                continue;
+            }
+
+            // A cutoff of 1 never counts the chunk as back facing
+            entries[entry_number] = (CullMeshlet) {
+                .first_index   = allocation->first_index + first,
+                .index_count   = count,
+                .material      = material,
+                .draw_offset   = material == MATERIAL_OPAQUE ? 0 : alpha_draw_offset,
+                .vertex_offset = (int32_t) allocation->vertex_offset,
+                .visibility    = first_visibility + chunks->visible_chunks[i],
+                .cone          = {0.0f, 0.0f, 0.0f, 1.0f}
+            };
+            glm_vec4_copy(sphere, entries[entry_number].bounds);
+            entry_number++;
+        }
+    }
+
+    return entry_number;
+}
@@ -0,0 +1,38 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CHUNKS_H
+#define CHUNKS_H
+#define CHUNK_MAX_VERTICES 8192
+#define CHUNK_MAX_INDICES 24576
+#define CHUNK_RESIDENT_VERTICES (1u << 20)
+#define CHUNK_RESIDENT_INDICES (3u << 20)
+#define CHUNK_UPLOADS_PER_FRAME 4
+#define CHUNK_QUEUE_SIZE 64
+#define CHUNK_EVICTION_MARGIN 1.25f
+#define CHUNK_PREFETCH_FRAMES 30.0f
+#define CHUNK_UNLOADED 0
+#define CHUNK_QUEUED 1
+#define CHUNK_LOADED 2
+#define CHUNK_RESIDENT 3
+
+#include "defines.h"
+
+PChunks* create_chunks(PModel* model, float chunk_size, float radius);
+void update_chunks(PChunks* chunks, PBuffers* buffers);
+void destroy_chunks(PChunks* chunks);
+
+#endif
@@ -16,17 +16,34 @@
 
 #include "commands.h"
 #include "structs.h"
+#include "instancing.h"
+#include "culling.h"
+#include "buffers.h"
+
+#define STATISTIC_QUERIES_PER_FRAME (CULL_PHASE_COUNT * RENDER_STATISTIC_COUNT)
 
 extern QueueFamilyIndices* find_queue_families(VkPhysicalDevice device, VkSurfaceKHR surface);
+extern void record_cull_mesh_updates(VkCommandBuffer command_buffer, PCulling* culling, PBuffers* buffers);
+extern void record_culling(VkCommandBuffer command_buffer, PCulling* culling, PInstancing* instancing, PBuffers* buffers, PChunks* chunks, uint32_t frame, uint32_t phase);
+extern void record_culled_draws(VkCommandBuffer command_buffer, PCulling* culling, uint32_t frame, uint32_t phase);
+extern void record_depth_pyramid(VkCommandBuffer command_buffer, PDepthPyramid* depth_pyramid);
+extern void record_culled_meshlets(VkCommandBuffer command_buffer, PCulling* culling, uint32_t frame, uint32_t phase, uint32_t material);
+extern void record_meshlet_draws(VkCommandBuffer command_buffer, PBuffers* buffers, uint32_t frame, uint32_t material);
+extern void record_geometry_uploads(VkCommandBuffer command_buffer, PGeometryPool* pool, uint32_t frame);
+extern void record_texture_transfers(VkCommandBuffer command_buffer, PTextureList* texture_list);
+extern void record_chunk_draws(VkCommandBuffer command_buffer, PChunks* chunks, PGeometryPool* pool, uint32_t material);
 
 
 VkCommandPool create_command_pool(PDevice* device, PSurface* surface);
 VkCommandBuffer* create_command_buffers(VkCommandPool command_pool, PDevice* device, const uint32_t command_buffers_numbers);
-void record_commands(VkCommandBuffer command_buffer, PPipeline* pipeline, PSwapchain* swapchain, PRenderPass* render_pass, uint32_t image_index, PBuffers* buffers, PDescriptor* descriptor);
+void record_commands(VkCommandBuffer command_buffer, PCommands* commands, PPipeline* pipeline, PSwapchain* swapchain, PRenderPass* render_pass, uint32_t image_index, PBuffers* buffers, PTextureList* textures, PInstancing* instancing, PCulling* culling, PChunks* chunks, PDescriptor* descriptor);
+void record_scene(VkCommandBuffer command_buffer, PCommands* commands, PPipeline* pipeline, PBuffers* buffers, PInstancing* instancing, PCulling* culling, PChunks* chunks, uint32_t frame, uint32_t phase);
+void record_scene_draws(VkCommandBuffer command_buffer, const VkPipeline* graphic_pipelines, PPipeline* pipeline, PBuffers* buffers, PInstancing* instancing, PCulling* culling, PChunks* chunks, uint32_t frame, uint32_t phase);
+VkQueryPool create_statistics_pool(PDevice* device, const uint32_t frame_count);
 
 PCommands* create_commands(PDevice* device, PSurface* surface)
 {
-    PCommands* commands = malloc(sizeof(*commands));
+    PCommands* commands = calloc(1, sizeof(*commands));
     if(commands == NULL)
     {
         perror("malloc");
@@ -44,6 +61,45 @@ void update_commands(PCommands* commands, PDevice* device, const uint32_t comman
 {
     VkCommandBuffer* command_buffers = create_command_buffers(commands->command_pool, device, command_buffers_numbers);
     commands->command_buffers        = command_buffers;
+
+    if(device->pipeline_statistics)
+    {
+        commands->recorded_statistics = calloc(command_buffers_numbers, sizeof(*commands->recorded_statistics));
+        if(commands->recorded_statistics == NULL)
+        {
+            perror("malloc");
+            return;
+        }
+        commands->statistics_pool = create_statistics_pool(device, command_buffers_numbers);
+    }
+}
+
+void read_render_statistics(PCommands* commands, PDevice* device, uint32_t frame)
+{
+    if(commands->statistics_pool == NULL || commands->recorded_statistics[frame] == 0)
+    {
+        return;
+    }
+
+    uint64_t fragment_invocations[RENDER_STATISTIC_COUNT] = {0};
+    for(uint32_t i = 0; i < STATISTIC_QUERIES_PER_FRAME; i++)
+    {
+        if((commands->recorded_statistics[frame] & (1u << i)) == 0)
+        {
+            continue;
+        }
+
+        // The frame fence was waited on, but the results still come with their availability to stay on the safe side
+        uint64_t result[2];
+        VkResult query_result = vkGetQueryPoolResults(device->logical_device, commands->statistics_pool, frame * STATISTIC_QUERIES_PER_FRAME + i, 1, sizeof(result), result, sizeof(result), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if(query_result != VK_SUCCESS || result[1] == 0)
+        {
+            return;
+        }
+        fragment_invocations[i % RENDER_STATISTIC_COUNT] += result[0];
+    }
+
+    memcpy(commands->fragment_invocations, fragment_invocations, sizeof(fragment_invocations));
 }
 
 void destroy_commands(PCommands* commands, PDevice* device, const uint32_t command_buffers_numbers)
@@ -54,11 +110,13 @@ void destroy_commands(PCommands* commands, PDevice* device, const uint32_t comma
     }
     vkFreeCommandBuffers(device->logical_device, commands->command_pool, command_buffers_numbers, commands->command_buffers);
     free(commands->command_buffers);
+    vkDestroyQueryPool(device->logical_device, commands->statistics_pool, NULL);
+    free(commands->recorded_statistics);
     vkDestroyCommandPool(device->logical_device, commands->command_pool, NULL);
     free(commands);
 }
 
-void record_commands(VkCommandBuffer command_buffer, PPipeline* pipeline, PSwapchain* swapchain, PRenderPass* render_pass, uint32_t image_index, PBuffers* buffers, PDescriptor* descriptor)
+void record_commands(VkCommandBuffer command_buffer, PCommands* commands, PPipeline* pipeline, PSwapchain* swapchain, PRenderPass* render_pass, uint32_t image_index, PBuffers* buffers, PTextureList* textures, PInstancing* instancing, PCulling* culling, PChunks* chunks, PDescriptor* descriptor)
 {
     VkCommandBufferBeginInfo command_buffer_begin_info = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO
@@ -93,9 +151,22 @@ void record_commands(VkCommandBuffer command_buffer, PPipeline* pipeline, PSwapc
         .pClearValues    = clear_values
     };
 
-    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    if(commands->statistics_pool != NULL)
+    {
+        vkCmdResetQueryPool(command_buffer, commands->statistics_pool, swapchain->current_frame * STATISTIC_QUERIES_PER_FRAME, STATISTIC_QUERIES_PER_FRAME);
+        commands->recorded_statistics[swapchain->current_frame] = 0;
+    }
+
+    record_texture_transfers(command_buffer, textures);
+    record_geometry_uploads(command_buffer, buffers->geometry_pool, swapchain->current_frame);
+    record_cull_mesh_updates(command_buffer, culling, buffers);
+
+    if(culling != NULL)
+    {
+        record_culling(command_buffer, culling, instancing, buffers, chunks, swapchain->current_frame, CULL_PHASE_EARLY);
+    }
 
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->graphic_pipeline);
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
     VkViewport viewport = {
         viewport.x        = 0.0f,
@@ -114,21 +185,154 @@ void record_commands(VkCommandBuffer command_buffer, PPipeline* pipeline, PSwapc
     vkCmdSetViewport(command_buffer, 0, 1, &viewport);
     vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    VkBuffer vertex_buffers[] = {buffers->vertex_buffer};
+    // Every draw reads from the geometry pool, bound once for the whole frame
+    VkBuffer vertex_buffers[] = {buffers->geometry_pool->vertex_buffer};
     VkDeviceSize offsets[]    = {0};
     vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
-    vkCmdBindIndexBuffer(command_buffer, buffers->index_buffer, 0, VK_INDEX_TYPE_UINT32);
-    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline_layout, 0, 1, &descriptor->descriptor_sets[swapchain->current_frame], 0, NULL);
-    vkCmdDrawIndexed(command_buffer, buffers->indices_size, 1, 0, 0, 0);
+    vkCmdBindIndexBuffer(command_buffer, buffers->geometry_pool->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    VkDescriptorSet descriptor_sets[DESCRIPTOR_SET_COUNT] = {
+        [DESCRIPTOR_SET_TEXTURES] = descriptor->texture_set,
+        [DESCRIPTOR_SET_FRAME]    = descriptor->frame_sets[swapchain->current_frame]
+    };
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline_layout, 0, DESCRIPTOR_SET_COUNT, descriptor_sets, 1, &buffers->uniform_offset);
+
+    record_scene(command_buffer, commands, pipeline, buffers, instancing, culling, chunks, swapchain->current_frame, CULL_PHASE_EARLY);
 
     vkCmdEndRenderPass(command_buffer);
 
+    if(culling != NULL)
+    {
+        // Everything is tested again against the depth drawn so far, the instances and meshlets that turned visible are added on top
+        record_depth_pyramid(command_buffer, culling->depth_pyramid);
+        record_culling(command_buffer, culling, instancing, buffers, chunks, swapchain->current_frame, CULL_PHASE_LATE);
+
+        render_pass_begin_info.renderPass = render_pass->late_render_pass;
+        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+        record_scene(command_buffer, commands, pipeline, buffers, instancing, culling, chunks, swapchain->current_frame, CULL_PHASE_LATE);
+
+        vkCmdEndRenderPass(command_buffer);
+    }
+
+    if(descriptor->texture_feedback)
+    {
+        // Mip requests written by the fragment shader are read on the host after the frame fence
+        VkMemoryBarrier feedback_barrier = {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT
+        };
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &feedback_barrier, 0, NULL, 0, NULL);
+    }
+
     if(vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
     {
         fprintf(stderr, "Failed to record command buffer!\n");
     }
 }
 
+void record_scene(VkCommandBuffer command_buffer, PCommands* commands, PPipeline* pipeline, PBuffers* buffers, PInstancing* instancing, PCulling* culling, PChunks* chunks, uint32_t frame, uint32_t phase)
+{
+    const VkPipeline* graphic_pipelines[RENDER_STATISTIC_COUNT] = {
+        [RENDER_STATISTIC_PREPASS] = pipeline->depth_prepass_pipelines,
+        [RENDER_STATISTIC_SHADED]  = pipeline->graphic_pipelines
+    };
+
+    // The pre-pass lays down the final depth, the main pass then only shades the fragments that match it
+    for(uint32_t i = 0; i < RENDER_STATISTIC_COUNT; i++)
+    {
+        if(graphic_pipelines[i][MATERIAL_ALPHA_TESTED] == NULL)
+        {
+            continue;
+        }
+
+        uint32_t query = (phase * RENDER_STATISTIC_COUNT) + i;
+        if(commands->statistics_pool != NULL)
+        {
+            vkCmdBeginQuery(command_buffer, commands->statistics_pool, frame * STATISTIC_QUERIES_PER_FRAME + query, 0);
+        }
+
+        record_scene_draws(command_buffer, graphic_pipelines[i], pipeline, buffers, instancing, culling, chunks, frame, phase);
+
+        if(commands->statistics_pool != NULL)
+        {
+            vkCmdEndQuery(command_buffer, commands->statistics_pool, frame * STATISTIC_QUERIES_PER_FRAME + query);
+            commands->recorded_statistics[frame] |= 1u << query;
+        }
+    }
+}
+
+void record_scene_draws(VkCommandBuffer command_buffer, const VkPipeline* graphic_pipelines, PPipeline* pipeline, PBuffers* buffers, PInstancing* instancing, PCulling* culling, PChunks* chunks, uint32_t frame, uint32_t phase)
+{
+    ModelConstants model_constants;
+
+    // The static model is drawn as the meshlets and chunks that survived culling, opaque ones first to keep early depth testing
+    // GPU culling splits them between both phases like instances, otherwise they are all drawn in the first one
+    if((phase == CULL_PHASE_EARLY || culling != NULL) && (buffers->meshlet_number > 0 || chunks != NULL))
+    {
+        glm_mat4_ucopy(buffers->model_matrix, model_constants.model);
+        vkCmdPushConstants(command_buffer, pipeline->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(model_constants), &model_constants);
+
+        for(uint32_t i = 0; i < MATERIAL_COUNT; i++)
+        {
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphic_pipelines[i]);
+            if(culling != NULL)
+            {
+                record_culled_meshlets(command_buffer, culling, frame, phase, i);
+            }
+            else
+            {
+                record_meshlet_draws(command_buffer, buffers, frame, i);
+                record_chunk_draws(command_buffer, chunks, buffers->geometry_pool, i);
+            }
+        }
+    }
+
+    // Instance textures can change at any time, they always go through the alpha tested pipeline
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphic_pipelines[MATERIAL_ALPHA_TESTED]);
+
+    // Instances carry their own transform, one draw per level of detail of each mesh covers its instances
+    glm_mat4_identity(model_constants.model);
+    vkCmdPushConstants(command_buffer, pipeline->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(model_constants), &model_constants);
+
+    if(culling != NULL)
+    {
+        record_culled_draws(command_buffer, culling, frame, phase);
+    }
+    // Meshes added while running are skipped until their geometry has been uploaded
+    for(uint32_t i = 0; culling == NULL && i < buffers->mesh_number * MAX_MESH_LODS; i++)
+    {
+        if(instancing->batch_counts[i] > 0 && is_mesh_ready(buffers, i / MAX_MESH_LODS))
+        {
+            PMesh* mesh   = &buffers->meshes[i / MAX_MESH_LODS];
+            PMeshLod* lod = &mesh->lods[i % MAX_MESH_LODS];
+            vkCmdDrawIndexed(command_buffer, lod->index_count, instancing->batch_counts[i], lod->first_index, mesh->vertex_offset, instancing->batch_offsets[i]);
+        }
+    }
+}
+
+VkQueryPool create_statistics_pool(PDevice* device, const uint32_t frame_count)
+{
+    VkQueryPool statistics_pool = NULL;
+
+    VkQueryPoolCreateInfo query_pool_create_info = {
+        .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount         = frame_count * STATISTIC_QUERIES_PER_FRAME,
+        .pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+    };
+
+    if(vkCreateQueryPool(device->logical_device, &query_pool_create_info, NULL, &statistics_pool) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create statistics query pool!\n");
+        return NULL;
+    }
+
+    return statistics_pool;
+}
+
 VkCommandPool create_command_pool(PDevice* device, PSurface* surface)
 {
     VkCommandPool command_pool = NULL;
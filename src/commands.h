@@ -16,11 +16,15 @@
 
 #ifndef COMMANDS_H
 #define COMMANDS_H
+#define RENDER_STATISTIC_PREPASS 0
+#define RENDER_STATISTIC_SHADED 1
+#define RENDER_STATISTIC_COUNT 2
 
 #include "defines.h"
 
 PCommands* create_commands(PDevice* device, PSurface* surface);
 void update_commands(PCommands* commands, PDevice* device, const uint32_t command_buffers_numbers);
+void read_render_statistics(PCommands* commands, PDevice* device, uint32_t frame);
 void destroy_commands(PCommands* commands, PDevice* device, const uint32_t command_buffers_numbers);
 
 #endif
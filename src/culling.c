@@ -0,0 +1,692 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "culling.h"
+#include "structs.h"
+#include "shaders.h"
+#include "instancing.h"
+#include "depth_pyramid.h"
+#include "buffers.h"
+
+#include "lib/array.h"
+
+extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
+extern int create_device_local_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, void** buffer_mapped, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkCommandPool command_pool, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+extern uint32_t write_chunk_cull_entries(const PChunks* chunks, const PGeometryPool* pool, mat4 model_matrix, uint32_t first_visibility, uint32_t alpha_draw_offset, CullMeshlet* entries);
+
+int create_cull_pipeline(PCulling* culling, PDevice* device);
+int create_cull_descriptors(PCulling* culling, PDevice* device);
+int create_cull_buffers(PCulling* culling, PBuffers* buffers, PCommands* commands, PDevice* device);
+void write_cull_descriptor_set(PCulling* culling, PInstancing* instancing, PBuffers* buffers, PDevice* device, uint32_t frame);
+void fill_cull_mesh(PMesh* mesh, CullMesh* cull_mesh);
+void record_cull_mesh_updates(VkCommandBuffer command_buffer, PCulling* culling, PBuffers* buffers);
+void record_culling(VkCommandBuffer command_buffer, PCulling* culling, PInstancing* instancing, PBuffers* buffers, PChunks* chunks, uint32_t frame, uint32_t phase);
+void record_culled_draws(VkCommandBuffer command_buffer, PCulling* culling, uint32_t frame, uint32_t phase);
+void record_culled_meshlets(VkCommandBuffer command_buffer, PCulling* culling, uint32_t frame, uint32_t phase, uint32_t material);
+
+PCulling* create_culling(PBuffers* buffers, PInstancing* instancing, PChunks* chunks, PSwapchain* swapchain, PCommands* commands, PDevice* device, uint32_t frame_count)
+{
+    PCulling* culling = calloc(1, sizeof(*culling));
+    if(culling == NULL)
+    {
+        perror("create_culling");
+        return NULL;
+    }
+
+    culling->mesh_number           = buffers->mesh_capacity;
+    culling->meshlet_number        = buffers->meshlet_number;
+    culling->opaque_meshlet_number = buffers->opaque_meshlet_number;
+    culling->chunk_number          = chunks != NULL ? chunks->chunk_number : 0;
+    culling->frame_count           = frame_count;
+
+    // Each material of a phase has room for all its meshlets and one entry per chunk
+    culling->meshlet_draw_capacity = culling->meshlet_number + MATERIAL_COUNT * culling->chunk_number;
+
+    // Nothing has been drawn yet, so every instance and meshlet starts as occluded and is tested in the late phase
+    culling->reset_visibility         = (1u << frame_count) - 1u;
+    culling->reset_meshlet_visibility = (1u << frame_count) - 1u;
+
+    culling->draw_indexed_indirect_count = (PFN_vkCmdDrawIndexedIndirectCountKHR) vkGetDeviceProcAddr(device->logical_device, "vkCmdDrawIndexedIndirectCountKHR");
+    if(culling->draw_indexed_indirect_count == NULL)
+    {
+        fprintf(stderr, "Failed to load vkCmdDrawIndexedIndirectCountKHR!\n");
+        goto ERROR;
+    }
+
+    culling->depth_pyramid = create_depth_pyramid(swapchain, device, frame_count);
+    if(culling->depth_pyramid == NULL)
+    {
+        goto ERROR;
+    }
+
+    if(create_cull_descriptors(culling, device) != PIGMENT_SUCCESS || create_cull_pipeline(culling, device) != PIGMENT_SUCCESS ||
+       create_cull_buffers(culling, buffers, commands, device) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+
+    for(uint32_t i = 0; i < frame_count; i++)
+    {
+        write_cull_descriptor_set(culling, instancing, buffers, device, i);
+    }
+
+    return culling;
+
+ERROR:
+    destroy_culling(culling, device);
+    return NULL;
+}
+
+void destroy_culling(PCulling* culling, PDevice* device)
+{
+    if(culling == NULL)
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; culling->batch_buffers != NULL && culling->batch_buffers_memory != NULL && i < culling->frame_count; i++)
+    {
+        vkDestroyBuffer(device->logical_device, culling->batch_buffers[i], NULL);
+        free_device_memory(culling->batch_buffers_memory[i], device);
+    }
+    for(uint32_t i = 0; culling->draw_buffers != NULL && culling->draw_buffers_memory != NULL && i < culling->frame_count; i++)
+    {
+        vkDestroyBuffer(device->logical_device, culling->draw_buffers[i], NULL);
+        free_device_memory(culling->draw_buffers_memory[i], device);
+    }
+    for(uint32_t i = 0; culling->meshlet_visibility_buffers != NULL && culling->meshlet_visibility_buffers_memory != NULL && i < culling->frame_count; i++)
+    {
+        vkDestroyBuffer(device->logical_device, culling->meshlet_visibility_buffers[i], NULL);
+        free_device_memory(culling->meshlet_visibility_buffers_memory[i], device);
+    }
+    for(uint32_t i = 0; culling->chunk_buffers != NULL && culling->chunk_buffers_memory != NULL && i < culling->frame_count; i++)
+    {
+        if(culling->chunk_buffers_mapped != NULL && culling->chunk_buffers_mapped[i] != NULL)
+        {
+            vkUnmapMemory(device->logical_device, culling->chunk_buffers_memory[i]);
+        }
+        vkDestroyBuffer(device->logical_device, culling->chunk_buffers[i], NULL);
+        free_device_memory(culling->chunk_buffers_memory[i], device);
+    }
+
+    if(culling->mesh_buffer_mapped != NULL)
+    {
+        vkUnmapMemory(device->logical_device, culling->mesh_buffer_memory);
+    }
+    vkDestroyBuffer(device->logical_device, culling->mesh_buffer, NULL);
+    free_device_memory(culling->mesh_buffer_memory, device);
+
+    if(culling->meshlet_buffer_mapped != NULL)
+    {
+        vkUnmapMemory(device->logical_device, culling->meshlet_buffer_memory);
+    }
+    vkDestroyBuffer(device->logical_device, culling->meshlet_buffer, NULL);
+    free_device_memory(culling->meshlet_buffer_memory, device);
+
+    destroy_depth_pyramid(culling->depth_pyramid, device);
+    vkDestroyPipeline(device->logical_device, culling->pipeline, NULL);
+    vkDestroyPipelineLayout(device->logical_device, culling->pipeline_layout, NULL);
+    vkDestroyDescriptorPool(device->logical_device, culling->descriptor_pool, NULL);
+    vkDestroyDescriptorSetLayout(device->logical_device, culling->descriptor_set_layout, NULL);
+
+    free(culling->pending_meshes);
+    free(culling->batch_buffers);
+    free(culling->batch_buffers_memory);
+    free(culling->draw_buffers);
+    free(culling->draw_buffers_memory);
+    free(culling->meshlet_visibility_buffers);
+    free(culling->meshlet_visibility_buffers_memory);
+    free(culling->chunk_buffers);
+    free(culling->chunk_buffers_memory);
+    free(culling->chunk_buffers_mapped);
+    free(culling->descriptor_sets);
+    free(culling);
+}
+
+int create_cull_descriptors(PCulling* culling, PDevice* device)
+{
+    // Instances, visible lists, meshes, per mesh batches, draw commands and visibility, then the camera, the depth pyramid,
+    // the static meshlets with their visibility and the resident chunks of the frame
+    VkDescriptorSetLayoutBinding bindings[CULL_BINDING_COUNT];
+    for(uint32_t i = 0; i < CULL_BINDING_COUNT; i++)
+    {
+        bindings[i] = (VkDescriptorSetLayoutBinding) {
+            .binding            = i,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount    = 1,
+            .pImmutableSamplers = NULL,
+            .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT
+        };
+    }
+    bindings[CULL_BINDING_UNIFORMS].descriptorType      = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[CULL_BINDING_DEPTH_PYRAMID].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+        .pBindings    = bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(device->logical_device, &layout_info, NULL, &culling->descriptor_set_layout) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create culling descriptor set layout!\n");
+        return PIGMENT_ERROR;
+    }
+
+    VkDescriptorPoolSize pool_sizes[] = {
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = culling->frame_count * (CULL_BINDING_COUNT - 2)
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = culling->frame_count
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = culling->frame_count
+        }
+    };
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]),
+        .pPoolSizes    = pool_sizes,
+        .maxSets       = culling->frame_count
+    };
+
+    if(vkCreateDescriptorPool(device->logical_device, &pool_info, NULL, &culling->descriptor_pool) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create culling descriptor pool!\n");
+        return PIGMENT_ERROR;
+    }
+
+    VkDescriptorSetLayout* layouts = malloc(culling->frame_count * sizeof(*layouts));
+    culling->descriptor_sets       = malloc(culling->frame_count * sizeof(*culling->descriptor_sets));
+    if(layouts == NULL || culling->descriptor_sets == NULL)
+    {
+        perror("create_cull_descriptors");
+        free(layouts);
+        return PIGMENT_ERROR;
+    }
+
+    for(uint32_t i = 0; i < culling->frame_count; i++)
+    {
+        layouts[i] = culling->descriptor_set_layout;
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = culling->descriptor_pool,
+        .descriptorSetCount = culling->frame_count,
+        .pSetLayouts        = layouts
+    };
+
+    VkResult result = vkAllocateDescriptorSets(device->logical_device, &alloc_info, culling->descriptor_sets);
+    free(layouts);
+    if(result != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to allocate culling descriptor sets!\n");
+        return PIGMENT_ERROR;
+    }
+
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset     = 0,
+        .size       = sizeof(CullConstants)
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &culling->descriptor_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &push_constant_range
+    };
+
+    if(vkCreatePipelineLayout(device->logical_device, &pipeline_layout_info, NULL, &culling->pipeline_layout) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create culling pipeline layout!\n");
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+int create_cull_pipeline(PCulling* culling, PDevice* device)
+{
+    char* shader_code = NULL;
+    uint32_t* shader_spv = NULL;
+    VkShaderModule shader_module = NULL;
+    uint32_t shader_code_size;
+    uint32_t shader_spv_size;
+
+    shader_code = get_shader_code("shaders/cull.comp", &shader_code_size);
+    if(shader_code == NULL)
+    {
+        const char* default_code[] = {DEFAULT_CULL_COMPUTE_SHADER_DECLARATIONS, DEFAULT_CULL_COMPUTE_SHADER_FUNCTIONS, DEFAULT_CULL_COMPUTE_SHADER_MAIN};
+        shader_code = join_shader_code(default_code, sizeof(default_code) / sizeof(default_code[0]), &shader_code_size);
+        if(shader_code == NULL)
+        {
+            goto ERROR;
+        }
+    }
+
+    shader_spv = compile_glsl_to_spv(shader_code, shader_code_size, shaderc_glsl_compute_shader, "shaders/cull.spv", NULL, &shader_spv_size);
+    if(shader_spv == NULL)
+    {
+        fprintf(stderr, "Failed to compile culling compute shader to SPIR-V.\n");
+        goto ERROR;
+    }
+
+    shader_module = create_shader_module(device->logical_device, shader_spv, shader_spv_size);
+    if(shader_module == NULL)
+    {
+        goto ERROR;
+    }
+
+    VkComputePipelineCreateInfo pipeline_create_info = {
+        .sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+        .stage.module = shader_module,
+        .stage.pName  = "main",
+        .layout       = culling->pipeline_layout
+    };
+
+    if(vkCreateComputePipelines(device->logical_device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &culling->pipeline) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create culling compute pipeline!\n");
+        goto ERROR;
+    }
+
+    vkDestroyShaderModule(device->logical_device, shader_module, NULL);
+    free(shader_spv);
+    free(shader_code);
+
+    return PIGMENT_SUCCESS;
+
+ERROR:
+    if(shader_module != NULL)
+        vkDestroyShaderModule(device->logical_device, shader_module, NULL);
+    free(shader_spv);
+    free(shader_code);
+    return PIGMENT_ERROR;
+}
+
+int create_cull_buffers(PCulling* culling, PBuffers* buffers, PCommands* commands, PDevice* device)
+{
+    // Every mesh slot has an entry, the free ones draw nothing until a mesh is added to them
+    CullMesh* meshes = calloc(culling->mesh_number, sizeof(*meshes));
+    if(meshes == NULL)
+    {
+        perror("create_cull_buffers");
+        return PIGMENT_ERROR;
+    }
+
+    for(uint32_t i = 0; i < buffers->mesh_number; i++)
+    {
+        fill_cull_mesh(&buffers->meshes[i], &meshes[i]);
+    }
+
+    int result = create_device_local_buffer(&culling->mesh_buffer, &culling->mesh_buffer_memory, &culling->mesh_buffer_mapped, meshes, culling->mesh_number * sizeof(*meshes), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, commands->command_pool, device);
+    free(meshes);
+    if(result != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    // The binding needs a buffer even when the static model is empty
+    CullMeshlet* meshlets = calloc(culling->meshlet_number > 0 ? culling->meshlet_number : 1, sizeof(*meshlets));
+    if(meshlets == NULL)
+    {
+        perror("create_cull_buffers");
+        return PIGMENT_ERROR;
+    }
+
+    for(uint32_t i = 0; i < culling->meshlet_number; i++)
+    {
+        meshlets[i] = (CullMeshlet) {
+            .first_index = buffers->meshlets[i].first_index,
+            .index_count = buffers->meshlets[i].index_count,
+            .material    = buffers->meshlets[i].material,
+            .draw_offset = buffers->meshlets[i].material == MATERIAL_OPAQUE ? 0 : culling->opaque_meshlet_number + culling->chunk_number,
+            .visibility  = i
+        };
+        glm_vec4_ucopy(buffers->meshlets[i].bounds, meshlets[i].bounds);
+        glm_vec4_ucopy(buffers->meshlets[i].cone, meshlets[i].cone);
+    }
+
+    result = create_device_local_buffer(&culling->meshlet_buffer, &culling->meshlet_buffer_memory, &culling->meshlet_buffer_mapped, meshlets, (culling->meshlet_number > 0 ? culling->meshlet_number : 1) * sizeof(*meshlets), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, commands->command_pool, device);
+    free(meshlets);
+    if(result != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    culling->batch_buffers                     = calloc(culling->frame_count, sizeof(*culling->batch_buffers));
+    culling->batch_buffers_memory              = calloc(culling->frame_count, sizeof(*culling->batch_buffers_memory));
+    culling->draw_buffers                      = calloc(culling->frame_count, sizeof(*culling->draw_buffers));
+    culling->draw_buffers_memory               = calloc(culling->frame_count, sizeof(*culling->draw_buffers_memory));
+    culling->meshlet_visibility_buffers        = calloc(culling->frame_count, sizeof(*culling->meshlet_visibility_buffers));
+    culling->meshlet_visibility_buffers_memory = calloc(culling->frame_count, sizeof(*culling->meshlet_visibility_buffers_memory));
+    culling->chunk_buffers                     = calloc(culling->frame_count, sizeof(*culling->chunk_buffers));
+    culling->chunk_buffers_memory              = calloc(culling->frame_count, sizeof(*culling->chunk_buffers_memory));
+    culling->chunk_buffers_mapped              = calloc(culling->frame_count, sizeof(*culling->chunk_buffers_mapped));
+    if(culling->batch_buffers == NULL || culling->batch_buffers_memory == NULL || culling->draw_buffers == NULL || culling->draw_buffers_memory == NULL ||
+       culling->meshlet_visibility_buffers == NULL || culling->meshlet_visibility_buffers_memory == NULL ||
+       culling->chunk_buffers == NULL || culling->chunk_buffers_memory == NULL || culling->chunk_buffers_mapped == NULL)
+    {
+        perror("create_cull_buffers");
+        return PIGMENT_ERROR;
+    }
+
+    // The draw count of each phase and of each meshlet material of each phase sit in front of the per mesh counters
+    // Instances are batched per level of detail of each mesh
+    VkDeviceSize batch_size = (CULL_PHASE_COUNT + CULL_PHASE_COUNT * MATERIAL_COUNT) * sizeof(uint32_t) + CULL_PHASE_COUNT * culling->mesh_number * MAX_MESH_LODS * 2 * sizeof(uint32_t);
+    VkDeviceSize draw_size  = CULL_PHASE_COUNT * (culling->mesh_number * MAX_MESH_LODS + culling->meshlet_draw_capacity) * sizeof(VkDrawIndexedIndirectCommand);
+
+    // The bindings need buffers even without meshlets or chunks
+    uint32_t visibility_number   = culling->meshlet_number + culling->chunk_number;
+    VkDeviceSize visibility_size = (visibility_number > 0 ? visibility_number : 1) * sizeof(uint32_t);
+    VkDeviceSize chunk_size      = (culling->chunk_number > 0 ? MATERIAL_COUNT * culling->chunk_number : 1) * sizeof(CullMeshlet);
+
+    for(uint32_t i = 0; i < culling->frame_count; i++)
+    {
+        if(create_buffer(&culling->batch_buffers[i], &culling->batch_buffers_memory[i], batch_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+        if(create_buffer(&culling->draw_buffers[i], &culling->draw_buffers_memory[i], draw_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+        if(create_buffer(&culling->meshlet_visibility_buffers[i], &culling->meshlet_visibility_buffers_memory[i], visibility_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+
+        // Chunk entries are written by the host when the frame is recorded, see record_culling
+        if(create_buffer(&culling->chunk_buffers[i], &culling->chunk_buffers_memory[i], chunk_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+        if(vkMapMemory(device->logical_device, culling->chunk_buffers_memory[i], 0, chunk_size, 0, &culling->chunk_buffers_mapped[i]) != VK_SUCCESS)
+        {
+            fprintf(stderr, "Failed to map chunk culling buffer!\n");
+            return PIGMENT_ERROR;
+        }
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+void write_cull_descriptor_set(PCulling* culling, PInstancing* instancing, PBuffers* buffers, PDevice* device, uint32_t frame)
+{
+    VkBuffer storage_buffers[] = {
+        [CULL_BINDING_INSTANCES]          = instancing->frame_buffers[frame].buffer,
+        [CULL_BINDING_VISIBLE_INSTANCES]  = instancing->frame_buffers[frame].visible_buffer,
+        [CULL_BINDING_MESHES]             = culling->mesh_buffer,
+        [CULL_BINDING_BATCHES]            = culling->batch_buffers[frame],
+        [CULL_BINDING_DRAWS]              = culling->draw_buffers[frame],
+        [CULL_BINDING_VISIBILITY]         = instancing->frame_buffers[frame].visibility_buffer,
+        [CULL_BINDING_UNIFORMS]           = buffers->uniform_buffer,
+        [CULL_BINDING_MESHLETS]           = culling->meshlet_buffer,
+        [CULL_BINDING_MESHLET_VISIBILITY] = culling->meshlet_visibility_buffers[frame],
+        [CULL_BINDING_CHUNKS]             = culling->chunk_buffers[frame]
+    };
+
+    VkDescriptorBufferInfo buffer_infos[CULL_BINDING_COUNT];
+    VkWriteDescriptorSet descriptor_writes[CULL_BINDING_COUNT];
+    for(uint32_t i = 0; i < CULL_BINDING_COUNT; i++)
+    {
+        buffer_infos[i] = (VkDescriptorBufferInfo) {
+            .buffer = storage_buffers[i],
+            .offset = 0,
+            .range  = i == CULL_BINDING_UNIFORMS ? sizeof(UniformBufferObject) : VK_WHOLE_SIZE
+        };
+
+        descriptor_writes[i] = (VkWriteDescriptorSet) {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = culling->descriptor_sets[frame],
+            .dstBinding      = i,
+            .dstArrayElement = 0,
+            .descriptorType  = i == CULL_BINDING_UNIFORMS ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo     = &buffer_infos[i]
+        };
+    }
+
+    VkDescriptorImageInfo pyramid_info = {
+        .sampler     = culling->depth_pyramid->sampler,
+        .imageView   = culling->depth_pyramid->image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+    };
+
+    descriptor_writes[CULL_BINDING_DEPTH_PYRAMID].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptor_writes[CULL_BINDING_DEPTH_PYRAMID].pBufferInfo    = NULL;
+    descriptor_writes[CULL_BINDING_DEPTH_PYRAMID].pImageInfo     = &pyramid_info;
+
+    vkUpdateDescriptorSets(device->logical_device, CULL_BINDING_COUNT, descriptor_writes, 0, NULL);
+}
+
+void update_culling(PCulling* culling, PInstancing* instancing, PBuffers* buffers, PDevice* device, uint32_t frame)
+{
+    if(!((instancing->resized_frames | culling->resized_pyramid_frames) & (1u << frame)))
+    {
+        return;
+    }
+
+    // The new visibility buffer holds nothing from previous frames
+    if(instancing->resized_frames & (1u << frame))
+    {
+        culling->reset_visibility |= 1u << frame;
+    }
+    write_cull_descriptor_set(culling, instancing, buffers, device, frame);
+    instancing->resized_frames      &= ~(1u << frame);
+    culling->resized_pyramid_frames &= ~(1u << frame);
+}
+
+int resize_culling(PCulling* culling, PSwapchain* swapchain, PDevice* device)
+{
+    if(resize_depth_pyramid(culling->depth_pyramid, swapchain, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    // The set of each frame is rewritten once its fence has been waited on
+    culling->resized_pyramid_frames = (1u << culling->frame_count) - 1u;
+
+    return PIGMENT_SUCCESS;
+}
+
+void fill_cull_mesh(PMesh* mesh, CullMesh* cull_mesh)
+{
+    *cull_mesh = (CullMesh) {
+        .vertex_offset = mesh->vertex_offset,
+        .lod_count     = mesh->lod_count
+    };
+    glm_vec4_ucopy(mesh->bounds, cull_mesh->bounds);
+    for(uint32_t i = 0; i < mesh->lod_count; i++)
+    {
+        cull_mesh->lod_errors[i]      = mesh->lods[i].error;
+        cull_mesh->lod_first_index[i] = mesh->lods[i].first_index;
+        cull_mesh->lod_index_count[i] = mesh->lods[i].index_count;
+    }
+}
+
+void update_cull_mesh(PCulling* culling, uint32_t mesh_index)
+{
+    for(uint32_t i = 0; i < culling->pending_mesh_number; i++)
+    {
+        if(culling->pending_meshes[i] == mesh_index)
+        {
+            return;
+        }
+    }
+
+    if(push_free_index(&culling->pending_meshes, &culling->pending_mesh_number, &culling->pending_mesh_size, mesh_index) != PIGMENT_SUCCESS)
+    {
+        perror("update_cull_mesh");
+    }
+}
+
+void record_cull_mesh_updates(VkCommandBuffer command_buffer, PCulling* culling, PBuffers* buffers)
+{
+    if(culling == NULL || culling->pending_mesh_number == 0)
+    {
+        return;
+    }
+
+    // The previous frames may still be reading the entries from their culling pass
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0, NULL);
+
+    // A mesh whose geometry has not been uploaded yet keeps an empty entry, and is written again on the next frame
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < culling->pending_mesh_number; i++)
+    {
+        uint32_t mesh_index = culling->pending_meshes[i];
+        bool ready          = is_mesh_ready(buffers, mesh_index);
+        CullMesh cull_mesh  = {0};
+        if(ready)
+        {
+            fill_cull_mesh(&buffers->meshes[mesh_index], &cull_mesh);
+        }
+        else if(has_mesh(buffers, mesh_index))
+        {
+            culling->pending_meshes[kept++] = mesh_index;
+        }
+
+        vkCmdUpdateBuffer(command_buffer, culling->mesh_buffer, mesh_index * sizeof(cull_mesh), sizeof(cull_mesh), &cull_mesh);
+    }
+    culling->pending_mesh_number = kept;
+
+    VkMemoryBarrier update_barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &update_barrier, 0, NULL, 0, NULL);
+}
+
+void record_culling(VkCommandBuffer command_buffer, PCulling* culling, PInstancing* instancing, PBuffers* buffers, PChunks* chunks, uint32_t frame, uint32_t phase)
+{
+    PInstanceBuffer* frame_buffer = &instancing->frame_buffers[frame];
+
+    if(phase == CULL_PHASE_EARLY)
+    {
+        // The pool was compacted and its uploads recorded for this frame, so the chunk allocations are final
+        culling->chunk_entry_number = write_chunk_cull_entries(chunks, buffers->geometry_pool, buffers->model_matrix, culling->meshlet_number, culling->opaque_meshlet_number + culling->chunk_number, culling->chunk_buffers_mapped[frame]);
+
+        // Counters start from zero, and the first visible entry always points to the static model
+        vkCmdFillBuffer(command_buffer, culling->batch_buffers[frame], 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(command_buffer, frame_buffer->visible_buffer, 0, sizeof(uint32_t), STATIC_INSTANCE);
+        if(culling->reset_visibility & (1u << frame))
+        {
+            vkCmdFillBuffer(command_buffer, frame_buffer->visibility_buffer, 0, VK_WHOLE_SIZE, 0);
+            culling->reset_visibility &= ~(1u << frame);
+        }
+        if(culling->reset_meshlet_visibility & (1u << frame))
+        {
+            vkCmdFillBuffer(command_buffer, culling->meshlet_visibility_buffers[frame], 0, VK_WHOLE_SIZE, 0);
+            culling->reset_meshlet_visibility &= ~(1u << frame);
+        }
+
+        VkMemoryBarrier clear_barrier = {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        };
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &clear_barrier, 0, NULL, 0, NULL);
+    }
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling->pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling->pipeline_layout, 0, 1, &culling->descriptor_sets[frame], 1, &buffers->uniform_offset);
+
+    CullConstants constants = {
+        .instance_count        = instancing->packed_number,
+        .mesh_count            = culling->mesh_number,
+        .pass                  = CULL_PASS_INSTANCES,
+        .phase                 = phase,
+        .meshlet_count         = culling->meshlet_number,
+        .lod_scale             = buffers->lod_scale,
+        .chunk_count           = culling->chunk_entry_number,
+        .meshlet_draw_capacity = culling->meshlet_draw_capacity
+    };
+    memcpy(constants.frustum, buffers->frustum_planes, sizeof(constants.frustum));
+
+    vkCmdPushConstants(command_buffer, culling->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(command_buffer, (constants.instance_count + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+    // Meshlets of the static model and resident chunks are tested against the frustum and their normal cone, then the pyramid in the late phase
+    uint32_t meshlet_entry_number = culling->meshlet_number + culling->chunk_entry_number;
+    if(meshlet_entry_number > 0)
+    {
+        constants.pass = CULL_PASS_MESHLETS;
+        vkCmdPushConstants(command_buffer, culling->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(command_buffer, (meshlet_entry_number + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+    }
+
+    VkMemoryBarrier cull_barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cull_barrier, 0, NULL, 0, NULL);
+
+    // Levels of detail left with visible instances get one draw each, packed at the front of the phase's draws
+    constants.pass = CULL_PASS_BUILD_DRAWS;
+    vkCmdPushConstants(command_buffer, culling->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(command_buffer, (culling->mesh_number * MAX_MESH_LODS + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier draw_barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &draw_barrier, 0, NULL, 0, NULL);
+}
+
+void record_culled_draws(VkCommandBuffer command_buffer, PCulling* culling, uint32_t frame, uint32_t phase)
+{
+    uint32_t max_draws        = culling->mesh_number * MAX_MESH_LODS;
+    VkDeviceSize draw_offset  = phase * max_draws * sizeof(VkDrawIndexedIndirectCommand);
+    VkDeviceSize count_offset = phase * sizeof(uint32_t);
+
+    culling->draw_indexed_indirect_count(command_buffer, culling->draw_buffers[frame], draw_offset, culling->batch_buffers[frame], count_offset, max_draws, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void record_culled_meshlets(VkCommandBuffer command_buffer, PCulling* culling, uint32_t frame, uint32_t phase, uint32_t material)
+{
+    // Opaque draws come first, with room for one entry per chunk after the opaque meshlets
+    uint32_t first_draw = material == MATERIAL_OPAQUE ? 0 : culling->opaque_meshlet_number + culling->chunk_number;
+    uint32_t max_draws  = (material == MATERIAL_OPAQUE ? culling->opaque_meshlet_number : culling->meshlet_number - culling->opaque_meshlet_number) + culling->chunk_number;
+    if(max_draws == 0)
+    {
+        return;
+    }
+
+    VkDeviceSize draw_offset  = (CULL_PHASE_COUNT * culling->mesh_number * MAX_MESH_LODS + phase * culling->meshlet_draw_capacity + first_draw) * sizeof(VkDrawIndexedIndirectCommand);
+    VkDeviceSize count_offset = (CULL_PHASE_COUNT + phase * MATERIAL_COUNT + material) * sizeof(uint32_t);
+
+    culling->draw_indexed_indirect_count(command_buffer, culling->draw_buffers[frame], draw_offset, culling->batch_buffers[frame], count_offset, max_draws, sizeof(VkDrawIndexedIndirectCommand));
+}
@@ -0,0 +1,48 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef CULLING_H
+#define CULLING_H
+#define CULL_WORKGROUP_SIZE 64
+#define CULL_PASS_INSTANCES 0
+#define CULL_PASS_BUILD_DRAWS 1
+#define CULL_PASS_MESHLETS 2
+#define CULL_PHASE_EARLY 0
+#define CULL_PHASE_LATE 1
+#define CULL_PHASE_COUNT 2
+#define CULL_BINDING_INSTANCES 0
+#define CULL_BINDING_VISIBLE_INSTANCES 1
+#define CULL_BINDING_MESHES 2
+#define CULL_BINDING_BATCHES 3
+#define CULL_BINDING_DRAWS 4
+#define CULL_BINDING_VISIBILITY 5
+#define CULL_BINDING_UNIFORMS 6
+#define CULL_BINDING_DEPTH_PYRAMID 7
+#define CULL_BINDING_MESHLETS 8
+#define CULL_BINDING_MESHLET_VISIBILITY 9
+#define CULL_BINDING_CHUNKS 10
+#define CULL_BINDING_COUNT 11
+
+#include "defines.h"
+
+PCulling* create_culling(PBuffers* buffers, PInstancing* instancing, PChunks* chunks, PSwapchain* swapchain, PCommands* commands, PDevice* device, uint32_t frame_count);
+void destroy_culling(PCulling* culling, PDevice* device);
+void update_cull_mesh(PCulling* culling, uint32_t mesh_index);
+void update_culling(PCulling* culling, PInstancing* instancing, PBuffers* buffers, PDevice* device, uint32_t frame);
+int resize_culling(PCulling* culling, PSwapchain* swapchain, PDevice* device);
+
+#endif
@@ -32,6 +32,8 @@
 #define PIGMENT_SUCCESS 0
 #define PIGMENT_ERROR 1
 
+#define MAX_MESH_LODS 4
+
 #define PIGMENT_MAKE_VERSION(major, minor, patch) \
     ((((uint32_t)(major)) << 22U) | (((uint32_t)(minor)) << 12U) | ((uint32_t)(patch)))
 
@@ -43,6 +45,16 @@ typedef struct {
 typedef struct PAppInfo_T {
     const char* app_name;
     uint32_t    app_version;
+    bool        pack_texture_arrays;
+    bool        stream_textures;
+    bool        cook_textures;
+    const char* cooked_texture_directory;
+    bool        gpu_culling;
+    bool        depth_prepass;
+    bool        merge_block_faces;
+    float       chunk_size;
+    float       chunk_radius;
+    uint32_t    max_meshes;
 } PAppInfo;
 
 typedef struct PWindowInfo_T {
@@ -93,6 +105,22 @@ typedef struct PTexture_T PTexture;
 
 typedef struct PTextureList_T PTextureList;
 
+typedef struct PTextureSlot_T PTextureSlot;
+
+typedef struct PTextureContent_T PTextureContent;
+
+typedef struct PTextureContents_T PTextureContents;
+
+typedef struct PTextureStream_T PTextureStream;
+
+typedef struct PTextureStreamer_T PTextureStreamer;
+
+typedef struct PStreamingLoad_T PStreamingLoad;
+
+typedef struct PStreamingTransfer_T PStreamingTransfer;
+
+typedef struct PRetiredTexture_T PRetiredTexture;
+
 typedef struct PSampler_T PSampler;
 
 typedef struct PSamplerList_T PSamplerList;
@@ -103,11 +131,67 @@ typedef struct PDepthResources_T PDepthResources;
 
 typedef struct PCamera_T PCamera;
 
+typedef struct PMipmapGenerator_T PMipmapGenerator;
+
+typedef struct PMemoryTracker_T PMemoryTracker;
+
+typedef struct PDeferredResource_T PDeferredResource;
+
+typedef struct PDeletionQueue_T PDeletionQueue;
+
+typedef struct PMemoryAllocation_T PMemoryAllocation;
+
+typedef struct PMesh_T PMesh;
+typedef struct PMeshLod_T PMeshLod;
+typedef struct PMeshlet_T PMeshlet;
+
+typedef struct PInstancing_T PInstancing;
+
+typedef struct PInstanceBuffer_T PInstanceBuffer;
+
+typedef struct PCulling_T PCulling;
+
+typedef struct PDepthPyramid_T PDepthPyramid;
+
+typedef struct PGeometryPool_T PGeometryPool;
+typedef struct PGeometryRange_T PGeometryRange;
+typedef struct PGeometryFreeList_T PGeometryFreeList;
+typedef struct PGeometryAllocation_T PGeometryAllocation;
+typedef struct PGeometryUpload_T PGeometryUpload;
+typedef struct PRetiredGeometry_T PRetiredGeometry;
+
+typedef struct PChunk_T PChunk;
+
+typedef struct PChunks_T PChunks;
+
 typedef enum {
     NEAREST = 0,
     LINEAR  = 1
 } FilteringMode;
 
+typedef enum {
+    MEMORY_TEXTURES = 0,
+    MEMORY_GEOMETRY = 1,
+    MEMORY_UNIFORMS = 2,
+    MEMORY_STAGING  = 3,
+    MEMORY_OTHER    = 4,
+    MEMORY_CATEGORY_COUNT
+} MemoryCategory;
+
+typedef struct PMemoryStats {
+    uint64_t category_usage[MEMORY_CATEGORY_COUNT];
+    uint64_t device_local_budget;
+    uint64_t device_local_usage;
+    bool     budget_from_driver;
+} PMemoryStats;
+
+typedef struct PRenderStats {
+    uint64_t prepass_fragments;
+    uint64_t shaded_fragments;
+    uint64_t pixels;
+    bool     available;
+} PRenderStats;
+
 #define CGLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <cglm/cglm.h>
 
@@ -117,12 +201,71 @@ typedef struct Vertex {
     vec2 texture_coord;
     uint32_t texture_index;
     uint32_t sampler_index;
+    uint32_t texture_layer;
 } Vertex;
 
 typedef struct UniformBufferObject {
-    alignas(16) mat4 model;
     alignas(16) mat4 view;
     alignas(16) mat4 projection;
 } UniformBufferObject;
 
+typedef struct ModelConstants {
+    alignas(16) mat4 model;
+} ModelConstants;
+
+typedef struct InstanceData {
+    alignas(16) mat4 model;
+    alignas(16) vec4 color;
+    uint32_t texture_index;
+    uint32_t texture_layer;
+    uint32_t mesh_index;
+    uint32_t batch_offset;
+} InstanceData;
+
+typedef struct CullMesh {
+    int32_t vertex_offset;
+    uint32_t lod_count;
+    uint32_t padding[2];
+    alignas(16) vec4 bounds;
+    alignas(16) vec4 lod_errors;
+    alignas(16) uint32_t lod_first_index[MAX_MESH_LODS];
+    alignas(16) uint32_t lod_index_count[MAX_MESH_LODS];
+} CullMesh;
+
+typedef struct CullMeshlet {
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t material;
+    uint32_t draw_offset;
+    int32_t vertex_offset;
+    uint32_t visibility;
+    uint32_t padding[2];
+    alignas(16) vec4 bounds;
+    alignas(16) vec4 cone;
+} CullMeshlet;
+
+typedef struct CullConstants {
+    vec4 frustum[6];
+    uint32_t instance_count;
+    uint32_t mesh_count;
+    uint32_t pass;
+    uint32_t phase;
+    uint32_t meshlet_count;
+    float lod_scale;
+    uint32_t chunk_count;
+    uint32_t meshlet_draw_capacity;
+} CullConstants;
+
+typedef struct ChunkCandidate {
+    float distance;
+    uint32_t chunk;
+} ChunkCandidate;
+
+typedef struct MipmapConstants {
+    uint32_t mip_levels;
+    uint32_t workgroup_count;
+    uint32_t counter_index;
+    uint32_t srgb;
+} MipmapConstants;
+
 #endif
@@ -0,0 +1,280 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "deletion_queue.h"
+#include "structs.h"
+#include "memory_tracker.h"
+
+#include "lib/array.h"
+
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+
+void defer_destroy_buffer(VkBuffer buffer, PDevice* device);
+void defer_destroy_image(VkImage image, PDevice* device);
+void defer_destroy_image_view(VkImageView image_view, PDevice* device);
+void defer_destroy_framebuffer(VkFramebuffer framebuffer, PDevice* device);
+void defer_free_descriptor_set(VkDescriptorSet descriptor_set, VkDescriptorPool descriptor_pool, PDevice* device);
+void defer_free_memory(VkDeviceMemory memory, PDevice* device);
+void defer_destroy_semaphore(VkSemaphore semaphore, PDevice* device);
+void defer_destroy_swapchain(VkSwapchainKHR swapchain, PDevice* device);
+void defer_destroy_descriptor_pool(VkDescriptorPool descriptor_pool, PDevice* device);
+void defer_resource(PDeferredResource resource, PDevice* device);
+void release_resource(const PDeferredResource* resource, PDevice* device);
+void release_deferred_resources(PDeletionQueue* deletion_queue, PDevice* device, bool release_all);
+uint64_t evict_deferred_memory(void* context, uint64_t size, bool out_of_memory, PDevice* device);
+VkDeviceSize get_tracked_memory_usage(PDevice* device);
+
+int create_deletion_queue(PDevice* device, uint32_t frame_count)
+{
+    device->deletion_queue = calloc(1, sizeof(*device->deletion_queue));
+    if(device->deletion_queue == NULL)
+    {
+        perror("create_deletion_queue");
+        return PIGMENT_ERROR;
+    }
+
+    device->deletion_queue->frame_count = frame_count;
+
+    // Memory waiting for its frames is the first thing given back when the budget runs out
+    register_memory_evictor(device, evict_deferred_memory, device->deletion_queue);
+
+    return PIGMENT_SUCCESS;
+}
+
+void destroy_deletion_queue(PDevice* device)
+{
+    if(device->deletion_queue == NULL)
+    {
+        return;
+    }
+
+    vkDeviceWaitIdle(device->logical_device);
+    release_deferred_resources(device->deletion_queue, device, true);
+    unregister_memory_evictor(device, device->deletion_queue);
+
+    free(device->deletion_queue->resources);
+    free(device->deletion_queue);
+    device->deletion_queue = NULL;
+}
+
+// Called once the fence of the current frame has been waited on
+void update_deletion_queue(PDevice* device)
+{
+    if(device->deletion_queue == NULL)
+    {
+        return;
+    }
+
+    release_deferred_resources(device->deletion_queue, device, false);
+}
+
+void advance_deletion_frame(PDevice* device)
+{
+    if(device->deletion_queue != NULL)
+    {
+        device->deletion_queue->frame++;
+    }
+}
+
+void defer_resource(PDeferredResource resource, PDevice* device)
+{
+    PDeletionQueue* deletion_queue = device->deletion_queue;
+
+    // Without a queue, or room in it, the resource waits for the device instead
+    if(deletion_queue == NULL || reserve_array((void**) &deletion_queue->resources, &deletion_queue->resource_size, deletion_queue->resource_number + 1, sizeof(*deletion_queue->resources)) != PIGMENT_SUCCESS)
+    {
+        vkDeviceWaitIdle(device->logical_device);
+        release_resource(&resource, device);
+        return;
+    }
+
+    resource.frame = deletion_queue->frame;
+    deletion_queue->resources[deletion_queue->resource_number++] = resource;
+}
+
+void release_resource(const PDeferredResource* resource, PDevice* device)
+{
+    switch(resource->type)
+    {
+        case DEFERRED_BUFFER:
+            vkDestroyBuffer(device->logical_device, resource->buffer, NULL);
+            break;
+        case DEFERRED_IMAGE:
+            vkDestroyImage(device->logical_device, resource->image, NULL);
+            break;
+        case DEFERRED_IMAGE_VIEW:
+            vkDestroyImageView(device->logical_device, resource->image_view, NULL);
+            break;
+        case DEFERRED_FRAMEBUFFER:
+            vkDestroyFramebuffer(device->logical_device, resource->framebuffer, NULL);
+            break;
+        case DEFERRED_DESCRIPTOR_SET:
+            vkFreeDescriptorSets(device->logical_device, resource->descriptor_pool, 1, &resource->descriptor_set);
+            break;
+        case DEFERRED_MEMORY:
+            free_device_memory(resource->memory, device);
+            break;
+        case DEFERRED_SEMAPHORE:
+            vkDestroySemaphore(device->logical_device, resource->semaphore, NULL);
+            break;
+        case DEFERRED_SWAPCHAIN:
+            vkDestroySwapchainKHR(device->logical_device, resource->swapchain, NULL);
+            break;
+        case DEFERRED_DESCRIPTOR_POOL:
+            vkDestroyDescriptorPool(device->logical_device, resource->descriptor_pool, NULL);
+            break;
+    }
+}
+
+void release_deferred_resources(PDeletionQueue* deletion_queue, PDevice* device, bool release_all)
+{
+    // Resources are released in the order they were deferred, so views go before their image and images before their memory
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < deletion_queue->resource_number; i++)
+    {
+        PDeferredResource* resource = &deletion_queue->resources[i];
+        if(!release_all && deletion_queue->frame < resource->frame + deletion_queue->frame_count)
+        {
+            deletion_queue->resources[kept++] = *resource;
+            continue;
+        }
+
+        release_resource(resource, device);
+    }
+    deletion_queue->resource_number = kept;
+}
+
+uint64_t evict_deferred_memory(void* context, uint64_t size, bool out_of_memory, PDevice* device)
+{
+    PDeletionQueue* deletion_queue = context;
+
+    // Near the budget, the deferred memory is released by the next frames anyway, waiting for the device is not worth it
+    if(!out_of_memory)
+    {
+        return 0;
+    }
+
+    bool holds_memory = false;
+    for(uint32_t i = 0; i < deletion_queue->resource_number && !holds_memory; i++)
+    {
+        holds_memory = deletion_queue->resources[i].type == DEFERRED_MEMORY;
+    }
+    if(!holds_memory)
+    {
+        return 0;
+    }
+
+    VkDeviceSize before = get_tracked_memory_usage(device);
+
+    vkDeviceWaitIdle(device->logical_device);
+
+    // Every resource could go now, only the oldest ones are released until enough memory went back to the device
+    uint32_t released_number = 0;
+    while(released_number < deletion_queue->resource_number && before - get_tracked_memory_usage(device) < size)
+    {
+        release_resource(&deletion_queue->resources[released_number++], device);
+    }
+    deletion_queue->resource_number -= released_number;
+    memmove(deletion_queue->resources, &deletion_queue->resources[released_number], deletion_queue->resource_number * sizeof(*deletion_queue->resources));
+
+    return before - get_tracked_memory_usage(device);
+}
+
+VkDeviceSize get_tracked_memory_usage(PDevice* device)
+{
+    VkDeviceSize usage = 0;
+    for(uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        usage += device->memory_tracker->category_usage[i];
+    }
+
+    return usage;
+}
+
+void defer_destroy_buffer(VkBuffer buffer, PDevice* device)
+{
+    if(buffer != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_BUFFER, .buffer = buffer}, device);
+    }
+}
+
+void defer_destroy_image(VkImage image, PDevice* device)
+{
+    if(image != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_IMAGE, .image = image}, device);
+    }
+}
+
+void defer_destroy_image_view(VkImageView image_view, PDevice* device)
+{
+    if(image_view != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_IMAGE_VIEW, .image_view = image_view}, device);
+    }
+}
+
+void defer_destroy_framebuffer(VkFramebuffer framebuffer, PDevice* device)
+{
+    if(framebuffer != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_FRAMEBUFFER, .framebuffer = framebuffer}, device);
+    }
+}
+
+// The pool must have been created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+void defer_free_descriptor_set(VkDescriptorSet descriptor_set, VkDescriptorPool descriptor_pool, PDevice* device)
+{
+    if(descriptor_set != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_DESCRIPTOR_SET, .descriptor_set = descriptor_set, .descriptor_pool = descriptor_pool}, device);
+    }
+}
+
+void defer_free_memory(VkDeviceMemory memory, PDevice* device)
+{
+    if(memory != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_MEMORY, .memory = memory}, device);
+    }
+}
+
+void defer_destroy_semaphore(VkSemaphore semaphore, PDevice* device)
+{
+    if(semaphore != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_SEMAPHORE, .semaphore = semaphore}, device);
+    }
+}
+
+// The swapchain must have been retired by passing it as the old swapchain of a new one, or not be presenting anymore
+void defer_destroy_swapchain(VkSwapchainKHR swapchain, PDevice* device)
+{
+    if(swapchain != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_SWAPCHAIN, .swapchain = swapchain}, device);
+    }
+}
+
+// Descriptor sets deferred before the pool are freed before it
+void defer_destroy_descriptor_pool(VkDescriptorPool descriptor_pool, PDevice* device)
+{
+    if(descriptor_pool != VK_NULL_HANDLE)
+    {
+        defer_resource((PDeferredResource) {.type = DEFERRED_DESCRIPTOR_POOL, .descriptor_pool = descriptor_pool}, device);
+    }
+}
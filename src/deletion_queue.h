@@ -0,0 +1,36 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DELETION_QUEUE_H
+#define DELETION_QUEUE_H
+#define DEFERRED_BUFFER 0
+#define DEFERRED_IMAGE 1
+#define DEFERRED_IMAGE_VIEW 2
+#define DEFERRED_FRAMEBUFFER 3
+#define DEFERRED_DESCRIPTOR_SET 4
+#define DEFERRED_MEMORY 5
+#define DEFERRED_SEMAPHORE 6
+#define DEFERRED_SWAPCHAIN 7
+#define DEFERRED_DESCRIPTOR_POOL 8
+
+#include "defines.h"
+
+int create_deletion_queue(PDevice* device, uint32_t frame_count);
+void destroy_deletion_queue(PDevice* device);
+void update_deletion_queue(PDevice* device);
+void advance_deletion_frame(PDevice* device);
+
+#endif
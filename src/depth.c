@@ -17,18 +17,20 @@
 #include "depth.h"
 #include "structs.h"
 
-extern int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
-extern int transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels, VkCommandPool command_pool, PDevice* device);
+extern int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t array_layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkMemoryPropertyFlags properties, PDevice* device);
 extern VkImageView create_image_view(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels, VkDevice device);
+extern void defer_destroy_image(VkImage image, PDevice* device);
+extern void defer_destroy_image_view(VkImageView image_view, PDevice* device);
+extern void defer_free_memory(VkDeviceMemory memory, PDevice* device);
 
 VkFormat find_depth_format(VkPhysicalDevice physical_device);
 VkFormat find_supported_format(VkFormat* candidates, uint32_t candidates_number, VkImageTiling tiling, VkFormatFeatureFlags features, VkPhysicalDevice physical_device);
 
-int create_depth_resources(PSwapchain* swapchain, PCommands* commands, PDevice* device)
+int create_depth_resources(PSwapchain* swapchain, PDevice* device)
 {
     VkFormat depth_format = find_depth_format(device->physical_device);
 
-    if(create_image(&swapchain->depth_image, &swapchain->depth_image_memory, swapchain->extent.width, swapchain->extent.height, 1, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    if(create_image(&swapchain->depth_image, &swapchain->depth_image_memory, swapchain->extent.width, swapchain->extent.height, 1, 1, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
     {
         goto ERROR;
     }
@@ -37,11 +39,8 @@ int create_depth_resources(PSwapchain* swapchain, PCommands* commands, PDevice*
     {
         goto ERROR;
     }
-    if(transition_image_layout(swapchain->depth_image, depth_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1, commands->command_pool, device) != PIGMENT_SUCCESS)
-    {
-        goto ERROR;
-    }
 
+    // The render pass clears depth from an undefined layout, the image needs no transition before its first frame
     return PIGMENT_SUCCESS;
 
 ERROR:
@@ -54,9 +53,9 @@ void destroy_depth_resources(PSwapchain* swapchain, PDevice* device)
     {
         return;
     }
-    vkDestroyImageView(device->logical_device, swapchain->depth_image_view, NULL);
-    vkDestroyImage(device->logical_device, swapchain->depth_image, NULL);
-    vkFreeMemory(device->logical_device, swapchain->depth_image_memory, NULL);
+    defer_destroy_image_view(swapchain->depth_image_view, device);
+    defer_destroy_image(swapchain->depth_image, device);
+    defer_free_memory(swapchain->depth_image_memory, device);
 }
 
 VkFormat find_supported_format(VkFormat* candidates, uint32_t candidates_number, VkImageTiling tiling, VkFormatFeatureFlags features, VkPhysicalDevice physical_device)
@@ -90,7 +89,7 @@ VkFormat find_depth_format(VkPhysicalDevice physical_device)
         candidates,
         candidates_size,
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT,
         physical_device
     );
 }
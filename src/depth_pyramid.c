@@ -0,0 +1,460 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "depth_pyramid.h"
+#include "structs.h"
+#include "shaders.h"
+
+extern int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t array_layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkMemoryPropertyFlags properties, PDevice* device);
+extern VkImageView create_image_view(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels, VkDevice device);
+extern VkImageView create_mip_view(VkImage image, VkFormat format, uint32_t mip_level, VkDevice device);
+extern VkFormat find_depth_format(VkPhysicalDevice physical_device);
+extern void defer_destroy_image(VkImage image, PDevice* device);
+extern void defer_destroy_image_view(VkImageView image_view, PDevice* device);
+extern void defer_free_memory(VkDeviceMemory memory, PDevice* device);
+extern void defer_free_descriptor_set(VkDescriptorSet descriptor_set, VkDescriptorPool descriptor_pool, PDevice* device);
+extern void defer_destroy_descriptor_pool(VkDescriptorPool descriptor_pool, PDevice* device);
+
+int create_depth_pyramid_pipeline(PDepthPyramid* depth_pyramid, PDevice* device);
+int create_depth_pyramid_descriptors(PDepthPyramid* depth_pyramid, PDevice* device, uint32_t frame_count);
+void destroy_depth_pyramid_image(PDepthPyramid* depth_pyramid, PDevice* device);
+uint32_t previous_power_of_two(uint32_t value);
+void record_depth_pyramid(VkCommandBuffer command_buffer, PDepthPyramid* depth_pyramid);
+
+PDepthPyramid* create_depth_pyramid(PSwapchain* swapchain, PDevice* device, uint32_t frame_count)
+{
+    PDepthPyramid* depth_pyramid = calloc(1, sizeof(*depth_pyramid));
+    if(depth_pyramid == NULL)
+    {
+        perror("create_depth_pyramid");
+        return NULL;
+    }
+
+    VkFormat depth_format = find_depth_format(device->physical_device);
+    depth_pyramid->depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if(depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format == VK_FORMAT_D24_UNORM_S8_UINT)
+    {
+        depth_pyramid->depth_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    if(create_depth_pyramid_descriptors(depth_pyramid, device, frame_count) != PIGMENT_SUCCESS || create_depth_pyramid_pipeline(depth_pyramid, device) != PIGMENT_SUCCESS ||
+       resize_depth_pyramid(depth_pyramid, swapchain, device) != PIGMENT_SUCCESS)
+    {
+        destroy_depth_pyramid(depth_pyramid, device);
+        return NULL;
+    }
+
+    return depth_pyramid;
+}
+
+void destroy_depth_pyramid(PDepthPyramid* depth_pyramid, PDevice* device)
+{
+    if(depth_pyramid == NULL)
+    {
+        return;
+    }
+
+    destroy_depth_pyramid_image(depth_pyramid, device);
+    vkDestroyPipeline(device->logical_device, depth_pyramid->pipeline, NULL);
+    vkDestroyPipelineLayout(device->logical_device, depth_pyramid->pipeline_layout, NULL);
+    // Queued after the sets of the previous sizes, so that they are freed before it
+    defer_destroy_descriptor_pool(depth_pyramid->descriptor_pool, device);
+    vkDestroyDescriptorSetLayout(device->logical_device, depth_pyramid->descriptor_set_layout, NULL);
+    vkDestroySampler(device->logical_device, depth_pyramid->sampler, NULL);
+    free(depth_pyramid);
+}
+
+void destroy_depth_pyramid_image(PDepthPyramid* depth_pyramid, PDevice* device)
+{
+    for(uint32_t i = 0; i < depth_pyramid->level_count; i++)
+    {
+        defer_destroy_image_view(depth_pyramid->level_views[i], device);
+        depth_pyramid->level_views[i] = VK_NULL_HANDLE;
+    }
+    for(uint32_t i = 0; i < MAX_DEPTH_PYRAMID_LEVELS; i++)
+    {
+        if(depth_pyramid->descriptor_sets[i] != VK_NULL_HANDLE)
+        {
+            defer_free_descriptor_set(depth_pyramid->descriptor_sets[i], depth_pyramid->descriptor_pool, device);
+            depth_pyramid->descriptor_sets[i] = VK_NULL_HANDLE;
+        }
+    }
+    defer_destroy_image_view(depth_pyramid->image_view, device);
+    defer_destroy_image(depth_pyramid->image, device);
+    defer_free_memory(depth_pyramid->image_memory, device);
+
+    depth_pyramid->image_view   = VK_NULL_HANDLE;
+    depth_pyramid->image        = VK_NULL_HANDLE;
+    depth_pyramid->image_memory = VK_NULL_HANDLE;
+    depth_pyramid->level_count  = 0;
+}
+
+uint32_t previous_power_of_two(uint32_t value)
+{
+    uint32_t result = 1;
+    while(result <= value / 2)
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+// The image and the descriptor sets are shared by every frame in flight, so the previous ones are retired through the deletion queue and new ones are made
+int resize_depth_pyramid(PDepthPyramid* depth_pyramid, PSwapchain* swapchain, PDevice* device)
+{
+    destroy_depth_pyramid_image(depth_pyramid, device);
+
+    // A power of two size keeps every level an exact 2x2 reduction of the previous one
+    depth_pyramid->width       = previous_power_of_two(swapchain->extent.width);
+    depth_pyramid->height      = previous_power_of_two(swapchain->extent.height);
+    depth_pyramid->depth_image = swapchain->depth_image;
+
+    uint32_t largest_side = depth_pyramid->width > depth_pyramid->height ? depth_pyramid->width : depth_pyramid->height;
+    uint32_t level_count  = 1;
+    while(level_count < MAX_DEPTH_PYRAMID_LEVELS && (largest_side >> level_count) > 0)
+    {
+        level_count++;
+    }
+
+    if(create_image(&depth_pyramid->image, &depth_pyramid->image_memory, depth_pyramid->width, depth_pyramid->height, level_count, 1, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    depth_pyramid->image_view = create_image_view(depth_pyramid->image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, level_count, device->logical_device);
+    if(depth_pyramid->image_view == NULL)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    for(; depth_pyramid->level_count < level_count; depth_pyramid->level_count++)
+    {
+        depth_pyramid->level_views[depth_pyramid->level_count] = create_mip_view(depth_pyramid->image, VK_FORMAT_R32_SFLOAT, depth_pyramid->level_count, device->logical_device);
+        if(depth_pyramid->level_views[depth_pyramid->level_count] == NULL)
+        {
+            return PIGMENT_ERROR;
+        }
+    }
+
+    VkDescriptorSetLayout layouts[MAX_DEPTH_PYRAMID_LEVELS];
+    for(uint32_t i = 0; i < level_count; i++)
+    {
+        layouts[i] = depth_pyramid->descriptor_set_layout;
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = depth_pyramid->descriptor_pool,
+        .descriptorSetCount = level_count,
+        .pSetLayouts        = layouts
+    };
+
+    if(vkAllocateDescriptorSets(device->logical_device, &alloc_info, depth_pyramid->descriptor_sets) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to allocate depth pyramid descriptor sets!\n");
+        return PIGMENT_ERROR;
+    }
+
+    // Each level reads the previous one, the first reads the depth buffer
+    VkDescriptorImageInfo input_infos[MAX_DEPTH_PYRAMID_LEVELS];
+    VkDescriptorImageInfo output_infos[MAX_DEPTH_PYRAMID_LEVELS];
+    VkWriteDescriptorSet descriptor_writes[MAX_DEPTH_PYRAMID_LEVELS * 2];
+
+    for(uint32_t i = 0; i < level_count; i++)
+    {
+        input_infos[i] = (VkDescriptorImageInfo) {
+            .sampler     = depth_pyramid->sampler,
+            .imageView   = i == 0 ? swapchain->depth_image_view : depth_pyramid->level_views[i - 1],
+            .imageLayout = i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+        };
+        output_infos[i] = (VkDescriptorImageInfo) {
+            .sampler     = VK_NULL_HANDLE,
+            .imageView   = depth_pyramid->level_views[i],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+        };
+
+        descriptor_writes[i * 2] = (VkWriteDescriptorSet) {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = depth_pyramid->descriptor_sets[i],
+            .dstBinding      = 0,
+            .dstArrayElement = 0,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .pImageInfo      = &input_infos[i]
+        };
+        descriptor_writes[i * 2 + 1] = (VkWriteDescriptorSet) {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = depth_pyramid->descriptor_sets[i],
+            .dstBinding      = 1,
+            .dstArrayElement = 0,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .pImageInfo      = &output_infos[i]
+        };
+    }
+
+    vkUpdateDescriptorSets(device->logical_device, level_count * 2, descriptor_writes, 0, NULL);
+
+    return PIGMENT_SUCCESS;
+}
+
+int create_depth_pyramid_descriptors(PDepthPyramid* depth_pyramid, PDevice* device, uint32_t frame_count)
+{
+    VkSamplerCreateInfo sampler_create_info = {
+        .sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter               = VK_FILTER_NEAREST,
+        .minFilter               = VK_FILTER_NEAREST,
+        .addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .anisotropyEnable        = VK_FALSE,
+        .borderColor             = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE,
+        .compareEnable           = VK_FALSE,
+        .compareOp               = VK_COMPARE_OP_ALWAYS,
+        .mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .minLod                  = 0.0f,
+        .maxLod                  = VK_LOD_CLAMP_NONE
+    };
+
+    if(vkCreateSampler(device->logical_device, &sampler_create_info, NULL, &depth_pyramid->sampler) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create depth pyramid sampler!\n");
+        return PIGMENT_ERROR;
+    }
+
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding            = 0,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount    = 1,
+            .pImmutableSamplers = NULL,
+            .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT
+        },
+        {
+            .binding            = 1,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount    = 1,
+            .pImmutableSamplers = NULL,
+            .stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT
+        }
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+        .pBindings    = bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(device->logical_device, &layout_info, NULL, &depth_pyramid->descriptor_set_layout) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create depth pyramid descriptor set layout!\n");
+        return PIGMENT_ERROR;
+    }
+
+    // Sets of the previous sizes stay allocated until the frames in flight are done with them, one resize per frame at most
+    uint32_t set_count = MAX_DEPTH_PYRAMID_LEVELS * (frame_count + 1);
+
+    VkDescriptorPoolSize pool_sizes[] = {
+        {
+            .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = set_count
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = set_count
+        }
+    };
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]),
+        .pPoolSizes    = pool_sizes,
+        .maxSets       = set_count
+    };
+
+    if(vkCreateDescriptorPool(device->logical_device, &pool_info, NULL, &depth_pyramid->descriptor_pool) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create depth pyramid descriptor pool!\n");
+        return PIGMENT_ERROR;
+    }
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &depth_pyramid->descriptor_set_layout,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges    = NULL
+    };
+
+    if(vkCreatePipelineLayout(device->logical_device, &pipeline_layout_info, NULL, &depth_pyramid->pipeline_layout) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create depth pyramid pipeline layout!\n");
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+int create_depth_pyramid_pipeline(PDepthPyramid* depth_pyramid, PDevice* device)
+{
+    char* shader_code = NULL;
+    uint32_t* shader_spv = NULL;
+    VkShaderModule shader_module = NULL;
+    uint32_t shader_code_size;
+    uint32_t shader_spv_size;
+
+    shader_code = get_shader_code("shaders/depth_pyramid.comp", &shader_code_size);
+    if(shader_code == NULL)
+    {
+        shader_code_size = strlen(DEFAULT_DEPTH_PYRAMID_COMPUTE_SHADER);
+        shader_code = malloc(shader_code_size + 1);
+        if(shader_code == NULL)
+        {
+            goto ERROR;
+        }
+        memcpy(shader_code, DEFAULT_DEPTH_PYRAMID_COMPUTE_SHADER, shader_code_size + 1);
+    }
+
+    shader_spv = compile_glsl_to_spv(shader_code, shader_code_size, shaderc_glsl_compute_shader, "shaders/depth_pyramid.spv", NULL, &shader_spv_size);
+    if(shader_spv == NULL)
+    {
+        fprintf(stderr, "Failed to compile depth pyramid compute shader to SPIR-V.\n");
+        goto ERROR;
+    }
+
+    shader_module = create_shader_module(device->logical_device, shader_spv, shader_spv_size);
+    if(shader_module == NULL)
+    {
+        goto ERROR;
+    }
+
+    VkComputePipelineCreateInfo pipeline_create_info = {
+        .sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+        .stage.module = shader_module,
+        .stage.pName  = "main",
+        .layout       = depth_pyramid->pipeline_layout
+    };
+
+    if(vkCreateComputePipelines(device->logical_device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &depth_pyramid->pipeline) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create depth pyramid compute pipeline!\n");
+        goto ERROR;
+    }
+
+    vkDestroyShaderModule(device->logical_device, shader_module, NULL);
+    free(shader_spv);
+    free(shader_code);
+
+    return PIGMENT_SUCCESS;
+
+ERROR:
+    if(shader_module != NULL)
+        vkDestroyShaderModule(device->logical_device, shader_module, NULL);
+    free(shader_spv);
+    free(shader_code);
+    return PIGMENT_ERROR;
+}
+
+void record_depth_pyramid(VkCommandBuffer command_buffer, PDepthPyramid* depth_pyramid)
+{
+    // The previous content of the pyramid is discarded, the depth buffer is sampled until the late pass
+    VkImageMemoryBarrier start_barriers[] = {
+        {
+            .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask                   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask                   = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout                       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            .newLayout                       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+            .image                           = depth_pyramid->depth_image,
+            .subresourceRange.aspectMask     = depth_pyramid->depth_aspect,
+            .subresourceRange.baseMipLevel   = 0,
+            .subresourceRange.levelCount     = 1,
+            .subresourceRange.baseArrayLayer = 0,
+            .subresourceRange.layerCount     = 1
+        },
+        {
+            .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask                   = 0,
+            .dstAccessMask                   = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout                       = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+            .image                           = depth_pyramid->image,
+            .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .subresourceRange.baseMipLevel   = 0,
+            .subresourceRange.levelCount     = depth_pyramid->level_count,
+            .subresourceRange.baseArrayLayer = 0,
+            .subresourceRange.layerCount     = 1
+        }
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, sizeof(start_barriers) / sizeof(start_barriers[0]), start_barriers);
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, depth_pyramid->pipeline);
+
+    VkImageMemoryBarrier level_barrier = {
+        .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask                   = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask                   = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout                       = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout                       = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .image                           = depth_pyramid->image,
+        .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.levelCount     = 1,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount     = 1
+    };
+
+    for(uint32_t i = 0; i < depth_pyramid->level_count; i++)
+    {
+        uint32_t level_width  = depth_pyramid->width >> i > 0 ? depth_pyramid->width >> i : 1;
+        uint32_t level_height = depth_pyramid->height >> i > 0 ? depth_pyramid->height >> i : 1;
+
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, depth_pyramid->pipeline_layout, 0, 1, &depth_pyramid->descriptor_sets[i], 0, NULL);
+        vkCmdDispatch(command_buffer, (level_width + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE, (level_height + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE, 1);
+
+        level_barrier.subresourceRange.baseMipLevel = i;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &level_barrier);
+    }
+
+    VkImageMemoryBarrier depth_barrier = {
+        .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask                   = 0,
+        .dstAccessMask                   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        .oldLayout                       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+        .newLayout                       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .image                           = depth_pyramid->depth_image,
+        .subresourceRange.aspectMask     = depth_pyramid->depth_aspect,
+        .subresourceRange.baseMipLevel   = 0,
+        .subresourceRange.levelCount     = 1,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount     = 1
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, NULL, 0, NULL, 1, &depth_barrier);
+}
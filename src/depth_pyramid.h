@@ -0,0 +1,28 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+#define MAX_DEPTH_PYRAMID_LEVELS 16
+#define DEPTH_PYRAMID_WORKGROUP_SIZE 8
+
+#include "defines.h"
+
+PDepthPyramid* create_depth_pyramid(PSwapchain* swapchain, PDevice* device, uint32_t frame_count);
+int resize_depth_pyramid(PDepthPyramid* depth_pyramid, PSwapchain* swapchain, PDevice* device);
+void destroy_depth_pyramid(PDepthPyramid* depth_pyramid, PDevice* device);
+#endif
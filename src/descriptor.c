@@ -18,91 +18,152 @@
 
 #include "structs.h"
 
-int create_descriptor_pool(PDescriptor* descriptor, PTextureList* textures, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count);
-int create_descriptor_sets(PDescriptor* descriptor, PBuffers* buffers, PTextureList* textures, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count);
+extern void write_texture_descriptor(VkDescriptorSet descriptor_set, uint32_t descriptor_index, VkImageView image_view, VkDevice device);
 
-PDescriptor* create_descriptor(PTextureList* textures, PSamplerList* samplers, PDevice* device)
+int create_texture_set_layout(PDescriptor* descriptor, PSamplerList* samplers, PDevice* device);
+int create_frame_set_layout(PDescriptor* descriptor, PDevice* device);
+bool frame_binding_used(const PDescriptor* descriptor, uint32_t binding);
+int create_descriptor_pool(PDescriptor* descriptor, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count);
+int create_texture_set(PDescriptor* descriptor, PTextureList* textures, PSamplerList* samplers, PDevice* device);
+int create_frame_sets(PDescriptor* descriptor, PBuffers* buffers, PTextureList* textures, PInstancing* instancing, PDevice* device, uint32_t descriptor_count);
+
+PDescriptor* create_descriptor(PTextureList* textures, PSamplerList* samplers, bool gpu_culling, PDevice* device)
 {
-    PDescriptor* descriptor = malloc(sizeof(*descriptor));
+    PDescriptor* descriptor = calloc(1, sizeof(*descriptor));
     if(descriptor == NULL)
     {
-        goto ERROR;
+        perror("create_descriptor");
+        return NULL;
     }
 
-    VkDescriptorSetLayoutBinding uniform_buffer_set_layout_binding = {
-        .binding            = 0,
-        .descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount    = 1,
-        .pImmutableSamplers = NULL,
-        .stageFlags         = VK_SHADER_STAGE_VERTEX_BIT
-    };
+    descriptor->texture_feedback = textures->streamer != NULL;
+    descriptor->gpu_culling      = gpu_culling;
 
-    VkDescriptorSetLayoutBinding sampler_set_layout_binding = {
-        .binding = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
-        .descriptorCount = samplers->sampler_number,
-        .pImmutableSamplers = NULL,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-    };
+    if(create_texture_set_layout(descriptor, samplers, device) != PIGMENT_SUCCESS || create_frame_set_layout(descriptor, device) != PIGMENT_SUCCESS)
+    {
+        destroy_descriptor(descriptor, device);
+        return NULL;
+    }
 
-    VkDescriptorSetLayoutBinding image_set_layout_binding = {
-        .binding            = 2,
-        .descriptorType     = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
-        .descriptorCount    = textures->texture_number,
-        .pImmutableSamplers = NULL,
-        .stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT
-    };
+    return descriptor;
+}
 
-    VkDescriptorSetLayoutBinding descriptor_set_layout_binding[] = {
-        uniform_buffer_set_layout_binding, 
-        sampler_set_layout_binding,
-        image_set_layout_binding
+int create_texture_set_layout(PDescriptor* descriptor, PSamplerList* samplers, PDevice* device)
+{
+    // Samplers and textures are shared by every frame, textures added later are written in place
+    VkDescriptorSetLayoutBinding bindings[] = {
+        {
+            .binding            = 0,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_SAMPLER,
+            .descriptorCount    = samplers->sampler_number,
+            .pImmutableSamplers = NULL,
+            .stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT
+        },
+        {
+            .binding            = 1,
+            .descriptorType     = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            .descriptorCount    = device->max_bindless_textures,
+            .pImmutableSamplers = NULL,
+            .stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT
+        }
     };
 
-    VkDescriptorBindingFlagsEXT descriptor_binding_flags[]       = {
-        0,
+    VkDescriptorBindingFlagsEXT binding_flags[] = {
         0,
-        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT
+        VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT
     };
 
-    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT descriptor_set_layout_binding_flags = {
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info = {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
-        .bindingCount  = sizeof(descriptor_binding_flags) / sizeof(descriptor_binding_flags[0]),
-        .pBindingFlags = descriptor_binding_flags,
+        .bindingCount  = sizeof(bindings) / sizeof(bindings[0]),
+        .pBindingFlags = binding_flags
     };
 
     VkDescriptorSetLayoutCreateInfo layout_info = {
         .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = sizeof(descriptor_set_layout_binding) / sizeof(descriptor_set_layout_binding[0]),
-        .pBindings    = descriptor_set_layout_binding,
-        .pNext        = &descriptor_set_layout_binding_flags
+        .flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+        .bindingCount = sizeof(bindings) / sizeof(bindings[0]),
+        .pBindings    = bindings,
+        .pNext        = &binding_flags_info
     };
 
-    if(vkCreateDescriptorSetLayout(device->logical_device, &layout_info, NULL, &descriptor->descriptor_set_layout) != VK_SUCCESS)
+    if(vkCreateDescriptorSetLayout(device->logical_device, &layout_info, NULL, &descriptor->set_layouts[DESCRIPTOR_SET_TEXTURES]) != VK_SUCCESS)
     {
-        fprintf(stderr, "Failed to create descriptor set layout!\n");
-        goto ERROR;
+        fprintf(stderr, "Failed to create texture descriptor set layout!\n");
+        return PIGMENT_ERROR;
     }
 
-    return descriptor;
+    return PIGMENT_SUCCESS;
+}
 
-ERROR:
-    perror("create_descriptor");
-    free(descriptor);
-    return NULL;
+int create_frame_set_layout(PDescriptor* descriptor, PDevice* device)
+{
+    VkDescriptorSetLayoutBinding bindings[FRAME_BINDING_COUNT];
+    uint32_t binding_count = 0;
+
+    for(uint32_t i = 0; i < FRAME_BINDING_COUNT; i++)
+    {
+        if(!frame_binding_used(descriptor, i))
+        {
+            continue;
+        }
+
+        bindings[binding_count++] = (VkDescriptorSetLayoutBinding) {
+            .binding            = i,
+            .descriptorType     = i == FRAME_BINDING_UNIFORMS ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount    = 1,
+            .pImmutableSamplers = NULL,
+            .stageFlags         = i == FRAME_BINDING_FEEDBACK ? VK_SHADER_STAGE_FRAGMENT_BIT : VK_SHADER_STAGE_VERTEX_BIT
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = binding_count,
+        .pBindings    = bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(device->logical_device, &layout_info, NULL, &descriptor->set_layouts[DESCRIPTOR_SET_FRAME]) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create frame descriptor set layout!\n");
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+bool frame_binding_used(const PDescriptor* descriptor, uint32_t binding)
+{
+    switch(binding)
+    {
+        case FRAME_BINDING_VISIBLE_INSTANCES:
+            return descriptor->gpu_culling;
+        case FRAME_BINDING_FEEDBACK:
+            return descriptor->texture_feedback;
+        default:
+            return true;
+    }
 }
 
-int update_descriptor(PDescriptor* descriptor, PBuffers* buffers, PTextureList* textures, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count)
+int update_descriptor(PDescriptor* descriptor, PBuffers* buffers, PTextureList* textures, PInstancing* instancing, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count)
 {
-    if(create_descriptor_pool(descriptor, textures, samplers, device, descriptor_count))
+    if(create_descriptor_pool(descriptor, samplers, device, descriptor_count))
     {
         goto ERROR;
     }
-    if(create_descriptor_sets(descriptor, buffers, textures, samplers, device, descriptor_count))
+    if(create_texture_set(descriptor, textures, samplers, device))
+    {
+        goto ERROR;
+    }
+    if(create_frame_sets(descriptor, buffers, textures, instancing, device, descriptor_count))
     {
         goto ERROR;
     }
 
+    // Textures loaded from now on write their own descriptor
+    textures->descriptor = descriptor;
+
     return PIGMENT_SUCCESS;
 
 ERROR:
@@ -117,7 +178,12 @@ void destroy_descriptor(PDescriptor* descriptor, PDevice* device)
         return;
     }
     vkDestroyDescriptorPool(device->logical_device, descriptor->descriptor_pool, NULL);
-    vkDestroyDescriptorSetLayout(device->logical_device, descriptor->descriptor_set_layout, NULL);
+    for(uint32_t i = 0; i < DESCRIPTOR_SET_COUNT; i++)
+    {
+        vkDestroyDescriptorSetLayout(device->logical_device, descriptor->set_layouts[i], NULL);
+    }
+    free(descriptor->frame_sets);
+    free(descriptor);
 }
 
 VkDescriptorPoolSize create_descriptor_pool_size(VkDescriptorType type, uint32_t descriptor_count)
@@ -129,19 +195,22 @@ VkDescriptorPoolSize create_descriptor_pool_size(VkDescriptorType type, uint32_t
     return pool_size;
 }
 
-int create_descriptor_pool(PDescriptor* descriptor, PTextureList* textures, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count)
+int create_descriptor_pool(PDescriptor* descriptor, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count)
 {
+    // Only one copy of the texture set, the frame sets hold a few buffers each
     VkDescriptorPoolSize pool_sizes[] = {
-        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, descriptor_count),
-        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_SAMPLER, descriptor_count * samplers->sampler_number),
-        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, descriptor_count * textures->texture_number),
+        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_SAMPLER, samplers->sampler_number),
+        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, device->max_bindless_textures),
+        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, descriptor_count),
+        create_descriptor_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (FRAME_BINDING_COUNT - 1) * descriptor_count),
     };
 
     VkDescriptorPoolCreateInfo pool_info = {
         .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
         .poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]),
         .pPoolSizes    = pool_sizes,
-        .maxSets       = descriptor_count
+        .maxSets       = descriptor_count + 1
     };
 
     if(vkCreateDescriptorPool(device->logical_device, &pool_info, NULL, &(descriptor->descriptor_pool)) != VK_SUCCESS)
@@ -153,135 +222,156 @@ int create_descriptor_pool(PDescriptor* descriptor, PTextureList* textures, PSam
     return PIGMENT_SUCCESS;
 }
 
-int create_descriptor_sets(PDescriptor* descriptor, PBuffers* buffers, PTextureList* textures, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count)
+int create_texture_set(PDescriptor* descriptor, PTextureList* textures, PSamplerList* samplers, PDevice* device)
 {
-    VkDescriptorSetLayout* layouts = NULL;
-    uint32_t* variable_desciptor_counts = NULL;
-    VkDescriptorImageInfo* texture_infos = NULL;
-    VkDescriptorImageInfo* sampler_infos = NULL;
+    uint32_t variable_descriptor_count = device->max_bindless_textures;
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variable_descriptor_count_info = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT,
+        .descriptorSetCount = 1,
+        .pDescriptorCounts  = &variable_descriptor_count
+    };
 
-    layouts = malloc(descriptor_count * sizeof(*layouts));
-    if(layouts == NULL)
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = descriptor->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts        = &descriptor->set_layouts[DESCRIPTOR_SET_TEXTURES],
+        .pNext              = &variable_descriptor_count_info
+    };
+
+    if(vkAllocateDescriptorSets(device->logical_device, &alloc_info, &descriptor->texture_set) != VK_SUCCESS)
     {
-        goto ERROR;
+        fprintf(stderr, "Failed to allocate texture descriptor set!\n");
+        return PIGMENT_ERROR;
     }
 
-    variable_desciptor_counts = malloc(descriptor_count * sizeof(*variable_desciptor_counts));
-    if(variable_desciptor_counts == NULL)
+    VkDescriptorImageInfo* sampler_infos = malloc(samplers->sampler_number * sizeof(*sampler_infos));
+    if(sampler_infos == NULL)
     {
-        goto ERROR;
+        perror("create_texture_set");
+        return PIGMENT_ERROR;
     }
 
-    for(size_t i = 0; i < descriptor_count; i++)
+    for(size_t s = 0; s < samplers->sampler_number; s++)
     {
-        layouts[i] = descriptor->descriptor_set_layout;
-        variable_desciptor_counts[i] = textures->texture_number;
+        sampler_infos[s].sampler     = samplers->samplers[s].sampler;
+        sampler_infos[s].imageView   = NULL;
+        sampler_infos[s].imageLayout = 0;
     }
 
-    VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variable_desciptor_counts_alloc_info = {
-        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT,
-        .descriptorSetCount = descriptor_count,
-        .pDescriptorCounts  = variable_desciptor_counts
+    VkWriteDescriptorSet sampler_write = {
+        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet          = descriptor->texture_set,
+        .dstBinding      = 0,
+        .dstArrayElement = 0,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLER,
+        .descriptorCount = samplers->sampler_number,
+        .pImageInfo      = sampler_infos
     };
 
-    VkDescriptorSetAllocateInfo alloc_info = {
-        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool     = descriptor->descriptor_pool,
-        .descriptorSetCount = descriptor_count,
-        .pSetLayouts        = layouts,
-        .pNext              = &variable_desciptor_counts_alloc_info
-    };
+    vkUpdateDescriptorSets(device->logical_device, 1, &sampler_write, 0, NULL);
+    free(sampler_infos);
 
-    descriptor->descriptor_sets = malloc(descriptor_count * sizeof(*descriptor->descriptor_sets));
-    if(descriptor->descriptor_sets == NULL)
+    for(uint32_t i = 0; i < textures->texture_number; i++)
     {
-        goto ERROR;
+        if(textures->textures[i].image_view != VK_NULL_HANDLE)
+        {
+            write_texture_descriptor(descriptor->texture_set, textures->textures[i].descriptor_index, textures->textures[i].image_view, device->logical_device);
+        }
     }
 
-    texture_infos = malloc(textures->texture_number * sizeof(*texture_infos));
-    if(texture_infos == NULL)
+    return PIGMENT_SUCCESS;
+}
+
+int create_frame_sets(PDescriptor* descriptor, PBuffers* buffers, PTextureList* textures, PInstancing* instancing, PDevice* device, uint32_t descriptor_count)
+{
+    VkDescriptorSetLayout* layouts = malloc(descriptor_count * sizeof(*layouts));
+    descriptor->frame_sets         = malloc(descriptor_count * sizeof(*descriptor->frame_sets));
+    if(layouts == NULL || descriptor->frame_sets == NULL)
     {
+        perror("create_frame_sets");
         goto ERROR;
     }
 
-    sampler_infos = malloc(samplers->sampler_number * sizeof(*sampler_infos));
-    if(sampler_infos == NULL)
+    for(size_t i = 0; i < descriptor_count; i++)
     {
-        goto ERROR;
+        layouts[i] = descriptor->set_layouts[DESCRIPTOR_SET_FRAME];
     }
 
-    if(vkAllocateDescriptorSets(device->logical_device, &alloc_info, descriptor->descriptor_sets) != VK_SUCCESS)
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = descriptor->descriptor_pool,
+        .descriptorSetCount = descriptor_count,
+        .pSetLayouts        = layouts
+    };
+
+    if(vkAllocateDescriptorSets(device->logical_device, &alloc_info, descriptor->frame_sets) != VK_SUCCESS)
     {
-        fprintf(stderr, "Failed to allocate descriptor sets!\n");
+        fprintf(stderr, "Failed to allocate frame descriptor sets!\n");
         goto ERROR;
     }
 
     for(size_t i = 0; i < descriptor_count; i++)
     {
-
-        VkWriteDescriptorSet descriptor_set_writes[3] = {0};
-
-        VkDescriptorBufferInfo buffer_info = {
-            .buffer = buffers->uniform_buffers[i],
-            .offset = 0,
-            .range  = sizeof(UniformBufferObject)
+        VkDescriptorBufferInfo buffer_infos[FRAME_BINDING_COUNT] = {
+            [FRAME_BINDING_UNIFORMS] = {
+                .buffer = buffers->uniform_buffer,
+                .offset = 0,
+                .range  = sizeof(UniformBufferObject)
+            },
+            [FRAME_BINDING_TEXTURE_TABLE] = {
+                .buffer = textures->table_buffers[i],
+                .offset = 0,
+                .range  = VK_WHOLE_SIZE
+            },
+            [FRAME_BINDING_INSTANCES] = {
+                .buffer = instancing->frame_buffers[i].buffer,
+                .offset = 0,
+                .range  = VK_WHOLE_SIZE
+            },
+            [FRAME_BINDING_VISIBLE_INSTANCES] = {
+                .buffer = descriptor->gpu_culling ? instancing->frame_buffers[i].visible_buffer : VK_NULL_HANDLE,
+                .offset = 0,
+                .range  = VK_WHOLE_SIZE
+            },
+            [FRAME_BINDING_FEEDBACK] = {
+                .buffer = descriptor->texture_feedback ? textures->streamer->feedback_buffers[i] : VK_NULL_HANDLE,
+                .offset = 0,
+                .range  = VK_WHOLE_SIZE
+            }
         };
 
-        uint32_t descriptor_set_write_number = sizeof(descriptor_set_writes) / sizeof(descriptor_set_writes[0]);
-
-        descriptor_set_writes[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_set_writes[0].dstSet          = descriptor->descriptor_sets[i];
-        descriptor_set_writes[0].dstBinding      = 0;
-        descriptor_set_writes[0].dstArrayElement = 0;
-        descriptor_set_writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptor_set_writes[0].descriptorCount = 1;
-        descriptor_set_writes[0].pBufferInfo     = &buffer_info;
-
-        for(size_t s = 0; s < samplers->sampler_number; s++)
-        {
-            sampler_infos[s].sampler     = samplers->samplers[s].sampler;
-            sampler_infos[s].imageView   = NULL;
-            sampler_infos[s].imageLayout = 0;
-        }
-
-        descriptor_set_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_set_writes[1].dstSet = descriptor->descriptor_sets[i];
-        descriptor_set_writes[1].dstBinding = 1;
-        descriptor_set_writes[1].dstArrayElement = 0;
-        descriptor_set_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-        descriptor_set_writes[1].descriptorCount = samplers->sampler_number;
-        descriptor_set_writes[1].pImageInfo = sampler_infos;
+        VkWriteDescriptorSet descriptor_writes[FRAME_BINDING_COUNT];
+        uint32_t descriptor_write_number = 0;
 
-        for(size_t j = 0; j < textures->texture_number; j++)
+        for(uint32_t j = 0; j < FRAME_BINDING_COUNT; j++)
         {
-            texture_infos[j].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            texture_infos[j].imageView   = textures->textures[j].image_view;
+            if(!frame_binding_used(descriptor, j))
+            {
+                continue;
+            }
+
+            descriptor_writes[descriptor_write_number++] = (VkWriteDescriptorSet) {
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = descriptor->frame_sets[i],
+                .dstBinding      = j,
+                .dstArrayElement = 0,
+                .descriptorType  = j == FRAME_BINDING_UNIFORMS ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .pBufferInfo     = &buffer_infos[j]
+            };
         }
 
-        descriptor_set_writes[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_set_writes[2].dstSet          = descriptor->descriptor_sets[i];
-        descriptor_set_writes[2].dstBinding      = 2;
-        descriptor_set_writes[2].dstArrayElement = 0;
-        descriptor_set_writes[2].descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-        descriptor_set_writes[2].descriptorCount = textures->texture_number;
-        descriptor_set_writes[2].pImageInfo      = texture_infos;
-
-        vkUpdateDescriptorSets(device->logical_device, descriptor_set_write_number, descriptor_set_writes, 0, NULL);
+        vkUpdateDescriptorSets(device->logical_device, descriptor_write_number, descriptor_writes, 0, NULL);
     }
 
-    free(sampler_infos);
-    free(texture_infos);
-    free(variable_desciptor_counts);
     free(layouts);
     return PIGMENT_SUCCESS;
 
 ERROR:
-    perror("create_descriptor_sets");
-    free(sampler_infos);
-    free(texture_infos);
-    free(descriptor->descriptor_sets);
-    free(variable_desciptor_counts);
     free(layouts);
-
+    free(descriptor->frame_sets);
+    descriptor->frame_sets = NULL;
     return PIGMENT_ERROR;
 }
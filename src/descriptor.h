@@ -16,11 +16,21 @@
 
 #ifndef DESCRIPTOR_H
 #define DESCRIPTOR_H
+// Sets are ordered from the least to the most frequently changing, per material data will go in set 2
+#define DESCRIPTOR_SET_TEXTURES 0
+#define DESCRIPTOR_SET_FRAME 1
+#define DESCRIPTOR_SET_COUNT 2
+#define FRAME_BINDING_UNIFORMS 0
+#define FRAME_BINDING_TEXTURE_TABLE 1
+#define FRAME_BINDING_INSTANCES 2
+#define FRAME_BINDING_VISIBLE_INSTANCES 3
+#define FRAME_BINDING_FEEDBACK 4
+#define FRAME_BINDING_COUNT 5
 
 #include "defines.h"
 
-PDescriptor* create_descriptor(PTextureList* textures, PSamplerList* samplers, PDevice* device);
-int update_descriptor(PDescriptor* descriptor, PBuffers* buffers, PTextureList* texture, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count);
+PDescriptor* create_descriptor(PTextureList* textures, PSamplerList* samplers, bool gpu_culling, PDevice* device);
+int update_descriptor(PDescriptor* descriptor, PBuffers* buffers, PTextureList* texture, PInstancing* instancing, PSamplerList* samplers, PDevice* device, uint32_t descriptor_count);
 
 void destroy_descriptor(PDescriptor* descriptor, PDevice* device);
 
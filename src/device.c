@@ -16,12 +16,16 @@
 
 #include "device.h"
 #include "structs.h"
+#include "texture.h"
 
 #include <vulkan/vulkan_core.h>
 #define QUEUE_FAMILY_NUM 2
 
 extern SwapChainSupportDetails* get_support_details(VkPhysicalDevice device, VkSurfaceKHR surface);
 extern void destroy_support_details(SwapChainSupportDetails* details);
+extern bool has_direct_upload_memory(VkPhysicalDevice physical_device);
+extern int create_memory_tracker(PDevice* device);
+extern void destroy_memory_tracker(PDevice* device);
 
 QueueFamilySet* create_queue_family_set(QueueFamilyIndices* indices);
 void destroy_queue_family_set(QueueFamilySet* set);
@@ -33,6 +37,7 @@ bool queue_families_indices_completed(QueueFamilyIndices indices);
 bool check_device_extensions(VkPhysicalDevice device, ExtensionList requiered_extensions);
 bool is_suitable(VkPhysicalDevice device, VkSurfaceKHR surface, ExtensionList requiered_extensions);
 int pick_physical_device(PDevice* device, PInstance* instance, PSurface* surface);
+bool enable_optional_extension(PDevice* device, const char* extension_name);
 int create_logical_device(PDevice* device, PInstance* instance, PSurface* surface);
 
 void append_set(uint32_t* set, uint32_t* idx, uint32_t element)
@@ -208,7 +213,10 @@ bool is_suitable(VkPhysicalDevice device, VkSurfaceKHR surface, ExtensionList re
     bool has_descriptor_indexing_features = available_features.features.shaderSampledImageArrayDynamicIndexing &&
                                             descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing && 
                                             descriptor_indexing_features.runtimeDescriptorArray &&
-                                            descriptor_indexing_features.descriptorBindingVariableDescriptorCount;
+                                            descriptor_indexing_features.descriptorBindingVariableDescriptorCount &&
+                                            descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind &&
+                                            descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending &&
+                                            descriptor_indexing_features.descriptorBindingPartiallyBound;
 
 
     return is_completed && extensions_supported && suitable_swap_chain && available_features.features.samplerAnisotropy && has_descriptor_indexing_features;
@@ -324,6 +332,53 @@ ERROR:
     return NULL;
 }
 
+bool enable_optional_extension(PDevice* device, const char* extension_name)
+{
+    uint32_t extensions_count;
+    vkEnumerateDeviceExtensionProperties(device->physical_device, NULL, &extensions_count, NULL);
+
+    VkExtensionProperties* available_extensions = malloc(extensions_count * sizeof(*available_extensions));
+    if(available_extensions == NULL)
+    {
+        goto ERROR;
+    }
+
+    vkEnumerateDeviceExtensionProperties(device->physical_device, NULL, &extensions_count, available_extensions);
+
+    bool extension_found = false;
+    for(uint32_t i = 0; i < extensions_count; i++)
+    {
+        if(strcmp(extension_name, available_extensions[i].extensionName) == 0)
+        {
+            extension_found = true;
+            break;
+        }
+    }
+
+    free(available_extensions);
+
+    if(!extension_found)
+    {
+        return false;
+    }
+
+    const char** names = realloc(device->extensions->names, (device->extensions->size + 1) * sizeof(*names));
+    if(names == NULL)
+    {
+        goto ERROR;
+    }
+
+    names[device->extensions->size] = extension_name;
+    device->extensions->names       = names;
+    device->extensions->size++;
+
+    return true;
+
+ERROR:
+    perror("enable_optional_extension");
+    return false;
+}
+
 int create_logical_device(PDevice* device, PInstance* instance, PSurface* surface)
 {
     QueueFamilyIndices* indices = NULL;
@@ -357,16 +412,27 @@ int create_logical_device(PDevice* device, PInstance* instance, PSurface* surfac
         queue_create_infos[i].pQueuePriorities = &queue_priority;
     }
 
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(device->physical_device, &supported_features);
+
     VkPhysicalDeviceFeatures enabled_features = {
         .samplerAnisotropy                      = VK_TRUE,
-        .shaderSampledImageArrayDynamicIndexing = VK_TRUE
+        .shaderSampledImageArrayDynamicIndexing = VK_TRUE,
+        .shaderStorageImageArrayDynamicIndexing = supported_features.shaderStorageImageArrayDynamicIndexing,
+        .textureCompressionBC                   = supported_features.textureCompressionBC,
+        .fragmentStoresAndAtomics               = supported_features.fragmentStoresAndAtomics,
+        .multiDrawIndirect                      = supported_features.multiDrawIndirect,
+        .pipelineStatisticsQuery                = supported_features.pipelineStatisticsQuery
     };
 
     VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features = {
-        .sType                                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
-        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
-        .runtimeDescriptorArray                    = VK_TRUE,
-        .descriptorBindingVariableDescriptorCount  = VK_TRUE
+        .sType                                        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+        .shaderSampledImageArrayNonUniformIndexing    = VK_TRUE,
+        .runtimeDescriptorArray                       = VK_TRUE,
+        .descriptorBindingVariableDescriptorCount     = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending    = VK_TRUE,
+        .descriptorBindingPartiallyBound              = VK_TRUE
     };
 
     VkPhysicalDeviceFeatures2 features = {
@@ -401,6 +467,35 @@ int create_logical_device(PDevice* device, PInstance* instance, PSurface* surfac
         goto ERROR;
     }
 
+    device->storage_image_dynamic_indexing = supported_features.shaderStorageImageArrayDynamicIndexing;
+    device->texture_compression_bc         = supported_features.textureCompressionBC;
+    device->fragment_stores_and_atomics    = supported_features.fragmentStoresAndAtomics;
+    device->multi_draw_indirect            = supported_features.multiDrawIndirect;
+    device->draw_indirect_count            = device->draw_indirect_count && supported_features.multiDrawIndirect;
+    device->pipeline_statistics            = supported_features.pipelineStatisticsQuery;
+
+    VkPhysicalDeviceDescriptorIndexingProperties descriptor_indexing_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES
+    };
+
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &descriptor_indexing_properties
+    };
+
+    vkGetPhysicalDeviceProperties2(device->physical_device, &properties);
+
+    // The texture binding is sized once for the whole run, textures added later only take a free index
+    device->max_bindless_textures = MAX_BINDLESS_TEXTURES;
+    if(descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages < device->max_bindless_textures)
+    {
+        device->max_bindless_textures = descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages;
+    }
+    if(descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages < device->max_bindless_textures)
+    {
+        device->max_bindless_textures = descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages;
+    }
+
     vkGetDeviceQueue(device->logical_device, indices->graphics_family.value, 0, &device->graphics_queue);
     vkGetDeviceQueue(device->logical_device, indices->present_family.value, 0, &device->present_queue);
 
@@ -453,7 +548,20 @@ PDevice* create_device(PInstance* instance, PSurface* surface)
     memcpy(device->extensions->names, extensions, device->extensions->size * sizeof(*extensions));
 
     pick_physical_device(device, instance, surface);
+
+    device->memory_budget       = enable_optional_extension(device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    device->draw_indirect_count = enable_optional_extension(device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
     create_logical_device(device, instance, surface);
+
+    device->direct_buffer_upload = has_direct_upload_memory(device->physical_device);
+
+    if(create_memory_tracker(device) != PIGMENT_SUCCESS)
+    {
+        vkDestroyDevice(device->logical_device, NULL);
+        goto ERROR;
+    }
+
     return device;
 
 ERROR:
@@ -476,7 +584,9 @@ void destroy_device(PDevice* device)
     {
         return;
     }
+    destroy_memory_tracker(device);
     vkDestroyDevice(device->logical_device, NULL);
+    free(device->extensions->names);
     free(device->extensions);
     free(device);
 }
@@ -0,0 +1,496 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "faces.h"
+#include "structs.h"
+#include "lib/hashmap.h"
+
+#include <math.h>
+
+extern bool is_texture_alpha_tested(const PTextureList* texture_list, uint32_t texture_index);
+
+// An axis aligned rectangle of the static model, with texture coordinates being an affine function of the position
+typedef struct BlockFace {
+    uint32_t axis;
+    int32_t facing;
+    float plane;
+    float min[2];
+    float max[2];
+    vec2 uv_origin;
+    vec2 uv_steps[2];
+    Vertex attributes;
+    bool opaque;
+    bool removed;
+} BlockFace;
+
+bool find_block_face(const PModel* model, const uint32_t* indices, const PTextureList* texture_list, BlockFace* face);
+bool same_attributes(const Vertex* a, const Vertex* b);
+int compare_face_materials(const BlockFace* a, const BlockFace* b);
+int compare_face_rectangles(const void* a, const void* b);
+int compare_face_rows(const void* a, const void* b);
+int compare_face_columns(const void* a, const void* b);
+uint32_t remove_hidden_faces(BlockFace* faces, uint32_t face_number);
+uint32_t merge_faces(BlockFace* faces, uint32_t face_number, uint32_t dimension);
+bool can_merge_faces(const BlockFace* a, const BlockFace* b, uint32_t dimension);
+int append_vertex(VertexHashMap* vertices_dictionnary, Vertex* vertices, uint32_t* vertices_number, const Vertex* vertex, uint32_t* indices, uint32_t* indices_number);
+
+bool same_attributes(const Vertex* a, const Vertex* b)
+{
+    return a->texture_index == b->texture_index && a->texture_layer == b->texture_layer && a->sampler_index == b->sampler_index &&
+           memcmp(a->color, b->color, sizeof(a->color)) == 0;
+}
+
+// Two triangles in a row make a face when they cover an axis aligned rectangle with the same attributes
+bool find_block_face(const PModel* model, const uint32_t* indices, const PTextureList* texture_list, BlockFace* face)
+{
+    const Vertex* corners[4] = {NULL, NULL, NULL, NULL};
+    uint32_t corner_ids[4];
+    uint32_t corner_number = 0;
+
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        uint32_t j = 0;
+        while(j < corner_number && corner_ids[j] != indices[i])
+        {
+            j++;
+        }
+        if(j == corner_number)
+        {
+            if(corner_number == 4)
+            {
+                return false;
+            }
+            corner_ids[corner_number] = indices[i];
+            corners[corner_number++]  = &model->vertices[indices[i]];
+        }
+    }
+    if(corner_number != 4)
+    {
+        return false;
+    }
+
+    face->axis = 3;
+    for(uint32_t axis = 0; axis < 3 && face->axis == 3; axis++)
+    {
+        if(corners[0]->pos[axis] == corners[1]->pos[axis] && corners[0]->pos[axis] == corners[2]->pos[axis] && corners[0]->pos[axis] == corners[3]->pos[axis])
+        {
+            face->axis = axis;
+        }
+    }
+    if(face->axis == 3)
+    {
+        return false;
+    }
+
+    uint32_t dimensions[2] = {(face->axis + 1) % 3, (face->axis + 2) % 3};
+    face->plane            = corners[0]->pos[face->axis];
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        face->min[i] = glm_min(glm_min(corners[0]->pos[dimensions[i]], corners[1]->pos[dimensions[i]]), glm_min(corners[2]->pos[dimensions[i]], corners[3]->pos[dimensions[i]]));
+        face->max[i] = glm_max(glm_max(corners[0]->pos[dimensions[i]], corners[1]->pos[dimensions[i]]), glm_max(corners[2]->pos[dimensions[i]], corners[3]->pos[dimensions[i]]));
+    }
+    if(face->min[0] == face->max[0] || face->min[1] == face->max[1])
+    {
+        return false;
+    }
+
+    // Corners are ordered (min, min), (max, min), (max, max), (min, max)
+    const Vertex* rectangle[4] = {NULL, NULL, NULL, NULL};
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        float u = corners[i]->pos[dimensions[0]];
+        float v = corners[i]->pos[dimensions[1]];
+        if((u != face->min[0] && u != face->max[0]) || (v != face->min[1] && v != face->max[1]) || !same_attributes(corners[i], corners[0]))
+        {
+            return false;
+        }
+
+        uint32_t corner = v == face->min[1] ? (u == face->min[0] ? 0 : 1) : (u == face->max[0] ? 2 : 3);
+        if(rectangle[corner] != NULL)
+        {
+            return false;
+        }
+        rectangle[corner] = corners[i];
+    }
+
+    // Both triangles have to face the same way, the face keeps their winding
+    face->facing = 0;
+    for(uint32_t i = 0; i < 6; i += 3)
+    {
+        vec3 edge_1;
+        vec3 edge_2;
+        vec3 normal;
+        glm_vec3_sub(model->vertices[indices[i + 1]].pos, model->vertices[indices[i]].pos, edge_1);
+        glm_vec3_sub(model->vertices[indices[i + 2]].pos, model->vertices[indices[i]].pos, edge_2);
+        glm_vec3_cross(edge_1, edge_2, normal);
+
+        int32_t facing = normal[face->axis] > 0.0f ? 1 : -1;
+        if(normal[face->axis] == 0.0f || (face->facing != 0 && facing != face->facing))
+        {
+            return false;
+        }
+        face->facing = facing;
+    }
+
+    glm_vec2_copy((float*) rectangle[0]->texture_coord, face->uv_origin);
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        glm_vec2_sub((float*) rectangle[i == 0 ? 1 : 3]->texture_coord, face->uv_origin, face->uv_steps[i]);
+        glm_vec2_scale(face->uv_steps[i], 1.0f / (face->max[i] - face->min[i]), face->uv_steps[i]);
+    }
+
+    // The last corner has to follow from the others, or the mapping is not affine
+    vec2 expected;
+    glm_vec2_add((float*) rectangle[1]->texture_coord, (float*) rectangle[3]->texture_coord, expected);
+    glm_vec2_sub(expected, face->uv_origin, expected);
+    if(fabsf(expected[0] - rectangle[2]->texture_coord[0]) > FACE_UV_EPSILON || fabsf(expected[1] - rectangle[2]->texture_coord[1]) > FACE_UV_EPSILON)
+    {
+        return false;
+    }
+
+    face->attributes = *rectangle[0];
+    face->opaque     = !is_texture_alpha_tested(texture_list, face->attributes.texture_index);
+    face->removed    = false;
+
+    return true;
+}
+
+int compare_face_materials(const BlockFace* a, const BlockFace* b)
+{
+    if(a->axis != b->axis)
+    {
+        return a->axis < b->axis ? -1 : 1;
+    }
+    if(a->facing != b->facing)
+    {
+        return a->facing < b->facing ? -1 : 1;
+    }
+    if(a->plane != b->plane)
+    {
+        return a->plane < b->plane ? -1 : 1;
+    }
+    if(a->attributes.texture_index != b->attributes.texture_index)
+    {
+        return a->attributes.texture_index < b->attributes.texture_index ? -1 : 1;
+    }
+    if(a->attributes.texture_layer != b->attributes.texture_layer)
+    {
+        return a->attributes.texture_layer < b->attributes.texture_layer ? -1 : 1;
+    }
+    if(a->attributes.sampler_index != b->attributes.sampler_index)
+    {
+        return a->attributes.sampler_index < b->attributes.sampler_index ? -1 : 1;
+    }
+    return memcmp(a->attributes.color, b->attributes.color, sizeof(a->attributes.color));
+}
+
+int compare_face_rectangles(const void* a, const void* b)
+{
+    const BlockFace* first  = a;
+    const BlockFace* second = b;
+
+    if(first->axis != second->axis)
+    {
+        return first->axis < second->axis ? -1 : 1;
+    }
+    if(first->plane != second->plane)
+    {
+        return first->plane < second->plane ? -1 : 1;
+    }
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        if(first->min[i] != second->min[i])
+        {
+            return first->min[i] < second->min[i] ? -1 : 1;
+        }
+        if(first->max[i] != second->max[i])
+        {
+            return first->max[i] < second->max[i] ? -1 : 1;
+        }
+    }
+    return first->facing - second->facing;
+}
+
+// Faces of a row share their material and their extent along the second dimension, and are sorted along the first
+int compare_face_rows(const void* a, const void* b)
+{
+    const BlockFace* first  = a;
+    const BlockFace* second = b;
+
+    int result = compare_face_materials(first, second);
+    if(result != 0)
+    {
+        return result;
+    }
+    if(first->min[1] != second->min[1])
+    {
+        return first->min[1] < second->min[1] ? -1 : 1;
+    }
+    if(first->max[1] != second->max[1])
+    {
+        return first->max[1] < second->max[1] ? -1 : 1;
+    }
+    return first->min[0] < second->min[0] ? -1 : first->min[0] > second->min[0];
+}
+
+int compare_face_columns(const void* a, const void* b)
+{
+    const BlockFace* first  = a;
+    const BlockFace* second = b;
+
+    int result = compare_face_materials(first, second);
+    if(result != 0)
+    {
+        return result;
+    }
+    if(first->min[0] != second->min[0])
+    {
+        return first->min[0] < second->min[0] ? -1 : 1;
+    }
+    if(first->max[0] != second->max[0])
+    {
+        return first->max[0] < second->max[0] ? -1 : 1;
+    }
+    return first->min[1] < second->min[1] ? -1 : first->min[1] > second->min[1];
+}
+
+// Opaque faces covering the same rectangle back to back lie between two solid blocks and can never be seen
+uint32_t remove_hidden_faces(BlockFace* faces, uint32_t face_number)
+{
+    qsort(faces, face_number, sizeof(*faces), compare_face_rectangles);
+
+    for(uint32_t i = 0; i < face_number;)
+    {
+        uint32_t end = i + 1;
+        while(end < face_number && faces[end].axis == faces[i].axis && faces[end].plane == faces[i].plane &&
+              memcmp(faces[end].min, faces[i].min, sizeof(faces[i].min)) == 0 && memcmp(faces[end].max, faces[i].max, sizeof(faces[i].max)) == 0)
+        {
+            end++;
+        }
+
+        // Faces of the run are sorted by facing, pairs are taken from both ends
+        uint32_t back  = i;
+        uint32_t front = end - 1;
+        while(back < front && faces[back].facing < 0 && faces[front].facing > 0)
+        {
+            if(!faces[back].opaque)
+            {
+                back++;
+            }
+            else if(!faces[front].opaque)
+            {
+                front--;
+            }
+            else
+            {
+                faces[back++].removed  = true;
+                faces[front--].removed = true;
+            }
+        }
+        i = end;
+    }
+
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < face_number; i++)
+    {
+        if(!faces[i].removed)
+        {
+            faces[kept++] = faces[i];
+        }
+    }
+    return kept;
+}
+
+bool can_merge_faces(const BlockFace* a, const BlockFace* b, uint32_t dimension)
+{
+    uint32_t other = 1 - dimension;
+    if(compare_face_materials(a, b) != 0 || a->max[dimension] != b->min[dimension] || a->min[other] != b->min[other] || a->max[other] != b->max[other])
+    {
+        return false;
+    }
+
+    // The texture has to keep going across the edge, samplers repeat so whole texture offsets are fine
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        if(fabsf(a->uv_steps[0][i] - b->uv_steps[0][i]) > FACE_UV_EPSILON || fabsf(a->uv_steps[1][i] - b->uv_steps[1][i]) > FACE_UV_EPSILON)
+        {
+            return false;
+        }
+
+        float expected = a->uv_origin[i] + a->uv_steps[0][i] * (b->min[0] - a->min[0]) + a->uv_steps[1][i] * (b->min[1] - a->min[1]);
+        float offset   = expected - b->uv_origin[i];
+        if(fabsf(offset - roundf(offset)) > FACE_UV_EPSILON)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t merge_faces(BlockFace* faces, uint32_t face_number, uint32_t dimension)
+{
+    qsort(faces, face_number, sizeof(*faces), dimension == 0 ? compare_face_rows : compare_face_columns);
+
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < face_number; i++)
+    {
+        if(kept > 0 && can_merge_faces(&faces[kept - 1], &faces[i], dimension))
+        {
+            faces[kept - 1].max[dimension] = faces[i].max[dimension];
+        }
+        else
+        {
+            faces[kept++] = faces[i];
+        }
+    }
+    return kept;
+}
+
+int append_vertex(VertexHashMap* vertices_dictionnary, Vertex* vertices, uint32_t* vertices_number, const Vertex* vertex, uint32_t* indices, uint32_t* indices_number)
+{
+    uint32_t value;
+    if((value = (uint32_t) vertex_hashmap_get_value(vertices_dictionnary, vertex)) == (uint32_t) -1)
+    {
+        value = *vertices_number;
+        if(!vertex_hashmap_set_value(vertices_dictionnary, vertex, value))
+        {
+            return PIGMENT_ERROR;
+        }
+        vertices[(*vertices_number)++] = *vertex;
+    }
+    indices[(*indices_number)++] = value;
+
+    return PIGMENT_SUCCESS;
+}
+
+// Removes the faces between two solid blocks, then greedily merges coplanar faces into rows and the rows into
+// rectangles. The model is left untouched when anything fails.
+int merge_block_faces(PModel* model, const PTextureList* texture_list)
+{
+    uint32_t triangle_number            = model->indices_number / 3;
+    BlockFace* faces                    = malloc((triangle_number / 2 + 1) * sizeof(*faces));
+    uint32_t* triangles                 = malloc((triangle_number + 1) * sizeof(*triangles));
+    Vertex* vertices                    = NULL;
+    uint32_t* indices                   = NULL;
+    VertexHashMap* vertices_dictionnary = NULL;
+    int result                          = PIGMENT_ERROR;
+    if(faces == NULL || triangles == NULL)
+    {
+        perror("merge_block_faces");
+        goto FREE;
+    }
+
+    uint32_t face_number   = 0;
+    uint32_t triangle_kept = 0;
+    for(uint32_t i = 0; i + 2 < model->indices_number;)
+    {
+        if(i + 5 < model->indices_number && find_block_face(model, &model->indices[i], texture_list, &faces[face_number]))
+        {
+            face_number++;
+            i += 6;
+        }
+        else
+        {
+            triangles[triangle_kept++] = i;
+            i += 3;
+        }
+    }
+
+    face_number = remove_hidden_faces(faces, face_number);
+    face_number = merge_faces(faces, face_number, 0);
+    face_number = merge_faces(faces, face_number, 1);
+
+    uint32_t max_vertices = triangle_kept * 3 + face_number * 4;
+    uint32_t max_indices  = triangle_kept * 3 + face_number * 6;
+    vertices              = malloc((max_vertices + 1) * sizeof(*vertices));
+    indices               = malloc((max_indices + 1) * sizeof(*indices));
+    vertices_dictionnary  = vertex_hashmap_create();
+    if(vertices == NULL || indices == NULL || vertices_dictionnary == NULL)
+    {
+        perror("merge_block_faces");
+        goto FREE;
+    }
+
+    uint32_t vertices_number = 0;
+    uint32_t indices_number  = 0;
+    for(uint32_t i = 0; i < triangle_kept; i++)
+    {
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            if(append_vertex(vertices_dictionnary, vertices, &vertices_number, &model->vertices[model->indices[triangles[i] + j]], indices, &indices_number) != PIGMENT_SUCCESS)
+            {
+                goto FREE;
+            }
+        }
+    }
+
+    // Rectangle corners in the same order as when the faces were found, triangles keep the winding of the source ones
+    static const float corner_offsets[4][2] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+    static const uint32_t front_corners[6]  = {0, 1, 2, 0, 2, 3};
+    static const uint32_t back_corners[6]   = {0, 2, 1, 0, 3, 2};
+    for(uint32_t i = 0; i < face_number; i++)
+    {
+        BlockFace* face        = &faces[i];
+        uint32_t dimensions[2] = {(face->axis + 1) % 3, (face->axis + 2) % 3};
+        Vertex corners[4];
+
+        for(uint32_t j = 0; j < 4; j++)
+        {
+            float extent[2] = {(face->max[0] - face->min[0]) * corner_offsets[j][0], (face->max[1] - face->min[1]) * corner_offsets[j][1]};
+
+            corners[j]                    = face->attributes;
+            corners[j].pos[face->axis]    = face->plane;
+            corners[j].pos[dimensions[0]] = face->min[0] + extent[0];
+            corners[j].pos[dimensions[1]] = face->min[1] + extent[1];
+            corners[j].texture_coord[0]   = face->uv_origin[0] + face->uv_steps[0][0] * extent[0] + face->uv_steps[1][0] * extent[1];
+            corners[j].texture_coord[1]   = face->uv_origin[1] + face->uv_steps[0][1] * extent[0] + face->uv_steps[1][1] * extent[1];
+        }
+
+        const uint32_t* order = face->facing > 0 ? front_corners : back_corners;
+        for(uint32_t j = 0; j < 6; j++)
+        {
+            if(append_vertex(vertices_dictionnary, vertices, &vertices_number, &corners[order[j]], indices, &indices_number) != PIGMENT_SUCCESS)
+            {
+                goto FREE;
+            }
+        }
+    }
+
+    free(model->vertices);
+    free(model->indices);
+    model->vertices        = vertices;
+    model->vertices_number = vertices_number;
+    model->vertices_size   = max_vertices + 1;
+    model->indices         = indices;
+    model->indices_number  = indices_number;
+    model->indices_size    = max_indices + 1;
+    vertices               = NULL;
+    indices                = NULL;
+
+    result = PIGMENT_SUCCESS;
+
+FREE:
+    if(vertices_dictionnary != NULL)
+    {
+        vertex_hashmap_free(&vertices_dictionnary);
+    }
+    free(indices);
+    free(vertices);
+    free(triangles);
+    free(faces);
+    return result;
+}
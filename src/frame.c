@@ -17,16 +17,25 @@
 #include "frame.h"
 #include "structs.h"
 #include "synchronization.h"
+#include "texture.h"
+#include "instancing.h"
+#include "culling.h"
+#include "commands.h"
+#include "meshlets.h"
+#include "chunks.h"
+#include "geometry_pool.h"
+#include "deletion_queue.h"
+#include "window.h"
 
 extern VkFormat find_depth_format(VkPhysicalDevice physical_device);
-extern PSwapchain* recreate_swapchain(PSwapchain* previous_swapchain, PCommands* commands, PDevice* device, PSurface* surface, PWindow* window, PRenderPass* render_pass);
+extern PSwapchain* recreate_swapchain(PSwapchain* previous_swapchain, PDevice* device, PSurface* surface, PWindow* window, PRenderPass* render_pass);
 extern void update_uniform_buffer(PBuffers* buffers, PSwapchain* swapchain, PCamera* camera);
-extern void record_commands(VkCommandBuffer command_buffer, PPipeline* pipeline, PSwapchain* swapchain, PRenderPass* render_pass, uint32_t image_index, PBuffers* buffers, PDescriptor* descriptor);
+extern void record_commands(VkCommandBuffer command_buffer, PCommands* commands, PPipeline* pipeline, PSwapchain* swapchain, PRenderPass* render_pass, uint32_t image_index, PBuffers* buffers, PTextureList* textures, PInstancing* instancing, PCulling* culling, PChunks* chunks, PDescriptor* descriptor);
 
 
-PRenderPass* create_render_pass(PSwapchain* swapchain, PDevice* device)
+PRenderPass* create_render_pass(PSwapchain* swapchain, bool two_phase, PDevice* device)
 {
-    PRenderPass* render_pass = malloc(sizeof(*render_pass));
+    PRenderPass* render_pass = calloc(1, sizeof(*render_pass));
     if(render_pass == NULL)
     {
         perror("create_render_pass");
@@ -81,6 +90,13 @@ PRenderPass* create_render_pass(PSwapchain* swapchain, PDevice* device)
         .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
     };
 
+    if(two_phase)
+    {
+        // The first pass keeps its depth for the depth pyramid and leaves the image to the late pass
+        color_attachment_description.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        depth_attachment_description.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+    }
+
     VkAttachmentDescription attachments_description[] = {color_attachment_description, depth_attachment_description};
 
     VkRenderPassCreateInfo render_pass_create_info = {
@@ -100,6 +116,30 @@ PRenderPass* create_render_pass(PSwapchain* swapchain, PDevice* device)
         return NULL;
     }
 
+    if(!two_phase)
+    {
+        return render_pass;
+    }
+
+    // Draws instances that were occluded in the previous frame on top of the first pass
+    attachments_description[0].loadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments_description[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachments_description[0].finalLayout   = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachments_description[1].loadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments_description[1].storeOp       = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments_description[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    if(vkCreateRenderPass(device->logical_device, &render_pass_create_info, NULL, &(render_pass->late_render_pass)) != VK_SUCCESS)
+    {
+        fprintf(stderr, "failed to create late render pass!\n");
+        destroy_render_pass(render_pass, device);
+        return NULL;
+    }
+
     return render_pass;
 }
 
@@ -110,25 +150,34 @@ void destroy_render_pass(PRenderPass* render_pass, PDevice* device)
         return;
     }
     vkDestroyRenderPass(device->logical_device, render_pass->render_pass, NULL);
+    vkDestroyRenderPass(device->logical_device, render_pass->late_render_pass, NULL);
     free(render_pass);
 }
 
-void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PCommands* commands, PDescriptor* descriptor, PPipeline* pipeline, PSurface* surface, PWindow* window, PRenderPass* render_pass, PDevice* device, const uint32_t max_frame)
+void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PCommands* commands, PDescriptor* descriptor, PTextureList* textures, PInstancing* instancing, PCulling* culling, PChunks* chunks, PPipeline* pipeline, PSurface* surface, PWindow* window, PRenderPass* render_pass, PDevice* device, const uint32_t max_frame)
 {
-    if(window->framebuffer_resized)
+    // While the window is being resized, the swapchain is only recreated once the size settles, unless presenting is no longer possible
+    if(*swapchain != NULL && window->framebuffer_resized && (window->swapchain_out_of_date || glfwGetTime() - window->resize_time >= RESIZE_SETTLE_TIME))
     {
-        vkDeviceWaitIdle(device->logical_device);
+        window->framebuffer_resized   = false;
+        window->swapchain_out_of_date = false;
 
-        window->framebuffer_resized = false;
-        destroy_sync(*sync, device, (*swapchain), max_frame);
-        *swapchain = recreate_swapchain(*swapchain, commands, device, surface, window, render_pass);
+        // The old swapchain, semaphores and attachments go through the deletion queue, so the frames in flight keep running
+        *swapchain = recreate_swapchain(*swapchain, device, surface, window, render_pass);
         if(*swapchain == NULL)
         {
             fprintf(stderr, "Failed to recreate swap chain!\n");
             return;
         }
-        *sync = create_sync(device, max_frame, (*swapchain)->image_count);
-        (*swapchain)->current_frame = 0;
+        if(replace_render_semaphores(*sync, device, (*swapchain)->image_count) != PIGMENT_SUCCESS)
+        {
+            return;
+        }
+
+        if(culling != NULL && resize_culling(culling, *swapchain, device) != PIGMENT_SUCCESS)
+        {
+            fprintf(stderr, "Failed to resize depth pyramid!\n");
+        }
     }
 
     if(*swapchain == NULL)
@@ -143,11 +192,26 @@ void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PComman
 
     vkWaitForFences(device->logical_device, 1, &((*sync)->in_flight_fences[current_frame]), VK_TRUE, UINT64_MAX);
 
+    read_render_statistics(commands, device, current_frame);
+    update_textures(textures, device, current_frame);
+    update_geometry_pool(buffers->geometry_pool);
+    update_deletion_queue(device);
+    if(culling == NULL)
+    {
+        select_instance_lods(instancing, buffers);
+    }
+    update_instancing(instancing, descriptor, device, current_frame);
+    if(culling != NULL)
+    {
+        update_culling(culling, instancing, buffers, device, current_frame);
+    }
+
     result = vkAcquireNextImageKHR(device->logical_device, (*swapchain)->swapchain, UINT64_MAX, (*sync)->image_available_semaphores[current_frame], VK_NULL_HANDLE, &image_index);
 
     if(result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        window->framebuffer_resized = true;
+        window->framebuffer_resized   = true;
+        window->swapchain_out_of_date = true;
         return;
     }
     else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
@@ -157,11 +221,16 @@ void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PComman
     }
 
     update_uniform_buffer(buffers, *swapchain, window->camera);
+    update_chunks(chunks, buffers);
+    if(culling == NULL)
+    {
+        cull_meshlets(buffers, current_frame);
+    }
 
     vkResetFences(device->logical_device, 1, &((*sync)->in_flight_fences[current_frame]));
 
     vkResetCommandBuffer(commands->command_buffers[current_frame], 0);
-    record_commands(commands->command_buffers[current_frame], pipeline, *swapchain, render_pass, image_index, buffers, descriptor);
+    record_commands(commands->command_buffers[current_frame], commands, pipeline, *swapchain, render_pass, image_index, buffers, textures, instancing, culling, chunks, descriptor);
 
     VkSemaphore wait_semaphores[]      = {(*sync)->image_available_semaphores[current_frame]};
     VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -186,6 +255,11 @@ void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PComman
         return;
     }
 
+    // Frames are only counted once submitted, so a frame given up after acquiring cannot release what it retired early
+    advance_texture_frame(textures);
+    advance_geometry_frame(buffers->geometry_pool);
+    advance_deletion_frame(device);
+
     VkSwapchainKHR swapchains[] = {(*swapchain)->swapchain};
 
     VkPresentInfoKHR present_info = {
@@ -197,9 +271,14 @@ void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PComman
         .pImageIndices      = &image_index
     };
 
-    vkQueuePresentKHR(device->present_queue, &present_info);
+    result = vkQueuePresentKHR(device->present_queue, &present_info);
 
-    if(result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    if(result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        window->framebuffer_resized   = true;
+        window->swapchain_out_of_date = true;
+    }
+    else if(result == VK_SUBOPTIMAL_KHR)
     {
         window->framebuffer_resized = true;
     }
@@ -19,8 +19,8 @@
 
 #include "defines.h"
 
-PRenderPass* create_render_pass(PSwapchain* swapchain, PDevice* device);
+PRenderPass* create_render_pass(PSwapchain* swapchain, bool two_phase, PDevice* device);
 void destroy_render_pass(PRenderPass* render_pass, PDevice* device);
-void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PCommands* commands, PDescriptor* descriptor, PPipeline* pipeline, PSurface* surface, PWindow* window, PRenderPass* render_pass, PDevice* device, const uint32_t max_frame);
+void draw_frame(PBuffers* buffers, PSwapchain** swapchain, PSync** sync, PCommands* commands, PDescriptor* descriptor, PTextureList* textures, PInstancing* instancing, PCulling* culling, PChunks* chunks, PPipeline* pipeline, PSurface* surface, PWindow* window, PRenderPass* render_pass, PDevice* device, const uint32_t max_frame);
 
 #endif
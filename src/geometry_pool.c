@@ -0,0 +1,626 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "geometry_pool.h"
+#include "structs.h"
+
+#include "lib/array.h"
+
+extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
+extern int update_device_local_buffer(VkBuffer buffer, void* buffer_mapped, const void* data, VkDeviceSize offset, VkDeviceSize size, VkCommandPool command_pool, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+
+int create_pool_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, void** buffer_mapped, VkDeviceSize size, VkBufferUsageFlags usage, PDevice* device);
+int init_free_list(PGeometryFreeList* free_list, uint32_t capacity);
+int allocate_range(PGeometryFreeList* free_list, uint32_t count, uint32_t* offset);
+void release_range(PGeometryFreeList* free_list, uint32_t offset, uint32_t count);
+bool is_fragmented(const PGeometryFreeList* free_list);
+void retire_geometry(PGeometryPool* pool, const PGeometryAllocation* allocation);
+bool compact_geometry(PGeometryPool* pool, VkBufferCopy* vertex_move, VkBufferCopy* index_move);
+void record_geometry_uploads(VkCommandBuffer command_buffer, PGeometryPool* pool, uint32_t frame);
+
+PGeometryPool* create_geometry_pool(uint32_t vertex_capacity, uint32_t index_capacity, PDevice* device, uint32_t frame_count)
+{
+    PGeometryPool* pool = calloc(1, sizeof(*pool));
+    if(pool == NULL)
+    {
+        perror("create_geometry_pool");
+        return NULL;
+    }
+
+    pool->frame_count = frame_count;
+
+    if(init_free_list(&pool->vertex_space, vertex_capacity) != PIGMENT_SUCCESS || init_free_list(&pool->index_space, index_capacity) != PIGMENT_SUCCESS)
+    {
+        perror("create_geometry_pool");
+        goto ERROR;
+    }
+
+    // Ranges are copied within the buffers when the pool is compacted
+    if(create_pool_buffer(&pool->vertex_buffer, &pool->vertex_buffer_memory, &pool->vertex_buffer_mapped, (VkDeviceSize) vertex_capacity * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, device) != PIGMENT_SUCCESS ||
+       create_pool_buffer(&pool->index_buffer, &pool->index_buffer_memory, &pool->index_buffer_mapped, (VkDeviceSize) index_capacity * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, device) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+
+    // Geometry is written straight into mapped buffers, staging is only needed by the other devices
+    if(pool->vertex_buffer_mapped != NULL && pool->index_buffer_mapped != NULL)
+    {
+        return pool;
+    }
+
+    pool->staging_buffers        = calloc(frame_count, sizeof(*pool->staging_buffers));
+    pool->staging_buffers_memory = calloc(frame_count, sizeof(*pool->staging_buffers_memory));
+    pool->staging_buffers_mapped = calloc(frame_count, sizeof(*pool->staging_buffers_mapped));
+    if(pool->staging_buffers == NULL || pool->staging_buffers_memory == NULL || pool->staging_buffers_mapped == NULL)
+    {
+        perror("create_geometry_pool");
+        goto ERROR;
+    }
+
+    // Each frame in flight fills its own staging buffer, which is free again once its fence is signaled
+    for(uint32_t i = 0; i < frame_count; i++)
+    {
+        if(create_buffer(&pool->staging_buffers[i], &pool->staging_buffers_memory[i], GEOMETRY_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+        {
+            goto ERROR;
+        }
+        if(vkMapMemory(device->logical_device, pool->staging_buffers_memory[i], 0, GEOMETRY_STAGING_SIZE, 0, &pool->staging_buffers_mapped[i]) != VK_SUCCESS)
+        {
+            fprintf(stderr, "Failed to map geometry staging buffer!\n");
+            goto ERROR;
+        }
+    }
+
+    return pool;
+
+ERROR:
+    destroy_geometry_pool(pool, device);
+    return NULL;
+}
+
+void destroy_geometry_pool(PGeometryPool* pool, PDevice* device)
+{
+    if(pool == NULL)
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; pool->staging_buffers != NULL && pool->staging_buffers_memory != NULL && i < pool->frame_count; i++)
+    {
+        if(pool->staging_buffers_mapped != NULL && pool->staging_buffers_mapped[i] != NULL)
+        {
+            vkUnmapMemory(device->logical_device, pool->staging_buffers_memory[i]);
+        }
+        vkDestroyBuffer(device->logical_device, pool->staging_buffers[i], NULL);
+        free_device_memory(pool->staging_buffers_memory[i], device);
+    }
+
+    if(pool->vertex_buffer_mapped != NULL)
+    {
+        vkUnmapMemory(device->logical_device, pool->vertex_buffer_memory);
+    }
+    if(pool->index_buffer_mapped != NULL)
+    {
+        vkUnmapMemory(device->logical_device, pool->index_buffer_memory);
+    }
+
+    vkDestroyBuffer(device->logical_device, pool->vertex_buffer, NULL);
+    free_device_memory(pool->vertex_buffer_memory, device);
+    vkDestroyBuffer(device->logical_device, pool->index_buffer, NULL);
+    free_device_memory(pool->index_buffer_memory, device);
+
+    for(uint32_t i = 0; i < pool->upload_number; i++)
+    {
+        free(pool->uploads[i].data);
+    }
+
+    free(pool->staging_buffers);
+    free(pool->staging_buffers_memory);
+    free(pool->staging_buffers_mapped);
+    free(pool->vertex_copies);
+    free(pool->index_copies);
+    free(pool->uploads);
+    free(pool->retired);
+    free(pool->free_allocations);
+    free(pool->allocations);
+    free(pool->vertex_space.ranges);
+    free(pool->index_space.ranges);
+    free(pool);
+}
+
+// On ReBAR and UMA devices the buffer stays mapped, see create_device_local_buffer
+int create_pool_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, void** buffer_mapped, VkDeviceSize size, VkBufferUsageFlags usage, PDevice* device)
+{
+    *buffer_mapped = NULL;
+
+    if(device->direct_buffer_upload && create_buffer(buffer, buffer_memory, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) == PIGMENT_SUCCESS)
+    {
+        if(vkMapMemory(device->logical_device, *buffer_memory, 0, size, 0, buffer_mapped) == VK_SUCCESS)
+        {
+            return PIGMENT_SUCCESS;
+        }
+
+        *buffer_mapped = NULL;
+        vkDestroyBuffer(device->logical_device, *buffer, NULL);
+        free_device_memory(*buffer_memory, device);
+    }
+
+    return create_buffer(buffer, buffer_memory, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device);
+}
+
+int init_free_list(PGeometryFreeList* free_list, uint32_t capacity)
+{
+    if(reserve_array((void**) &free_list->ranges, &free_list->range_size, 1, sizeof(*free_list->ranges)) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    free_list->ranges[0] = (PGeometryRange) {
+        .offset = 0,
+        .count  = capacity
+    };
+    free_list->range_number = 1;
+    free_list->capacity     = capacity;
+    free_list->free_count   = capacity;
+
+    return PIGMENT_SUCCESS;
+}
+
+// Free ranges are sorted by offset, the first one large enough is used so that the start of the buffers fills up first
+int allocate_range(PGeometryFreeList* free_list, uint32_t count, uint32_t* offset)
+{
+    for(uint32_t i = 0; i < free_list->range_number; i++)
+    {
+        PGeometryRange* range = &free_list->ranges[i];
+        if(range->count < count)
+        {
+            continue;
+        }
+
+        *offset        = range->offset;
+        range->offset += count;
+        range->count  -= count;
+        if(range->count == 0)
+        {
+            free_list->range_number--;
+            memmove(range, range + 1, (free_list->range_number - i) * sizeof(*range));
+        }
+        free_list->free_count -= count;
+
+        return PIGMENT_SUCCESS;
+    }
+
+    return PIGMENT_ERROR;
+}
+
+void release_range(PGeometryFreeList* free_list, uint32_t offset, uint32_t count)
+{
+    uint32_t next = 0;
+    while(next < free_list->range_number && free_list->ranges[next].offset < offset)
+    {
+        next++;
+    }
+
+    bool joins_previous = next > 0 && free_list->ranges[next - 1].offset + free_list->ranges[next - 1].count == offset;
+    bool joins_next     = next < free_list->range_number && offset + count == free_list->ranges[next].offset;
+
+    free_list->free_count += count;
+
+    if(joins_previous && joins_next)
+    {
+        free_list->ranges[next - 1].count += count + free_list->ranges[next].count;
+        free_list->range_number--;
+        memmove(&free_list->ranges[next], &free_list->ranges[next + 1], (free_list->range_number - next) * sizeof(*free_list->ranges));
+        return;
+    }
+    if(joins_previous)
+    {
+        free_list->ranges[next - 1].count += count;
+        return;
+    }
+    if(joins_next)
+    {
+        free_list->ranges[next].offset  = offset;
+        free_list->ranges[next].count  += count;
+        return;
+    }
+
+    if(reserve_array((void**) &free_list->ranges, &free_list->range_size, free_list->range_number + 1, sizeof(*free_list->ranges)) != PIGMENT_SUCCESS)
+    {
+        // The range is lost until the pool is destroyed
+        perror("release_range");
+        free_list->free_count -= count;
+        return;
+    }
+
+    memmove(&free_list->ranges[next + 1], &free_list->ranges[next], (free_list->range_number - next) * sizeof(*free_list->ranges));
+    free_list->ranges[next] = (PGeometryRange) {
+        .offset = offset,
+        .count  = count
+    };
+    free_list->range_number++;
+}
+
+bool is_fragmented(const PGeometryFreeList* free_list)
+{
+    uint32_t largest = 0;
+    for(uint32_t i = 0; i < free_list->range_number; i++)
+    {
+        largest = free_list->ranges[i].count > largest ? free_list->ranges[i].count : largest;
+    }
+
+    return (uint64_t) largest * 100u < (uint64_t) free_list->free_count * (100u - GEOMETRY_FRAGMENTATION_PERCENT);
+}
+
+uint32_t allocate_geometry(PGeometryPool* pool, uint32_t vertex_count, uint32_t index_count, bool movable)
+{
+    if(vertex_count == 0 || index_count == 0)
+    {
+        return GEOMETRY_NO_ALLOCATION;
+    }
+
+    uint32_t allocation_index = pool->allocation_number;
+    if(pool->free_allocation_number > 0)
+    {
+        allocation_index = pool->free_allocations[pool->free_allocation_number - 1];
+    }
+    else if(reserve_array((void**) &pool->allocations, &pool->allocation_size, pool->allocation_number + 1, sizeof(*pool->allocations)) != PIGMENT_SUCCESS)
+    {
+        perror("allocate_geometry");
+        return GEOMETRY_NO_ALLOCATION;
+    }
+
+    PGeometryAllocation allocation = {
+        .vertex_count = vertex_count,
+        .index_count  = index_count,
+        .live         = true,
+        .movable      = movable
+    };
+
+    if(allocate_range(&pool->vertex_space, vertex_count, &allocation.vertex_offset) != PIGMENT_SUCCESS)
+    {
+        return GEOMETRY_NO_ALLOCATION;
+    }
+    if(allocate_range(&pool->index_space, index_count, &allocation.first_index) != PIGMENT_SUCCESS)
+    {
+        release_range(&pool->vertex_space, allocation.vertex_offset, vertex_count);
+        return GEOMETRY_NO_ALLOCATION;
+    }
+
+    if(allocation_index == pool->allocation_number)
+    {
+        pool->allocation_number++;
+    }
+    else
+    {
+        pool->free_allocation_number--;
+    }
+    pool->allocations[allocation_index] = allocation;
+
+    return allocation_index;
+}
+
+void release_geometry(PGeometryPool* pool, uint32_t allocation_index)
+{
+    if(pool == NULL || allocation_index >= pool->allocation_number || !pool->allocations[allocation_index].live)
+    {
+        return;
+    }
+
+    PGeometryAllocation* allocation = &pool->allocations[allocation_index];
+
+    // An upload that was not recorded yet goes away with its allocation
+    for(uint32_t i = 0; i < pool->upload_number; i++)
+    {
+        if(pool->uploads[i].allocation == allocation_index)
+        {
+            free(pool->uploads[i].data);
+            pool->upload_number--;
+            memmove(&pool->uploads[i], &pool->uploads[i + 1], (pool->upload_number - i) * sizeof(*pool->uploads));
+            break;
+        }
+    }
+
+    // Ranges the device never read are free right away, the others once the frames in flight are done with them
+    if(allocation->uploaded)
+    {
+        retire_geometry(pool, allocation);
+    }
+    else
+    {
+        release_range(&pool->vertex_space, allocation->vertex_offset, allocation->vertex_count);
+        release_range(&pool->index_space, allocation->first_index, allocation->index_count);
+    }
+
+    allocation->live = false;
+    if(push_free_index(&pool->free_allocations, &pool->free_allocation_number, &pool->free_allocation_size, allocation_index) != PIGMENT_SUCCESS)
+    {
+        perror("release_geometry");
+    }
+}
+
+void retire_geometry(PGeometryPool* pool, const PGeometryAllocation* allocation)
+{
+    if(reserve_array((void**) &pool->retired, &pool->retired_size, pool->retired_number + 1, sizeof(*pool->retired)) != PIGMENT_SUCCESS)
+    {
+        // The ranges are lost until the pool is destroyed
+        perror("retire_geometry");
+        return;
+    }
+
+    pool->retired[pool->retired_number++] = (PRetiredGeometry) {
+        .vertices = {allocation->vertex_offset, allocation->vertex_count},
+        .indices  = {allocation->first_index, allocation->index_count},
+        .frame    = pool->frame
+    };
+}
+
+void update_geometry_pool(PGeometryPool* pool)
+{
+    if(pool == NULL)
+    {
+        return;
+    }
+
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < pool->retired_number; i++)
+    {
+        PRetiredGeometry* retired = &pool->retired[i];
+        if(pool->frame < retired->frame + pool->frame_count)
+        {
+            pool->retired[kept++] = *retired;
+            continue;
+        }
+
+        release_range(&pool->vertex_space, retired->vertices.offset, retired->vertices.count);
+        release_range(&pool->index_space, retired->indices.offset, retired->indices.count);
+    }
+    pool->retired_number = kept;
+}
+
+void advance_geometry_frame(PGeometryPool* pool)
+{
+    if(pool != NULL)
+    {
+        pool->frame++;
+    }
+}
+
+int write_geometry(PGeometryPool* pool, uint32_t allocation_index, const Vertex* vertices, const uint32_t* indices, PCommands* commands, PDevice* device)
+{
+    PGeometryAllocation* allocation = &pool->allocations[allocation_index];
+
+    // Fresh ranges are not read by any frame in flight, mapped buffers are written in place without waiting for the device
+    if(update_device_local_buffer(pool->vertex_buffer, pool->vertex_buffer_mapped, vertices, (VkDeviceSize) allocation->vertex_offset * sizeof(Vertex), (VkDeviceSize) allocation->vertex_count * sizeof(Vertex), commands->command_pool, device) != PIGMENT_SUCCESS ||
+       update_device_local_buffer(pool->index_buffer, pool->index_buffer_mapped, indices, (VkDeviceSize) allocation->first_index * sizeof(uint32_t), (VkDeviceSize) allocation->index_count * sizeof(uint32_t), commands->command_pool, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    allocation->uploaded = true;
+    return PIGMENT_SUCCESS;
+}
+
+int queue_geometry_upload(PGeometryPool* pool, uint32_t allocation_index, const Vertex* vertices, const uint32_t* indices)
+{
+    PGeometryAllocation* allocation = &pool->allocations[allocation_index];
+    size_t vertex_size              = allocation->vertex_count * sizeof(Vertex);
+    size_t index_size               = allocation->index_count * sizeof(uint32_t);
+
+    // The ranges are fresh, the next submit sees them without any copy
+    if(pool->vertex_buffer_mapped != NULL && pool->index_buffer_mapped != NULL)
+    {
+        memcpy((char*) pool->vertex_buffer_mapped + (size_t) allocation->vertex_offset * sizeof(Vertex), vertices, vertex_size);
+        memcpy((char*) pool->index_buffer_mapped + (size_t) allocation->first_index * sizeof(uint32_t), indices, index_size);
+        allocation->uploaded = true;
+        return PIGMENT_SUCCESS;
+    }
+
+    if(vertex_size + index_size > GEOMETRY_STAGING_SIZE)
+    {
+        fprintf(stderr, "Failed to queue geometry upload, it does not fit in a staging buffer!\n");
+        return PIGMENT_ERROR;
+    }
+
+    if(reserve_array((void**) &pool->uploads, &pool->upload_size, pool->upload_number + 1, sizeof(*pool->uploads)) != PIGMENT_SUCCESS)
+    {
+        perror("queue_geometry_upload");
+        return PIGMENT_ERROR;
+    }
+    if(pool->copy_size < pool->upload_size)
+    {
+        VkBufferCopy* vertex_copies = realloc(pool->vertex_copies, pool->upload_size * sizeof(*vertex_copies));
+        if(vertex_copies == NULL)
+        {
+            perror("queue_geometry_upload");
+            return PIGMENT_ERROR;
+        }
+        pool->vertex_copies = vertex_copies;
+
+        VkBufferCopy* index_copies = realloc(pool->index_copies, pool->upload_size * sizeof(*index_copies));
+        if(index_copies == NULL)
+        {
+            perror("queue_geometry_upload");
+            return PIGMENT_ERROR;
+        }
+        pool->index_copies = index_copies;
+        pool->copy_size    = pool->upload_size;
+    }
+
+    // Vertices and indices are kept together, in the layout they get in the staging buffer
+    void* data = malloc(vertex_size + index_size);
+    if(data == NULL)
+    {
+        perror("queue_geometry_upload");
+        return PIGMENT_ERROR;
+    }
+    memcpy(data, vertices, vertex_size);
+    memcpy((char*) data + vertex_size, indices, index_size);
+
+    pool->uploads[pool->upload_number++] = (PGeometryUpload) {
+        .allocation = allocation_index,
+        .data       = data
+    };
+
+    return PIGMENT_SUCCESS;
+}
+
+// Moves the movable allocation that ends the furthest in a fragmented space into the first gap that fits it
+bool compact_geometry(PGeometryPool* pool, VkBufferCopy* vertex_move, VkBufferCopy* index_move)
+{
+    bool vertices_fragmented = is_fragmented(&pool->vertex_space);
+    if(!vertices_fragmented && !is_fragmented(&pool->index_space))
+    {
+        return false;
+    }
+
+    uint32_t moved_index = GEOMETRY_NO_ALLOCATION;
+    uint32_t moved_end   = 0;
+    for(uint32_t i = 0; i < pool->allocation_number; i++)
+    {
+        const PGeometryAllocation* allocation = &pool->allocations[i];
+        if(!allocation->live || !allocation->movable || !allocation->uploaded)
+        {
+            continue;
+        }
+
+        uint32_t end = vertices_fragmented ? allocation->vertex_offset + allocation->vertex_count : allocation->first_index + allocation->index_count;
+        if(end > moved_end)
+        {
+            moved_index = i;
+            moved_end   = end;
+        }
+    }
+    if(moved_index == GEOMETRY_NO_ALLOCATION)
+    {
+        return false;
+    }
+
+    PGeometryAllocation* allocation = &pool->allocations[moved_index];
+    uint32_t vertex_offset;
+    uint32_t first_index;
+
+    if(allocate_range(&pool->vertex_space, allocation->vertex_count, &vertex_offset) != PIGMENT_SUCCESS)
+    {
+        return false;
+    }
+    if(allocate_range(&pool->index_space, allocation->index_count, &first_index) != PIGMENT_SUCCESS)
+    {
+        release_range(&pool->vertex_space, vertex_offset, allocation->vertex_count);
+        return false;
+    }
+    if(vertex_offset > allocation->vertex_offset || first_index > allocation->first_index)
+    {
+        release_range(&pool->vertex_space, vertex_offset, allocation->vertex_count);
+        release_range(&pool->index_space, first_index, allocation->index_count);
+        return false;
+    }
+
+    *vertex_move = (VkBufferCopy) {
+        .srcOffset = (VkDeviceSize) allocation->vertex_offset * sizeof(Vertex),
+        .dstOffset = (VkDeviceSize) vertex_offset * sizeof(Vertex),
+        .size      = (VkDeviceSize) allocation->vertex_count * sizeof(Vertex)
+    };
+    *index_move = (VkBufferCopy) {
+        .srcOffset = (VkDeviceSize) allocation->first_index * sizeof(uint32_t),
+        .dstOffset = (VkDeviceSize) first_index * sizeof(uint32_t),
+        .size      = (VkDeviceSize) allocation->index_count * sizeof(uint32_t)
+    };
+
+    // Frames in flight still draw from the old ranges
+    retire_geometry(pool, allocation);
+    allocation->vertex_offset = vertex_offset;
+    allocation->first_index   = first_index;
+
+    return true;
+}
+
+void record_geometry_uploads(VkCommandBuffer command_buffer, PGeometryPool* pool, uint32_t frame)
+{
+    VkBufferCopy vertex_move;
+    VkBufferCopy index_move;
+    bool moved = compact_geometry(pool, &vertex_move, &index_move);
+
+    VkDeviceSize staging_offset = 0;
+    uint32_t copy_count         = 0;
+
+    // Uploads that do not fit in this frame's staging buffer wait for the next frame
+    for(; copy_count < pool->upload_number; copy_count++)
+    {
+        PGeometryUpload* upload         = &pool->uploads[copy_count];
+        PGeometryAllocation* allocation = &pool->allocations[upload->allocation];
+        VkDeviceSize vertex_size        = (VkDeviceSize) allocation->vertex_count * sizeof(Vertex);
+        VkDeviceSize index_size         = (VkDeviceSize) allocation->index_count * sizeof(uint32_t);
+
+        if(staging_offset + vertex_size + index_size > GEOMETRY_STAGING_SIZE)
+        {
+            break;
+        }
+
+        memcpy((char*) pool->staging_buffers_mapped[frame] + staging_offset, upload->data, (size_t) (vertex_size + index_size));
+        free(upload->data);
+
+        pool->vertex_copies[copy_count] = (VkBufferCopy) {
+            .srcOffset = staging_offset,
+            .dstOffset = (VkDeviceSize) allocation->vertex_offset * sizeof(Vertex),
+            .size      = vertex_size
+        };
+        pool->index_copies[copy_count] = (VkBufferCopy) {
+            .srcOffset = staging_offset + vertex_size,
+            .dstOffset = (VkDeviceSize) allocation->first_index * sizeof(uint32_t),
+            .size      = index_size
+        };
+
+        staging_offset      += vertex_size + index_size;
+        allocation->uploaded = true;
+    }
+
+    pool->upload_number -= copy_count;
+    memmove(pool->uploads, &pool->uploads[copy_count], pool->upload_number * sizeof(*pool->uploads));
+
+    if(!moved && copy_count == 0)
+    {
+        return;
+    }
+
+    if(moved)
+    {
+        // The moved ranges may have been uploaded by the previous frames
+        VkMemoryBarrier move_barrier = {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
+        };
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &move_barrier, 0, NULL, 0, NULL);
+        vkCmdCopyBuffer(command_buffer, pool->vertex_buffer, pool->vertex_buffer, 1, &vertex_move);
+        vkCmdCopyBuffer(command_buffer, pool->index_buffer, pool->index_buffer, 1, &index_move);
+    }
+    if(copy_count > 0)
+    {
+        vkCmdCopyBuffer(command_buffer, pool->staging_buffers[frame], pool->vertex_buffer, copy_count, pool->vertex_copies);
+        vkCmdCopyBuffer(command_buffer, pool->staging_buffers[frame], pool->index_buffer, copy_count, pool->index_copies);
+    }
+
+    VkMemoryBarrier upload_barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &upload_barrier, 0, NULL, 0, NULL);
+}
@@ -0,0 +1,36 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+#define GEOMETRY_POOL_SPARE_VERTICES (1u << 18)
+#define GEOMETRY_POOL_SPARE_INDICES (3u << 18)
+#define GEOMETRY_STAGING_SIZE (8ull * 1024ull * 1024ull)
+#define GEOMETRY_FRAGMENTATION_PERCENT 50
+#define GEOMETRY_NO_ALLOCATION UINT32_MAX
+
+#include "defines.h"
+
+PGeometryPool* create_geometry_pool(uint32_t vertex_capacity, uint32_t index_capacity, PDevice* device, uint32_t frame_count);
+uint32_t allocate_geometry(PGeometryPool* pool, uint32_t vertex_count, uint32_t index_count, bool movable);
+void release_geometry(PGeometryPool* pool, uint32_t allocation);
+int write_geometry(PGeometryPool* pool, uint32_t allocation, const Vertex* vertices, const uint32_t* indices, PCommands* commands, PDevice* device);
+int queue_geometry_upload(PGeometryPool* pool, uint32_t allocation, const Vertex* vertices, const uint32_t* indices);
+void update_geometry_pool(PGeometryPool* pool);
+void advance_geometry_frame(PGeometryPool* pool);
+void destroy_geometry_pool(PGeometryPool* pool, PDevice* device);
+
+#endif
@@ -0,0 +1,401 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "instancing.h"
+#include "structs.h"
+#include "descriptor.h"
+#include "culling.h"
+#include "lod.h"
+
+#include "lib/array.h"
+
+extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+
+#define NO_MESH UINT32_MAX
+
+int create_instance_buffer(PInstanceBuffer* instance_buffer, uint32_t capacity, bool gpu_culling, PDevice* device);
+void destroy_instance_buffer(PInstanceBuffer* instance_buffer, PDevice* device);
+void write_instance_descriptor(VkDescriptorSet descriptor_set, uint32_t binding, VkBuffer buffer, VkDevice device);
+void pack_instances(PInstancing* instancing, InstanceData* packed);
+
+PInstancing* create_instancing(uint32_t mesh_number, bool gpu_culling, PDevice* device, uint32_t frame_count)
+{
+    PInstancing* instancing = calloc(1, sizeof(*instancing));
+    if(instancing == NULL)
+    {
+        goto ERROR;
+    }
+
+    instancing->mesh_number = mesh_number;
+    instancing->frame_count = frame_count;
+    instancing->gpu_culling = gpu_culling;
+
+    // Instances are batched per level of detail of each mesh
+    instancing->instances     = malloc(INITIAL_INSTANCE_CAPACITY * sizeof(*instancing->instances));
+    instancing->instance_lods = calloc(INITIAL_INSTANCE_CAPACITY, sizeof(*instancing->instance_lods));
+    instancing->batch_offsets = calloc(mesh_number * MAX_MESH_LODS + 1, sizeof(*instancing->batch_offsets));
+    instancing->batch_counts  = calloc(mesh_number * MAX_MESH_LODS + 1, sizeof(*instancing->batch_counts));
+    instancing->frame_buffers = calloc(frame_count, sizeof(*instancing->frame_buffers));
+    if(instancing->instances == NULL || instancing->instance_lods == NULL || instancing->batch_offsets == NULL || instancing->batch_counts == NULL || instancing->frame_buffers == NULL)
+    {
+        goto ERROR;
+    }
+
+    instancing->instance_size = INITIAL_INSTANCE_CAPACITY;
+
+    // The first instance is the one used by the static model, it leaves its transform to the push constant
+    InstanceData static_instance = {
+        .model         = GLM_MAT4_IDENTITY_INIT,
+        .color         = {1.0f, 1.0f, 1.0f, 1.0f},
+        .texture_index = INSTANCE_TEXTURE_FROM_VERTEX,
+        .texture_layer = 0,
+        .mesh_index    = NO_MESH
+    };
+    instancing->instances[STATIC_INSTANCE] = static_instance;
+    instancing->instance_number            = 1;
+
+    for(uint32_t i = 0; i < frame_count; i++)
+    {
+        if(create_instance_buffer(&instancing->frame_buffers[i], INITIAL_INSTANCE_CAPACITY, gpu_culling, device) != PIGMENT_SUCCESS)
+        {
+            destroy_instancing(instancing, device);
+            return NULL;
+        }
+    }
+
+    instancing->pending_frames = (1u << frame_count) - 1u;
+
+    return instancing;
+
+ERROR:
+    perror("create_instancing");
+    destroy_instancing(instancing, device);
+    return NULL;
+}
+
+void destroy_instancing(PInstancing* instancing, PDevice* device)
+{
+    if(instancing == NULL)
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; instancing->frame_buffers != NULL && i < instancing->frame_count; i++)
+    {
+        destroy_instance_buffer(&instancing->frame_buffers[i], device);
+    }
+
+    free(instancing->instances);
+    free(instancing->instance_lods);
+    free(instancing->free_instances);
+    free(instancing->batch_offsets);
+    free(instancing->batch_counts);
+    free(instancing->frame_buffers);
+    free(instancing);
+}
+
+int create_instance_buffer(PInstanceBuffer* instance_buffer, uint32_t capacity, bool gpu_culling, PDevice* device)
+{
+    VkDeviceSize buffer_size = capacity * sizeof(InstanceData);
+
+    if(create_buffer(&instance_buffer->buffer, &instance_buffer->memory, buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    if(vkMapMemory(device->logical_device, instance_buffer->memory, 0, buffer_size, 0, (void**) &instance_buffer->mapped) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to map instance buffer!\n");
+        return PIGMENT_ERROR;
+    }
+
+    // Only written by the culling pass, which lists the visible instances of each level of detail for both draw phases,
+    // and keeps which instances passed the occlusion test for the next time this frame is rendered
+    if(gpu_culling && create_buffer(&instance_buffer->visible_buffer, &instance_buffer->visible_memory, CULL_PHASE_COUNT * MAX_MESH_LODS * capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+    if(gpu_culling && create_buffer(&instance_buffer->visibility_buffer, &instance_buffer->visibility_memory, capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    instance_buffer->capacity = capacity;
+
+    return PIGMENT_SUCCESS;
+}
+
+void destroy_instance_buffer(PInstanceBuffer* instance_buffer, PDevice* device)
+{
+    if(instance_buffer->mapped != NULL)
+    {
+        vkUnmapMemory(device->logical_device, instance_buffer->memory);
+    }
+    vkDestroyBuffer(device->logical_device, instance_buffer->buffer, NULL);
+    free_device_memory(instance_buffer->memory, device);
+    vkDestroyBuffer(device->logical_device, instance_buffer->visible_buffer, NULL);
+    free_device_memory(instance_buffer->visible_memory, device);
+    vkDestroyBuffer(device->logical_device, instance_buffer->visibility_buffer, NULL);
+    free_device_memory(instance_buffer->visibility_memory, device);
+
+    memset(instance_buffer, 0, sizeof(*instance_buffer));
+}
+
+void write_instance_descriptor(VkDescriptorSet descriptor_set, uint32_t binding, VkBuffer buffer, VkDevice device)
+{
+    VkDescriptorBufferInfo buffer_info = {
+        .buffer = buffer,
+        .offset = 0,
+        .range  = VK_WHOLE_SIZE
+    };
+
+    VkWriteDescriptorSet descriptor_write = {
+        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet          = descriptor_set,
+        .dstBinding      = binding,
+        .dstArrayElement = 0,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .pBufferInfo     = &buffer_info
+    };
+
+    vkUpdateDescriptorSets(device, 1, &descriptor_write, 0, NULL);
+}
+
+uint32_t add_instance(PInstancing* instancing, uint32_t mesh_index, mat4 transform, uint32_t texture_index, uint32_t texture_layer, const float* color)
+{
+    if(mesh_index >= instancing->mesh_number)
+    {
+        fprintf(stderr, "Failed to add instance, mesh %u does not exist!\n", mesh_index);
+        return UINT32_MAX;
+    }
+
+    uint32_t instance_index;
+    if(instancing->free_instance_number > 0)
+    {
+        instance_index = instancing->free_instances[--instancing->free_instance_number];
+    }
+    else
+    {
+        if(instancing->instance_number >= instancing->instance_size)
+        {
+            uint32_t size         = instancing->instance_size * 2;
+            InstanceData* resized = realloc(instancing->instances, size * sizeof(*resized));
+            if(resized == NULL)
+            {
+                perror("add_instance");
+                return UINT32_MAX;
+            }
+            instancing->instances = resized;
+
+            uint32_t* resized_lods = realloc(instancing->instance_lods, size * sizeof(*resized_lods));
+            if(resized_lods == NULL)
+            {
+                perror("add_instance");
+                return UINT32_MAX;
+            }
+            instancing->instance_lods = resized_lods;
+            instancing->instance_size = size;
+        }
+        instance_index = instancing->instance_number++;
+    }
+
+    InstanceData* instance = &instancing->instances[instance_index];
+    glm_mat4_ucopy(transform, instance->model);
+    instance->color[0]      = color != NULL ? color[0] : 1.0f;
+    instance->color[1]      = color != NULL ? color[1] : 1.0f;
+    instance->color[2]      = color != NULL ? color[2] : 1.0f;
+    instance->color[3]      = color != NULL ? color[3] : 1.0f;
+    instance->texture_index = texture_index;
+    instance->texture_layer = texture_layer;
+    instance->mesh_index    = mesh_index;
+    instance->batch_offset  = 0;
+
+    instancing->instance_lods[instance_index] = 0;
+
+    instancing->pending_frames = (1u << instancing->frame_count) - 1u;
+
+    return instance_index;
+}
+
+void set_instance_transform(PInstancing* instancing, uint32_t instance_index, mat4 transform)
+{
+    if(instance_index == STATIC_INSTANCE || instance_index >= instancing->instance_number || instancing->instances[instance_index].mesh_index == NO_MESH)
+    {
+        return;
+    }
+
+    glm_mat4_ucopy(transform, instancing->instances[instance_index].model);
+    instancing->pending_frames = (1u << instancing->frame_count) - 1u;
+}
+
+void remove_instance(PInstancing* instancing, uint32_t instance_index)
+{
+    if(instance_index == STATIC_INSTANCE || instance_index >= instancing->instance_number || instancing->instances[instance_index].mesh_index == NO_MESH)
+    {
+        return;
+    }
+
+    if(push_free_index(&instancing->free_instances, &instancing->free_instance_number, &instancing->free_instance_size, instance_index) != PIGMENT_SUCCESS)
+    {
+        perror("remove_instance");
+        return;
+    }
+
+    instancing->instances[instance_index].mesh_index = NO_MESH;
+    instancing->pending_frames = (1u << instancing->frame_count) - 1u;
+}
+
+void set_instance_texture(PInstancing* instancing, uint32_t instance_index, uint32_t texture_index, uint32_t texture_layer)
+{
+    if(instance_index == STATIC_INSTANCE || instance_index >= instancing->instance_number || instancing->instances[instance_index].mesh_index == NO_MESH)
+    {
+        return;
+    }
+
+    instancing->instances[instance_index].texture_index = texture_index;
+    instancing->instances[instance_index].texture_layer = texture_layer;
+    instancing->pending_frames = (1u << instancing->frame_count) - 1u;
+}
+
+void remove_mesh_instances(PInstancing* instancing, uint32_t mesh_index)
+{
+    for(uint32_t i = STATIC_INSTANCE + 1; i < instancing->instance_number; i++)
+    {
+        if(instancing->instances[i].mesh_index == mesh_index)
+        {
+            remove_instance(instancing, i);
+        }
+    }
+}
+
+void pack_instances(PInstancing* instancing, InstanceData* packed)
+{
+    // Instances of the same mesh and level of detail are made contiguous so that each of them is a single draw.
+    // With GPU culling every instance stays at the first level here, and the culling pass picks their level.
+    uint32_t batch_number = instancing->mesh_number * MAX_MESH_LODS;
+
+    memset(instancing->batch_counts, 0, batch_number * sizeof(*instancing->batch_counts));
+    for(uint32_t i = STATIC_INSTANCE + 1; i < instancing->instance_number; i++)
+    {
+        if(instancing->instances[i].mesh_index != NO_MESH)
+        {
+            instancing->batch_counts[instancing->instances[i].mesh_index * MAX_MESH_LODS + instancing->instance_lods[i]]++;
+        }
+    }
+
+    uint32_t offset = STATIC_INSTANCE + 1;
+    for(uint32_t i = 0; i < batch_number; i++)
+    {
+        instancing->batch_offsets[i] = offset;
+        offset += instancing->batch_counts[i];
+    }
+    instancing->packed_number = offset;
+
+    packed[STATIC_INSTANCE] = instancing->instances[STATIC_INSTANCE];
+
+    // batch_counts is rebuilt while filling, it ends up with the same values
+    memset(instancing->batch_counts, 0, batch_number * sizeof(*instancing->batch_counts));
+    for(uint32_t i = STATIC_INSTANCE + 1; i < instancing->instance_number; i++)
+    {
+        uint32_t mesh_index = instancing->instances[i].mesh_index;
+        if(mesh_index != NO_MESH)
+        {
+            uint32_t batch         = mesh_index * MAX_MESH_LODS + instancing->instance_lods[i];
+            InstanceData* instance = &packed[instancing->batch_offsets[batch] + instancing->batch_counts[batch]++];
+            *instance              = instancing->instances[i];
+            instance->batch_offset = instancing->batch_offsets[batch];
+        }
+    }
+}
+
+void select_instance_lods(PInstancing* instancing, PBuffers* buffers)
+{
+    bool changed = false;
+
+    // Levels are picked from the previous frame's camera, the instances are packed before the uniforms are updated
+    for(uint32_t i = STATIC_INSTANCE + 1; i < instancing->instance_number; i++)
+    {
+        InstanceData* instance = &instancing->instances[i];
+        if(instance->mesh_index == NO_MESH || buffers->meshes[instance->mesh_index].lod_count < 2)
+        {
+            continue;
+        }
+
+        PMesh* mesh = &buffers->meshes[instance->mesh_index];
+        float scale = glm_max(glm_vec3_norm(instance->model[0]), glm_max(glm_vec3_norm(instance->model[1]), glm_vec3_norm(instance->model[2])));
+
+        vec3 center;
+        glm_mat4_mulv3(instance->model, mesh->bounds, 1.0f, center);
+        float distance = glm_vec3_distance(center, buffers->camera_position) - mesh->bounds[3] * scale;
+
+        uint32_t lod = select_mesh_lod(mesh, scale * buffers->lod_scale, distance, instancing->instance_lods[i]);
+        if(lod != instancing->instance_lods[i])
+        {
+            instancing->instance_lods[i] = lod;
+            changed                      = true;
+        }
+    }
+
+    if(changed)
+    {
+        instancing->pending_frames = (1u << instancing->frame_count) - 1u;
+    }
+}
+
+void update_instancing(PInstancing* instancing, PDescriptor* descriptor, PDevice* device, uint32_t frame)
+{
+    if(!(instancing->pending_frames & (1u << frame)))
+    {
+        return;
+    }
+
+    // The frame fence has been waited on, so this frame's buffers and descriptor set are idle
+    PInstanceBuffer* frame_buffer = &instancing->frame_buffers[frame];
+    uint32_t needed               = instancing->instance_number - instancing->free_instance_number;
+    if(needed > frame_buffer->capacity)
+    {
+        uint32_t capacity = frame_buffer->capacity;
+        while(capacity < needed)
+        {
+            capacity *= 2;
+        }
+
+        PInstanceBuffer grown = {0};
+        if(create_instance_buffer(&grown, capacity, instancing->gpu_culling, device) != PIGMENT_SUCCESS)
+        {
+            fprintf(stderr, "Failed to grow instance buffer, skipping instances this frame!\n");
+            destroy_instance_buffer(&grown, device);
+            memset(instancing->batch_counts, 0, instancing->mesh_number * MAX_MESH_LODS * sizeof(*instancing->batch_counts));
+            return;
+        }
+
+        destroy_instance_buffer(frame_buffer, device);
+        *frame_buffer = grown;
+
+        write_instance_descriptor(descriptor->frame_sets[frame], FRAME_BINDING_INSTANCES, frame_buffer->buffer, device->logical_device);
+        if(instancing->gpu_culling)
+        {
+            write_instance_descriptor(descriptor->frame_sets[frame], FRAME_BINDING_VISIBLE_INSTANCES, frame_buffer->visible_buffer, device->logical_device);
+        }
+        instancing->resized_frames |= 1u << frame;
+    }
+
+    pack_instances(instancing, frame_buffer->mapped);
+    instancing->pending_frames &= ~(1u << frame);
+}
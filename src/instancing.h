@@ -0,0 +1,36 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INSTANCING_H
+#define INSTANCING_H
+#define INITIAL_INSTANCE_CAPACITY 1024
+#define STATIC_INSTANCE 0
+#define INSTANCE_TEXTURE_FROM_VERTEX UINT32_MAX
+
+#include "defines.h"
+
+PInstancing* create_instancing(uint32_t mesh_number, bool gpu_culling, PDevice* device, uint32_t frame_count);
+void destroy_instancing(PInstancing* instancing, PDevice* device);
+uint32_t add_instance(PInstancing* instancing, uint32_t mesh_index, mat4 transform, uint32_t texture_index, uint32_t texture_layer, const float* color);
+void set_instance_transform(PInstancing* instancing, uint32_t instance_index, mat4 transform);
+void set_instance_texture(PInstancing* instancing, uint32_t instance_index, uint32_t texture_index, uint32_t texture_layer);
+void remove_instance(PInstancing* instancing, uint32_t instance_index);
+void remove_mesh_instances(PInstancing* instancing, uint32_t mesh_index);
+void select_instance_lods(PInstancing* instancing, PBuffers* buffers);
+void update_instancing(PInstancing* instancing, PDescriptor* descriptor, PDevice* device, uint32_t frame);
+
+#endif
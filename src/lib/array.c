@@ -0,0 +1,61 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "array.h"
+
+int reserve_array(void** storage, uint32_t* size, uint32_t needed, size_t element_size)
+{
+    if(needed <= *size)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    uint32_t new_size = *size > 0 ? *size : 64;
+    while(new_size < needed)
+    {
+        new_size *= 2;
+    }
+
+    void* new_storage = realloc(*storage, new_size * element_size);
+    if(new_storage == NULL)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    *storage = new_storage;
+    *size    = new_size;
+    return PIGMENT_SUCCESS;
+}
+
+int push_free_index(uint32_t** indices, uint32_t* index_number, uint32_t* index_size, uint32_t index)
+{
+    if(*index_number >= *index_size)
+    {
+        uint32_t size     = *index_size > 0 ? *index_size * 2 : 4;
+        uint32_t* resized = realloc(*indices, size * sizeof(*resized));
+        if(resized == NULL)
+        {
+            perror("push_free_index");
+            return PIGMENT_ERROR;
+        }
+        *indices    = resized;
+        *index_size = size;
+    }
+
+    (*indices)[(*index_number)++] = index;
+
+    return PIGMENT_SUCCESS;
+}
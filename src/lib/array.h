@@ -0,0 +1,26 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include "defines.h"
+
+// Grows storage to hold at least needed elements, doubling its size so that appends stay amortized
+int reserve_array(void** storage, uint32_t* size, uint32_t needed, size_t element_size);
+int push_free_index(uint32_t** indices, uint32_t* index_number, uint32_t* index_size, uint32_t index);
+
+#endif
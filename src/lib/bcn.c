@@ -0,0 +1,413 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bcn.h"
+
+#include <math.h>
+#include <pthread.h>
+
+typedef struct BCNJob {
+    BCFormat format;
+    const unsigned char* rgba;
+    uint32_t width;
+    uint32_t height;
+    uint32_t first_block_row;
+    uint32_t last_block_row;
+    unsigned char* output;
+} BCNJob;
+
+static const uint32_t bc7_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+void fetch_block(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, unsigned char block[16][4]);
+void find_endpoints(unsigned char block[16][4], uint32_t channels, float endpoint_0[4], float endpoint_1[4]);
+void encode_bc1_block(unsigned char block[16][4], unsigned char* output);
+void encode_bc7_block(unsigned char block[16][4], unsigned char* output);
+uint16_t pack_565(const float color[4]);
+void unpack_565(uint16_t packed, int color[3]);
+void write_bits(unsigned char* output, uint32_t* bit_position, uint32_t value, uint32_t bit_count);
+void quantize_bc7_endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t* p_bit);
+void* bcn_encode_rows(void* arg);
+
+void fetch_block(const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y, unsigned char block[16][4])
+{
+    // Texels outside of the image repeat the last row and column
+    for(uint32_t y = 0; y < 4; y++)
+    {
+        uint32_t source_y = block_y * 4 + y < height ? block_y * 4 + y : height - 1;
+        for(uint32_t x = 0; x < 4; x++)
+        {
+            uint32_t source_x = block_x * 4 + x < width ? block_x * 4 + x : width - 1;
+            memcpy(block[y * 4 + x], &rgba[((size_t) source_y * width + source_x) * 4], 4);
+        }
+    }
+}
+
+void find_endpoints(unsigned char block[16][4], uint32_t channels, float endpoint_0[4], float endpoint_1[4])
+{
+    float mean[4] = {0};
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        for(uint32_t c = 0; c < channels; c++)
+        {
+            mean[c] += block[i][c] / 16.0f;
+        }
+    }
+
+    float covariance[4][4] = {0};
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        for(uint32_t a = 0; a < channels; a++)
+        {
+            for(uint32_t b = 0; b < channels; b++)
+            {
+                covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // A few power iterations are enough to get the principal axis of a 4x4 block
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for(uint32_t iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {0};
+        float length  = 0.0f;
+        for(uint32_t a = 0; a < channels; a++)
+        {
+            for(uint32_t b = 0; b < channels; b++)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+        if(length < 1e-6f)
+        {
+            break;
+        }
+        length = sqrtf(length);
+        for(uint32_t a = 0; a < channels; a++)
+        {
+            axis[a] = next[a] / length;
+        }
+    }
+
+    float min_projection = 0.0f;
+    float max_projection = 0.0f;
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        float projection = 0.0f;
+        for(uint32_t c = 0; c < channels; c++)
+        {
+            projection += (block[i][c] - mean[c]) * axis[c];
+        }
+        min_projection = projection < min_projection ? projection : min_projection;
+        max_projection = projection > max_projection ? projection : max_projection;
+    }
+
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        float value_0 = c < channels ? mean[c] + axis[c] * min_projection : 255.0f;
+        float value_1 = c < channels ? mean[c] + axis[c] * max_projection : 255.0f;
+        endpoint_0[c] = value_0 < 0.0f ? 0.0f : (value_0 > 255.0f ? 255.0f : value_0);
+        endpoint_1[c] = value_1 < 0.0f ? 0.0f : (value_1 > 255.0f ? 255.0f : value_1);
+    }
+}
+
+uint16_t pack_565(const float color[4])
+{
+    uint16_t r = (uint16_t) (color[0] * 31.0f / 255.0f + 0.5f);
+    uint16_t g = (uint16_t) (color[1] * 63.0f / 255.0f + 0.5f);
+    uint16_t b = (uint16_t) (color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t) (r << 11 | g << 5 | b);
+}
+
+void unpack_565(uint16_t packed, int color[3])
+{
+    color[0] = ((packed >> 11) & 31) * 255 / 31;
+    color[1] = ((packed >> 5) & 63) * 255 / 63;
+    color[2] = (packed & 31) * 255 / 31;
+}
+
+void encode_bc1_block(unsigned char block[16][4], unsigned char* output)
+{
+    float endpoint_0[4], endpoint_1[4];
+    find_endpoints(block, 3, endpoint_0, endpoint_1);
+
+    uint16_t color_0 = pack_565(endpoint_1);
+    uint16_t color_1 = pack_565(endpoint_0);
+
+    // color_0 > color_1 selects the four color mode
+    if(color_0 < color_1)
+    {
+        uint16_t swap = color_0;
+        color_0 = color_1;
+        color_1 = swap;
+    }
+
+    uint32_t indices = 0;
+
+    if(color_0 != color_1)
+    {
+        int palette[4][3];
+        unpack_565(color_0, palette[0]);
+        unpack_565(color_1, palette[1]);
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t best_index = 0;
+            int best_error      = INT32_MAX;
+            for(uint32_t p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    int difference = block[i][c] - palette[p][c];
+                    error += difference * difference;
+                }
+                if(error < best_error)
+                {
+                    best_error = error;
+                    best_index = p;
+                }
+            }
+            indices |= best_index << (i * 2);
+        }
+    }
+
+    output[0] = (unsigned char) (color_0 & 0xFF);
+    output[1] = (unsigned char) (color_0 >> 8);
+    output[2] = (unsigned char) (color_1 & 0xFF);
+    output[3] = (unsigned char) (color_1 >> 8);
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        output[4 + i] = (unsigned char) (indices >> (i * 8));
+    }
+}
+
+void write_bits(unsigned char* output, uint32_t* bit_position, uint32_t value, uint32_t bit_count)
+{
+    for(uint32_t i = 0; i < bit_count; i++, (*bit_position)++)
+    {
+        if(value & (1u << i))
+        {
+            output[*bit_position / 8] |= (unsigned char) (1u << (*bit_position % 8));
+        }
+    }
+}
+
+void quantize_bc7_endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t* p_bit)
+{
+    uint32_t best_error = UINT32_MAX;
+
+    for(uint32_t p = 0; p < 2; p++)
+    {
+        uint32_t error = 0;
+        uint32_t candidate[4];
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            int value    = (int) ((endpoint[c] - (float) p) / 2.0f + 0.5f);
+            candidate[c] = (uint32_t) (value < 0 ? 0 : (value > 127 ? 127 : value));
+            int decoded  = (int) (candidate[c] << 1 | p);
+            int difference = decoded - (int) (endpoint[c] + 0.5f);
+            error += (uint32_t) (difference * difference);
+        }
+        if(error < best_error)
+        {
+            best_error = error;
+            *p_bit     = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// BC7 mode 6: a single RGBA subset with 7 bit endpoints, a p-bit per endpoint and 4 bit indices
+void encode_bc7_block(unsigned char block[16][4], unsigned char* output)
+{
+    float endpoint_0[4], endpoint_1[4];
+    find_endpoints(block, 4, endpoint_0, endpoint_1);
+
+    uint32_t quantized[2][4];
+    uint32_t p_bits[2];
+    quantize_bc7_endpoint(endpoint_0, quantized[0], &p_bits[0]);
+    quantize_bc7_endpoint(endpoint_1, quantized[1], &p_bits[1]);
+
+    int palette[16][4];
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        int value_0 = (int) (quantized[0][c] << 1 | p_bits[0]);
+        int value_1 = (int) (quantized[1][c] << 1 | p_bits[1]);
+        for(uint32_t w = 0; w < 16; w++)
+        {
+            palette[w][c] = ((64 - (int) bc7_weights[w]) * value_0 + (int) bc7_weights[w] * value_1 + 32) >> 6;
+        }
+    }
+
+    uint32_t indices[16];
+    for(uint32_t i = 0; i < 16; i++)
+    {
+        int best_error = INT32_MAX;
+        indices[i]     = 0;
+        for(uint32_t w = 0; w < 16; w++)
+        {
+            int error = 0;
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                int difference = block[i][c] - palette[w][c];
+                error += difference * difference;
+            }
+            if(error < best_error)
+            {
+                best_error = error;
+                indices[i] = w;
+            }
+        }
+    }
+
+    // The anchor index is stored without its high bit, swap the endpoints so it is always clear
+    if(indices[0] & 8)
+    {
+        uint32_t swap_endpoint[4];
+        memcpy(swap_endpoint, quantized[0], sizeof(swap_endpoint));
+        memcpy(quantized[0], quantized[1], sizeof(swap_endpoint));
+        memcpy(quantized[1], swap_endpoint, sizeof(swap_endpoint));
+
+        uint32_t swap_p_bit = p_bits[0];
+        p_bits[0]           = p_bits[1];
+        p_bits[1]           = swap_p_bit;
+
+        for(uint32_t i = 0; i < 16; i++)
+        {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    memset(output, 0, BC7_BLOCK_SIZE);
+    uint32_t bit_position = 0;
+
+    write_bits(output, &bit_position, 1u << 6, 7);
+    for(uint32_t c = 0; c < 4; c++)
+    {
+        write_bits(output, &bit_position, quantized[0][c], 7);
+        write_bits(output, &bit_position, quantized[1][c], 7);
+    }
+    write_bits(output, &bit_position, p_bits[0], 1);
+    write_bits(output, &bit_position, p_bits[1], 1);
+    write_bits(output, &bit_position, indices[0], 3);
+    for(uint32_t i = 1; i < 16; i++)
+    {
+        write_bits(output, &bit_position, indices[i], 4);
+    }
+}
+
+void* bcn_encode_rows(void* arg)
+{
+    BCNJob* job              = arg;
+    uint32_t blocks_per_row  = (job->width + 3) / 4;
+    size_t block_size        = job->format == BC1 ? BC1_BLOCK_SIZE : BC7_BLOCK_SIZE;
+    unsigned char block[16][4];
+
+    for(uint32_t block_y = job->first_block_row; block_y < job->last_block_row; block_y++)
+    {
+        for(uint32_t block_x = 0; block_x < blocks_per_row; block_x++)
+        {
+            unsigned char* output = job->output + ((size_t) block_y * blocks_per_row + block_x) * block_size;
+
+            fetch_block(job->rgba, job->width, job->height, block_x, block_y, block);
+            if(job->format == BC1)
+            {
+                encode_bc1_block(block, output);
+            }
+            else
+            {
+                encode_bc7_block(block, output);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+uint64_t bcn_encoded_size(BCFormat format, uint32_t width, uint32_t height)
+{
+    uint64_t block_count = (uint64_t) ((width + 3) / 4) * ((height + 3) / 4);
+    return block_count * (format == BC1 ? BC1_BLOCK_SIZE : BC7_BLOCK_SIZE);
+}
+
+void bcn_encode(BCFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, unsigned char* output, uint32_t thread_count)
+{
+    uint32_t block_rows = (height + 3) / 4;
+    if(thread_count > block_rows)
+    {
+        thread_count = block_rows;
+    }
+    if(thread_count == 0)
+    {
+        thread_count = 1;
+    }
+
+    BCNJob* jobs       = malloc(thread_count * sizeof(*jobs));
+    pthread_t* threads = malloc(thread_count * sizeof(*threads));
+    bool* started      = calloc(thread_count, sizeof(*started));
+    if(jobs == NULL || threads == NULL || started == NULL)
+    {
+        thread_count = 0;
+    }
+
+    for(uint32_t i = 0; i < thread_count; i++)
+    {
+        jobs[i] = (BCNJob) {
+            .format          = format,
+            .rgba            = rgba,
+            .width           = width,
+            .height          = height,
+            .first_block_row = block_rows * i / thread_count,
+            .last_block_row  = block_rows * (i + 1) / thread_count,
+            .output          = output
+        };
+
+        // The first slice is encoded on the calling thread
+        if(i > 0)
+        {
+            started[i] = pthread_create(&threads[i], NULL, bcn_encode_rows, &jobs[i]) == 0;
+        }
+    }
+
+    if(thread_count == 0)
+    {
+        BCNJob job = {format, rgba, width, height, 0, block_rows, output};
+        bcn_encode_rows(&job);
+    }
+
+    for(uint32_t i = 0; i < thread_count; i++)
+    {
+        if(started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            bcn_encode_rows(&jobs[i]);
+        }
+    }
+
+    free(started);
+    free(threads);
+    free(jobs);
+}
@@ -0,0 +1,33 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BCN_H
+#define BCN_H
+
+#include "defines.h"
+
+#define BC1_BLOCK_SIZE 8
+#define BC7_BLOCK_SIZE 16
+
+typedef enum {
+    BC1 = 0,
+    BC7 = 1
+} BCFormat;
+
+uint64_t bcn_encoded_size(BCFormat format, uint32_t width, uint32_t height);
+void bcn_encode(BCFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, unsigned char* output, uint32_t thread_count);
+
+#endif
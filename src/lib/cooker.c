@@ -0,0 +1,246 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cooker.h"
+#include "bcn.h"
+#include "ktx2.h"
+#include "stb_image.h"
+
+#include <errno.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_COOKED_MIP_LEVELS 16
+
+// Vulkan format values written in the cooked KTX2 files
+#define COOKED_FORMAT_BC1_SRGB 132
+#define COOKED_FORMAT_BC7_SRGB 146
+
+uint32_t get_cooking_thread_count(void);
+void init_srgb_table(float table[256]);
+unsigned char linear_to_srgb(float value);
+unsigned char* downsample_rgba(const unsigned char* source, uint32_t width, uint32_t height, const float srgb_table[256]);
+bool is_opaque(const unsigned char* rgba, uint32_t width, uint32_t height);
+
+uint32_t get_cooking_thread_count(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if(count > 0)
+    {
+        return (uint32_t) count;
+    }
+#endif
+    return 4;
+}
+
+void init_srgb_table(float table[256])
+{
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        float value = (float) i / 255.0f;
+        table[i]    = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+unsigned char linear_to_srgb(float value)
+{
+    float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+    return (unsigned char) (srgb <= 0.0f ? 0 : (srgb >= 1.0f ? 255 : (int) (srgb * 255.0f + 0.5f)));
+}
+
+unsigned char* downsample_rgba(const unsigned char* source, uint32_t width, uint32_t height, const float srgb_table[256])
+{
+    uint32_t next_width  = width > 1 ? width / 2 : 1;
+    uint32_t next_height = height > 1 ? height / 2 : 1;
+
+    unsigned char* destination = malloc((size_t) next_width * next_height * 4);
+    if(destination == NULL)
+    {
+        return NULL;
+    }
+
+    for(uint32_t y = 0; y < next_height; y++)
+    {
+        for(uint32_t x = 0; x < next_width; x++)
+        {
+            float sum[4] = {0};
+            for(uint32_t i = 0; i < 4; i++)
+            {
+                uint32_t source_x = x * 2 + (i & 1) < width ? x * 2 + (i & 1) : width - 1;
+                uint32_t source_y = y * 2 + (i >> 1) < height ? y * 2 + (i >> 1) : height - 1;
+                const unsigned char* texel = &source[((size_t) source_y * width + source_x) * 4];
+
+                sum[0] += srgb_table[texel[0]];
+                sum[1] += srgb_table[texel[1]];
+                sum[2] += srgb_table[texel[2]];
+                sum[3] += texel[3];
+            }
+
+            unsigned char* texel = &destination[((size_t) y * next_width + x) * 4];
+            texel[0] = linear_to_srgb(sum[0] / 4.0f);
+            texel[1] = linear_to_srgb(sum[1] / 4.0f);
+            texel[2] = linear_to_srgb(sum[2] / 4.0f);
+            texel[3] = (unsigned char) (sum[3] / 4.0f + 0.5f);
+        }
+    }
+
+    return destination;
+}
+
+bool is_opaque(const unsigned char* rgba, uint32_t width, uint32_t height)
+{
+    for(size_t i = 0; i < (size_t) width * height; i++)
+    {
+        if(rgba[i * 4 + 3] != 255)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Caches are kept out of the texture directories, which are scanned for textures to load
+char* get_cooked_texture_path(const char* directory, const char* source_path)
+{
+    if(mkdir(directory, 0755) != 0 && errno != EEXIST)
+    {
+        perror("get_cooked_texture_path");
+        return NULL;
+    }
+
+    size_t directory_length = strlen(directory);
+    size_t cooked_path_size = directory_length + 1 + strlen(source_path) + sizeof(COOKED_TEXTURE_EXTENSION);
+    char* cooked_path       = malloc(cooked_path_size);
+    if(cooked_path == NULL)
+    {
+        perror("get_cooked_texture_path");
+        return NULL;
+    }
+    snprintf(cooked_path, cooked_path_size, "%s/%s" COOKED_TEXTURE_EXTENSION, directory, source_path);
+
+    // The source path is flattened into a single file name
+    for(char* c = cooked_path + directory_length + 1; *c != '\0'; c++)
+    {
+        if(*c == '/' || *c == '\\')
+        {
+            *c = '_';
+        }
+    }
+
+    return cooked_path;
+}
+
+bool cooked_texture_is_fresh(const char* source_path, const char* cooked_path)
+{
+    struct stat source_stat, cooked_stat;
+
+    if(stat(cooked_path, &cooked_stat) != 0 || stat(source_path, &source_stat) != 0)
+    {
+        return false;
+    }
+
+    return cooked_stat.st_mtime >= source_stat.st_mtime;
+}
+
+int cook_texture(const char* source_path, const char* cooked_path)
+{
+    int width, height, channels;
+    unsigned char* levels[MAX_COOKED_MIP_LEVELS] = {0};
+    KTX2Level ktx2_levels[MAX_COOKED_MIP_LEVELS];
+    int result = PIGMENT_ERROR;
+
+    KTX2Image image = {0};
+
+    levels[0] = stbi_load(source_path, &width, &height, &channels, STBI_rgb_alpha);
+    if(levels[0] == NULL)
+    {
+        fprintf(stderr, "Failed to load texture file %s for cooking!\n", source_path);
+        return PIGMENT_ERROR;
+    }
+
+    // Opaque textures fit in BC1, anything with alpha goes to BC7
+    BCFormat format  = is_opaque(levels[0], (uint32_t) width, (uint32_t) height) ? BC1 : BC7;
+    image.vk_format  = format == BC1 ? COOKED_FORMAT_BC1_SRGB : COOKED_FORMAT_BC7_SRGB;
+    image.width      = (uint32_t) width;
+    image.height     = (uint32_t) height;
+    image.levels     = ktx2_levels;
+
+    uint32_t max_size = image.width > image.height ? image.width : image.height;
+    image.level_count = (uint32_t) floor(log2((double) max_size)) + 1;
+    if(image.level_count > MAX_COOKED_MIP_LEVELS)
+    {
+        fprintf(stderr, "Texture %s is too large to be cooked!\n", source_path);
+        goto FREE;
+    }
+
+    float srgb_table[256];
+    init_srgb_table(srgb_table);
+
+    for(uint32_t i = 0; i < image.level_count; i++)
+    {
+        uint32_t level_width  = image.width >> i ? image.width >> i : 1;
+        uint32_t level_height = image.height >> i ? image.height >> i : 1;
+
+        if(i > 0)
+        {
+            levels[i] = downsample_rgba(levels[i - 1], image.width >> (i - 1) ? image.width >> (i - 1) : 1, image.height >> (i - 1) ? image.height >> (i - 1) : 1, srgb_table);
+            if(levels[i] == NULL)
+            {
+                perror("cook_texture");
+                goto FREE;
+            }
+        }
+
+        ktx2_levels[i].offset = image.data_size;
+        ktx2_levels[i].size   = bcn_encoded_size(format, level_width, level_height);
+        image.data_size      += (ktx2_levels[i].size + KTX2_LEVEL_ALIGNMENT - 1) & ~(uint64_t) (KTX2_LEVEL_ALIGNMENT - 1);
+    }
+
+    image.data = calloc(1, (size_t) image.data_size);
+    if(image.data == NULL)
+    {
+        perror("cook_texture");
+        goto FREE;
+    }
+
+    uint32_t thread_count = get_cooking_thread_count();
+    for(uint32_t i = 0; i < image.level_count; i++)
+    {
+        uint32_t level_width  = image.width >> i ? image.width >> i : 1;
+        uint32_t level_height = image.height >> i ? image.height >> i : 1;
+
+        bcn_encode(format, levels[i], level_width, level_height, image.data + ktx2_levels[i].offset, thread_count);
+    }
+
+    if(ktx2_write(cooked_path, &image) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to write cooked texture %s!\n", cooked_path);
+        goto FREE;
+    }
+
+    result = PIGMENT_SUCCESS;
+
+FREE:
+    stbi_image_free(levels[0]);
+    for(uint32_t i = 1; i < MAX_COOKED_MIP_LEVELS; i++)
+    {
+        free(levels[i]);
+    }
+    free(image.data);
+    return result;
+}
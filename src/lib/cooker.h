@@ -0,0 +1,29 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COOKER_H
+#define COOKER_H
+
+#include "defines.h"
+
+#define COOKED_TEXTURE_EXTENSION ".ktx2"
+#define COOKED_TEXTURE_DIRECTORY "cooked_textures"
+
+char* get_cooked_texture_path(const char* directory, const char* source_path);
+bool cooked_texture_is_fresh(const char* source_path, const char* cooked_path);
+int cook_texture(const char* source_path, const char* cooked_path);
+
+#endif
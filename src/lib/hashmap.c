@@ -331,3 +331,104 @@ void texture_hashmap_free(TextureHashMap** hashmap)
     free(*hashmap);
     *hashmap = NULL;
 }
+
+// content hash (uint64) to uint32 hashmap
+
+typedef struct _content_hashmap_node {
+    uint64_t key;
+    uint32_t value;
+    struct _content_hashmap_node* next;
+} ContentHashmapNode;
+
+struct _content_hashmap {
+    ContentHashmapNode* nodes[HASHSET_SIZE];
+};
+
+/*
+FNV-1a over SIZE bytes of DATA.
+*/
+uint64_t content_hash(const void* data, size_t size)
+{
+    return content_hash_append(0xcbf29ce484222325ull, data, size);
+}
+
+/*
+Continue the FNV-1a HASH over SIZE more bytes of DATA.
+*/
+uint64_t content_hash_append(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+ContentHashMap* content_hashmap_create(void)
+{
+    return calloc(1, sizeof(ContentHashMap));
+}
+
+bool content_hashmap_set_value(ContentHashMap* hashmap, uint64_t key, uint32_t value)
+{
+    uint32_t hash = (uint32_t) (key % HASHSET_SIZE);
+    ContentHashmapNode* node = hashmap->nodes[hash];
+    while(node != NULL && node->key != key)
+    {
+        node = node->next;
+    }
+    if(node != NULL)
+    {
+        node->value = value;
+        return true;
+    }
+    node = (ContentHashmapNode*) malloc(sizeof(ContentHashmapNode));
+    if(node == NULL)
+    {
+        return false;
+    }
+    node->key            = key;
+    node->value          = value;
+    node->next           = hashmap->nodes[hash];
+    hashmap->nodes[hash] = node;
+    return true;
+}
+
+int64_t content_hashmap_get_value(const ContentHashMap* hashmap, uint64_t key)
+{
+    ContentHashmapNode* node = hashmap->nodes[key % HASHSET_SIZE];
+    while(node != NULL && node->key != key)
+    {
+        node = node->next;
+    }
+    if(node == NULL)
+    {
+        return -1;
+    }
+    return (int64_t) node->value;
+}
+
+/*
+Free the underlying hashmap behind the pointer HASHMAP and set the hashmap handler to NULL.
+*/
+void content_hashmap_free(ContentHashMap** hashmap)
+{
+    if(*hashmap == NULL)
+    {
+        return;
+    }
+    for(int i = 0; i < HASHSET_SIZE; i++)
+    {
+        ContentHashmapNode* node = (*hashmap)->nodes[i];
+        while(node != NULL)
+        {
+            ContentHashmapNode* next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(*hashmap);
+    *hashmap = NULL;
+}
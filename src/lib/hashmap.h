@@ -47,4 +47,18 @@ char** texture_hashmap_get_keys_list(const TextureHashMap* hashmap);
 
 void texture_hashmap_free(TextureHashMap** hashmap);
 
+// content hash (uint64) to uint32 hashmap
+
+typedef struct _content_hashmap ContentHashMap;
+
+uint64_t content_hash(const void* data, size_t size);
+uint64_t content_hash_append(uint64_t hash, const void* data, size_t size);
+
+ContentHashMap* content_hashmap_create(void);
+
+bool content_hashmap_set_value(ContentHashMap* hashmap, uint64_t key, uint32_t value);
+int64_t content_hashmap_get_value(const ContentHashMap* hashmap, uint64_t key);
+
+void content_hashmap_free(ContentHashMap** hashmap);
+
 #endif
@@ -0,0 +1,422 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ktx2.h"
+
+#include <zstd.h>
+
+#define KTX2_HEADER_SIZE 80
+#define KTX2_LEVEL_INDEX_ENTRY_SIZE 24
+
+#define KTX2_SUPERCOMPRESSION_NONE 0
+#define KTX2_SUPERCOMPRESSION_ZSTD 2
+
+#define KHR_DF_MODEL_UNSPECIFIED 0
+#define KHR_DF_MODEL_BC1A 128
+#define KHR_DF_MODEL_BC3 130
+#define KHR_DF_MODEL_BC7 135
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_TRANSFER_SRGB 2
+#define KHR_DF_CHANNEL_ALPHA 15
+
+static const unsigned char ktx2_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+unsigned char* ktx2_read_file(const char* path, uint64_t* size);
+uint32_t ktx2_read_u32(const unsigned char* bytes);
+uint64_t ktx2_read_u64(const unsigned char* bytes);
+void ktx2_write_u32(FILE* fd, uint32_t value);
+void ktx2_write_u64(FILE* fd, uint64_t value);
+uint32_t ktx2_write_dfd(FILE* fd, uint32_t vk_format, bool write);
+uint32_t ktx2_format_block(uint32_t vk_format, uint32_t* block_extent);
+uint64_t ktx2_level_size(uint32_t vk_format, uint32_t width, uint32_t height, uint32_t level);
+
+unsigned char* ktx2_read_file(const char* path, uint64_t* size)
+{
+    FILE* fd = fopen(path, "rb");
+    if(fd == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(fd, 0l, SEEK_END);
+    long file_size = ftell(fd);
+    rewind(fd);
+
+    unsigned char* bytes = NULL;
+    if(file_size > 0)
+    {
+        bytes = malloc((size_t) file_size);
+    }
+    if(bytes != NULL && fread(bytes, 1, (size_t) file_size, fd) != (size_t) file_size)
+    {
+        free(bytes);
+        bytes = NULL;
+    }
+
+    fclose(fd);
+
+    *size = (uint64_t) file_size;
+    return bytes;
+}
+
+uint32_t ktx2_read_u32(const unsigned char* bytes)
+{
+    return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+uint64_t ktx2_read_u64(const unsigned char* bytes)
+{
+    return (uint64_t) ktx2_read_u32(bytes) | (uint64_t) ktx2_read_u32(bytes + 4) << 32;
+}
+
+// Returns the size in bytes of a texel block, 0 for the formats the loader does not know
+uint32_t ktx2_format_block(uint32_t vk_format, uint32_t* block_extent)
+{
+    *block_extent = 1;
+
+    switch(vk_format)
+    {
+        case 9: case 10: case 11: case 12: case 13: case 14: case 15: // VK_FORMAT_R8_*
+            return 1;
+        case 16: case 17: case 18: case 19: case 20: case 21: case 22: // VK_FORMAT_R8G8_*
+            return 2;
+        case 37: case 38: case 39: case 40: case 41: case 42: case 43: // VK_FORMAT_R8G8B8A8_*
+        case 44: case 45: case 46: case 47: case 48: case 49: case 50: // VK_FORMAT_B8G8R8A8_*
+            return 4;
+        case 97: // VK_FORMAT_R16G16B16A16_SFLOAT
+            return 8;
+        case 109: // VK_FORMAT_R32G32B32A32_SFLOAT
+            return 16;
+        case 131: case 132: case 133: case 134: // VK_FORMAT_BC1_*
+        case 139: case 140:                     // VK_FORMAT_BC4_*
+            *block_extent = 4;
+            return 8;
+        case 135: case 136: // VK_FORMAT_BC2_*
+        case 137: case 138: // VK_FORMAT_BC3_*
+        case 141: case 142: // VK_FORMAT_BC5_*
+        case 143: case 144: // VK_FORMAT_BC6H_*
+        case 145: case 146: // VK_FORMAT_BC7_*
+            *block_extent = 4;
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+uint64_t ktx2_level_size(uint32_t vk_format, uint32_t width, uint32_t height, uint32_t level)
+{
+    uint32_t block_extent;
+    uint32_t block_size = ktx2_format_block(vk_format, &block_extent);
+
+    uint64_t level_width  = width >> level > 0 ? width >> level : 1;
+    uint64_t level_height = height >> level > 0 ? height >> level : 1;
+
+    return ((level_width + block_extent - 1) / block_extent) * ((level_height + block_extent - 1) / block_extent) * block_size;
+}
+
+bool ktx2_is_file(const char* path)
+{
+    size_t length = strlen(path);
+    return length > 5 && strcmp(path + length - 5, ".ktx2") == 0;
+}
+
+KTX2Image* ktx2_load(const char* path)
+{
+    uint64_t file_size = 0;
+    unsigned char* file = ktx2_read_file(path, &file_size);
+    if(file == NULL)
+    {
+        fprintf(stderr, "Failed to read KTX2 file %s!\n", path);
+        return NULL;
+    }
+
+    KTX2Image* image = calloc(1, sizeof(*image));
+    if(image == NULL)
+    {
+        perror("ktx2_load");
+        goto ERROR;
+    }
+
+    if(file_size < KTX2_HEADER_SIZE || memcmp(file, ktx2_identifier, sizeof(ktx2_identifier)) != 0)
+    {
+        fprintf(stderr, "%s is not a KTX2 file!\n", path);
+        goto ERROR;
+    }
+
+    image->vk_format     = ktx2_read_u32(file + 12);
+    image->width         = ktx2_read_u32(file + 20);
+    image->height        = ktx2_read_u32(file + 24);
+    uint32_t depth       = ktx2_read_u32(file + 28);
+    uint32_t layer_count = ktx2_read_u32(file + 32);
+    uint32_t face_count  = ktx2_read_u32(file + 36);
+    uint32_t level_count = ktx2_read_u32(file + 40);
+    uint32_t scheme      = ktx2_read_u32(file + 44);
+
+    if(image->vk_format == 0 || image->width == 0 || image->height == 0 || depth > 1 || layer_count > 1 || face_count != 1)
+    {
+        fprintf(stderr, "Unsupported KTX2 texture %s, only plain 2D textures are handled!\n", path);
+        goto ERROR;
+    }
+
+    uint32_t block_extent;
+    if(ktx2_format_block(image->vk_format, &block_extent) == 0)
+    {
+        fprintf(stderr, "Unsupported KTX2 format %u in %s!\n", image->vk_format, path);
+        goto ERROR;
+    }
+
+    if(scheme != KTX2_SUPERCOMPRESSION_NONE && scheme != KTX2_SUPERCOMPRESSION_ZSTD)
+    {
+        fprintf(stderr, "Unsupported KTX2 supercompression scheme %u in %s!\n", scheme, path);
+        goto ERROR;
+    }
+
+    // A level count of 0 asks the loader to build the mip chain itself
+    image->needs_mipmaps = level_count == 0;
+    image->level_count   = level_count == 0 ? 1 : level_count;
+
+    uint32_t largest_side = image->width > image->height ? image->width : image->height;
+    if(image->level_count > 32 || largest_side >> (image->level_count - 1) == 0)
+    {
+        fprintf(stderr, "KTX2 file %s has more levels than its size allows!\n", path);
+        goto ERROR;
+    }
+
+    if(file_size < KTX2_HEADER_SIZE + (uint64_t) image->level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE)
+    {
+        fprintf(stderr, "Truncated KTX2 file %s!\n", path);
+        goto ERROR;
+    }
+
+    image->levels = malloc(image->level_count * sizeof(*image->levels));
+    if(image->levels == NULL)
+    {
+        perror("ktx2_load");
+        goto ERROR;
+    }
+
+    for(uint32_t i = 0; i < image->level_count; i++)
+    {
+        const unsigned char* entry = file + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        uint64_t byte_offset       = ktx2_read_u64(entry);
+        uint64_t byte_length       = ktx2_read_u64(entry + 8);
+
+        if(byte_offset > file_size || byte_length > file_size - byte_offset)
+        {
+            fprintf(stderr, "Truncated KTX2 file %s!\n", path);
+            goto ERROR;
+        }
+
+        // The copy to the image reads the whole level, whatever the file claims
+        image->levels[i].offset = image->data_size;
+        image->levels[i].size   = scheme == KTX2_SUPERCOMPRESSION_ZSTD ? ktx2_read_u64(entry + 16) : byte_length;
+        if(image->levels[i].size != ktx2_level_size(image->vk_format, image->width, image->height, i))
+        {
+            fprintf(stderr, "Level %u of KTX2 file %s does not match its format and size!\n", i, path);
+            goto ERROR;
+        }
+
+        image->data_size       += (image->levels[i].size + KTX2_LEVEL_ALIGNMENT - 1) & ~(uint64_t) (KTX2_LEVEL_ALIGNMENT - 1);
+    }
+
+    image->data = malloc((size_t) image->data_size);
+    if(image->data == NULL)
+    {
+        perror("ktx2_load");
+        goto ERROR;
+    }
+
+    for(uint32_t i = 0; i < image->level_count; i++)
+    {
+        const unsigned char* entry = file + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        const unsigned char* source = file + ktx2_read_u64(entry);
+        uint64_t source_size        = ktx2_read_u64(entry + 8);
+
+        if(scheme == KTX2_SUPERCOMPRESSION_ZSTD)
+        {
+            size_t result = ZSTD_decompress(image->data + image->levels[i].offset, (size_t) image->levels[i].size, source, (size_t) source_size);
+            if(ZSTD_isError(result) || result != image->levels[i].size)
+            {
+                fprintf(stderr, "Failed to decompress level %u of %s!\n", i, path);
+                goto ERROR;
+            }
+        }
+        else
+        {
+            memcpy(image->data + image->levels[i].offset, source, (size_t) source_size);
+        }
+    }
+
+    free(file);
+
+    return image;
+
+ERROR:
+    free(file);
+    ktx2_destroy(image);
+    return NULL;
+}
+
+void ktx2_destroy(KTX2Image* image)
+{
+    if(image != NULL)
+    {
+        free(image->levels);
+        free(image->data);
+        free(image);
+    }
+}
+
+void ktx2_write_u32(FILE* fd, uint32_t value)
+{
+    unsigned char bytes[4] = {(unsigned char) value, (unsigned char) (value >> 8), (unsigned char) (value >> 16), (unsigned char) (value >> 24)};
+    fwrite(bytes, 1, sizeof(bytes), fd);
+}
+
+void ktx2_write_u64(FILE* fd, uint64_t value)
+{
+    ktx2_write_u32(fd, (uint32_t) value);
+    ktx2_write_u32(fd, (uint32_t) (value >> 32));
+}
+
+// Writes a basic data format descriptor for the block compressed formats, returns its size
+uint32_t ktx2_write_dfd(FILE* fd, uint32_t vk_format, bool write)
+{
+    uint32_t model        = KHR_DF_MODEL_UNSPECIFIED;
+    uint32_t transfer     = KHR_DF_TRANSFER_LINEAR;
+    uint32_t bytes        = 0;
+    uint32_t sample_count = 1;
+
+    switch(vk_format)
+    {
+        case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+        case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+            transfer = KHR_DF_TRANSFER_SRGB;
+            // fallthrough
+        case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+            model = KHR_DF_MODEL_BC1A;
+            bytes = 8;
+            break;
+        case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+            transfer = KHR_DF_TRANSFER_SRGB;
+            // fallthrough
+        case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+            model        = KHR_DF_MODEL_BC3;
+            bytes        = 16;
+            sample_count = 2;
+            break;
+        case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+            transfer = KHR_DF_TRANSFER_SRGB;
+            // fallthrough
+        case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+            model = KHR_DF_MODEL_BC7;
+            bytes = 16;
+            break;
+        default:
+            sample_count = 0;
+            break;
+    }
+
+    uint32_t block_size = 24 + 16 * sample_count;
+    if(!write)
+    {
+        return 4 + block_size;
+    }
+
+    ktx2_write_u32(fd, 4 + block_size);
+    ktx2_write_u32(fd, 0);
+    ktx2_write_u32(fd, 2 | block_size << 16);
+    ktx2_write_u32(fd, model | KHR_DF_PRIMARIES_BT709 << 8 | transfer << 16);
+    ktx2_write_u32(fd, model == KHR_DF_MODEL_UNSPECIFIED ? 0 : 3 | 3 << 8);
+    ktx2_write_u32(fd, bytes);
+    ktx2_write_u32(fd, 0);
+
+    for(uint32_t i = 0; i < sample_count; i++)
+    {
+        uint32_t bit_length = bytes * 8 / sample_count;
+        uint32_t channel    = sample_count == 2 && i == 0 ? KHR_DF_CHANNEL_ALPHA : 0;
+
+        ktx2_write_u32(fd, (i * bit_length) | (bit_length - 1) << 16 | channel << 24);
+        ktx2_write_u32(fd, 0);
+        ktx2_write_u32(fd, 0);
+        ktx2_write_u32(fd, UINT32_MAX);
+    }
+
+    return 4 + block_size;
+}
+
+int ktx2_write(const char* path, const KTX2Image* image)
+{
+    FILE* fd = fopen(path, "wb");
+    if(fd == NULL)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    uint32_t dfd_offset = KTX2_HEADER_SIZE + image->level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    uint32_t dfd_size   = ktx2_write_dfd(fd, image->vk_format, false);
+    uint64_t data_start = (dfd_offset + dfd_size + KTX2_LEVEL_ALIGNMENT - 1) & ~(uint64_t) (KTX2_LEVEL_ALIGNMENT - 1);
+
+    fwrite(ktx2_identifier, 1, sizeof(ktx2_identifier), fd);
+    ktx2_write_u32(fd, image->vk_format);
+    ktx2_write_u32(fd, 1);
+    ktx2_write_u32(fd, image->width);
+    ktx2_write_u32(fd, image->height);
+    ktx2_write_u32(fd, 0);
+    ktx2_write_u32(fd, 0);
+    ktx2_write_u32(fd, 1);
+    ktx2_write_u32(fd, image->needs_mipmaps ? 0 : image->level_count);
+    ktx2_write_u32(fd, KTX2_SUPERCOMPRESSION_NONE);
+    ktx2_write_u32(fd, dfd_offset);
+    ktx2_write_u32(fd, dfd_size);
+    ktx2_write_u32(fd, 0);
+    ktx2_write_u32(fd, 0);
+    ktx2_write_u64(fd, 0);
+    ktx2_write_u64(fd, 0);
+
+    // The packed data already has the smallest level last, the file wants it first
+    for(uint32_t i = 0; i < image->level_count; i++)
+    {
+        ktx2_write_u64(fd, data_start + image->data_size - image->levels[i].offset - ((image->levels[i].size + KTX2_LEVEL_ALIGNMENT - 1) & ~(uint64_t) (KTX2_LEVEL_ALIGNMENT - 1)));
+        ktx2_write_u64(fd, image->levels[i].size);
+        ktx2_write_u64(fd, image->levels[i].size);
+    }
+
+    ktx2_write_dfd(fd, image->vk_format, true);
+
+    unsigned char padding[KTX2_LEVEL_ALIGNMENT] = {0};
+    fwrite(padding, 1, (size_t) (data_start - dfd_offset - dfd_size), fd);
+
+    for(uint32_t i = image->level_count; i > 0; i--)
+    {
+        const KTX2Level* level = &image->levels[i - 1];
+        uint64_t aligned_size  = (level->size + KTX2_LEVEL_ALIGNMENT - 1) & ~(uint64_t) (KTX2_LEVEL_ALIGNMENT - 1);
+
+        fwrite(image->data + level->offset, 1, (size_t) level->size, fd);
+        fwrite(padding, 1, (size_t) (aligned_size - level->size), fd);
+    }
+
+    bool failed = ferror(fd) != 0;
+    if(fclose(fd) != 0 || failed)
+    {
+        remove(path);
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef KTX2_H
+#define KTX2_H
+
+#include "defines.h"
+
+#define KTX2_LEVEL_ALIGNMENT 16
+
+typedef struct KTX2Level {
+    uint64_t offset;
+    uint64_t size;
+} KTX2Level;
+
+// Mip levels are stored largest first, each one aligned on KTX2_LEVEL_ALIGNMENT inside data
+typedef struct KTX2Image {
+    uint32_t vk_format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    bool needs_mipmaps;
+    KTX2Level* levels;
+    unsigned char* data;
+    uint64_t data_size;
+} KTX2Image;
+
+bool ktx2_is_file(const char* path);
+KTX2Image* ktx2_load(const char* path);
+int ktx2_write(const char* path, const KTX2Image* image);
+void ktx2_destroy(KTX2Image* image);
+
+#endif
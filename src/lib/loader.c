@@ -31,6 +31,17 @@ struct StringArray_T {
 };
 
 extern int add_texture(PTextureList* texture_list, const char* texture_path, PCommands* commands, PDevice* device);
+extern int generate_pending_mipmaps(PTextureList* texture_list, PCommands* commands, PDevice* device);
+extern uint32_t get_texture_number(const PTextureList* texture_list);
+extern int enable_texture_sharing(PTextureList* texture_list);
+extern void disable_texture_sharing(PTextureList* texture_list);
+extern uint32_t get_shared_texture(const PTextureList* texture_list);
+
+char* find_texture_path(const char* texture_name, StringArray* paths);
+unsigned char* read_texture_file(const char* texture_path, size_t* size);
+int hash_texture_file(const char* texture_path, uint64_t* hash);
+bool same_texture_file(const char* texture_path, const char* other_path);
+int32_t load_unique_texture(PTextureList* texture_list, const char* texture_name, StringArray* paths, ContentHashMap* file_hashes, char** slot_paths, PCommands* commands, PDevice* device);
 
 TexturesToLoad* init_textures_to_load(void)
 {
@@ -48,18 +59,12 @@ TexturesToLoad* init_textures_to_load(void)
 
 void add_texture_to_load(TexturesToLoad* textures_to_load, const char* texture_name)
 {
-    int textures_number   = textures_to_load_number(textures_to_load);
-    char** textures_names = texture_hashmap_get_keys_list(textures_to_load);
-
-    for(int i = 0; i < textures_number; i++)
+    if(texture_hashmap_get_value(textures_to_load, texture_name) != -1)
     {
-        if(strcmp(texture_name, textures_names[i]) == 0)
-        {
-            return;
-        }
+        return;
     }
 
-    texture_hashmap_set_value(textures_to_load, texture_name, (uint16_t) textures_number);
+    texture_hashmap_set_value(textures_to_load, texture_name, (uint16_t) textures_to_load_number(textures_to_load));
 }
 
 void add_textures_dir_to_load(TexturesToLoad* textures_to_load, const char* texture_dir)
@@ -205,21 +210,21 @@ ERROR:
     return;
 }
 
-void load_texture(PTextureList* texture_list, const char* texture_name, StringArray* paths, PCommands* commands, PDevice* device)
+char* find_texture_path(const char* texture_name, StringArray* paths)
 {
-    if(strcmp(texture_name, "default") == 0)
-    {
-        add_texture(texture_list, "default", commands, device);
-        return;
-    }
-
     struct stat path_stat;
     int stat_result;
 
     char* texture_path = calloc(PATH_MAX_SIZE, sizeof(*texture_path));
     if(texture_path == NULL)
     {
-        goto ERROR;
+        return NULL;
+    }
+
+    if(strcmp(texture_name, "default") == 0)
+    {
+        strncpy(texture_path, "default", PATH_MAX_SIZE - 1);
+        return texture_path;
     }
 
     for(size_t i = 0; i < paths->size; i++)
@@ -234,22 +239,153 @@ void load_texture(PTextureList* texture_list, const char* texture_name, StringAr
         texture_path[0] = '\0';
     }
 
-    add_texture(texture_list, texture_path, commands, device);
+    return texture_path;
+}
+
+unsigned char* read_texture_file(const char* texture_path, size_t* size)
+{
+    FILE* fd = fopen(texture_path, "rb");
+    if(fd == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(fd, 0l, SEEK_END);
+    long file_size = ftell(fd);
+    rewind(fd);
 
-    free(texture_path);
+    unsigned char* bytes = file_size > 0 ? malloc((size_t) file_size) : NULL;
+    if(bytes == NULL || fread(bytes, 1, (size_t) file_size, fd) != (size_t) file_size)
+    {
+        free(bytes);
+        fclose(fd);
+        return NULL;
+    }
+    fclose(fd);
 
-    return;
+    *size = (size_t) file_size;
 
-ERROR:
-    perror("load_texture");
-    return;
+    return bytes;
+}
+
+int hash_texture_file(const char* texture_path, uint64_t* hash)
+{
+    size_t size;
+    unsigned char* bytes = read_texture_file(texture_path, &size);
+    if(bytes == NULL)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    *hash = content_hash(bytes, size);
+    free(bytes);
+
+    return PIGMENT_SUCCESS;
+}
+
+bool same_texture_file(const char* texture_path, const char* other_path)
+{
+    size_t size, other_size;
+    unsigned char* bytes       = read_texture_file(texture_path, &size);
+    unsigned char* other_bytes = read_texture_file(other_path, &other_size);
+
+    bool same = bytes != NULL && other_bytes != NULL && size == other_size && memcmp(bytes, other_bytes, size) == 0;
+
+    free(bytes);
+    free(other_bytes);
+
+    return same;
+}
+
+int32_t load_unique_texture(PTextureList* texture_list, const char* texture_name, StringArray* paths, ContentHashMap* file_hashes, char** slot_paths, PCommands* commands, PDevice* device)
+{
+    uint32_t slot      = get_texture_number(texture_list);
+    uint64_t file_hash = 0;
+    bool has_file_hash = false;
+
+    char* texture_path = find_texture_path(texture_name, paths);
+    if(texture_path == NULL)
+    {
+        perror("load_texture");
+        return -1;
+    }
+
+    // Byte identical files are caught before anything is decoded or uploaded, a hash hit is confirmed against the first file
+    if(file_hashes != NULL && strcmp(texture_path, "default") != 0 && hash_texture_file(texture_path, &file_hash) == PIGMENT_SUCCESS)
+    {
+        int64_t existing_slot = content_hashmap_get_value(file_hashes, file_hash);
+        if(existing_slot != -1 && same_texture_file(texture_path, slot_paths[existing_slot]))
+        {
+            free(texture_path);
+            return (int32_t) existing_slot;
+        }
+        has_file_hash = existing_slot == -1;
+    }
+
+    // Keep the slot taken so the indices of the following textures still match
+    if(add_texture(texture_list, texture_path, commands, device) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to load texture %s, using default texture instead!\n", texture_name);
+        if(add_texture(texture_list, "default", commands, device) != PIGMENT_SUCCESS)
+        {
+            free(texture_path);
+            return -1;
+        }
+    }
+
+    // Different files can still decode to the same content, the texture list then shares the first upload
+    if(get_texture_number(texture_list) == slot)
+    {
+        free(texture_path);
+        return (int32_t) get_shared_texture(texture_list);
+    }
+
+    if(has_file_hash)
+    {
+        content_hashmap_set_value(file_hashes, file_hash, slot);
+        slot_paths[slot] = texture_path;
+    }
+    else
+    {
+        free(texture_path);
+    }
+
+    return (int32_t) slot;
+}
+
+void load_texture(PTextureList* texture_list, const char* texture_name, StringArray* paths, PCommands* commands, PDevice* device)
+{
+    load_unique_texture(texture_list, texture_name, paths, NULL, NULL, commands, device);
 }
 
 void load_all_textures(PTextureList* texture_list, TexturesToLoad* textures_to_load, StringArray* paths, PCommands* commands, PDevice* device)
 {
+    int texture_count           = textures_to_load_number(textures_to_load);
+    ContentHashMap* file_hashes = content_hashmap_create();
+    char** slot_paths           = calloc((size_t) texture_count, sizeof(*slot_paths));
+
+    // Without the maps every name is simply loaded on its own
+    if(file_hashes == NULL || slot_paths == NULL)
+    {
+        content_hashmap_free(&file_hashes);
+    }
+    enable_texture_sharing(texture_list);
+
     char** textures = get_textures_to_load(textures_to_load);
-    for(int i = 0; i < textures_to_load_number(textures_to_load); i++)
+    for(int i = 0; i < texture_count; i++)
+    {
+        // Names with identical content alias the slot of the first one loaded
+        int32_t slot = load_unique_texture(texture_list, textures[i], paths, file_hashes, slot_paths, commands, device);
+        texture_hashmap_set_value(textures_to_load, textures[i], slot < 0 ? 0 : (uint16_t) slot);
+    }
+
+    generate_pending_mipmaps(texture_list, commands, device);
+
+    disable_texture_sharing(texture_list);
+    for(int i = 0; slot_paths != NULL && i < texture_count; i++)
     {
-        load_texture(texture_list, textures[i], paths, commands, device);
+        free(slot_paths[i]);
     }
+    free(slot_paths);
+    content_hashmap_free(&file_hashes);
 }
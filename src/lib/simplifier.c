@@ -0,0 +1,435 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "simplifier.h"
+
+#include <math.h>
+
+typedef struct Quadric {
+    double a2;
+    double ab;
+    double ac;
+    double ad;
+    double b2;
+    double bc;
+    double bd;
+    double c2;
+    double cd;
+    double d2;
+} Quadric;
+
+typedef struct PositionKey {
+    float position[3];
+    uint32_t vertex;
+} PositionKey;
+
+typedef struct Edge {
+    uint32_t first;
+    uint32_t second;
+} Edge;
+
+typedef struct Collapse {
+    uint32_t source;
+    uint32_t target;
+    double error;
+} Collapse;
+
+int compare_positions(const void* a, const void* b);
+int compare_edges(const void* a, const void* b);
+int compare_collapses(const void* a, const void* b);
+int lock_vertices(const SimplifyInput* input, bool* locked);
+void add_triangle_quadric(Quadric* quadrics, const SimplifyInput* input, uint32_t a, uint32_t b, uint32_t c);
+double quadric_error(const Quadric* quadric, const float* position);
+void merge_quadric(Quadric* target, const Quadric* source);
+void triangle_normal(const float* a, const float* b, const float* c, float normal[3]);
+bool collapse_flips(const SimplifyInput* input, const uint32_t* indices, const uint32_t* triangles, uint32_t triangle_count, uint32_t source, uint32_t target);
+
+int compare_positions(const void* a, const void* b)
+{
+    const PositionKey* first  = a;
+    const PositionKey* second = b;
+
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        if(first->position[i] != second->position[i])
+        {
+            return first->position[i] < second->position[i] ? -1 : 1;
+        }
+    }
+    return first->vertex < second->vertex ? -1 : first->vertex > second->vertex;
+}
+
+int compare_edges(const void* a, const void* b)
+{
+    const Edge* first  = a;
+    const Edge* second = b;
+
+    if(first->first != second->first)
+    {
+        return first->first < second->first ? -1 : 1;
+    }
+    return first->second < second->second ? -1 : first->second > second->second;
+}
+
+int compare_collapses(const void* a, const void* b)
+{
+    const Collapse* first  = a;
+    const Collapse* second = b;
+
+    return first->error < second->error ? -1 : first->error > second->error;
+}
+
+// Vertices sharing a position with another one sit on an attribute seam, and vertices of an open or
+// non-manifold edge on a border. Both keep their place, so the silhouette and the texture mapping hold.
+int lock_vertices(const SimplifyInput* input, bool* locked)
+{
+    PositionKey* keys = malloc(input->vertex_count * sizeof(*keys));
+    uint32_t* remap   = malloc(input->vertex_count * sizeof(*remap));
+    Edge* edges       = malloc(input->index_count * sizeof(*edges));
+    int result        = PIGMENT_ERROR;
+    if(keys == NULL || remap == NULL || edges == NULL)
+    {
+        goto FREE;
+    }
+
+    for(uint32_t i = 0; i < input->vertex_count; i++)
+    {
+        memcpy(keys[i].position, &input->positions[i * 3], sizeof(keys[i].position));
+        keys[i].vertex = i;
+    }
+    qsort(keys, input->vertex_count, sizeof(*keys), compare_positions);
+
+    for(uint32_t i = 0; i < input->vertex_count; i++)
+    {
+        bool shared = i > 0 && memcmp(keys[i].position, keys[i - 1].position, sizeof(keys[i].position)) == 0;
+
+        remap[keys[i].vertex] = shared ? remap[keys[i - 1].vertex] : keys[i].vertex;
+        if(shared)
+        {
+            locked[keys[i].vertex]        = true;
+            locked[remap[keys[i].vertex]] = true;
+        }
+    }
+
+    for(uint32_t i = 0; i < input->index_count; i++)
+    {
+        uint32_t a = remap[input->indices[i]];
+        uint32_t b = remap[input->indices[i - i % 3 + (i + 1) % 3]];
+        edges[i]   = (Edge) {a < b ? a : b, a < b ? b : a};
+    }
+    qsort(edges, input->index_count, sizeof(*edges), compare_edges);
+
+    for(uint32_t i = 0; i < input->index_count;)
+    {
+        uint32_t count = 1;
+        while(i + count < input->index_count && compare_edges(&edges[i], &edges[i + count]) == 0)
+        {
+            count++;
+        }
+        if(count != 2)
+        {
+            locked[edges[i].first]  = true;
+            locked[edges[i].second] = true;
+        }
+        i += count;
+    }
+
+    // Border vertices were found through their position, every vertex at that position is locked with them
+    for(uint32_t i = 0; i < input->vertex_count; i++)
+    {
+        locked[i] = locked[i] || locked[remap[i]];
+    }
+
+    result = PIGMENT_SUCCESS;
+
+FREE:
+    free(edges);
+    free(remap);
+    free(keys);
+    return result;
+}
+
+void add_triangle_quadric(Quadric* quadrics, const SimplifyInput* input, uint32_t a, uint32_t b, uint32_t c)
+{
+    const float* p0 = &input->positions[a * 3];
+    const float* p1 = &input->positions[b * 3];
+    const float* p2 = &input->positions[c * 3];
+
+    float normal[3];
+    triangle_normal(p0, p1, p2, normal);
+
+    double length = sqrt((double) normal[0] * normal[0] + (double) normal[1] * normal[1] + (double) normal[2] * normal[2]);
+    if(length == 0.0)
+    {
+        return;
+    }
+
+    double x      = normal[0] / length;
+    double y      = normal[1] / length;
+    double z      = normal[2] / length;
+    double d      = -(x * p0[0] + y * p0[1] + z * p0[2]);
+
+    Quadric plane = {
+        .a2 = x * x,
+        .ab = x * y,
+        .ac = x * z,
+        .ad = x * d,
+        .b2 = y * y,
+        .bc = y * z,
+        .bd = y * d,
+        .c2 = z * z,
+        .cd = z * d,
+        .d2 = d * d
+    };
+
+    merge_quadric(&quadrics[a], &plane);
+    merge_quadric(&quadrics[b], &plane);
+    merge_quadric(&quadrics[c], &plane);
+}
+
+// Sum of the squared distances to the planes of the triangles merged into the vertex
+double quadric_error(const Quadric* quadric, const float* position)
+{
+    double x = position[0];
+    double y = position[1];
+    double z = position[2];
+
+    double error = quadric->a2 * x * x + quadric->b2 * y * y + quadric->c2 * z * z + quadric->d2 +
+                   2.0 * (quadric->ab * x * y + quadric->ac * x * z + quadric->bc * y * z + quadric->ad * x + quadric->bd * y + quadric->cd * z);
+
+    return error > 0.0 ? error : 0.0;
+}
+
+void merge_quadric(Quadric* target, const Quadric* source)
+{
+    target->a2 += source->a2;
+    target->ab += source->ab;
+    target->ac += source->ac;
+    target->ad += source->ad;
+    target->b2 += source->b2;
+    target->bc += source->bc;
+    target->bd += source->bd;
+    target->c2 += source->c2;
+    target->cd += source->cd;
+    target->d2 += source->d2;
+}
+
+void triangle_normal(const float* a, const float* b, const float* c, float normal[3])
+{
+    float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+}
+
+bool collapse_flips(const SimplifyInput* input, const uint32_t* indices, const uint32_t* triangles, uint32_t triangle_count, uint32_t source, uint32_t target)
+{
+    for(uint32_t i = 0; i < triangle_count; i++)
+    {
+        const uint32_t* triangle = &indices[triangles[i] * 3];
+        if(triangle[0] == target || triangle[1] == target || triangle[2] == target)
+        {
+            continue;
+        }
+
+        const float* before[3];
+        const float* after[3];
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            before[j] = &input->positions[triangle[j] * 3];
+            after[j]  = triangle[j] == source ? &input->positions[target * 3] : before[j];
+        }
+
+        float old_normal[3];
+        float new_normal[3];
+        triangle_normal(before[0], before[1], before[2], old_normal);
+        triangle_normal(after[0], after[1], after[2], new_normal);
+
+        if(old_normal[0] * new_normal[0] + old_normal[1] * new_normal[1] + old_normal[2] * new_normal[2] <= 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Collapses edges onto one of their vertices, cheapest quadric error first, until the index count reaches the target
+// or no collapse stays under the error bounds. Vertices are never moved, so their attributes stay valid.
+uint32_t simplify_mesh(const SimplifyInput* input, uint32_t target_index_count, float max_error, float max_attribute_error, uint32_t* destination, float* result_error)
+{
+    uint32_t vertex_count  = input->vertex_count;
+    uint32_t index_count   = input->index_count;
+    double error_limit     = (double) max_error * max_error;
+    double attribute_limit = (double) max_attribute_error * max_attribute_error;
+    double worst_error     = 0.0;
+
+    bool* locked               = calloc(vertex_count, sizeof(*locked));
+    bool* touched              = malloc(vertex_count * sizeof(*touched));
+    uint32_t* collapse_target  = malloc(vertex_count * sizeof(*collapse_target));
+    uint32_t* triangle_offsets = malloc((vertex_count + 1) * sizeof(*triangle_offsets));
+    uint32_t* vertex_triangles = malloc(index_count * sizeof(*vertex_triangles));
+    Quadric* quadrics          = calloc(vertex_count, sizeof(*quadrics));
+    Collapse* collapses        = malloc(2 * index_count * sizeof(*collapses));
+
+    memcpy(destination, input->indices, index_count * sizeof(*destination));
+    *result_error = 0.0f;
+
+    if(locked == NULL || touched == NULL || collapse_target == NULL || triangle_offsets == NULL || vertex_triangles == NULL || quadrics == NULL || collapses == NULL ||
+       lock_vertices(input, locked) != PIGMENT_SUCCESS)
+    {
+        goto FREE;
+    }
+
+    for(uint32_t i = 0; i < index_count; i += 3)
+    {
+        add_triangle_quadric(quadrics, input, destination[i], destination[i + 1], destination[i + 2]);
+    }
+
+    while(index_count > target_index_count)
+    {
+        // Triangles around each vertex, rebuilt every pass since collapses remove some of them
+        memset(triangle_offsets, 0, (vertex_count + 1) * sizeof(*triangle_offsets));
+        for(uint32_t i = 0; i < index_count; i++)
+        {
+            triangle_offsets[destination[i] + 1]++;
+        }
+        for(uint32_t i = 0; i < vertex_count; i++)
+        {
+            triangle_offsets[i + 1] += triangle_offsets[i];
+        }
+        for(uint32_t i = 0; i < index_count; i++)
+        {
+            vertex_triangles[triangle_offsets[destination[i]]++] = i / 3;
+        }
+        for(uint32_t i = vertex_count; i > 0; i--)
+        {
+            triangle_offsets[i] = triangle_offsets[i - 1];
+        }
+        triangle_offsets[0] = 0;
+
+        uint32_t collapse_number = 0;
+        for(uint32_t i = 0; i < index_count; i++)
+        {
+            uint32_t ends[2] = {destination[i], destination[i - i % 3 + (i + 1) % 3]};
+
+            for(uint32_t j = 0; j < 2; j++)
+            {
+                uint32_t source = ends[j];
+                uint32_t target = ends[1 - j];
+                if(locked[source] || source == target || (input->materials != NULL && input->materials[source] != input->materials[target]))
+                {
+                    continue;
+                }
+
+                double attribute_error = 0.0;
+                for(uint32_t k = 0; k < input->attribute_count; k++)
+                {
+                    double difference = input->attributes[source * input->attribute_count + k] - input->attributes[target * input->attribute_count + k];
+                    attribute_error += difference * difference;
+                }
+
+                double error = quadric_error(&quadrics[source], &input->positions[target * 3]);
+                if(attribute_error > attribute_limit || error > error_limit)
+                {
+                    continue;
+                }
+
+                collapses[collapse_number++] = (Collapse) {source, target, error};
+            }
+        }
+
+        if(collapse_number == 0)
+        {
+            break;
+        }
+        qsort(collapses, collapse_number, sizeof(*collapses), compare_collapses);
+
+        for(uint32_t i = 0; i < vertex_count; i++)
+        {
+            collapse_target[i] = i;
+            touched[i]         = false;
+        }
+
+        // Each vertex takes part in one collapse per pass, and so do its neighbours, so the flip test sees final positions
+        uint32_t removed = 0;
+        uint32_t needed  = (index_count - target_index_count) / 3;
+        uint32_t applied = 0;
+        for(uint32_t i = 0; i < collapse_number && removed < needed; i++)
+        {
+            Collapse* collapse        = &collapses[i];
+            const uint32_t* triangles = &vertex_triangles[triangle_offsets[collapse->source]];
+            uint32_t triangle_count   = triangle_offsets[collapse->source + 1] - triangle_offsets[collapse->source];
+
+            if(touched[collapse->source] || touched[collapse->target] ||
+               collapse_flips(input, destination, triangles, triangle_count, collapse->source, collapse->target))
+            {
+                continue;
+            }
+
+            for(uint32_t j = 0; j < triangle_count; j++)
+            {
+                const uint32_t* triangle = &destination[triangles[j] * 3];
+                touched[triangle[0]]     = true;
+                touched[triangle[1]]     = true;
+                touched[triangle[2]]     = true;
+                if(triangle[0] == collapse->target || triangle[1] == collapse->target || triangle[2] == collapse->target)
+                {
+                    removed++;
+                }
+            }
+
+            collapse_target[collapse->source] = collapse->target;
+            merge_quadric(&quadrics[collapse->target], &quadrics[collapse->source]);
+            worst_error = collapse->error > worst_error ? collapse->error : worst_error;
+            applied++;
+        }
+
+        if(applied == 0)
+        {
+            break;
+        }
+
+        uint32_t kept = 0;
+        for(uint32_t i = 0; i < index_count; i += 3)
+        {
+            uint32_t a = collapse_target[destination[i]];
+            uint32_t b = collapse_target[destination[i + 1]];
+            uint32_t c = collapse_target[destination[i + 2]];
+            if(a != b && b != c && a != c)
+            {
+                destination[kept++] = a;
+                destination[kept++] = b;
+                destination[kept++] = c;
+            }
+        }
+        index_count = kept;
+    }
+
+    *result_error = (float) sqrt(worst_error);
+
+FREE:
+    free(collapses);
+    free(quadrics);
+    free(vertex_triangles);
+    free(triangle_offsets);
+    free(collapse_target);
+    free(touched);
+    free(locked);
+    return index_count;
+}
@@ -0,0 +1,34 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMPLIFIER_H
+#define SIMPLIFIER_H
+
+#include "defines.h"
+
+typedef struct SimplifyInput {
+    const float* positions;
+    const float* attributes;
+    const uint32_t* materials;
+    uint32_t attribute_count;
+    uint32_t vertex_count;
+    const uint32_t* indices;
+    uint32_t index_count;
+} SimplifyInput;
+
+uint32_t simplify_mesh(const SimplifyInput* input, uint32_t target_index_count, float max_error, float max_attribute_error, uint32_t* destination, float* result_error);
+
+#endif
@@ -0,0 +1,243 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lod.h"
+#include "structs.h"
+#include "lib/array.h"
+#include "lib/simplifier.h"
+
+#include <pthread.h>
+
+extern uint32_t get_cooking_thread_count(void);
+
+typedef struct MeshLods {
+    uint32_t* indices[MAX_MESH_LODS];
+    uint32_t index_counts[MAX_MESH_LODS];
+    float errors[MAX_MESH_LODS];
+    uint32_t lod_count;
+} MeshLods;
+
+typedef struct LodJob {
+    const PModel* model;
+    uint32_t first_mesh;
+    uint32_t last_mesh;
+    MeshLods* lods;
+} LodJob;
+
+void build_lods(const PModel* model, uint32_t mesh_index, MeshLods* lods);
+void* build_lods_for_meshes(void* arg);
+
+void build_lods(const PModel* model, uint32_t mesh_index, MeshLods* lods)
+{
+    const PMesh* mesh       = &model->meshes[mesh_index];
+    const uint32_t* indices = &model->mesh_indices[mesh->lods[0].first_index];
+    uint32_t index_count    = mesh->lods[0].index_count;
+    const Vertex* vertices  = &model->mesh_vertices[mesh->vertex_offset];
+
+    lods->lod_count = 1;
+
+    uint32_t vertex_count = 0;
+    for(uint32_t i = 0; i < index_count; i++)
+    {
+        vertex_count = indices[i] + 1 > vertex_count ? indices[i] + 1 : vertex_count;
+    }
+
+    float* positions    = malloc(vertex_count * 3 * sizeof(*positions));
+    float* attributes   = malloc(vertex_count * 2 * sizeof(*attributes));
+    uint32_t* materials = malloc(vertex_count * sizeof(*materials));
+    if(positions == NULL || attributes == NULL || materials == NULL)
+    {
+        goto FREE;
+    }
+
+    // Triangles using different textures never share a vertex after a collapse
+    for(uint32_t i = 0; i < vertex_count; i++)
+    {
+        memcpy(&positions[i * 3], vertices[i].pos, 3 * sizeof(*positions));
+        memcpy(&attributes[i * 2], vertices[i].texture_coord, 2 * sizeof(*attributes));
+        materials[i] = vertices[i].texture_index;
+    }
+
+    SimplifyInput input = {
+        .positions       = positions,
+        .attributes      = attributes,
+        .materials       = materials,
+        .attribute_count = 2,
+        .vertex_count    = vertex_count,
+        .indices         = indices,
+        .index_count     = index_count
+    };
+
+    // Each level simplifies the previous one, its error adds up to the errors before it
+    float error = 0.0f;
+    while(lods->lod_count < MAX_MESH_LODS)
+    {
+        uint32_t target_count = (uint32_t) ((float) input.index_count * LOD_INDEX_RATIO) / 3 * 3;
+        uint32_t* destination = malloc(input.index_count * sizeof(*destination));
+        if(destination == NULL)
+        {
+            break;
+        }
+
+        float level_error;
+        uint32_t count = simplify_mesh(&input, target_count, LOD_MAX_ERROR * mesh->bounds[3], LOD_MAX_UV_ERROR, destination, &level_error);
+        if(count == 0 || (float) count > (float) input.index_count * LOD_MIN_REDUCTION)
+        {
+            free(destination);
+            break;
+        }
+
+        error += level_error;
+
+        lods->indices[lods->lod_count]      = destination;
+        lods->index_counts[lods->lod_count] = count;
+        lods->errors[lods->lod_count]       = error;
+        lods->lod_count++;
+
+        input.indices     = destination;
+        input.index_count = count;
+    }
+
+FREE:
+    free(materials);
+    free(attributes);
+    free(positions);
+}
+
+void* build_lods_for_meshes(void* arg)
+{
+    LodJob* job = arg;
+
+    for(uint32_t i = job->first_mesh; i < job->last_mesh; i++)
+    {
+        build_lods(job->model, i, &job->lods[i]);
+    }
+
+    return NULL;
+}
+
+int build_mesh_lods(PModel* model)
+{
+    if(model->mesh_number == 0)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    uint32_t thread_count = get_cooking_thread_count();
+    if(thread_count > model->mesh_number)
+    {
+        thread_count = model->mesh_number;
+    }
+
+    MeshLods* lods     = calloc(model->mesh_number, sizeof(*lods));
+    LodJob* jobs       = malloc(thread_count * sizeof(*jobs));
+    pthread_t* threads = malloc(thread_count * sizeof(*threads));
+    bool* started      = calloc(thread_count, sizeof(*started));
+    int result         = PIGMENT_ERROR;
+    if(lods == NULL || jobs == NULL || threads == NULL || started == NULL)
+    {
+        perror("build_mesh_lods");
+        goto FREE;
+    }
+
+    for(uint32_t i = 0; i < thread_count; i++)
+    {
+        jobs[i] = (LodJob) {
+            .model      = model,
+            .first_mesh = model->mesh_number * i / thread_count,
+            .last_mesh  = model->mesh_number * (i + 1) / thread_count,
+            .lods       = lods
+        };
+
+        // The first meshes are simplified on the calling thread
+        if(i > 0)
+        {
+            started[i] = pthread_create(&threads[i], NULL, build_lods_for_meshes, &jobs[i]) == 0;
+        }
+    }
+
+    for(uint32_t i = 0; i < thread_count; i++)
+    {
+        if(started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            build_lods_for_meshes(&jobs[i]);
+        }
+    }
+
+    // Levels are appended after every mesh, they share the vertices of their first level
+    for(uint32_t i = 0; i < model->mesh_number; i++)
+    {
+        PMesh* mesh = &model->meshes[i];
+
+        for(uint32_t j = 1; j < lods[i].lod_count; j++)
+        {
+            if(reserve_array((void**) &model->mesh_indices, &model->mesh_indices_size, model->mesh_indices_number + lods[i].index_counts[j], sizeof(*model->mesh_indices)) != PIGMENT_SUCCESS)
+            {
+                perror("build_mesh_lods");
+                goto FREE;
+            }
+
+            memcpy(&model->mesh_indices[model->mesh_indices_number], lods[i].indices[j], lods[i].index_counts[j] * sizeof(*model->mesh_indices));
+
+            mesh->lods[j] = (PMeshLod) {
+                .first_index = model->mesh_indices_number,
+                .index_count = lods[i].index_counts[j],
+                .error       = lods[i].errors[j]
+            };
+            mesh->lod_count = j + 1;
+            model->mesh_indices_number += lods[i].index_counts[j];
+        }
+    }
+
+    result = PIGMENT_SUCCESS;
+
+FREE:
+    for(uint32_t i = 0; lods != NULL && i < model->mesh_number; i++)
+    {
+        for(uint32_t j = 1; j < lods[i].lod_count; j++)
+        {
+            free(lods[i].indices[j]);
+        }
+    }
+    free(started);
+    free(threads);
+    free(jobs);
+    free(lods);
+    return result;
+}
+
+// Coarsest level whose error projects under LOD_PIXEL_ERROR pixels. Going to a coarser level than the current one
+// needs a margin, so that an instance at the boundary does not switch every frame.
+uint32_t select_mesh_lod(const PMesh* mesh, float error_scale, float distance, uint32_t current_lod)
+{
+    uint32_t lod = 0;
+
+    for(uint32_t i = 1; i < mesh->lod_count; i++)
+    {
+        float threshold = i > current_lod ? LOD_HYSTERESIS : 1.0f;
+        if(mesh->lods[i].error * error_scale > threshold * distance)
+        {
+            break;
+        }
+        lod = i;
+    }
+
+    return lod;
+}
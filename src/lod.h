@@ -0,0 +1,31 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOD_H
+#define LOD_H
+#define LOD_INDEX_RATIO 0.5f
+#define LOD_MIN_REDUCTION 0.85f
+#define LOD_MAX_ERROR 0.05f
+#define LOD_MAX_UV_ERROR 0.25f
+#define LOD_PIXEL_ERROR 1.0f
+#define LOD_HYSTERESIS 0.75f
+
+#include "defines.h"
+
+int build_mesh_lods(PModel* model);
+uint32_t select_mesh_lod(const PMesh* mesh, float error_scale, float distance, uint32_t current_lod);
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory_tracker.h"
+#include "structs.h"
+
+extern uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
+
+int allocate_device_memory(const VkMemoryRequirements* memory_requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkDeviceMemory* memory, PDevice* device);
+void free_device_memory(VkDeviceMemory memory, PDevice* device);
+MemoryCategory get_buffer_memory_category(VkBufferUsageFlags usage);
+MemoryCategory get_image_memory_category(VkImageUsageFlags usage);
+void query_device_local_budget(PDevice* device, VkDeviceSize* budget, VkDeviceSize* usage);
+uint64_t run_memory_evictors(PDevice* device, uint64_t size, bool out_of_memory);
+int track_allocation(PMemoryTracker* tracker, VkDeviceMemory memory, VkDeviceSize size, MemoryCategory category, uint32_t heap_index);
+
+int create_memory_tracker(PDevice* device)
+{
+    device->memory_tracker = calloc(1, sizeof(*device->memory_tracker));
+    if(device->memory_tracker == NULL)
+    {
+        perror("create_memory_tracker");
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+void destroy_memory_tracker(PDevice* device)
+{
+    if(device->memory_tracker == NULL)
+    {
+        return;
+    }
+
+    if(device->memory_tracker->allocation_number > 0)
+    {
+        fprintf(stderr, "%u device memory allocations were not freed!\n", device->memory_tracker->allocation_number);
+    }
+
+    free(device->memory_tracker->allocations);
+    free(device->memory_tracker);
+    device->memory_tracker = NULL;
+}
+
+void register_memory_evictor(PDevice* device, PMemoryEvictor evictor, void* context)
+{
+    PMemoryTracker* tracker = device->memory_tracker;
+    if(tracker->evictor_number >= MAX_MEMORY_EVICTORS)
+    {
+        fprintf(stderr, "Too many memory evictors registered!\n");
+        return;
+    }
+
+    tracker->evictors[tracker->evictor_number]         = evictor;
+    tracker->evictor_contexts[tracker->evictor_number] = context;
+    tracker->evictor_number++;
+}
+
+void unregister_memory_evictor(PDevice* device, void* context)
+{
+    PMemoryTracker* tracker = device->memory_tracker;
+    for(uint32_t i = 0; i < tracker->evictor_number; i++)
+    {
+        if(tracker->evictor_contexts[i] == context)
+        {
+            tracker->evictor_number--;
+            tracker->evictors[i]         = tracker->evictors[tracker->evictor_number];
+            tracker->evictor_contexts[i] = tracker->evictor_contexts[tracker->evictor_number];
+            return;
+        }
+    }
+}
+
+MemoryCategory get_buffer_memory_category(VkBufferUsageFlags usage)
+{
+    if(usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT))
+    {
+        return MEMORY_GEOMETRY;
+    }
+    if(usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    {
+        return MEMORY_UNIFORMS;
+    }
+    if(usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+    {
+        return MEMORY_STAGING;
+    }
+    return MEMORY_OTHER;
+}
+
+MemoryCategory get_image_memory_category(VkImageUsageFlags usage)
+{
+    return (usage & VK_IMAGE_USAGE_SAMPLED_BIT) ? MEMORY_TEXTURES : MEMORY_OTHER;
+}
+
+void query_device_local_budget(PDevice* device, VkDeviceSize* budget, VkDeviceSize* usage)
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT
+    };
+
+    VkPhysicalDeviceMemoryProperties2 memory_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = device->memory_budget ? &budget_properties : NULL
+    };
+
+    vkGetPhysicalDeviceMemoryProperties2(device->physical_device, &memory_properties);
+
+    *budget = 0;
+    *usage  = 0;
+
+    for(uint32_t i = 0; i < memory_properties.memoryProperties.memoryHeapCount; i++)
+    {
+        if(!(memory_properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+        {
+            continue;
+        }
+
+        // Without the extension, the heap size stands in for the budget and only our own allocations are counted
+        if(device->memory_budget)
+        {
+            *budget += budget_properties.heapBudget[i];
+            *usage  += budget_properties.heapUsage[i];
+        }
+        else
+        {
+            *budget += memory_properties.memoryProperties.memoryHeaps[i].size / 100 * MEMORY_FALLBACK_BUDGET_PERCENT;
+            *usage  += device->memory_tracker->heap_usage[i];
+        }
+    }
+}
+
+bool memory_budget_exceeded(PDevice* device, uint64_t extra_size)
+{
+    VkDeviceSize budget, usage;
+    query_device_local_budget(device, &budget, &usage);
+
+    return usage + extra_size > budget / 100 * MEMORY_BUDGET_THRESHOLD_PERCENT;
+}
+
+void get_memory_stats(PDevice* device, PMemoryStats* stats)
+{
+    memcpy(stats->category_usage, device->memory_tracker->category_usage, sizeof(stats->category_usage));
+    query_device_local_budget(device, &stats->device_local_budget, &stats->device_local_usage);
+    stats->budget_from_driver = device->memory_budget;
+}
+
+uint64_t run_memory_evictors(PDevice* device, uint64_t size, bool out_of_memory)
+{
+    PMemoryTracker* tracker = device->memory_tracker;
+
+    // Evictors allocate smaller replacements themselves, those allocations must not evict again
+    if(tracker->evicting)
+    {
+        return 0;
+    }
+
+    tracker->evicting = true;
+
+    uint64_t released = 0;
+    for(uint32_t i = 0; i < tracker->evictor_number && released < size; i++)
+    {
+        released += tracker->evictors[i](tracker->evictor_contexts[i], size - released, out_of_memory, device);
+    }
+
+    tracker->evicting = false;
+
+    return released;
+}
+
+int track_allocation(PMemoryTracker* tracker, VkDeviceMemory memory, VkDeviceSize size, MemoryCategory category, uint32_t heap_index)
+{
+    if(tracker->allocation_number >= tracker->allocation_size)
+    {
+        uint32_t allocation_size       = tracker->allocation_size > 0 ? tracker->allocation_size * 2 : 64;
+        PMemoryAllocation* allocations = realloc(tracker->allocations, allocation_size * sizeof(*allocations));
+        if(allocations == NULL)
+        {
+            perror("track_allocation");
+            return PIGMENT_ERROR;
+        }
+        tracker->allocations     = allocations;
+        tracker->allocation_size = allocation_size;
+    }
+
+    tracker->allocations[tracker->allocation_number] = (PMemoryAllocation) {
+        .memory     = memory,
+        .size       = size,
+        .category   = category,
+        .heap_index = heap_index
+    };
+    tracker->allocation_number++;
+
+    tracker->category_usage[category] += size;
+    tracker->heap_usage[heap_index]   += size;
+
+    return PIGMENT_SUCCESS;
+}
+
+int allocate_device_memory(const VkMemoryRequirements* memory_requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkDeviceMemory* memory, PDevice* device)
+{
+    VkMemoryAllocateInfo allocate_info = {
+        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize  = memory_requirements->size,
+        .memoryTypeIndex = find_memory_type(device->physical_device, memory_requirements->memoryTypeBits, properties)
+    };
+
+    if(allocate_info.memoryTypeIndex == UINT32_MAX)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    vkGetPhysicalDeviceMemoryProperties(device->physical_device, &memory_properties);
+
+    uint32_t heap_index = memory_properties.memoryTypes[allocate_info.memoryTypeIndex].heapIndex;
+    bool device_local   = memory_properties.memoryHeaps[heap_index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+    // Make room before the driver starts paging or refusing allocations
+    if(device_local && memory_budget_exceeded(device, memory_requirements->size))
+    {
+        run_memory_evictors(device, memory_requirements->size, false);
+    }
+
+    VkResult result = vkAllocateMemory(device->logical_device, &allocate_info, NULL, memory);
+    if(result == VK_ERROR_OUT_OF_DEVICE_MEMORY && run_memory_evictors(device, memory_requirements->size, true) > 0)
+    {
+        result = vkAllocateMemory(device->logical_device, &allocate_info, NULL, memory);
+    }
+
+    if(result != VK_SUCCESS)
+    {
+        *memory = VK_NULL_HANDLE;
+        return PIGMENT_ERROR;
+    }
+
+    if(track_allocation(device->memory_tracker, *memory, memory_requirements->size, category, heap_index) != PIGMENT_SUCCESS)
+    {
+        vkFreeMemory(device->logical_device, *memory, NULL);
+        *memory = VK_NULL_HANDLE;
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+void free_device_memory(VkDeviceMemory memory, PDevice* device)
+{
+    if(memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    PMemoryTracker* tracker = device->memory_tracker;
+    for(uint32_t i = 0; i < tracker->allocation_number; i++)
+    {
+        if(tracker->allocations[i].memory != memory)
+        {
+            continue;
+        }
+
+        tracker->category_usage[tracker->allocations[i].category] -= tracker->allocations[i].size;
+        tracker->heap_usage[tracker->allocations[i].heap_index]   -= tracker->allocations[i].size;
+
+        tracker->allocation_number--;
+        tracker->allocations[i] = tracker->allocations[tracker->allocation_number];
+        break;
+    }
+
+    vkFreeMemory(device->logical_device, memory, NULL);
+}
@@ -0,0 +1,35 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+#define MEMORY_BUDGET_THRESHOLD_PERCENT 90
+#define MEMORY_FALLBACK_BUDGET_PERCENT 80
+#define MAX_MEMORY_EVICTORS 4
+
+#include "defines.h"
+
+// Releases at least size bytes of device local memory if it can, returns how much was released
+// Below out of memory, evictors must not wait for the device and may count memory released once the frames in flight are done
+typedef uint64_t (*PMemoryEvictor)(void* context, uint64_t size, bool out_of_memory, PDevice* device);
+
+int create_memory_tracker(PDevice* device);
+void destroy_memory_tracker(PDevice* device);
+void register_memory_evictor(PDevice* device, PMemoryEvictor evictor, void* context);
+void unregister_memory_evictor(PDevice* device, void* context);
+bool memory_budget_exceeded(PDevice* device, uint64_t extra_size);
+void get_memory_stats(PDevice* device, PMemoryStats* stats);
+#endif
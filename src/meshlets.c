@@ -0,0 +1,319 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "meshlets.h"
+#include "structs.h"
+#include "instancing.h"
+#include "pipeline.h"
+
+extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+
+int build_meshlets(PBuffers* buffers, const PModel* model, uint32_t first_index, uint32_t index_count, uint32_t material, uint32_t* meshlet_size);
+int append_meshlet(PBuffers* buffers, const PModel* model, PMeshlet* meshlet, uint32_t* meshlet_size);
+void compute_meshlet_bounds(const Vertex* vertices, const uint32_t* indices, PMeshlet* meshlet, mat4 model_matrix);
+bool meshlet_is_visible(const PMeshlet* meshlet, vec4* frustum_planes, vec3 camera_position);
+void record_meshlet_draws(VkCommandBuffer command_buffer, PBuffers* buffers, uint32_t frame, uint32_t material);
+
+int create_meshlets(PBuffers* buffers, const PModel* model, PDevice* device, uint32_t frame_count)
+{
+    uint32_t meshlet_size = 0;
+
+    // Opaque and alpha tested triangles are split beforehand, so no meshlet mixes both
+    if(build_meshlets(buffers, model, 0, model->opaque_indices_number, MATERIAL_OPAQUE, &meshlet_size) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+    buffers->opaque_meshlet_number = buffers->meshlet_number;
+    if(build_meshlets(buffers, model, model->opaque_indices_number, model->indices_number - model->opaque_indices_number, MATERIAL_ALPHA_TESTED, &meshlet_size) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    buffers->multi_draw_indirect = device->multi_draw_indirect;
+    if(buffers->meshlet_number == 0)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    buffers->meshlet_draw_buffers         = calloc(frame_count, sizeof(*buffers->meshlet_draw_buffers));
+    buffers->meshlet_draw_buffers_memory  = calloc(frame_count, sizeof(*buffers->meshlet_draw_buffers_memory));
+    buffers->meshlet_draw_buffers_mapped  = calloc(frame_count, sizeof(*buffers->meshlet_draw_buffers_mapped));
+    if(buffers->meshlet_draw_buffers == NULL || buffers->meshlet_draw_buffers_memory == NULL || buffers->meshlet_draw_buffers_mapped == NULL)
+    {
+        perror("create_meshlets");
+        return PIGMENT_ERROR;
+    }
+
+    VkDeviceSize draw_size = buffers->meshlet_number * sizeof(VkDrawIndexedIndirectCommand);
+    for(uint32_t i = 0; i < frame_count; i++)
+    {
+        if(create_buffer(&buffers->meshlet_draw_buffers[i], &buffers->meshlet_draw_buffers_memory[i], draw_size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+        if(vkMapMemory(device->logical_device, buffers->meshlet_draw_buffers_memory[i], 0, draw_size, 0, &buffers->meshlet_draw_buffers_mapped[i]) != VK_SUCCESS)
+        {
+            fprintf(stderr, "Failed to map meshlet draw buffer!\n");
+            return PIGMENT_ERROR;
+        }
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+void destroy_meshlets(PBuffers* buffers, PDevice* device, uint32_t frame_count)
+{
+    for(uint32_t i = 0; buffers->meshlet_draw_buffers != NULL && buffers->meshlet_draw_buffers_memory != NULL && i < frame_count; i++)
+    {
+        if(buffers->meshlet_draw_buffers_mapped != NULL && buffers->meshlet_draw_buffers_mapped[i] != NULL)
+        {
+            vkUnmapMemory(device->logical_device, buffers->meshlet_draw_buffers_memory[i]);
+        }
+        vkDestroyBuffer(device->logical_device, buffers->meshlet_draw_buffers[i], NULL);
+        free_device_memory(buffers->meshlet_draw_buffers_memory[i], device);
+    }
+
+    free(buffers->meshlet_draw_buffers);
+    free(buffers->meshlet_draw_buffers_memory);
+    free(buffers->meshlet_draw_buffers_mapped);
+    free(buffers->meshlets);
+}
+
+int build_meshlets(PBuffers* buffers, const PModel* model, uint32_t first_index, uint32_t index_count, uint32_t material, uint32_t* meshlet_size)
+{
+    uint32_t meshlet_vertices[MESHLET_MAX_VERTICES];
+    uint32_t vertex_number = 0;
+
+    PMeshlet meshlet = {
+        .first_index = first_index,
+        .index_count = 0,
+        .material    = material
+    };
+
+    // Triangles are taken in index buffer order, so every meshlet stays a contiguous range of it
+    for(uint32_t i = first_index; i + 2 < first_index + index_count; i += 3)
+    {
+        uint32_t new_vertices[3];
+        uint32_t new_vertex_number = 0;
+        for(uint32_t j = 0; j < 3; j++)
+        {
+            uint32_t vertex = model->indices[i + j];
+            bool known      = false;
+            for(uint32_t k = 0; k < vertex_number && !known; k++)
+            {
+                known = meshlet_vertices[k] == vertex;
+            }
+            for(uint32_t k = 0; k < new_vertex_number && !known; k++)
+            {
+                known = new_vertices[k] == vertex;
+            }
+            if(!known)
+            {
+                new_vertices[new_vertex_number++] = vertex;
+            }
+        }
+
+        if(vertex_number + new_vertex_number > MESHLET_MAX_VERTICES || meshlet.index_count / 3 >= MESHLET_MAX_TRIANGLES)
+        {
+            if(append_meshlet(buffers, model, &meshlet, meshlet_size) != PIGMENT_SUCCESS)
+            {
+                return PIGMENT_ERROR;
+            }
+            meshlet.first_index = i;
+            meshlet.index_count = 0;
+            vertex_number       = 0;
+        }
+
+        memcpy(&meshlet_vertices[vertex_number], new_vertices, new_vertex_number * sizeof(*new_vertices));
+        vertex_number       += new_vertex_number;
+        meshlet.index_count += 3;
+    }
+
+    if(meshlet.index_count > 0)
+    {
+        return append_meshlet(buffers, model, &meshlet, meshlet_size);
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+int append_meshlet(PBuffers* buffers, const PModel* model, PMeshlet* meshlet, uint32_t* meshlet_size)
+{
+    if(buffers->meshlet_number >= *meshlet_size)
+    {
+        uint32_t new_size = *meshlet_size > 0 ? *meshlet_size * 2 : 256;
+        PMeshlet* meshlets = realloc(buffers->meshlets, new_size * sizeof(*meshlets));
+        if(meshlets == NULL)
+        {
+            perror("append_meshlet");
+            return PIGMENT_ERROR;
+        }
+        buffers->meshlets = meshlets;
+        *meshlet_size     = new_size;
+    }
+
+    compute_meshlet_bounds(model->vertices, model->indices, meshlet, buffers->model_matrix);
+    buffers->meshlets[buffers->meshlet_number++] = *meshlet;
+
+    return PIGMENT_SUCCESS;
+}
+
+void compute_meshlet_bounds(const Vertex* vertices, const uint32_t* indices, PMeshlet* meshlet, mat4 model_matrix)
+{
+    const uint32_t* meshlet_indices = &indices[meshlet->first_index];
+
+    vec3 min;
+    vec3 max;
+    glm_vec3_copy((float*) vertices[meshlet_indices[0]].pos, min);
+    glm_vec3_copy((float*) vertices[meshlet_indices[0]].pos, max);
+    for(uint32_t i = 1; i < meshlet->index_count; i++)
+    {
+        glm_vec3_minv(min, (float*) vertices[meshlet_indices[i]].pos, min);
+        glm_vec3_maxv(max, (float*) vertices[meshlet_indices[i]].pos, max);
+    }
+
+    vec3 center;
+    glm_vec3_add(min, max, center);
+    glm_vec3_scale(center, 0.5f, center);
+
+    float radius2 = 0.0f;
+    for(uint32_t i = 0; i < meshlet->index_count; i++)
+    {
+        radius2 = glm_max(radius2, glm_vec3_distance2(center, (float*) vertices[meshlet_indices[i]].pos));
+    }
+
+    // The cone axis is the average facing of the triangles, its cutoff covers the one that deviates the most
+    vec3 normals[MESHLET_MAX_TRIANGLES];
+    vec3 axis = {0.0f, 0.0f, 0.0f};
+    for(uint32_t i = 0; i < meshlet->index_count / 3; i++)
+    {
+        vec3 edge1;
+        vec3 edge2;
+        glm_vec3_sub((float*) vertices[meshlet_indices[i * 3 + 1]].pos, (float*) vertices[meshlet_indices[i * 3]].pos, edge1);
+        glm_vec3_sub((float*) vertices[meshlet_indices[i * 3 + 2]].pos, (float*) vertices[meshlet_indices[i * 3]].pos, edge2);
+        glm_vec3_cross(edge1, edge2, normals[i]);
+
+        float area = glm_vec3_norm(normals[i]);
+        glm_vec3_scale(normals[i], area > 0.0f ? 1.0f / area : 0.0f, normals[i]);
+        glm_vec3_add(axis, normals[i], axis);
+    }
+
+    float axis_length = glm_vec3_norm(axis);
+    float min_dot     = axis_length > 0.0f ? 1.0f : -1.0f;
+    glm_vec3_scale(axis, axis_length > 0.0f ? 1.0f / axis_length : 0.0f, axis);
+    for(uint32_t i = 0; i < meshlet->index_count / 3; i++)
+    {
+        min_dot = fminf(min_dot, glm_vec3_dot(axis, normals[i]));
+    }
+
+    // Bounds are kept in world space, the static model's transform does not change
+    glm_mat4_mulv3(model_matrix, center, 1.0f, meshlet->bounds);
+    float scale = fmaxf(glm_vec3_norm(model_matrix[0]), fmaxf(glm_vec3_norm(model_matrix[1]), glm_vec3_norm(model_matrix[2])));
+    meshlet->bounds[3] = sqrtf(radius2) * scale;
+
+    glm_mat4_mulv3(model_matrix, axis, 0.0f, meshlet->cone);
+    glm_vec3_normalize(meshlet->cone);
+    // A cone wider than a half space can not be back facing as a whole, a cutoff of 1 never culls it
+    meshlet->cone[3] = min_dot > 0.0f ? sqrtf(1.0f - min_dot * min_dot) : 1.0f;
+}
+
+bool meshlet_is_visible(const PMeshlet* meshlet, vec4* frustum_planes, vec3 camera_position)
+{
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        if(glm_vec3_dot(frustum_planes[i], (float*) meshlet->bounds) + frustum_planes[i][3] < -meshlet->bounds[3])
+        {
+            return false;
+        }
+    }
+
+    // Every triangle faces away when the camera sees the whole cone from behind
+    vec3 direction;
+    glm_vec3_sub((float*) meshlet->bounds, camera_position, direction);
+    return glm_vec3_dot(direction, (float*) meshlet->cone) < meshlet->cone[3] * glm_vec3_norm(direction) + meshlet->bounds[3];
+}
+
+void cull_meshlets(PBuffers* buffers, uint32_t frame)
+{
+    if(buffers->meshlet_number == 0)
+    {
+        return;
+    }
+
+    VkDrawIndexedIndirectCommand* draws = buffers->meshlet_draw_buffers_mapped[frame];
+
+    for(uint32_t material = 0; material < MATERIAL_COUNT; material++)
+    {
+        uint32_t first_meshlet = material == MATERIAL_OPAQUE ? 0 : buffers->opaque_meshlet_number;
+        uint32_t last_meshlet  = material == MATERIAL_OPAQUE ? buffers->opaque_meshlet_number : buffers->meshlet_number;
+        uint32_t draw_number   = 0;
+
+        VkDrawIndexedIndirectCommand range = {
+            .instanceCount = 1,
+            .firstInstance = STATIC_INSTANCE
+        };
+
+        // Visible meshlets that follow each other in the index buffer are merged into a single range
+        for(uint32_t i = first_meshlet; i < last_meshlet; i++)
+        {
+            const PMeshlet* meshlet = &buffers->meshlets[i];
+            if(!meshlet_is_visible(meshlet, buffers->frustum_planes, buffers->camera_position))
+            {
+                continue;
+            }
+
+            if(range.indexCount > 0 && range.firstIndex + range.indexCount == meshlet->first_index)
+            {
+                range.indexCount += meshlet->index_count;
+                continue;
+            }
+            if(range.indexCount > 0)
+            {
+                draws[first_meshlet + draw_number++] = range;
+            }
+            range.firstIndex = meshlet->first_index;
+            range.indexCount = meshlet->index_count;
+        }
+        if(range.indexCount > 0)
+        {
+            draws[first_meshlet + draw_number++] = range;
+        }
+
+        buffers->meshlet_draw_counts[material] = draw_number;
+    }
+}
+
+void record_meshlet_draws(VkCommandBuffer command_buffer, PBuffers* buffers, uint32_t frame, uint32_t material)
+{
+    uint32_t draw_count = buffers->meshlet_draw_counts[material];
+    VkDeviceSize offset = (material == MATERIAL_OPAQUE ? 0 : buffers->opaque_meshlet_number) * sizeof(VkDrawIndexedIndirectCommand);
+
+    if(buffers->multi_draw_indirect)
+    {
+        if(draw_count > 0)
+        {
+            vkCmdDrawIndexedIndirect(command_buffer, buffers->meshlet_draw_buffers[frame], offset, draw_count, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        return;
+    }
+
+    for(uint32_t i = 0; i < draw_count; i++)
+    {
+        vkCmdDrawIndexedIndirect(command_buffer, buffers->meshlet_draw_buffers[frame], offset + i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
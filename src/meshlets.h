@@ -0,0 +1,29 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MESHLETS_H
+#define MESHLETS_H
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+#include "defines.h"
+
+int create_meshlets(PBuffers* buffers, const PModel* model, PDevice* device, uint32_t frame_count);
+void cull_meshlets(PBuffers* buffers, uint32_t frame);
+void destroy_meshlets(PBuffers* buffers, PDevice* device, uint32_t frame_count);
+
+#endif
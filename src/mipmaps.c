@@ -0,0 +1,663 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mipmaps.h"
+#include "structs.h"
+#include "shaders.h"
+
+extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
+extern VkCommandBuffer start_single_usage_commands(VkCommandPool command_pool, PDevice* device);
+extern void end_single_usage_commands(VkCommandBuffer* command_buffer, VkCommandPool command_pool, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+
+VkFormat get_storage_format(VkFormat format, bool* srgb);
+bool use_compute_mipmaps(PDevice* device, VkFormat format, uint32_t mip_levels);
+int create_mipmap_pipeline(PMipmapGenerator* generator, PDevice* device);
+VkImageView create_mip_view(VkImage image, VkFormat format, uint32_t mip_level, VkDevice device);
+int record_blit_mipmaps(VkCommandBuffer command_buffer, PTexture* texture, PDevice* device);
+int generate_mipmap_batch(PTextureList* texture_list, PMipmapGenerator* generator, uint32_t* next_texture, PCommands* commands, PDevice* device);
+
+VkFormat get_storage_format(VkFormat format, bool* srgb)
+{
+    *srgb = false;
+
+    switch(format)
+    {
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            *srgb = true;
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+bool use_compute_mipmaps(PDevice* device, VkFormat format, uint32_t mip_levels)
+{
+    bool srgb;
+    VkFormat storage_format = get_storage_format(format, &srgb);
+
+    if(!device->storage_image_dynamic_indexing || storage_format == VK_FORMAT_UNDEFINED || mip_levels < 2 || mip_levels > MAX_COMPUTE_MIP_LEVELS)
+    {
+        return false;
+    }
+
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(device->physical_device, storage_format, &format_properties);
+
+    return (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+int create_mipmap_pipeline(PMipmapGenerator* generator, PDevice* device)
+{
+    char* shader_code = NULL;
+    uint32_t* shader_spv = NULL;
+    VkShaderModule shader_module = NULL;
+    uint32_t shader_code_size;
+    uint32_t shader_spv_size;
+
+    shader_code = get_shader_code("shaders/mipmap.comp", &shader_code_size);
+    if(shader_code == NULL)
+    {
+        shader_code_size = strlen(DEFAULT_MIPMAP_COMPUTE_SHADER);
+        shader_code = malloc(shader_code_size + 1);
+        if(shader_code == NULL)
+        {
+            goto ERROR;
+        }
+        memcpy(shader_code, DEFAULT_MIPMAP_COMPUTE_SHADER, shader_code_size + 1);
+    }
+
+    shader_spv = compile_glsl_to_spv(shader_code, shader_code_size, shaderc_glsl_compute_shader, "shaders/mipmap.spv", NULL, &shader_spv_size);
+    if(shader_spv == NULL)
+    {
+        fprintf(stderr, "Failed to compile mipmap compute shader to SPIR-V.\n");
+        goto ERROR;
+    }
+
+    shader_module = create_shader_module(device->logical_device, shader_spv, shader_spv_size);
+    if(shader_module == NULL)
+    {
+        goto ERROR;
+    }
+
+    VkComputePipelineCreateInfo pipeline_create_info = {
+        .sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT,
+        .stage.module = shader_module,
+        .stage.pName  = "main",
+        .layout       = generator->pipeline_layout
+    };
+
+    if(vkCreateComputePipelines(device->logical_device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &generator->pipeline) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create mipmap compute pipeline!\n");
+        goto ERROR;
+    }
+
+    vkDestroyShaderModule(device->logical_device, shader_module, NULL);
+    free(shader_spv);
+    free(shader_code);
+
+    return PIGMENT_SUCCESS;
+
+ERROR:
+    if(shader_module != NULL)
+        vkDestroyShaderModule(device->logical_device, shader_module, NULL);
+    free(shader_spv);
+    free(shader_code);
+    return PIGMENT_ERROR;
+}
+
+PMipmapGenerator* create_mipmap_generator(PDevice* device)
+{
+    PMipmapGenerator* generator = calloc(1, sizeof(*generator));
+    if(generator == NULL)
+    {
+        perror("create_mipmap_generator");
+        return NULL;
+    }
+
+    VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[] = {
+        {
+            .binding         = 0,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = MAX_COMPUTE_MIP_LEVELS,
+            .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT
+        },
+        {
+            .binding         = 1,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT
+        }
+    };
+
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = sizeof(descriptor_set_layout_bindings) / sizeof(descriptor_set_layout_bindings[0]),
+        .pBindings    = descriptor_set_layout_bindings
+    };
+
+    if(vkCreateDescriptorSetLayout(device->logical_device, &layout_info, NULL, &generator->descriptor_set_layout) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create mipmap descriptor set layout!\n");
+        goto ERROR;
+    }
+
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset     = 0,
+        .size       = sizeof(MipmapConstants)
+    };
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &generator->descriptor_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &push_constant_range
+    };
+
+    if(vkCreatePipelineLayout(device->logical_device, &pipeline_layout_info, NULL, &generator->pipeline_layout) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create mipmap pipeline layout!\n");
+        goto ERROR;
+    }
+
+    if(create_mipmap_pipeline(generator, device) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+
+    VkDescriptorPoolSize pool_sizes[] = {
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = MIPMAP_BATCH_SIZE * MAX_COMPUTE_MIP_LEVELS
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = MIPMAP_BATCH_SIZE
+        }
+    };
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]),
+        .pPoolSizes    = pool_sizes,
+        .maxSets       = MIPMAP_BATCH_SIZE
+    };
+
+    if(vkCreateDescriptorPool(device->logical_device, &pool_info, NULL, &generator->descriptor_pool) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create mipmap descriptor pool!\n");
+        goto ERROR;
+    }
+
+    // The sets are rewritten for every batch, once the previous one has completed
+    VkDescriptorSetLayout layouts[MIPMAP_BATCH_SIZE];
+    for(uint32_t i = 0; i < MIPMAP_BATCH_SIZE; i++)
+    {
+        layouts[i] = generator->descriptor_set_layout;
+    }
+
+    VkDescriptorSetAllocateInfo allocate_info = {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = generator->descriptor_pool,
+        .descriptorSetCount = MIPMAP_BATCH_SIZE,
+        .pSetLayouts        = layouts
+    };
+
+    if(vkAllocateDescriptorSets(device->logical_device, &allocate_info, generator->descriptor_sets) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to allocate mipmap descriptor sets!\n");
+        goto ERROR;
+    }
+
+    if(create_buffer(&generator->counter_buffer, &generator->counter_buffer_memory, MIPMAP_BATCH_SIZE * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        generator->counter_buffer = NULL;
+        goto ERROR;
+    }
+
+    return generator;
+
+ERROR:
+    destroy_mipmap_generator(generator, device);
+    return NULL;
+}
+
+void destroy_mipmap_generator(PMipmapGenerator* generator, PDevice* device)
+{
+    if(generator == NULL)
+    {
+        return;
+    }
+
+    vkDestroyBuffer(device->logical_device, generator->counter_buffer, NULL);
+    free_device_memory(generator->counter_buffer_memory, device);
+    vkDestroyDescriptorPool(device->logical_device, generator->descriptor_pool, NULL);
+    vkDestroyPipeline(device->logical_device, generator->pipeline, NULL);
+    vkDestroyPipelineLayout(device->logical_device, generator->pipeline_layout, NULL);
+    vkDestroyDescriptorSetLayout(device->logical_device, generator->descriptor_set_layout, NULL);
+    free(generator);
+}
+
+VkImageView create_mip_view(VkImage image, VkFormat format, uint32_t mip_level, VkDevice device)
+{
+    VkImageView image_view;
+
+    VkImageViewCreateInfo view_create_info = {
+        .sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image                           = image,
+        .viewType                        = VK_IMAGE_VIEW_TYPE_2D,
+        .format                          = format,
+        .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseMipLevel   = mip_level,
+        .subresourceRange.levelCount     = 1,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount     = 1
+    };
+
+    if(vkCreateImageView(device, &view_create_info, NULL, &image_view) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create mip level image view!\n");
+        return NULL;
+    }
+
+    return image_view;
+}
+
+int record_blit_mipmaps(VkCommandBuffer command_buffer, PTexture* texture, PDevice* device)
+{
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(device->physical_device, texture->format, &format_properties);
+
+    bool can_blit = (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+    if(!can_blit && texture->mip_levels > 1)
+    {
+        fprintf(stderr, "Texture image format does not support linear blitting!\n");
+    }
+
+    VkImageMemoryBarrier barrier = {
+        .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .image                           = texture->image,
+        .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount     = 1,
+        .subresourceRange.levelCount     = 1
+    };
+
+    int32_t mip_width  = (int32_t) texture->width;
+    int32_t mip_height = (int32_t) texture->height;
+
+    for(uint32_t i = 1; can_blit && i < texture->mip_levels; i++)
+    {
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0,
+            NULL,
+            0,
+            NULL,
+            1,
+            &barrier
+        );
+
+        VkOffset3D src_offsets[] = {
+            {        0,          0, 0},
+            {mip_width, mip_height, 1}
+        };
+
+        VkOffset3D dst_offsets[] = {
+            {                                0,                                   0, 0},
+            {mip_width > 1 ? mip_width / 2 : 1, mip_height > 1 ? mip_height / 2 : 1, 1}
+        };
+
+        VkImageBlit blit = {
+            .srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .srcSubresource.mipLevel       = i - 1,
+            .srcSubresource.baseArrayLayer = 0,
+            .srcSubresource.layerCount     = 1,
+            .dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .dstSubresource.mipLevel       = i,
+            .dstSubresource.baseArrayLayer = 0,
+            .dstSubresource.layerCount     = 1
+        };
+
+        memcpy(blit.srcOffsets, src_offsets, 2 * sizeof(*src_offsets));
+        memcpy(blit.dstOffsets, dst_offsets, 2 * sizeof(*dst_offsets));
+
+        vkCmdBlitImage(
+            command_buffer,
+            texture->image,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            texture->image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &blit,
+            VK_FILTER_LINEAR
+        );
+
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            0,
+            NULL,
+            0,
+            NULL,
+            1,
+            &barrier
+        );
+
+        if(mip_width > 1)
+        {
+            mip_width /= 2;
+        }
+
+        if(mip_height > 1)
+        {
+            mip_height /= 2;
+        }
+    }
+
+    // Without blit support the remaining levels are left undefined, but the texture stays usable
+    barrier.subresourceRange.baseMipLevel = can_blit ? texture->mip_levels - 1 : 0;
+    barrier.subresourceRange.levelCount   = can_blit ? 1 : texture->mip_levels;
+    barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        NULL,
+        0,
+        NULL,
+        1,
+        &barrier
+    );
+
+    return can_blit || texture->mip_levels == 1 ? PIGMENT_SUCCESS : PIGMENT_ERROR;
+}
+
+// Records the pending textures from *next_texture on, until the generator has no set left, and submits them
+int generate_mipmap_batch(PTextureList* texture_list, PMipmapGenerator* generator, uint32_t* next_texture, PCommands* commands, PDevice* device)
+{
+    PTexture* compute_textures[MIPMAP_BATCH_SIZE];
+    VkImageView mip_views[MIPMAP_BATCH_SIZE * MAX_COMPUTE_MIP_LEVELS];
+    VkImageMemoryBarrier barriers[MIPMAP_BATCH_SIZE];
+    uint32_t compute_count = 0;
+    int status             = PIGMENT_SUCCESS;
+
+    VkCommandBuffer command_buffer = start_single_usage_commands(commands->command_pool, device);
+
+    for(; *next_texture < texture_list->texture_number; (*next_texture)++)
+    {
+        PTexture* texture = &texture_list->textures[*next_texture];
+        if(!texture->mipmaps_pending)
+        {
+            continue;
+        }
+
+        bool compute = generator != NULL && use_compute_mipmaps(device, texture->format, texture->mip_levels);
+        if(compute && compute_count == MIPMAP_BATCH_SIZE)
+        {
+            break;
+        }
+        texture->mipmaps_pending = false;
+
+        bool srgb;
+        VkFormat storage_format = get_storage_format(texture->format, &srgb);
+        VkImageView* views      = &mip_views[compute_count * MAX_COMPUTE_MIP_LEVELS];
+
+        for(uint32_t level = 0; compute && level < texture->mip_levels; level++)
+        {
+            views[level] = create_mip_view(texture->image, storage_format, level, device->logical_device);
+            if(views[level] == NULL)
+            {
+                for(uint32_t i = 0; i < level; i++)
+                {
+                    vkDestroyImageView(device->logical_device, views[i], NULL);
+                }
+                compute = false;
+            }
+        }
+
+        if(compute)
+        {
+            compute_textures[compute_count] = texture;
+            compute_count++;
+        }
+        else if(record_blit_mipmaps(command_buffer, texture, device) != PIGMENT_SUCCESS)
+        {
+            status = PIGMENT_ERROR;
+        }
+    }
+
+    for(uint32_t i = 0; i < compute_count; i++)
+    {
+        PTexture* texture  = compute_textures[i];
+        VkImageView* views = &mip_views[i * MAX_COMPUTE_MIP_LEVELS];
+
+        // Unused slots alias the last level, the shader never touches them
+        VkDescriptorImageInfo image_infos[MAX_COMPUTE_MIP_LEVELS];
+        for(uint32_t level = 0; level < MAX_COMPUTE_MIP_LEVELS; level++)
+        {
+            image_infos[level].sampler     = NULL;
+            image_infos[level].imageView   = views[level < texture->mip_levels ? level : texture->mip_levels - 1];
+            image_infos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = generator->counter_buffer,
+            .offset = 0,
+            .range  = VK_WHOLE_SIZE
+        };
+
+        VkWriteDescriptorSet descriptor_writes[] = {
+            {
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = generator->descriptor_sets[i],
+                .dstBinding      = 0,
+                .dstArrayElement = 0,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .descriptorCount = MAX_COMPUTE_MIP_LEVELS,
+                .pImageInfo      = image_infos
+            },
+            {
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = generator->descriptor_sets[i],
+                .dstBinding      = 1,
+                .dstArrayElement = 0,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .descriptorCount = 1,
+                .pBufferInfo     = &buffer_info
+            }
+        };
+
+        vkUpdateDescriptorSets(device->logical_device, sizeof(descriptor_writes) / sizeof(descriptor_writes[0]), descriptor_writes, 0, NULL);
+
+        barriers[i] = (VkImageMemoryBarrier) {
+            .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .image                           = texture->image,
+            .oldLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout                       = VK_IMAGE_LAYOUT_GENERAL,
+            .srcAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask                   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+            .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .subresourceRange.baseMipLevel   = 0,
+            .subresourceRange.levelCount     = texture->mip_levels,
+            .subresourceRange.baseArrayLayer = 0,
+            .subresourceRange.layerCount     = 1
+        };
+    }
+
+    if(compute_count > 0)
+    {
+        vkCmdFillBuffer(command_buffer, generator->counter_buffer, 0, VK_WHOLE_SIZE, 0);
+
+        VkBufferMemoryBarrier counter_barrier = {
+            .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .buffer              = generator->counter_buffer,
+            .offset              = 0,
+            .size                = VK_WHOLE_SIZE,
+            .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED
+        };
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0,
+            NULL,
+            1,
+            &counter_barrier,
+            compute_count,
+            barriers
+        );
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, generator->pipeline);
+
+        for(uint32_t i = 0; i < compute_count; i++)
+        {
+            PTexture* texture = compute_textures[i];
+
+            bool srgb;
+            get_storage_format(texture->format, &srgb);
+
+            uint32_t group_count_x = (texture->width + MIPMAP_TILE_SIZE - 1) / MIPMAP_TILE_SIZE;
+            uint32_t group_count_y = (texture->height + MIPMAP_TILE_SIZE - 1) / MIPMAP_TILE_SIZE;
+
+            MipmapConstants constants = {
+                .mip_levels      = texture->mip_levels,
+                .workgroup_count = group_count_x * group_count_y,
+                .counter_index   = i,
+                .srgb            = srgb
+            };
+
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, generator->pipeline_layout, 0, 1, &generator->descriptor_sets[i], 0, NULL);
+            vkCmdPushConstants(command_buffer, generator->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+            vkCmdDispatch(command_buffer, group_count_x, group_count_y, 1);
+        }
+
+        for(uint32_t i = 0; i < compute_count; i++)
+        {
+            barriers[i].oldLayout     = VK_IMAGE_LAYOUT_GENERAL;
+            barriers[i].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[i].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
+
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            0,
+            NULL,
+            0,
+            NULL,
+            compute_count,
+            barriers
+        );
+    }
+
+    end_single_usage_commands(&command_buffer, commands->command_pool, device);
+
+    for(uint32_t i = 0; i < compute_count; i++)
+    {
+        for(uint32_t level = 0; level < compute_textures[i]->mip_levels; level++)
+        {
+            vkDestroyImageView(device->logical_device, mip_views[i * MAX_COMPUTE_MIP_LEVELS + level], NULL);
+        }
+    }
+
+    return status;
+}
+
+int generate_pending_mipmaps(PTextureList* texture_list, PCommands* commands, PDevice* device)
+{
+    bool compute_pending = false;
+    bool pending         = false;
+
+    for(uint32_t i = 0; i < texture_list->texture_number; i++)
+    {
+        PTexture* texture = &texture_list->textures[i];
+        if(texture->mipmaps_pending)
+        {
+            pending         = true;
+            compute_pending = compute_pending || use_compute_mipmaps(device, texture->format, texture->mip_levels);
+        }
+    }
+
+    if(!pending)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    // The generator is built the first time a texture needs it and kept for the textures added later
+    if(compute_pending && texture_list->mipmap_generator == NULL && !texture_list->blit_mipmaps)
+    {
+        texture_list->mipmap_generator = create_mipmap_generator(device);
+        if(texture_list->mipmap_generator == NULL)
+        {
+            fprintf(stderr, "Failed to create mipmap generator, falling back to blits!\n");
+            texture_list->blit_mipmaps = true;
+        }
+    }
+
+    int status            = PIGMENT_SUCCESS;
+    uint32_t next_texture = 0;
+    while(next_texture < texture_list->texture_number)
+    {
+        if(generate_mipmap_batch(texture_list, texture_list->mipmap_generator, &next_texture, commands, device) != PIGMENT_SUCCESS)
+        {
+            status = PIGMENT_ERROR;
+        }
+    }
+
+    return status;
+}
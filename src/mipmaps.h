@@ -0,0 +1,28 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MIPMAPS_H
+#define MIPMAPS_H
+#define MAX_COMPUTE_MIP_LEVELS 13
+#define MIPMAP_TILE_SIZE 64
+#define MIPMAP_BATCH_SIZE 64
+
+#include "defines.h"
+
+PMipmapGenerator* create_mipmap_generator(PDevice* device);
+void destroy_mipmap_generator(PMipmapGenerator* generator, PDevice* device);
+int generate_pending_mipmaps(PTextureList* texture_list, PCommands* commands, PDevice* device);
+#endif
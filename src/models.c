@@ -18,12 +18,33 @@
 #include "models.h"
 #include "structs.h"
 
+#include "lib/array.h"
+#include "lib/loader.h"
+
 #define TINYOBJ_LOADER_C_IMPLEMENTATION
 #include "lib/tinyobj_loader_c.h"
 
 #define INITIAL_SIZE 262144
+#define CUBE_VERTEX_NUMBER 24
+#define CUBE_INDEX_NUMBER 36
+
+extern void get_texture_slot(const PTextureList* texture_list, uint32_t slot, uint32_t* texture_index, uint32_t* layer);
+extern bool is_texture_alpha_tested(const PTextureList* texture_list, uint32_t texture_index);
 
 void vertices_list_append(PModel* model, Vertex vertex);
+void get_cube_vertices(float size, const vec3 cube_center, uint16_t texture_index, Vertex* vertices);
+void compute_mesh_bounds(const Vertex* vertices, uint32_t vertices_number, vec4 bounds);
+void remap_vertices_textures(Vertex* vertices, uint32_t vertices_number, const PTextureSlot* remap, int textures_number);
+
+// Two triangles per face, in the order of the vertices returned by get_cube_vertices
+static const uint32_t cube_indices[CUBE_INDEX_NUMBER] = {
+    0, 1, 2, 2, 3, 0,
+    4, 5, 6, 6, 7, 4,
+    8, 9, 10, 10, 11, 8,
+    12, 13, 14, 14, 15, 12,
+    16, 17, 18, 18, 19, 16,
+    20, 21, 22, 22, 23, 20
+};
 void indices_list_append(PModel* model, uint32_t indice);
 void load_file(void* ctx __attribute__((unused)), const char* filename, const int is_mtl __attribute__((unused)), const char* obj_filename __attribute__((unused)), char** buffer, size_t* len);
 
@@ -67,6 +88,9 @@ void destroy_model(PModel* model)
     }
     free(model->vertices);
     free(model->indices);
+    free(model->mesh_vertices);
+    free(model->mesh_indices);
+    free(model->meshes);
     free(model);
 }
 
@@ -114,9 +138,12 @@ void load_model_multi_textures(const char* filepath, float x_pos, float y_pos, f
             glm_vec3_add(vertex.pos, position, vertex.pos);
             glm_vec3_scale(vertex.pos, scale, vertex.pos);
 
-            if(materials[attrib.material_ids[j / 3]].diffuse_texname != NULL)
+            int material_id = attrib.material_ids[j / 3];
+            if(material_id >= 0 && (size_t) material_id < num_materials && materials[material_id].diffuse_texname != NULL)
             {
-                vertex.texture_index = (uint16_t) texture_hashmap_get_value(textures_to_load, materials[attrib.material_ids[j / 3]].diffuse_texname);
+                // Only the textures referenced by the materials get registered, and so loaded
+                add_texture_to_load(textures_to_load, materials[material_id].diffuse_texname);
+                vertex.texture_index = get_texture_to_load_indice(textures_to_load, materials[material_id].diffuse_texname);
             }
 
             uint32_t value;
@@ -199,6 +226,83 @@ void load_model(const char* filepath, float x_pos, float y_pos, float z_pos, flo
     tinyobj_materials_free(materials, num_materials);
 }
 
+void remap_model_textures(PModel* model, const TextureHashMap* textures_to_load, const PTextureList* texture_list)
+{
+    int textures_number = textures_to_load_number(textures_to_load);
+    char** textures     = get_textures_to_load(textures_to_load);
+
+    PTextureSlot* remap = malloc((size_t) textures_number * sizeof(*remap));
+    if(remap == NULL)
+    {
+        perror("remap_model_textures");
+        return;
+    }
+
+    // Vertices hold the registration order of their texture, which may now alias a shared slot or a layer of a packed array
+    bool identity = true;
+    for(int i = 0; i < textures_number; i++)
+    {
+        get_texture_slot(texture_list, get_texture_to_load_indice(textures_to_load, textures[i]), &remap[i].texture_index, &remap[i].layer);
+        identity = identity && remap[i].texture_index == (uint32_t) i && remap[i].layer == 0;
+    }
+
+    if(!identity)
+    {
+        remap_vertices_textures(model->vertices, model->vertices_number, remap, textures_number);
+        remap_vertices_textures(model->mesh_vertices, model->mesh_vertices_number, remap, textures_number);
+    }
+
+    free(remap);
+}
+
+void sort_model_by_material(PModel* model, const PTextureList* texture_list)
+{
+    uint32_t* sorted_indices = malloc(model->indices_number * sizeof(*sorted_indices));
+    if(sorted_indices == NULL && model->indices_number > 0)
+    {
+        perror("sort_model_by_material");
+        model->opaque_indices_number = 0;
+        return;
+    }
+
+    // Opaque triangles are moved to the front so they can be drawn without discard, the alpha tested ones follow
+    uint32_t opaque_number = 0;
+    uint32_t alpha_number  = 0;
+    for(uint32_t i = 0; i + 2 < model->indices_number; i += 3)
+    {
+        if(!is_texture_alpha_tested(texture_list, model->vertices[model->indices[i]].texture_index))
+        {
+            memcpy(&sorted_indices[opaque_number], &model->indices[i], 3 * sizeof(*sorted_indices));
+            opaque_number += 3;
+        }
+    }
+    for(uint32_t i = 0; i + 2 < model->indices_number; i += 3)
+    {
+        if(is_texture_alpha_tested(texture_list, model->vertices[model->indices[i]].texture_index))
+        {
+            memcpy(&sorted_indices[opaque_number + alpha_number], &model->indices[i], 3 * sizeof(*sorted_indices));
+            alpha_number += 3;
+        }
+    }
+
+    memcpy(model->indices, sorted_indices, (opaque_number + alpha_number) * sizeof(*sorted_indices));
+    model->opaque_indices_number = opaque_number;
+
+    free(sorted_indices);
+}
+
+void remap_vertices_textures(Vertex* vertices, uint32_t vertices_number, const PTextureSlot* remap, int textures_number)
+{
+    for(uint32_t i = 0; i < vertices_number; i++)
+    {
+        if(vertices[i].texture_index < (uint32_t) textures_number)
+        {
+            vertices[i].texture_layer = remap[vertices[i].texture_index].layer;
+            vertices[i].texture_index = remap[vertices[i].texture_index].texture_index;
+        }
+    }
+}
+
 void vertices_list_append(PModel* model, Vertex vertex)
 {
     if(model->vertices_number >= model->vertices_size)
@@ -259,104 +363,135 @@ void load_file(void* ctx __attribute__((unused)), const char* filename, const in
     *len = read_size;
 }
 
-void load_cube(float size, float x_pos, float y_pos, float z_pos, uint16_t texture_index, PModel* model)
+void get_cube_vertices(float size, const vec3 cube_center, uint16_t texture_index, Vertex* vertices)
 {
     float half_cube_size = size / 2.0f;
-    vec3 cube_center     = {x_pos, y_pos, z_pos};
     FilteringMode filtering_mode = LINEAR;
 
-    Vertex vertices[] = {
+    Vertex cube_vertices[] = {
         // +X face
-        {{cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}, texture_index, filtering_mode},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
 
         // -X face
-        {{cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}, texture_index, filtering_mode},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
 
         // +Y face
-        {{cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}, texture_index, filtering_mode},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
 
         // -Y face
-        {{cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}, texture_index, filtering_mode},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
 
         // +Z face
-        {{cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}, texture_index, filtering_mode},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] + half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
 
         // -Z face
-        {{cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}, texture_index, filtering_mode},
-        {{cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, {1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}, texture_index, filtering_mode},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] - half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {0.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] - half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 1.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
+        {.pos = {cube_center[0] + half_cube_size, cube_center[1] + half_cube_size, cube_center[2] - half_cube_size}, .color = {1.0f, 1.0f, 1.0f}, .texture_coord = {1.0f, 0.0f}, .texture_index = texture_index, .sampler_index = filtering_mode, .texture_layer = 0},
     };
 
-    uint32_t vertices_size = sizeof(vertices) / sizeof(vertices[0]);
+    memcpy(vertices, cube_vertices, sizeof(cube_vertices));
+}
+
+void load_cube(float size, float x_pos, float y_pos, float z_pos, uint16_t texture_index, PModel* model)
+{
+    vec3 cube_center = {x_pos, y_pos, z_pos};
+    Vertex vertices[CUBE_VERTEX_NUMBER];
+    get_cube_vertices(size, cube_center, texture_index, vertices);
 
     uint32_t offset = model->vertices_number;
 
-    for(size_t i = 0; i < vertices_size; i++)
+    for(size_t i = 0; i < CUBE_VERTEX_NUMBER; i++)
     {
         vertices_list_append(model, vertices[i]);
     }
 
-    // +X face
-    indices_list_append(model, offset + 0);
-    indices_list_append(model, offset + 1);
-    indices_list_append(model, offset + 2);
-    indices_list_append(model, offset + 2);
-    indices_list_append(model, offset + 3);
-    indices_list_append(model, offset + 0);
-
-    // -X face
-    indices_list_append(model, offset + 4);
-    indices_list_append(model, offset + 5);
-    indices_list_append(model, offset + 6);
-    indices_list_append(model, offset + 6);
-    indices_list_append(model, offset + 7);
-    indices_list_append(model, offset + 4);
-
-    // +Y face
-    indices_list_append(model, offset + 8);
-    indices_list_append(model, offset + 9);
-    indices_list_append(model, offset + 10);
-    indices_list_append(model, offset + 10);
-    indices_list_append(model, offset + 11);
-    indices_list_append(model, offset + 8);
-
-    // -X face
-    indices_list_append(model, offset + 12);
-    indices_list_append(model, offset + 13);
-    indices_list_append(model, offset + 14);
-    indices_list_append(model, offset + 14);
-    indices_list_append(model, offset + 15);
-    indices_list_append(model, offset + 12);
-
-    // +Z face
-    indices_list_append(model, offset + 16);
-    indices_list_append(model, offset + 17);
-    indices_list_append(model, offset + 18);
-    indices_list_append(model, offset + 18);
-    indices_list_append(model, offset + 19);
-    indices_list_append(model, offset + 16);
-
-    // -X face
-    indices_list_append(model, offset + 20);
-    indices_list_append(model, offset + 21);
-    indices_list_append(model, offset + 22);
-    indices_list_append(model, offset + 22);
-    indices_list_append(model, offset + 23);
-    indices_list_append(model, offset + 20);
+    for(size_t i = 0; i < CUBE_INDEX_NUMBER; i++)
+    {
+        indices_list_append(model, offset + cube_indices[i]);
+    }
+}
+
+uint32_t add_cube_mesh(float size, PModel* model)
+{
+    vec3 cube_center = {0.0f, 0.0f, 0.0f};
+    Vertex vertices[CUBE_VERTEX_NUMBER];
+    get_cube_vertices(size, cube_center, 0, vertices);
+
+    return add_mesh(vertices, CUBE_VERTEX_NUMBER, cube_indices, CUBE_INDEX_NUMBER, model);
+}
+
+uint32_t add_mesh(const Vertex* vertices, uint32_t vertices_number, const uint32_t* indices, uint32_t indices_number, PModel* model)
+{
+    if(reserve_array((void**) &model->mesh_vertices, &model->mesh_vertices_size, model->mesh_vertices_number + vertices_number, sizeof(*vertices)) != PIGMENT_SUCCESS ||
+       reserve_array((void**) &model->mesh_indices, &model->mesh_indices_size, model->mesh_indices_number + indices_number, sizeof(*indices)) != PIGMENT_SUCCESS ||
+       reserve_array((void**) &model->meshes, &model->mesh_size, model->mesh_number + 1, sizeof(*model->meshes)) != PIGMENT_SUCCESS)
+    {
+        perror("add_mesh");
+        return UINT32_MAX;
+    }
+
+    // Indices stay local to the mesh, the draw adds its vertex offset
+    PMesh mesh = {
+        .lods          = {{model->mesh_indices_number, indices_number, 0.0f}},
+        .lod_count     = 1,
+        .vertex_offset = (int32_t) model->mesh_vertices_number,
+        .vertex_count  = vertices_number
+    };
+    compute_mesh_bounds(vertices, vertices_number, mesh.bounds);
+
+    memcpy(&model->mesh_vertices[model->mesh_vertices_number], vertices, vertices_number * sizeof(*vertices));
+    memcpy(&model->mesh_indices[model->mesh_indices_number], indices, indices_number * sizeof(*indices));
+    model->mesh_vertices_number += vertices_number;
+    model->mesh_indices_number  += indices_number;
+
+    model->meshes[model->mesh_number] = mesh;
+    return model->mesh_number++;
+}
+
+// Sphere around the center of the bounding box, in mesh space
+void compute_mesh_bounds(const Vertex* vertices, uint32_t vertices_number, vec4 bounds)
+{
+    vec3 min = {0.0f, 0.0f, 0.0f};
+    vec3 max = {0.0f, 0.0f, 0.0f};
+
+    if(vertices_number > 0)
+    {
+        glm_vec3_copy((float*) vertices[0].pos, min);
+        glm_vec3_copy((float*) vertices[0].pos, max);
+    }
+    for(uint32_t i = 1; i < vertices_number; i++)
+    {
+        glm_vec3_minv(min, (float*) vertices[i].pos, min);
+        glm_vec3_maxv(max, (float*) vertices[i].pos, max);
+    }
+
+    vec3 center;
+    glm_vec3_add(min, max, center);
+    glm_vec3_scale(center, 0.5f, center);
+
+    float radius2 = 0.0f;
+    for(uint32_t i = 0; i < vertices_number; i++)
+    {
+        radius2 = glm_max(radius2, glm_vec3_distance2(center, (float*) vertices[i].pos));
+    }
+
+    glm_vec3_copy(center, bounds);
+    bounds[3] = sqrtf(radius2);
 }
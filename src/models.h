@@ -25,5 +25,9 @@ void destroy_model(PModel* model);
 void load_model_multi_textures(const char* filepath, float x_pos, float y_pos, float z_pos, float scale, TextureHashMap* textures_to_load, PModel* model);
 void load_model(const char* filepath, float x_pos, float y_pos, float z_pos, float scale, uint16_t texture_index, PModel* model);
 void load_cube(float size, float x_pos, float y_pos, float z_pos, uint16_t texture_index, PModel* model);
+uint32_t add_mesh(const Vertex* vertices, uint32_t vertices_number, const uint32_t* indices, uint32_t indices_number, PModel* model);
+uint32_t add_cube_mesh(float size, PModel* model);
+void remap_model_textures(PModel* model, const TextureHashMap* textures_to_load, const PTextureList* texture_list);
+void sort_model_by_material(PModel* model, const PTextureList* texture_list);
 
 #endif
@@ -29,13 +29,23 @@
 #include "buffers.h"
 #include "descriptor.h"
 #include "texture.h"
+#include "streaming.h"
+#include "memory_tracker.h"
+#include "deletion_queue.h"
+#include "instancing.h"
+#include "culling.h"
+#include "lod.h"
+#include "faces.h"
+#include "chunks.h"
 #include "models.h"
 #include "camera.h"
 #include "time.h"
 
+extern void get_texture_slot(const PTextureList* texture_list, uint32_t slot, uint32_t* texture_index, uint32_t* layer);
+
 Pigment* init_pigment(PAppInfo* app_info, PWindowInfo* window_info, PModel* model, TexturesToLoad* textures_to_load, StringArray* texture_paths, uint32_t max_frame_in_flight)
 {
-    Pigment* pigment = malloc(sizeof(*pigment));
+    Pigment* pigment = calloc(1, sizeof(*pigment));
     if(pigment == NULL)
     {
         return NULL;
@@ -71,13 +81,26 @@ Pigment* init_pigment(PAppInfo* app_info, PWindowInfo* window_info, PModel* mode
     {
         goto ERROR;
     }
-    pigment->swapchain = create_swapchain(pigment->device, pigment->surface, pigment->window);
+    if(create_deletion_queue(pigment->device, pigment->max_frames_in_flight) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+    pigment->swapchain = create_swapchain(pigment->device, pigment->surface, pigment->window, NULL);
     if(pigment->swapchain == NULL)
     {
         goto ERROR;
     }
     create_image_views(pigment->swapchain, pigment->device);
-    pigment->render_pass = create_render_pass(pigment->swapchain, pigment->device);
+    // Meshes can be added while running, their slots are sized once with room for the model's meshes
+    uint32_t mesh_capacity = app_info->max_meshes > 0 ? app_info->max_meshes : DEFAULT_MESH_CAPACITY;
+    if(mesh_capacity < pigment->model->mesh_number)
+    {
+        mesh_capacity = pigment->model->mesh_number;
+    }
+    // Culling draws through vkCmdDrawIndexedIndirectCountKHR
+    bool gpu_culling = app_info->gpu_culling && pigment->device->draw_indirect_count;
+
+    pigment->render_pass = create_render_pass(pigment->swapchain, gpu_culling, pigment->device);
     if(pigment->render_pass == NULL)
     {
         goto ERROR;
@@ -87,7 +110,7 @@ Pigment* init_pigment(PAppInfo* app_info, PWindowInfo* window_info, PModel* mode
     {
         goto ERROR;
     }
-    pigment->textures    = create_textures();
+    pigment->textures    = create_textures(pigment->max_frames_in_flight);
     if(pigment->textures == NULL)
     {
         goto ERROR;
@@ -98,26 +121,82 @@ Pigment* init_pigment(PAppInfo* app_info, PWindowInfo* window_info, PModel* mode
         goto ERROR;
     }
 
+    if(app_info->stream_textures)
+    {
+        enable_texture_streaming(pigment->textures, pigment->device);
+    }
+    if(app_info->cook_textures)
+    {
+        enable_texture_cooking(pigment->textures, app_info->cooked_texture_directory);
+    }
+
     load_all_textures(pigment->textures, textures_to_load, texture_paths, pigment->commands, pigment->device);
+    if(app_info->pack_texture_arrays && pack_texture_arrays(pigment->textures, pigment->commands, pigment->device) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to pack textures into arrays, keeping them separate!\n");
+    }
+    remap_model_textures(pigment->model, textures_to_load, pigment->textures);
+    if(app_info->merge_block_faces && merge_block_faces(pigment->model, pigment->textures) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to merge block faces, keeping the model as loaded!\n");
+    }
+    sort_model_by_material(pigment->model, pigment->textures);
+
+    if(create_texture_streamer(pigment->textures, pigment->device, pigment->max_frames_in_flight) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+    if(create_texture_table(pigment->textures, pigment->device) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
 
-    pigment->descriptor = create_descriptor(pigment->textures, pigment->samplers, pigment->device);
+    pigment->descriptor = create_descriptor(pigment->textures, pigment->samplers, gpu_culling, pigment->device);
     if(pigment->descriptor == NULL)
     {
         goto ERROR;
     }
-    pigment->pipeline   = create_graphic_pipeline(pigment->render_pass, pigment->descriptor, pigment->device, pigment->vertex_description);
+    pigment->pipeline   = create_graphic_pipeline(pigment->render_pass, pigment->descriptor, app_info->depth_prepass, pigment->device, pigment->vertex_description);
     if(pigment->pipeline == NULL)
     {
         goto ERROR;
     }
-    create_depth_resources(pigment->swapchain, pigment->commands, pigment->device);
+    create_depth_resources(pigment->swapchain, pigment->device);
     create_framebuffers(pigment->swapchain, pigment->render_pass, pigment->device);
-    pigment->buffers = create_buffers(pigment->model, pigment->device, pigment->commands, pigment->max_frames_in_flight);
+    if(build_mesh_lods(pigment->model) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to build mesh levels of detail, drawing meshes at full detail!\n");
+    }
+    if(app_info->chunk_size > 0.0f && app_info->chunk_radius > 0.0f && pigment->model->indices_number > 0)
+    {
+        pigment->chunks = create_chunks(pigment->model, app_info->chunk_size, app_info->chunk_radius);
+        if(pigment->chunks == NULL)
+        {
+            fprintf(stderr, "Failed to split the model into chunks, keeping it resident!\n");
+        }
+    }
+    // Streamed chunks share the geometry pool with the rest of the scene
+    uint32_t reserved_vertices = pigment->chunks != NULL ? CHUNK_RESIDENT_VERTICES : 0;
+    uint32_t reserved_indices  = pigment->chunks != NULL ? CHUNK_RESIDENT_INDICES : 0;
+    pigment->buffers = create_buffers(pigment->model, mesh_capacity, reserved_vertices, reserved_indices, pigment->device, pigment->commands, pigment->max_frames_in_flight);
     if(pigment->buffers == NULL)
     {
         goto ERROR;
     }
-    update_descriptor(pigment->descriptor, pigment->buffers, pigment->textures, pigment->samplers, pigment->device, pigment->max_frames_in_flight);
+    pigment->instancing = create_instancing(pigment->buffers->mesh_capacity, gpu_culling, pigment->device, pigment->max_frames_in_flight);
+    if(pigment->instancing == NULL)
+    {
+        goto ERROR;
+    }
+    if(gpu_culling)
+    {
+        pigment->culling = create_culling(pigment->buffers, pigment->instancing, pigment->chunks, pigment->swapchain, pigment->commands, pigment->device, pigment->max_frames_in_flight);
+        if(pigment->culling == NULL)
+        {
+            goto ERROR;
+        }
+    }
+    update_descriptor(pigment->descriptor, pigment->buffers, pigment->textures, pigment->instancing, pigment->samplers, pigment->device, pigment->max_frames_in_flight);
     update_commands(pigment->commands, pigment->device, pigment->max_frames_in_flight);
     pigment->sync = create_sync(pigment->device, pigment->max_frames_in_flight, pigment->swapchain->image_count);
     if(pigment->sync == NULL)
@@ -153,9 +232,12 @@ void destroy_pigment(Pigment* pigment)
     }
 
     destroy_camera(pigment->camera);
-    destroy_sync(pigment->sync, pigment->device, pigment->swapchain, pigment->max_frames_in_flight);
+    destroy_sync(pigment->sync, pigment->device, pigment->max_frames_in_flight);
     destroy_swapchain(pigment->swapchain, pigment->device);
     destroy_buffers(pigment->buffers, pigment->device, pigment->max_frames_in_flight);
+    destroy_culling(pigment->culling, pigment->device);
+    destroy_chunks(pigment->chunks);
+    destroy_instancing(pigment->instancing, pigment->device);
     destroy_descriptor(pigment->descriptor, pigment->device);
     destroy_pipeline(pigment->pipeline, pigment->device);
     destroy_textures(pigment->textures, pigment->device);
@@ -163,6 +245,10 @@ void destroy_pigment(Pigment* pigment)
     destroy_commands(pigment->commands, pigment->device, pigment->max_frames_in_flight);
     destroy_vertex_description(pigment->vertex_description);
     destroy_render_pass(pigment->render_pass, pigment->device);
+    if(pigment->device != NULL)
+    {
+        destroy_deletion_queue(pigment->device);
+    }
     destroy_device(pigment->device);
     destroy_surface(pigment->surface, pigment->instance);
     destroy_instance(pigment->instance);
@@ -195,5 +281,159 @@ void pigment_draw_frame(Pigment* pigment)
         return;
     }
 
-    draw_frame(pigment->buffers, &(pigment->swapchain), &(pigment->sync), pigment->commands, pigment->descriptor, pigment->pipeline, pigment->surface, pigment->window, pigment->render_pass, pigment->device, pigment->max_frames_in_flight);
+    draw_frame(pigment->buffers, &(pigment->swapchain), &(pigment->sync), pigment->commands, pigment->descriptor, pigment->textures, pigment->instancing, pigment->culling, pigment->chunks, pigment->pipeline, pigment->surface, pigment->window, pigment->render_pass, pigment->device, pigment->max_frames_in_flight);
+}
+
+void pigment_get_memory_stats(Pigment* pigment, PMemoryStats* stats)
+{
+    if(pigment == NULL || stats == NULL)
+    {
+        return;
+    }
+
+    get_memory_stats(pigment->device, stats);
+}
+
+void pigment_get_render_stats(Pigment* pigment, PRenderStats* stats)
+{
+    if(pigment == NULL || stats == NULL)
+    {
+        return;
+    }
+
+    stats->prepass_fragments = pigment->commands->fragment_invocations[RENDER_STATISTIC_PREPASS];
+    stats->shaded_fragments  = pigment->commands->fragment_invocations[RENDER_STATISTIC_SHADED];
+    stats->pixels            = (uint64_t) pigment->swapchain->extent.width * pigment->swapchain->extent.height;
+    stats->available         = pigment->commands->statistics_pool != NULL;
+}
+
+void pigment_set_fov(Pigment* pigment, float fov)
+{
+    if(pigment == NULL || fov <= 0.0f || fov >= 180.0f)
+    {
+        return;
+    }
+
+    pigment->camera->fov = fov;
+}
+
+uint32_t pigment_add_texture(Pigment* pigment, const char* texture_path)
+{
+    if(pigment == NULL)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t texture_slot;
+    if(insert_texture(pigment->textures, texture_path, pigment->commands, pigment->device, &texture_slot) != PIGMENT_SUCCESS)
+    {
+        return UINT32_MAX;
+    }
+
+    return texture_slot;
+}
+
+int pigment_replace_texture(Pigment* pigment, uint32_t texture_index, const char* texture_path)
+{
+    if(pigment == NULL)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    return replace_texture(pigment->textures, texture_index, texture_path, pigment->commands, pigment->device);
+}
+
+void pigment_remove_texture(Pigment* pigment, uint32_t texture_index)
+{
+    if(pigment == NULL)
+    {
+        return;
+    }
+
+    remove_texture(pigment->textures, texture_index);
+}
+
+uint32_t pigment_add_mesh(Pigment* pigment, const Vertex* vertices, uint32_t vertices_number, const uint32_t* indices, uint32_t indices_number)
+{
+    if(pigment == NULL)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t mesh_index = insert_mesh(pigment->buffers, vertices, vertices_number, indices, indices_number, pigment->commands, pigment->device);
+    if(mesh_index != UINT32_MAX && pigment->culling != NULL)
+    {
+        update_cull_mesh(pigment->culling, mesh_index);
+    }
+
+    return mesh_index;
+}
+
+void pigment_remove_mesh(Pigment* pigment, uint32_t mesh_index)
+{
+    if(pigment == NULL || !has_mesh(pigment->buffers, mesh_index))
+    {
+        return;
+    }
+
+    remove_mesh_instances(pigment->instancing, mesh_index);
+    remove_mesh(pigment->buffers, mesh_index);
+    if(pigment->culling != NULL)
+    {
+        update_cull_mesh(pigment->culling, mesh_index);
+    }
+}
+
+uint32_t pigment_add_instance(Pigment* pigment, uint32_t mesh_index, mat4 transform, uint32_t texture_index, const float* color)
+{
+    if(pigment == NULL)
+    {
+        return UINT32_MAX;
+    }
+
+    if(!has_mesh(pigment->buffers, mesh_index))
+    {
+        fprintf(stderr, "Failed to add instance, mesh %u does not exist!\n", mesh_index);
+        return UINT32_MAX;
+    }
+
+    uint32_t texture_array;
+    uint32_t texture_layer;
+    get_texture_slot(pigment->textures, texture_index, &texture_array, &texture_layer);
+
+    return add_instance(pigment->instancing, mesh_index, transform, texture_array, texture_layer, color);
+}
+
+void pigment_set_instance_transform(Pigment* pigment, uint32_t instance_index, mat4 transform)
+{
+    if(pigment == NULL)
+    {
+        return;
+    }
+
+    set_instance_transform(pigment->instancing, instance_index, transform);
+}
+
+void pigment_set_instance_texture(Pigment* pigment, uint32_t instance_index, uint32_t texture_index)
+{
+    if(pigment == NULL)
+    {
+        return;
+    }
+
+    uint32_t texture_array;
+    uint32_t texture_layer;
+    get_texture_slot(pigment->textures, texture_index, &texture_array, &texture_layer);
+
+    set_instance_texture(pigment->instancing, instance_index, texture_array, texture_layer);
+}
+
+void pigment_remove_instance(Pigment* pigment, uint32_t instance_index)
+{
+    if(pigment == NULL)
+    {
+        return;
+    }
+
+    remove_instance(pigment->instancing, instance_index);
 }
@@ -25,5 +25,22 @@ void destroy_pigment(Pigment* pigment);
 
 void pigment_draw_frame(Pigment* pigment);
 void pigment_run(Pigment* pigment);
+void pigment_get_memory_stats(Pigment* pigment, PMemoryStats* stats);
+void pigment_get_render_stats(Pigment* pigment, PRenderStats* stats);
+void pigment_set_fov(Pigment* pigment, float fov);
+
+// Texture indices are slots: the index a texture had in the textures to load, or the one returned by pigment_add_texture.
+// They stay valid when textures are packed into arrays, instances and replacements take the same indices.
+uint32_t pigment_add_texture(Pigment* pigment, const char* texture_path);
+int pigment_replace_texture(Pigment* pigment, uint32_t texture_index, const char* texture_path);
+void pigment_remove_texture(Pigment* pigment, uint32_t texture_index);
+
+uint32_t pigment_add_mesh(Pigment* pigment, const Vertex* vertices, uint32_t vertices_number, const uint32_t* indices, uint32_t indices_number);
+void pigment_remove_mesh(Pigment* pigment, uint32_t mesh_index);
+
+uint32_t pigment_add_instance(Pigment* pigment, uint32_t mesh_index, mat4 transform, uint32_t texture_index, const float* color);
+void pigment_set_instance_transform(Pigment* pigment, uint32_t instance_index, mat4 transform);
+void pigment_set_instance_texture(Pigment* pigment, uint32_t instance_index, uint32_t texture_index);
+void pigment_remove_instance(Pigment* pigment, uint32_t instance_index);
 
 #endif
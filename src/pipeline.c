@@ -17,6 +17,7 @@
 #include "pipeline.h"
 #include "structs.h"
 #include "shaders.h"
+#include "vertex.h"
 
 VkPipelineShaderStageCreateInfo configure_shader_stage_create_info(VkShaderModule shader_module, char type, const char* entry_point);
 VkPipelineVertexInputStateCreateInfo configure_vertex_input_state_create_info(PVertexDescription* vertex_description);
@@ -28,72 +29,164 @@ VkPipelineDepthStencilStateCreateInfo configure_depth_stencil_state_create_info(
 VkPipelineColorBlendAttachmentState configure_color_blend_attachment_state_create_info(void);
 VkPipelineColorBlendStateCreateInfo configure_color_blend_state_create_info(VkPipelineColorBlendAttachmentState* color_blend_attachment_state_create_info);
 VkPipelineDynamicStateCreateInfo configure_dynamic_state_create_info(VkDynamicState* dynamic_states, uint32_t dynamic_states_size);
-VkPipelineLayout create_pipeline_layout(VkDescriptorSetLayout* descriptor_set_layout, VkDevice device);
+VkPipelineLayout create_pipeline_layout(const VkDescriptorSetLayout* set_layouts, VkDevice device);
+VkShaderModule load_shader_module(const char* file_path, const char* default_code, shaderc_shader_kind kind, const char* spv_name, const char* definitions, VkDevice device);
+int create_scene_pipeline(PRenderPass* render_pass, VkPipelineLayout pipeline_layout, VkShaderModule vertex_shader_module, const char* fragment_definitions, const VkPipelineVertexInputStateCreateInfo* vertex_input_state_create_info, const VkPipelineDepthStencilStateCreateInfo* depth_stencil_state_create_info, VkPipelineColorBlendAttachmentState* color_blend_attachment_state, PDevice* device, VkPipeline* graphic_pipeline);
 
-PPipeline* create_graphic_pipeline(PRenderPass* render_pass, PDescriptor* descriptor, PDevice* device, PVertexDescription* vertex_description)
+PPipeline* create_graphic_pipeline(PRenderPass* render_pass, PDescriptor* descriptor, bool depth_prepass, PDevice* device, PVertexDescription* vertex_description)
 {
     PPipeline* pipeline = NULL;
-    char* vertex_shader_code = NULL;
-    char* fragment_shader_code = NULL;
     VkShaderModule vertex_shader_module = NULL;
-    VkShaderModule fragment_shader_module = NULL;
-    uint32_t vertex_shader_code_size;
-    uint32_t fragment_shader_code_size;
-    uint32_t* vertex_spv = NULL;
-    uint32_t* fragment_spv = NULL;
-    uint32_t vertex_spv_size;
-    uint32_t fragment_spv_size;
+    VkShaderModule prepass_vertex_shader_module = NULL;
 
+    char definitions[64];
 
-    vertex_shader_code   = get_shader_code("shaders/shader.vert", &vertex_shader_code_size);
-    if(vertex_shader_code == NULL)
+    snprintf(definitions, sizeof(definitions), "%s", descriptor->gpu_culling ? "GPU_CULLING" : "");
+    vertex_shader_module = load_shader_module("shaders/shader.vert", DEFAULT_VERTEX_SHADER, shaderc_glsl_vertex_shader, "shaders/vert.spv", definitions, device->logical_device);
+    if(vertex_shader_module == NULL)
+    {
+        goto ERROR;
+    }
+
+    pipeline = calloc(1, sizeof(*pipeline));
+    if(pipeline == NULL)
+    {
+        perror("create_graphic_pipeline: malloc: ");
+        goto ERROR;
+    }
+
+    pipeline->pipeline_layout = create_pipeline_layout(descriptor->set_layouts, device->logical_device);
+
+    VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info   = configure_vertex_input_state_create_info(vertex_description);
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info = configure_depth_stencil_state_create_info();
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state      = configure_color_blend_attachment_state_create_info();
+
+    if(depth_prepass)
     {
-        printf("File shaders/shader.vert missing, using default vertex shader\n");
-        vertex_shader_code_size = strlen(DEFAULT_VERTEX_SHADER);
-        vertex_shader_code = malloc(vertex_shader_code_size + 1);
-        if (vertex_shader_code == NULL)
+        // Depth is final after the pre-pass, each pixel is shaded once by the fragment that wrote it
+        depth_stencil_state_create_info.depthWriteEnable = VK_FALSE;
+        depth_stencil_state_create_info.depthCompareOp   = VK_COMPARE_OP_EQUAL;
+    }
+
+    for(uint32_t i = 0; i < MATERIAL_COUNT; i++)
+    {
+        // Mip requests are only written out when texture streaming reads them back
+        snprintf(definitions, sizeof(definitions), "%s %s %s", descriptor->texture_feedback ? "TEXTURE_FEEDBACK" : "", depth_prepass ? "DEPTH_EQUAL" : "", i == MATERIAL_OPAQUE ? "OPAQUE_MATERIAL" : "");
+        if(create_scene_pipeline(render_pass, pipeline->pipeline_layout, vertex_shader_module, definitions, &vertex_input_state_create_info, &depth_stencil_state_create_info, &color_blend_attachment_state, device, &pipeline->graphic_pipelines[i]) != PIGMENT_SUCCESS)
         {
-            perror("malloc");
             goto ERROR;
         }
-        memcpy(vertex_shader_code, DEFAULT_VERTEX_SHADER, vertex_shader_code_size + 1);
     }
 
-    vertex_spv = compile_glsl_to_spv(vertex_shader_code, vertex_shader_code_size, shaderc_glsl_vertex_shader, "shaders/vert.spv", &vertex_spv_size);
-    if (vertex_spv == NULL) {
-        fprintf(stderr, "Failed to compile vertex shader to SPIR-V.\n");
-        goto ERROR;
+    if(depth_prepass)
+    {
+        snprintf(definitions, sizeof(definitions), "DEPTH_PREPASS %s", descriptor->gpu_culling ? "GPU_CULLING" : "");
+        prepass_vertex_shader_module = load_shader_module("shaders/shader.vert", DEFAULT_VERTEX_SHADER, shaderc_glsl_vertex_shader, "shaders/prepass_vert.spv", definitions, device->logical_device);
+        if(prepass_vertex_shader_module == NULL)
+        {
+            goto ERROR;
+        }
+
+        // The pre-pass skips the vertex color, it only needs what the alpha test reads
+        VkVertexInputAttributeDescription prepass_attributes[VERTEX_ATTRIBUTE_COUNT];
+        uint32_t prepass_attribute_number = 0;
+        for(uint32_t i = 0; i < vertex_description->attribute_descriptions_size; i++)
+        {
+            if(vertex_description->attribute_descriptions[i].location != VERTEX_COLOR_LOCATION)
+            {
+                prepass_attributes[prepass_attribute_number++] = vertex_description->attribute_descriptions[i];
+            }
+        }
+        vertex_input_state_create_info.vertexAttributeDescriptionCount = prepass_attribute_number;
+        vertex_input_state_create_info.pVertexAttributeDescriptions    = prepass_attributes;
+
+        depth_stencil_state_create_info.depthWriteEnable = VK_TRUE;
+        depth_stencil_state_create_info.depthCompareOp   = VK_COMPARE_OP_LESS;
+        color_blend_attachment_state.colorWriteMask      = 0;
+
+        for(uint32_t i = 0; i < MATERIAL_COUNT; i++)
+        {
+            snprintf(definitions, sizeof(definitions), "DEPTH_PREPASS %s", i == MATERIAL_OPAQUE ? "OPAQUE_MATERIAL" : "");
+            if(create_scene_pipeline(render_pass, pipeline->pipeline_layout, prepass_vertex_shader_module, definitions, &vertex_input_state_create_info, &depth_stencil_state_create_info, &color_blend_attachment_state, device, &pipeline->depth_prepass_pipelines[i]) != PIGMENT_SUCCESS)
+            {
+                goto ERROR;
+            }
+        }
     }
 
-    fragment_shader_code = get_shader_code("shaders/shader.frag", &fragment_shader_code_size);
-    if(fragment_shader_code == NULL)
+    goto FREE;
+
+ERROR:
+    destroy_pipeline(pipeline, device);
+    pipeline = NULL;
+
+FREE:
+    if(vertex_shader_module != NULL)
+        vkDestroyShaderModule(device->logical_device, vertex_shader_module, NULL);
+    if(prepass_vertex_shader_module != NULL)
+        vkDestroyShaderModule(device->logical_device, prepass_vertex_shader_module, NULL);
+
+    return pipeline;
+}
+
+void destroy_pipeline(PPipeline* pipeline, PDevice* device)
+{
+    if(pipeline == NULL)
+    {
+        return;
+    }
+    for(uint32_t i = 0; i < MATERIAL_COUNT; i++)
     {
-        printf("File shaders/shader.frag missing, using default fragment shader\n");
-        fragment_shader_code_size = strlen(DEFAULT_FRAGMENT_SHADER);
-        fragment_shader_code = malloc(fragment_shader_code_size + 1);
-        if (fragment_shader_code == NULL)
+        vkDestroyPipeline(device->logical_device, pipeline->graphic_pipelines[i], NULL);
+        vkDestroyPipeline(device->logical_device, pipeline->depth_prepass_pipelines[i], NULL);
+    }
+    vkDestroyPipelineLayout(device->logical_device, pipeline->pipeline_layout, NULL);
+    free(pipeline);
+}
+
+VkShaderModule load_shader_module(const char* file_path, const char* default_code, shaderc_shader_kind kind, const char* spv_name, const char* definitions, VkDevice device)
+{
+    VkShaderModule shader_module = NULL;
+    uint32_t* shader_spv = NULL;
+    uint32_t shader_code_size;
+    uint32_t shader_spv_size;
+
+    char* shader_code = get_shader_code(file_path, &shader_code_size);
+    if(shader_code == NULL)
+    {
+        printf("File %s missing, using default shader\n", file_path);
+        shader_code_size = strlen(default_code);
+        shader_code = malloc(shader_code_size + 1);
+        if(shader_code == NULL)
         {
             perror("malloc");
-            goto ERROR;
+            return NULL;
         }
-        memcpy(fragment_shader_code, DEFAULT_FRAGMENT_SHADER, fragment_shader_code_size + 1);
+        memcpy(shader_code, default_code, shader_code_size + 1);
     }
 
-    fragment_spv = compile_glsl_to_spv(fragment_shader_code, fragment_shader_code_size, shaderc_glsl_fragment_shader, "shaders/frag.spv", &fragment_spv_size);
-    if (fragment_spv == NULL) {
-        fprintf(stderr, "Failed to compile fragment shader to SPIR-V.\n");
-        goto ERROR;
+    shader_spv = compile_glsl_to_spv(shader_code, shader_code_size, kind, spv_name, definitions, &shader_spv_size);
+    if(shader_spv == NULL)
+    {
+        fprintf(stderr, "Failed to compile %s to SPIR-V.\n", file_path);
     }
-
-    vertex_shader_module   = create_shader_module(device->logical_device, vertex_spv, vertex_spv_size);
-    if(vertex_shader_module == NULL)
+    else
     {
-        goto ERROR;
+        shader_module = create_shader_module(device, shader_spv, shader_spv_size);
     }
-    fragment_shader_module = create_shader_module(device->logical_device, fragment_spv, fragment_spv_size);
-    if(fragment_shader_code == NULL)
+
+    free(shader_spv);
+    free(shader_code);
+
+    return shader_module;
+}
+
+int create_scene_pipeline(PRenderPass* render_pass, VkPipelineLayout pipeline_layout, VkShaderModule vertex_shader_module, const char* fragment_definitions, const VkPipelineVertexInputStateCreateInfo* vertex_input_state_create_info, const VkPipelineDepthStencilStateCreateInfo* depth_stencil_state_create_info, VkPipelineColorBlendAttachmentState* color_blend_attachment_state, PDevice* device, VkPipeline* graphic_pipeline)
+{
+    VkShaderModule fragment_shader_module = load_shader_module("shaders/shader.frag", DEFAULT_FRAGMENT_SHADER, shaderc_glsl_fragment_shader, "shaders/frag.spv", fragment_definitions, device->logical_device);
+    if(fragment_shader_module == NULL)
     {
-        goto ERROR;
+        return PIGMENT_ERROR;
     }
 
     VkPipelineShaderStageCreateInfo shader_stages_create_info[] = {
@@ -101,14 +194,11 @@ PPipeline* create_graphic_pipeline(PRenderPass* render_pass, PDescriptor* descri
         configure_shader_stage_create_info(fragment_shader_module, FRAGMENT_SHADER_TYPE, "main")
     };
 
-    VkPipelineVertexInputStateCreateInfo vertex_input_state_create_info          = configure_vertex_input_state_create_info(vertex_description);
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info      = configure_input_assembly_state_create_info();
-    VkPipelineViewportStateCreateInfo viewport_state_create_info                 = configure_viewport_state_create_info();
-    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info          = configure_rasterizer_state_create_info();
-    VkPipelineMultisampleStateCreateInfo multisampling_state_create_info         = configure_multisampling_state_create_info();
-    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_create_info        = configure_depth_stencil_state_create_info();
-    VkPipelineColorBlendAttachmentState color_blend_attachment_state_create_info = configure_color_blend_attachment_state_create_info();
-    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info            = configure_color_blend_state_create_info(&color_blend_attachment_state_create_info);
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_create_info = configure_input_assembly_state_create_info();
+    VkPipelineViewportStateCreateInfo viewport_state_create_info            = configure_viewport_state_create_info();
+    VkPipelineRasterizationStateCreateInfo rasterizer_state_create_info     = configure_rasterizer_state_create_info();
+    VkPipelineMultisampleStateCreateInfo multisampling_state_create_info    = configure_multisampling_state_create_info();
+    VkPipelineColorBlendStateCreateInfo color_blend_state_create_info       = configure_color_blend_state_create_info(color_blend_attachment_state);
 
     VkDynamicState dynamic_states[] = {
         VK_DYNAMIC_STATE_VIEWPORT,
@@ -119,66 +209,35 @@ PPipeline* create_graphic_pipeline(PRenderPass* render_pass, PDescriptor* descri
 
     VkPipelineDynamicStateCreateInfo dynamic_state_create_info = configure_dynamic_state_create_info(dynamic_states, dynamic_states_size);
 
-
-    pipeline = malloc(sizeof(*pipeline));
-    if(pipeline == NULL)
-    {
-        perror("create_graphic_pipeline: malloc: ");
-        goto ERROR;
-    }
-
-    pipeline->pipeline_layout = create_pipeline_layout(&descriptor->descriptor_set_layout, device->logical_device);
-
     VkGraphicsPipelineCreateInfo pipeline_create_info = {
         .sType                        = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .stageCount                   = sizeof(shader_stages_create_info) / sizeof(shader_stages_create_info[0]),
         .pStages                      = shader_stages_create_info,
-        .pVertexInputState            = &vertex_input_state_create_info,
+        .pVertexInputState            = vertex_input_state_create_info,
         .pInputAssemblyState          = &input_assembly_state_create_info,
         .pViewportState               = &viewport_state_create_info,
         .pRasterizationState          = &rasterizer_state_create_info,
         .pMultisampleState            = &multisampling_state_create_info,
-        .pDepthStencilState           = &depth_stencil_state_create_info,
+        .pDepthStencilState           = depth_stencil_state_create_info,
         .pColorBlendState             = &color_blend_state_create_info,
         .pDynamicState                = &dynamic_state_create_info,
-        .layout                       = pipeline->pipeline_layout,
+        .layout                       = pipeline_layout,
         .renderPass                   = render_pass->render_pass,
         .subpass                      = 0,
         .basePipelineHandle           = VK_NULL_HANDLE
     };
 
-    if(vkCreateGraphicsPipelines(device->logical_device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &(pipeline->graphic_pipeline)) != VK_SUCCESS)
-    {
-        fprintf(stderr, "Failed to create graphics pipeline!\n");
-        goto ERROR;
-    }
-
-    goto FREE;
+    VkResult result = vkCreateGraphicsPipelines(device->logical_device, VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, graphic_pipeline);
 
-ERROR:
-    free(pipeline);
-    pipeline = NULL;
-
-FREE:
-    if(fragment_shader_module != NULL)
-        vkDestroyShaderModule(device->logical_device, fragment_shader_module, NULL);
-    if(vertex_shader_module != NULL)
-        vkDestroyShaderModule(device->logical_device, vertex_shader_module, NULL);
-    free(vertex_shader_code);
-    free(fragment_shader_code);
+    vkDestroyShaderModule(device->logical_device, fragment_shader_module, NULL);
 
-    return pipeline;
-}
-
-void destroy_pipeline(PPipeline* pipeline, PDevice* device)
-{
-    if(pipeline == NULL)
+    if(result != VK_SUCCESS)
     {
-        return;
+        fprintf(stderr, "Failed to create graphics pipeline!\n");
+        return PIGMENT_ERROR;
     }
-    vkDestroyPipeline(device->logical_device, pipeline->graphic_pipeline, NULL);
-    vkDestroyPipelineLayout(device->logical_device, pipeline->pipeline_layout, NULL);
-    free(pipeline);
+
+    return PIGMENT_SUCCESS;
 }
 
 VkPipelineShaderStageCreateInfo configure_shader_stage_create_info(VkShaderModule shader_module, char type, const char* entry_point)
@@ -316,15 +375,22 @@ VkPipelineDynamicStateCreateInfo configure_dynamic_state_create_info(VkDynamicSt
     return dynamic_state_create_info;
 }
 
-VkPipelineLayout create_pipeline_layout(VkDescriptorSetLayout* descriptor_set_layout, VkDevice device)
+VkPipelineLayout create_pipeline_layout(const VkDescriptorSetLayout* set_layouts, VkDevice device)
 {
     VkPipelineLayout pipeline_layout;
 
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset     = 0,
+        .size       = sizeof(ModelConstants)
+    };
+
     VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
         .sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount             = 1,
-        .pSetLayouts                = descriptor_set_layout,
-        .pushConstantRangeCount     = 0
+        .setLayoutCount             = DESCRIPTOR_SET_COUNT,
+        .pSetLayouts                = set_layouts,
+        .pushConstantRangeCount     = 1,
+        .pPushConstantRanges        = &push_constant_range
     };
 
     if(vkCreatePipelineLayout(device, &pipeline_layout_create_info, NULL, &pipeline_layout) != VK_SUCCESS)
@@ -16,13 +16,16 @@
 
 #ifndef PIPELINE_H
 #define PIPELINE_H
+#define MATERIAL_OPAQUE 0
+#define MATERIAL_ALPHA_TESTED 1
+#define MATERIAL_COUNT 2
 
 #include "defines.h"
 
 #define VERTEX_SHADER_TYPE 0
 #define FRAGMENT_SHADER_TYPE 1
 
-PPipeline* create_graphic_pipeline(PRenderPass* render_pass, PDescriptor* descriptor, PDevice* device, PVertexDescription* vertex_description);
+PPipeline* create_graphic_pipeline(PRenderPass* render_pass, PDescriptor* descriptor, bool depth_prepass, PDevice* device, PVertexDescription* vertex_description);
 void destroy_pipeline(PPipeline* pipeline, PDevice* device);
 
 #endif
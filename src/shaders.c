@@ -42,7 +42,33 @@ char* get_shader_code(const char* file_path, uint32_t* shader_size)
     return shader_code;
 }
 
-uint32_t* compile_glsl_to_spv(const char* source_code, uint32_t source_size, shaderc_shader_kind kind, const char* file_name, uint32_t* spv_size)
+char* join_shader_code(const char* const* parts, uint32_t part_count, uint32_t* shader_size)
+{
+    *shader_size = 0;
+    for(uint32_t i = 0; i < part_count; i++)
+    {
+        *shader_size += (uint32_t) strlen(parts[i]);
+    }
+
+    char* shader_code = malloc((*shader_size) * sizeof(*shader_code) + 1);
+    if(shader_code == NULL)
+    {
+        return NULL;
+    }
+
+    char* end = shader_code;
+    for(uint32_t i = 0; i < part_count; i++)
+    {
+        size_t part_size = strlen(parts[i]);
+        memcpy(end, parts[i], part_size);
+        end += part_size;
+    }
+    *end = '\0';
+
+    return shader_code;
+}
+
+uint32_t* compile_glsl_to_spv(const char* source_code, uint32_t source_size, shaderc_shader_kind kind, const char* file_name, const char* definition, uint32_t* spv_size)
 {
 
     shaderc_compiler_t compiler = NULL;
@@ -63,6 +89,17 @@ uint32_t* compile_glsl_to_spv(const char* source_code, uint32_t source_size, sha
         goto ERROR;
     }
 
+    // Several macros can be given, separated by spaces
+    for (const char* name = definition; name != NULL && *name != '\0'; )
+    {
+        size_t name_size = strcspn(name, " ");
+        if (name_size > 0)
+        {
+            shaderc_compile_options_add_macro_definition(options, name, name_size, NULL, 0);
+        }
+        name += name_size + (name[name_size] == ' ');
+    }
+
     const char* input_name = file_name ? file_name : "default";
 
     const char* entry_point = "main";
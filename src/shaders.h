@@ -24,47 +24,127 @@
 #define DEFAULT_VERTEX_SHADER \
 "#version 450\n" \
 "\n" \
-"layout (binding = 0) uniform UniformBufferObject {\n" \
-"    mat4 model;\n" \
+"layout (set = 1, binding = 0) uniform UniformBufferObject {\n" \
 "    mat4 view;\n" \
 "    mat4 proj;\n" \
 "} ubo;\n" \
 "\n" \
+"struct Instance\n" \
+"{\n" \
+"    mat4 model;\n" \
+"    vec4 color;\n" \
+"    uint textureIndex;\n" \
+"    uint textureLayer;\n" \
+"    uint meshIndex;\n" \
+"    uint batchOffset;\n" \
+"};\n" \
+"\n" \
+"layout (set = 1, binding = 2) readonly buffer InstanceBuffer\n" \
+"{\n" \
+"    Instance instances[];\n" \
+"} instanceBuffer;\n" \
+"\n" \
+"#ifdef GPU_CULLING\n" \
+"layout (set = 1, binding = 3) readonly buffer VisibleBuffer\n" \
+"{\n" \
+"    uint visibleInstances[];\n" \
+"} visibleBuffer;\n" \
+"#endif\n" \
+"\n" \
+"layout (push_constant) uniform ModelConstants\n" \
+"{\n" \
+"    mat4 model;\n" \
+"} constants;\n" \
+"\n" \
+"layout (set = 1, binding = 1) readonly buffer TextureTable\n" \
+"{\n" \
+"    uint descriptorIndices[];\n" \
+"} textureTable;\n" \
+"\n" \
 "layout (location = 0) in vec3 inPosition;\n" \
+"#ifndef DEPTH_PREPASS\n" \
 "layout (location = 1) in vec3 inColor;\n" \
+"#endif\n" \
 "layout (location = 2) in vec2 inTexCoord;\n" \
 "layout (location = 3) in int inTextureIndex;\n" \
 "layout (location = 4) in int inSamplerIndex;\n" \
+"layout (location = 5) in int inTextureLayer;\n" \
 "\n" \
+"#ifndef DEPTH_PREPASS\n" \
 "layout (location = 0) out vec3 fragColor;\n" \
+"#endif\n" \
 "layout (location = 1) out vec2 fragTexCoord;\n" \
 "layout (location = 2) flat out int fragTexIndex;\n" \
 "layout (location = 3) flat out int fragSamplerIndex;\n" \
+"layout (location = 4) flat out int fragTexLayer;\n" \
+"layout (location = 5) flat out uint fragDescriptorIndex;\n" \
+"\n" \
+"// The depth pre-pass and the main pass must compute the exact same depth for the EQUAL test\n" \
+"invariant gl_Position;\n" \
 "\n" \
 "void main()\n" \
 "{\n" \
-"    fragColor = inColor;\n" \
+"#ifdef GPU_CULLING\n" \
+"    // Instances that passed culling are listed by mesh, the first entry stays on the static model\n" \
+"    Instance instance = instanceBuffer.instances[visibleBuffer.visibleInstances[gl_InstanceIndex]];\n" \
+"#else\n" \
+"    Instance instance = instanceBuffer.instances[gl_InstanceIndex];\n" \
+"#endif\n" \
+"\n" \
+"    // Instances of a shared mesh pick their texture, the static model keeps the one of each vertex\n" \
+"    int textureIndex = inTextureIndex;\n" \
+"    int textureLayer = inTextureLayer;\n" \
+"    if (instance.textureIndex != 0xFFFFFFFFu)\n" \
+"    {\n" \
+"        textureIndex = int(instance.textureIndex);\n" \
+"        textureLayer = int(instance.textureLayer);\n" \
+"    }\n" \
+"\n" \
+"#ifndef DEPTH_PREPASS\n" \
+"    fragColor = inColor * instance.color.rgb;\n" \
+"#endif\n" \
 "    fragTexCoord = inTexCoord;\n" \
-"    fragTexIndex = inTextureIndex;\n" \
+"    fragTexIndex = textureIndex;\n" \
 "    fragSamplerIndex = inSamplerIndex;\n" \
-"    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);\n" \
+"    fragTexLayer = textureLayer;\n" \
+"    fragDescriptorIndex = textureTable.descriptorIndices[max(textureIndex, 0)];\n" \
+"    gl_Position = ubo.proj * ubo.view * constants.model * instance.model * vec4(inPosition, 1.0);\n" \
 "}\n"
 
 #define DEFAULT_FRAGMENT_SHADER \
 "#version 450\n" \
 "#extension GL_EXT_nonuniform_qualifier : require\n" \
 "#define MAX_SAMPLERS 2\n" \
+"#define ALPHA_CUTOFF 0.8\n" \
 "\n" \
-"layout (binding = 1) uniform sampler _sampler[MAX_SAMPLERS];\n" \
-"layout (binding = 2) uniform texture2D _texture[];\n" \
+"layout (set = 0, binding = 0) uniform sampler _sampler[MAX_SAMPLERS];\n" \
+"layout (set = 0, binding = 1) uniform texture2DArray _texture[];\n" \
 "\n" \
+"#ifdef TEXTURE_FEEDBACK\n" \
+"#define FEEDBACK_LOD_BIAS 16.0\n" \
+"\n" \
+"layout (set = 1, binding = 4) buffer TextureFeedback\n" \
+"{\n" \
+"    uint requestedLevels[];\n" \
+"} feedback;\n" \
+"#endif\n" \
+"\n" \
+"#ifndef DEPTH_PREPASS\n" \
 "layout (location = 0) in vec3 fragColor;\n" \
+"#endif\n" \
 "layout (location = 1) in vec2 fragTexCoord;\n" \
 "layout (location = 2) flat in int inTexIndex;\n" \
 "layout (location = 3) flat in int inSamplerIndex;\n" \
+"layout (location = 4) flat in int inTexLayer;\n" \
+"layout (location = 5) flat in uint inDescriptorIndex;\n" \
 "\n" \
 "layout (location = 0) out vec4 outColor;\n" \
 "\n" \
+"#if defined(DEPTH_EQUAL) || (defined(OPAQUE_MATERIAL) && !defined(DEPTH_PREPASS))\n" \
+"// Nothing is discarded past this point, force the test before the shader even with the feedback writes\n" \
+"layout (early_fragment_tests) in;\n" \
+"#endif\n" \
+"\n" \
 "void main()\n" \
 "{\n" \
 "    int samplerIndex;\n" \
@@ -76,15 +156,549 @@
 "    {\n" \
 "        samplerIndex = inSamplerIndex;\n" \
 "    }\n" \
-"    outColor = texture(sampler2D(_texture[nonuniformEXT(inTexIndex)], _sampler[samplerIndex]), fragTexCoord);\n" \
-"    if (outColor.w < 0.8)\n" \
+"#ifdef DEPTH_PREPASS\n" \
+"#ifndef OPAQUE_MATERIAL\n" \
+"    // Only the alpha test runs here, the main pass shades what is left on the same depth\n" \
+"    if (texture(sampler2DArray(_texture[nonuniformEXT(inDescriptorIndex)], _sampler[samplerIndex]), vec3(fragTexCoord, inTexLayer)).a < ALPHA_CUTOFF)\n" \
+"    {\n" \
+"        discard;\n" \
+"    }\n" \
+"#endif\n" \
+"#else\n" \
+"    outColor = vec4(fragColor, 1.0) * texture(sampler2DArray(_texture[nonuniformEXT(inDescriptorIndex)], _sampler[samplerIndex]), vec3(fragTexCoord, inTexLayer));\n" \
+"#ifdef TEXTURE_FEEDBACK\n" \
+"    // Report the finest level wanted, biased so that magnified textures still ask for more detail\n" \
+"    float lod = textureQueryLod(sampler2DArray(_texture[nonuniformEXT(inDescriptorIndex)], _sampler[samplerIndex]), fragTexCoord).y;\n" \
+"    uint requestedLevel = uint(clamp(floor(lod) + FEEDBACK_LOD_BIAS, 0.0, 31.0));\n" \
+"    if (requestedLevel < feedback.requestedLevels[inTexIndex])\n" \
+"    {\n" \
+"        atomicMin(feedback.requestedLevels[inTexIndex], requestedLevel);\n" \
+"    }\n" \
+"#endif\n" \
+"#if !defined(DEPTH_EQUAL) && !defined(OPAQUE_MATERIAL)\n" \
+"    // Without a pre-pass the discard stays here, which prevents early depth testing\n" \
+"    if (outColor.w < ALPHA_CUTOFF)\n" \
 "    {\n" \
 "        discard;\n" \
 "    }\n" \
+"#endif\n" \
+"#endif\n" \
+"}\n"
+
+#define DEFAULT_MIPMAP_COMPUTE_SHADER \
+"#version 450\n" \
+"\n" \
+"#define MAX_MIP_LEVELS 13\n" \
+"#define TILE_SIZE 32\n" \
+"\n" \
+"layout (local_size_x = 256) in;\n" \
+"\n" \
+"layout (binding = 0, rgba8) uniform coherent image2D _mips[MAX_MIP_LEVELS];\n" \
+"layout (binding = 1) coherent buffer Counters\n" \
+"{\n" \
+"    uint counters[];\n" \
+"};\n" \
+"\n" \
+"layout (push_constant) uniform Constants\n" \
+"{\n" \
+"    uint mipLevels;\n" \
+"    uint workgroupCount;\n" \
+"    uint counterIndex;\n" \
+"    uint srgb;\n" \
+"} constants;\n" \
+"\n" \
+"shared vec4 tile[TILE_SIZE][TILE_SIZE];\n" \
+"shared bool lastWorkgroup;\n" \
+"\n" \
+"vec4 toLinear(vec4 color)\n" \
+"{\n" \
+"    if (constants.srgb == 0u)\n" \
+"    {\n" \
+"        return color;\n" \
+"    }\n" \
+"    vec3 low = color.rgb / 12.92;\n" \
+"    vec3 high = pow((color.rgb + 0.055) / 1.055, vec3(2.4));\n" \
+"    return vec4(mix(high, low, lessThanEqual(color.rgb, vec3(0.04045))), color.a);\n" \
+"}\n" \
+"\n" \
+"vec4 toSrgb(vec4 color)\n" \
+"{\n" \
+"    if (constants.srgb == 0u)\n" \
+"    {\n" \
+"        return color;\n" \
+"    }\n" \
+"    vec3 low = color.rgb * 12.92;\n" \
+"    vec3 high = 1.055 * pow(color.rgb, vec3(1.0 / 2.4)) - 0.055;\n" \
+"    return vec4(mix(high, low, lessThanEqual(color.rgb, vec3(0.0031308))), color.a);\n" \
+"}\n" \
+"\n" \
+"vec4 loadTexel(uint level, ivec2 position)\n" \
+"{\n" \
+"    ivec2 size = imageSize(_mips[level]);\n" \
+"    return toLinear(imageLoad(_mips[level], min(position, size - 1)));\n" \
+"}\n" \
+"\n" \
+"void storeTexel(uint level, ivec2 position, vec4 color)\n" \
+"{\n" \
+"    if (level < constants.mipLevels && all(lessThan(position, imageSize(_mips[level]))))\n" \
+"    {\n" \
+"        imageStore(_mips[level], position, toSrgb(color));\n" \
+"    }\n" \
+"}\n" \
+"\n" \
+"// Reduces a 64x64 region of sourceLevel into the six following levels\n" \
+"void downsample(uint sourceLevel, ivec2 tilePosition)\n" \
+"{\n" \
+"    uint index = gl_LocalInvocationIndex;\n" \
+"\n" \
+"    for (uint i = index; i < TILE_SIZE * TILE_SIZE; i += gl_WorkGroupSize.x)\n" \
+"    {\n" \
+"        ivec2 local = ivec2(i % TILE_SIZE, i / TILE_SIZE);\n" \
+"        ivec2 source = (tilePosition * TILE_SIZE + local) * 2;\n" \
+"        vec4 color = (loadTexel(sourceLevel, source) + loadTexel(sourceLevel, source + ivec2(1, 0)) +\n" \
+"                      loadTexel(sourceLevel, source + ivec2(0, 1)) + loadTexel(sourceLevel, source + ivec2(1, 1))) * 0.25;\n" \
+"        storeTexel(sourceLevel + 1u, tilePosition * TILE_SIZE + local, color);\n" \
+"        tile[local.y][local.x] = color;\n" \
+"    }\n" \
+"\n" \
+"    for (uint size = TILE_SIZE / 2, level = sourceLevel + 2u; size > 0u; size /= 2u, level++)\n" \
+"    {\n" \
+"        barrier();\n" \
+"\n" \
+"        bool active = index < size * size;\n" \
+"        ivec2 local = ivec2(index % size, index / size);\n" \
+"        vec4 color = vec4(0.0);\n" \
+"        if (active)\n" \
+"        {\n" \
+"            color = (tile[local.y * 2][local.x * 2] + tile[local.y * 2][local.x * 2 + 1] +\n" \
+"                     tile[local.y * 2 + 1][local.x * 2] + tile[local.y * 2 + 1][local.x * 2 + 1]) * 0.25;\n" \
+"        }\n" \
+"\n" \
+"        barrier();\n" \
+"\n" \
+"        if (active)\n" \
+"        {\n" \
+"            tile[local.y][local.x] = color;\n" \
+"            storeTexel(level, tilePosition * int(size) + local, color);\n" \
+"        }\n" \
+"    }\n" \
+"}\n" \
+"\n" \
+"void main()\n" \
+"{\n" \
+"    downsample(0u, ivec2(gl_WorkGroupID.xy));\n" \
+"\n" \
+"    if (constants.mipLevels <= 7u)\n" \
+"    {\n" \
+"        return;\n" \
+"    }\n" \
+"\n" \
+"    // The last workgroup to finish level 6 builds the remaining levels on its own\n" \
+"    memoryBarrierImage();\n" \
+"    barrier();\n" \
+"    if (gl_LocalInvocationIndex == 0u)\n" \
+"    {\n" \
+"        lastWorkgroup = atomicAdd(counters[constants.counterIndex], 1u) == constants.workgroupCount - 1u;\n" \
+"    }\n" \
+"    barrier();\n" \
+"\n" \
+"    if (!lastWorkgroup)\n" \
+"    {\n" \
+"        return;\n" \
+"    }\n" \
+"\n" \
+"    if (gl_LocalInvocationIndex == 0u)\n" \
+"    {\n" \
+"        counters[constants.counterIndex] = 0u;\n" \
+"    }\n" \
+"    downsample(6u, ivec2(0));\n" \
+"}\n"
+
+#define DEFAULT_DEPTH_PYRAMID_COMPUTE_SHADER \
+"#version 450\n" \
+"\n" \
+"layout (local_size_x = 8, local_size_y = 8) in;\n" \
+"\n" \
+"layout (binding = 0) uniform sampler2D inputDepth;\n" \
+"layout (binding = 1, r32f) uniform writeonly image2D outputDepth;\n" \
+"\n" \
+"void main()\n" \
+"{\n" \
+"    ivec2 position = ivec2(gl_GlobalInvocationID.xy);\n" \
+"    ivec2 outputSize = imageSize(outputDepth);\n" \
+"    if (any(greaterThanEqual(position, outputSize)))\n" \
+"    {\n" \
+"        return;\n" \
+"    }\n" \
+"\n" \
+"    // The first level is smaller than the depth buffer by a non integer ratio, so every input texel touched counts\n" \
+"    ivec2 inputSize = textureSize(inputDepth, 0);\n" \
+"    ivec2 first = position * inputSize / outputSize;\n" \
+"    ivec2 last = max(first, ((position + 1) * inputSize + outputSize - 1) / outputSize - 1);\n" \
+"\n" \
+"    float depth = 0.0;\n" \
+"    for (int y = first.y; y <= last.y; y++)\n" \
+"    {\n" \
+"        for (int x = first.x; x <= last.x; x++)\n" \
+"        {\n" \
+"            depth = max(depth, texelFetch(inputDepth, ivec2(x, y), 0).r);\n" \
+"        }\n" \
+"    }\n" \
+"\n" \
+"    imageStore(outputDepth, position, vec4(depth));\n" \
+"}\n"
+
+// Split in parts shorter than the 4095 characters compilers must accept in a string literal, joined by join_shader_code
+#define DEFAULT_CULL_COMPUTE_SHADER_DECLARATIONS \
+"#version 450\n" \
+"\n" \
+"layout (local_size_x = 64) in;\n" \
+"\n" \
+"#define CULL_INSTANCES 0u\n" \
+"#define BUILD_DRAWS 1u\n" \
+"#define CULL_MESHLETS 2u\n" \
+"\n" \
+"#define EARLY_PHASE 0u\n" \
+"#define LATE_PHASE 1u\n" \
+"\n" \
+"#define MAX_LODS 4u\n" \
+"// Same margin as LOD_HYSTERESIS in lod.h\n" \
+"#define LOD_HYSTERESIS 0.75\n" \
+"\n" \
+"struct Instance\n" \
+"{\n" \
+"    mat4 model;\n" \
+"    vec4 color;\n" \
+"    uint textureIndex;\n" \
+"    uint textureLayer;\n" \
+"    uint meshIndex;\n" \
+"    uint batchOffset;\n" \
+"};\n" \
+"\n" \
+"struct Mesh\n" \
+"{\n" \
+"    int vertexOffset;\n" \
+"    uint lodCount;\n" \
+"    uvec2 padding;\n" \
+"    vec4 bounds;\n" \
+"    vec4 lodErrors;\n" \
+"    uvec4 lodFirstIndex;\n" \
+"    uvec4 lodIndexCount;\n" \
+"};\n" \
+"\n" \
+"struct Meshlet\n" \
+"{\n" \
+"    uint firstIndex;\n" \
+"    uint indexCount;\n" \
+"    uint material;\n" \
+"    uint drawOffset;\n" \
+"    int vertexOffset;\n" \
+"    uint visibility;\n" \
+"    uvec2 padding;\n" \
+"    vec4 bounds;\n" \
+"    vec4 cone;\n" \
+"};\n" \
+"\n" \
+"struct Batch\n" \
+"{\n" \
+"    uint visibleCount;\n" \
+"    uint firstInstance;\n" \
+"};\n" \
+"\n" \
+"struct DrawCommand\n" \
+"{\n" \
+"    uint indexCount;\n" \
+"    uint instanceCount;\n" \
+"    uint firstIndex;\n" \
+"    int vertexOffset;\n" \
+"    uint firstInstance;\n" \
+"};\n" \
+"\n" \
+"layout (binding = 0) readonly buffer InstanceBuffer\n" \
+"{\n" \
+"    Instance instances[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 1) writeonly buffer VisibleBuffer\n" \
+"{\n" \
+"    uint visibleInstances[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 2) readonly buffer MeshBuffer\n" \
+"{\n" \
+"    Mesh meshes[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 3) buffer BatchBuffer\n" \
+"{\n" \
+"    uint drawCount[2];\n" \
+"    uint meshletDrawCount[2][2];\n" \
+"    Batch batches[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 4) writeonly buffer DrawBuffer\n" \
+"{\n" \
+"    DrawCommand draws[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 5) buffer VisibilityBuffer\n" \
+"{\n" \
+"    uint visibility[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 6) uniform UniformBufferObject\n" \
+"{\n" \
+"    mat4 view;\n" \
+"    mat4 proj;\n" \
+"} ubo;\n" \
+"\n" \
+"layout (binding = 7) uniform sampler2D depthPyramid;\n" \
+"\n" \
+"layout (binding = 8) readonly buffer MeshletBuffer\n" \
+"{\n" \
+"    Meshlet meshlets[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 9) buffer MeshletVisibilityBuffer\n" \
+"{\n" \
+"    uint meshletVisibility[];\n" \
+"};\n" \
+"\n" \
+"layout (binding = 10) readonly buffer ChunkBuffer\n" \
+"{\n" \
+"    Meshlet chunks[];\n" \
+"};\n" \
+"\n" \
+"layout (push_constant) uniform Constants\n" \
+"{\n" \
+"    vec4 frustum[6];\n" \
+"    uint instanceCount;\n" \
+"    uint meshCount;\n" \
+"    uint pass;\n" \
+"    uint phase;\n" \
+"    uint meshletCount;\n" \
+"    float lodScale;\n" \
+"    uint chunkCount;\n" \
+"    uint meshletDrawCapacity;\n" \
+"} constants;\n" \
+"\n"
+
+#define DEFAULT_CULL_COMPUTE_SHADER_FUNCTIONS \
+"float instanceScale(Instance instance)\n" \
+"{\n" \
+"    return max(length(instance.model[0].xyz), max(length(instance.model[1].xyz), length(instance.model[2].xyz)));\n" \
+"}\n" \
+"\n" \
+"vec4 worldBounds(Instance instance)\n" \
+"{\n" \
+"    vec4 bounds = meshes[instance.meshIndex].bounds;\n" \
+"    vec3 center = (instance.model * vec4(bounds.xyz, 1.0)).xyz;\n" \
+"    return vec4(center, bounds.w * instanceScale(instance));\n" \
+"}\n" \
+"\n" \
+"vec3 cameraPosition()\n" \
+"{\n" \
+"    return -(transpose(mat3(ubo.view)) * ubo.view[3].xyz);\n" \
+"}\n" \
+"\n" \
+"bool isInFrustum(vec4 sphere)\n" \
+"{\n" \
+"    for (int i = 0; i < 6; i++)\n" \
+"    {\n" \
+"        if (dot(constants.frustum[i].xyz, sphere.xyz) + constants.frustum[i].w < -sphere.w)\n" \
+"        {\n" \
+"            return false;\n" \
+"        }\n" \
+"    }\n" \
+"    return true;\n" \
+"}\n" \
+"\n" \
+"// Every triangle faces away when the camera sees the whole normal cone from behind\n" \
+"bool isBackFacing(vec4 sphere, vec4 cone)\n" \
+"{\n" \
+"    vec3 direction = sphere.xyz - cameraPosition();\n" \
+"    return dot(direction, cone.xyz) >= cone.w * length(direction) + sphere.w;\n" \
+"}\n" \
+"\n" \
+"// Compares the nearest depth of the sphere's box with the farthest depth in the pyramid texels it covers\n" \
+"bool isOccluded(vec4 sphere)\n" \
+"{\n" \
+"    mat4 viewProjection = ubo.proj * ubo.view;\n" \
+"    vec3 minimum = vec3(1.0);\n" \
+"    vec3 maximum = vec3(0.0);\n" \
+"\n" \
+"    for (int i = 0; i < 8; i++)\n" \
+"    {\n" \
+"        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);\n" \
+"        vec4 clip = viewProjection * vec4(corner, 1.0);\n" \
+"        if (clip.w <= 0.0)\n" \
+"        {\n" \
+"            return false;\n" \
+"        }\n" \
+"\n" \
+"        vec3 ndc = clip.xyz / clip.w;\n" \
+"        vec3 screen = vec3(ndc.xy * 0.5 + 0.5, ndc.z);\n" \
+"        minimum = min(minimum, screen);\n" \
+"        maximum = max(maximum, screen);\n" \
+"    }\n" \
+"\n" \
+"    if (minimum.z <= 0.0)\n" \
+"    {\n" \
+"        return false;\n" \
+"    }\n" \
+"\n" \
+"    minimum.xy = clamp(minimum.xy, 0.0, 1.0);\n" \
+"    maximum.xy = clamp(maximum.xy, 0.0, 1.0);\n" \
+"\n" \
+"    vec2 size = (maximum.xy - minimum.xy) * vec2(textureSize(depthPyramid, 0));\n" \
+"    int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, textureQueryLevels(depthPyramid) - 1);\n" \
+"\n" \
+"    ivec2 levelSize = textureSize(depthPyramid, level);\n" \
+"    ivec2 first = min(ivec2(minimum.xy * vec2(levelSize)), levelSize - 1);\n" \
+"    ivec2 last = min(ivec2(maximum.xy * vec2(levelSize)), levelSize - 1);\n" \
+"\n" \
+"    float depth = max(max(texelFetch(depthPyramid, first, level).r, texelFetch(depthPyramid, ivec2(last.x, first.y), level).r),\n" \
+"                      max(texelFetch(depthPyramid, ivec2(first.x, last.y), level).r, texelFetch(depthPyramid, last, level).r));\n" \
+"\n" \
+"    return minimum.z > depth;\n" \
+"}\n" \
+"\n" \
+"// Coarsest level whose error projects under a pixel, levels coarser than the previous one need a margin\n" \
+"// so that an instance at the boundary does not switch every frame\n" \
+"uint selectLod(Instance instance, vec4 sphere, uint previousLod)\n" \
+"{\n" \
+"    Mesh mesh = meshes[instance.meshIndex];\n" \
+"    float distance = length(sphere.xyz - cameraPosition()) - sphere.w;\n" \
+"    float scale = instanceScale(instance) * constants.lodScale;\n" \
+"\n" \
+"    uint lod = 0u;\n" \
+"    for (uint i = 1u; i < mesh.lodCount; i++)\n" \
+"    {\n" \
+"        float threshold = i > previousLod ? LOD_HYSTERESIS : 1.0;\n" \
+"        if (mesh.lodErrors[i] * scale > threshold * distance)\n" \
+"        {\n" \
+"            break;\n" \
+"        }\n" \
+"        lod = i;\n" \
+"    }\n" \
+"    return lod;\n" \
+"}\n" \
+"\n" \
+"void appendVisible(Instance instance, uint index, uint phase, uint lod)\n" \
+"{\n" \
+"    // Each level of each phase has its own list, so they all share one buffer\n" \
+"    uint batch = (phase * constants.meshCount + instance.meshIndex) * MAX_LODS + lod;\n" \
+"    uint listOffset = (phase * MAX_LODS + lod) * constants.instanceCount + instance.batchOffset;\n" \
+"\n" \
+"    uint slot = atomicAdd(batches[batch].visibleCount, 1u);\n" \
+"    if (slot == 0u)\n" \
+"    {\n" \
+"        batches[batch].firstInstance = listOffset;\n" \
+"    }\n" \
+"    visibleInstances[listOffset + slot] = index;\n" \
+"}\n" \
+"\n"
+
+#define DEFAULT_CULL_COMPUTE_SHADER_MAIN \
+"void main()\n" \
+"{\n" \
+"    uint index = gl_GlobalInvocationID.x;\n" \
+"\n" \
+"    if (constants.pass == CULL_INSTANCES)\n" \
+"    {\n" \
+"        // The first instance belongs to the static model and is never culled\n" \
+"        if (index == 0u || index >= constants.instanceCount)\n" \
+"        {\n" \
+"            return;\n" \
+"        }\n" \
+"\n" \
+"        Instance instance = instances[index];\n" \
+"        vec4 sphere = worldBounds(instance);\n" \
+"        // The lowest bit tells whether the instance was visible, the others keep the level it was drawn with\n" \
+"        bool wasVisible = (visibility[index] & 1u) != 0u;\n" \
+"        uint lod = selectLod(instance, sphere, visibility[index] >> 1);\n" \
+"\n" \
+"        if (constants.phase == EARLY_PHASE)\n" \
+"        {\n" \
+"            // Instances visible last time are drawn first, their depth builds the pyramid\n" \
+"            if (wasVisible && isInFrustum(sphere))\n" \
+"            {\n" \
+"                appendVisible(instance, index, EARLY_PHASE, lod);\n" \
+"            }\n" \
+"            return;\n" \
+"        }\n" \
+"\n" \
+"        // Everything is tested again against the pyramid, only the newly visible instances are drawn\n" \
+"        bool visible = isInFrustum(sphere) && !isOccluded(sphere);\n" \
+"        if (visible && !wasVisible)\n" \
+"        {\n" \
+"            appendVisible(instance, index, LATE_PHASE, lod);\n" \
+"        }\n" \
+"        visibility[index] = (lod << 1) | (visible ? 1u : 0u);\n" \
+"    }\n" \
+"    else if (constants.pass == BUILD_DRAWS)\n" \
+"    {\n" \
+"        // One invocation per level of each mesh\n" \
+"        uint batchCount = constants.meshCount * MAX_LODS;\n" \
+"        uint batch = constants.phase * batchCount + index;\n" \
+"        if (index >= batchCount || batches[batch].visibleCount == 0u)\n" \
+"        {\n" \
+"            return;\n" \
+"        }\n" \
+"\n" \
+"        Mesh mesh = meshes[index / MAX_LODS];\n" \
+"        uint lod = index % MAX_LODS;\n" \
+"        uint draw = constants.phase * batchCount + atomicAdd(drawCount[constants.phase], 1u);\n" \
+"        draws[draw].indexCount = mesh.lodIndexCount[lod];\n" \
+"        draws[draw].instanceCount = batches[batch].visibleCount;\n" \
+"        draws[draw].firstIndex = mesh.lodFirstIndex[lod];\n" \
+"        draws[draw].vertexOffset = mesh.vertexOffset;\n" \
+"        draws[draw].firstInstance = batches[batch].firstInstance;\n" \
+"    }\n" \
+"    else if (constants.pass == CULL_MESHLETS)\n" \
+"    {\n" \
+"        if (index >= constants.meshletCount + constants.chunkCount)\n" \
+"        {\n" \
+"            return;\n" \
+"        }\n" \
+"\n" \
+"        // The resident chunks of a streamed model follow the static meshlets, one entry per chunk and material\n" \
+"        Meshlet meshlet = index < constants.meshletCount ? meshlets[index] : chunks[index - constants.meshletCount];\n" \
+"        bool wasVisible = (meshletVisibility[meshlet.visibility] & 1u) != 0u;\n" \
+"        bool visible = isInFrustum(meshlet.bounds) && !isBackFacing(meshlet.bounds, meshlet.cone);\n" \
+"\n" \
+"        // Like instances, meshlets visible last time are drawn first and the others only once they pass the pyramid\n" \
+"        if (constants.phase == EARLY_PHASE)\n" \
+"        {\n" \
+"            if (!visible || !wasVisible)\n" \
+"            {\n" \
+"                return;\n" \
+"            }\n" \
+"        }\n" \
+"        else\n" \
+"        {\n" \
+"            visible = visible && !isOccluded(meshlet.bounds);\n" \
+"            meshletVisibility[meshlet.visibility] = visible ? 1u : 0u;\n" \
+"            if (!visible || wasVisible)\n" \
+"            {\n" \
+"                return;\n" \
+"            }\n" \
+"        }\n" \
+"\n" \
+"        // Meshlet draws follow the instance draws of both phases, each phase and material in its own range\n" \
+"        uint draw = 2u * constants.meshCount * MAX_LODS + constants.phase * constants.meshletDrawCapacity + meshlet.drawOffset + atomicAdd(meshletDrawCount[constants.phase][meshlet.material], 1u);\n" \
+"        draws[draw].indexCount = meshlet.indexCount;\n" \
+"        draws[draw].instanceCount = 1u;\n" \
+"        draws[draw].firstIndex = meshlet.firstIndex;\n" \
+"        draws[draw].vertexOffset = meshlet.vertexOffset;\n" \
+"        // The first visible entry always points to the static model\n" \
+"        draws[draw].firstInstance = 0u;\n" \
+"    }\n" \
 "}\n"
 
 char* get_shader_code(const char* file_path, uint32_t* shader_size);
-uint32_t* compile_glsl_to_spv(const char* source_code, uint32_t source_size, shaderc_shader_kind kind, const char* file_name, uint32_t* spv_size);
+char* join_shader_code(const char* const* parts, uint32_t part_count, uint32_t* shader_size);
+uint32_t* compile_glsl_to_spv(const char* source_code, uint32_t source_size, shaderc_shader_kind kind, const char* file_name, const char* definition, uint32_t* spv_size);
 VkShaderModule create_shader_module(VkDevice device, const uint32_t* code, uint32_t shader_size);
 
 #endif
@@ -0,0 +1,649 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "streaming.h"
+#include "structs.h"
+#include "texture.h"
+
+#include "lib/array.h"
+#include "lib/ktx2.h"
+
+extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
+extern int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t array_layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkMemoryPropertyFlags properties, PDevice* device);
+extern VkImageView create_texture_view(VkImage image, VkFormat format, uint32_t mip_levels, uint32_t layer_count, VkDevice device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+extern int retire_texture(PTextureList* texture_list, const PTexture* texture, uint32_t free_index);
+extern int publish_texture(PTextureList* texture_list, PTexture* texture, PDevice* device);
+extern void destroy_texture_stream(PTextureStream* stream);
+extern void defer_destroy_buffer(VkBuffer buffer, PDevice* device);
+extern void defer_free_memory(VkDeviceMemory memory, PDevice* device);
+
+VkDeviceSize get_image_memory_size(VkImage image, VkDevice device);
+uint32_t get_level_extent(uint32_t full_extent, uint32_t level);
+void* stream_texture_levels(void* arg);
+void release_texture_load(PStreamingLoad* load);
+void collect_texture_loads(PTextureList* texture_list, PDevice* device, uint32_t* resizes);
+void request_texture_loads(PTextureList* texture_list, PDevice* device);
+int stage_texture_levels(PTextureStream* stream, const KTX2Image* ktx2_image, uint32_t first_level, uint32_t level_count, VkBuffer* staging_buffer, VkDeviceMemory* staging_buffer_memory, VkDeviceSize* level_offsets, PDevice* device);
+int resize_streamed_texture(PTextureList* texture_list, PTexture* texture, uint32_t base_level, const KTX2Image* ktx2_image, PDevice* device);
+void record_texture_transfers(VkCommandBuffer command_buffer, PTextureList* texture_list);
+PTexture* find_eviction_victim(PTextureList* texture_list, uint64_t min_age);
+uint64_t evict_streamed_textures(void* context, uint64_t size, bool out_of_memory, PDevice* device);
+
+void enable_texture_streaming(PTextureList* texture_list, PDevice* device)
+{
+    if(!device->fragment_stores_and_atomics)
+    {
+        fprintf(stderr, "Texture streaming needs fragment shader stores, loading full mip chains instead!\n");
+        return;
+    }
+
+    texture_list->stream_mips = true;
+}
+
+VkDeviceSize get_image_memory_size(VkImage image, VkDevice device)
+{
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(device, image, &memory_requirements);
+
+    return memory_requirements.size;
+}
+
+uint32_t get_level_extent(uint32_t full_extent, uint32_t level)
+{
+    uint32_t extent = full_extent >> level;
+    return extent > 0 ? extent : 1;
+}
+
+int create_texture_streamer(PTextureList* texture_list, PDevice* device, uint32_t frame_count)
+{
+    if(!texture_list->stream_mips)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    PTextureStreamer* streamer = calloc(1, sizeof(*streamer));
+    if(streamer == NULL)
+    {
+        perror("create_texture_streamer");
+        return PIGMENT_ERROR;
+    }
+    texture_list->streamer = streamer;
+
+    pthread_mutex_init(&streamer->mutex, NULL);
+    pthread_cond_init(&streamer->condition, NULL);
+
+    streamer->frame_count   = frame_count;
+    streamer->feedback_size = device->max_bindless_textures;
+
+    streamer->feedback_buffers        = calloc(frame_count, sizeof(*streamer->feedback_buffers));
+    streamer->feedback_buffers_memory = calloc(frame_count, sizeof(*streamer->feedback_buffers_memory));
+    streamer->feedback_buffers_mapped = calloc(frame_count, sizeof(*streamer->feedback_buffers_mapped));
+    if(streamer->feedback_buffers == NULL || streamer->feedback_buffers_memory == NULL || streamer->feedback_buffers_mapped == NULL)
+    {
+        perror("create_texture_streamer");
+        goto ERROR;
+    }
+
+    VkDeviceSize feedback_buffer_size = streamer->feedback_size * sizeof(**streamer->feedback_buffers_mapped);
+
+    // One feedback buffer per frame in flight, read back once the fence of that frame has signaled
+    for(uint32_t i = 0; i < frame_count; i++)
+    {
+        if(create_buffer(&streamer->feedback_buffers[i], &streamer->feedback_buffers_memory[i], feedback_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+        {
+            goto ERROR;
+        }
+
+        if(vkMapMemory(device->logical_device, streamer->feedback_buffers_memory[i], 0, feedback_buffer_size, 0, (void**) &streamer->feedback_buffers_mapped[i]) != VK_SUCCESS)
+        {
+            fprintf(stderr, "Failed to map texture feedback buffer!\n");
+            goto ERROR;
+        }
+
+        memset(streamer->feedback_buffers_mapped[i], 0xFF, (size_t) feedback_buffer_size);
+    }
+
+    for(uint32_t i = 0; i < texture_list->texture_number; i++)
+    {
+        if(texture_list->textures[i].stream != NULL)
+        {
+            texture_list->textures[i].stream->memory_size = get_image_memory_size(texture_list->textures[i].image, device->logical_device);
+        }
+    }
+
+    register_memory_evictor(device, evict_streamed_textures, texture_list);
+
+    streamer->worker_started = pthread_create(&streamer->worker, NULL, stream_texture_levels, streamer) == 0;
+    if(!streamer->worker_started)
+    {
+        fprintf(stderr, "Failed to start texture streaming thread, reading mip levels on the render thread!\n");
+    }
+
+    return PIGMENT_SUCCESS;
+
+ERROR:
+    fprintf(stderr, "Failed to create texture streamer!\n");
+    destroy_texture_streamer(texture_list, device);
+    return PIGMENT_ERROR;
+}
+
+void update_texture_streaming(PTextureList* texture_list, PDevice* device, uint32_t frame)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+    if(streamer == NULL)
+    {
+        return;
+    }
+
+    // Each entry holds the finest level sampled during the last use of this frame, biased to stay unsigned
+    uint32_t* feedback = streamer->feedback_buffers_mapped[frame];
+    for(uint32_t i = 0; i < texture_list->texture_number; i++)
+    {
+        PTextureStream* stream = texture_list->textures[i].stream;
+        if(stream == NULL || feedback[i] == UINT32_MAX)
+        {
+            continue;
+        }
+
+        int64_t level = (int64_t) stream->base_level + (int64_t) feedback[i] - STREAMING_FEEDBACK_LOD_BIAS;
+        level         = level < 0 ? 0 : level;
+        level         = level >= stream->level_count ? stream->level_count - 1 : level;
+
+        stream->requested_level    = (uint32_t) level;
+        stream->last_request_frame = texture_list->frame;
+    }
+    memset(feedback, 0xFF, texture_list->texture_number * sizeof(*feedback));
+
+    uint32_t resizes = 0;
+    collect_texture_loads(texture_list, device, &resizes);
+    request_texture_loads(texture_list, device);
+
+    // Near the budget, textures nobody asked for recently fall back to their coarsest levels
+    while(resizes < STREAMING_RESIZES_PER_FRAME && memory_budget_exceeded(device, 0))
+    {
+        PTexture* victim = find_eviction_victim(texture_list, STREAMING_EVICTION_DELAY);
+        if(victim == NULL)
+        {
+            break;
+        }
+
+        uint32_t base_level = victim->stream->level_count - STREAMING_RESIDENT_LEVELS;
+        if(resize_streamed_texture(texture_list, victim, base_level, NULL, device) != PIGMENT_SUCCESS)
+        {
+            break;
+        }
+        victim->stream->requested_level = base_level;
+        resizes++;
+    }
+}
+
+void* stream_texture_levels(void* arg)
+{
+    PTextureStreamer* streamer = arg;
+
+    pthread_mutex_lock(&streamer->mutex);
+    while(!streamer->stopping)
+    {
+        if(streamer->request_number == 0)
+        {
+            pthread_cond_wait(&streamer->condition, &streamer->mutex);
+            continue;
+        }
+
+        PStreamingLoad load = streamer->requests[0];
+        streamer->request_number--;
+        memmove(streamer->requests, &streamer->requests[1], streamer->request_number * sizeof(*streamer->requests));
+
+        // The stream is not freed while it is loading, its path can be read without the lock
+        pthread_mutex_unlock(&streamer->mutex);
+        load.ktx2_image = ktx2_load(load.stream->path);
+        pthread_mutex_lock(&streamer->mutex);
+
+        streamer->completed[streamer->completed_number++] = load;
+    }
+    pthread_mutex_unlock(&streamer->mutex);
+
+    return NULL;
+}
+
+void release_texture_load(PStreamingLoad* load)
+{
+    ktx2_destroy(load->ktx2_image);
+    load->ktx2_image = NULL;
+
+    load->stream->loading = false;
+    if(load->stream->orphaned)
+    {
+        destroy_texture_stream(load->stream);
+    }
+}
+
+void collect_texture_loads(PTextureList* texture_list, PDevice* device, uint32_t* resizes)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+
+    PStreamingLoad completed[STREAMING_QUEUE_SIZE];
+    uint32_t completed_number = 0;
+
+    pthread_mutex_lock(&streamer->mutex);
+    if(!streamer->worker_started)
+    {
+        for(uint32_t i = 0; i < streamer->request_number; i++)
+        {
+            streamer->requests[i].ktx2_image                  = ktx2_load(streamer->requests[i].stream->path);
+            streamer->completed[streamer->completed_number++] = streamer->requests[i];
+        }
+        streamer->request_number = 0;
+    }
+    completed_number = streamer->completed_number;
+    memcpy(completed, streamer->completed, completed_number * sizeof(*completed));
+    streamer->completed_number = 0;
+    pthread_mutex_unlock(&streamer->mutex);
+
+    for(uint32_t i = 0; i < completed_number; i++)
+    {
+        PStreamingLoad* load   = &completed[i];
+        PTextureStream* stream = load->stream;
+        streamer->pending_number--;
+
+        // The texture may have been removed, replaced or resized while its file was read
+        if(stream->orphaned || load->texture_index >= texture_list->texture_number || texture_list->textures[load->texture_index].stream != stream || stream->base_level != load->previous_base_level)
+        {
+            release_texture_load(load);
+            continue;
+        }
+
+        VkDeviceSize grown_size = stream->memory_size << (2 * (stream->base_level - load->base_level));
+        if(load->ktx2_image == NULL || memory_budget_exceeded(device, grown_size - stream->memory_size) || resize_streamed_texture(texture_list, &texture_list->textures[load->texture_index], load->base_level, load->ktx2_image, device) != PIGMENT_SUCCESS)
+        {
+            stream->requested_level = stream->base_level;
+        }
+        else
+        {
+            (*resizes)++;
+        }
+
+        release_texture_load(load);
+    }
+}
+
+void request_texture_loads(PTextureList* texture_list, PDevice* device)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+
+    PStreamingLoad requests[STREAMING_QUEUE_SIZE];
+    uint32_t request_number = 0;
+
+    for(uint32_t i = 0; i < texture_list->texture_number && streamer->pending_number < STREAMING_QUEUE_SIZE; i++)
+    {
+        PTextureStream* stream = texture_list->textures[i].stream;
+        if(stream == NULL || stream->loading || stream->requested_level >= stream->base_level)
+        {
+            continue;
+        }
+
+        // Each finer level roughly quadruples the size of the image
+        VkDeviceSize grown_size = stream->memory_size << (2 * (stream->base_level - stream->requested_level));
+        if(memory_budget_exceeded(device, grown_size - stream->memory_size))
+        {
+            continue;
+        }
+
+        stream->loading            = true;
+        requests[request_number++] = (PStreamingLoad) {
+            .stream              = stream,
+            .texture_index       = i,
+            .base_level          = stream->requested_level,
+            .previous_base_level = stream->base_level
+        };
+        streamer->pending_number++;
+    }
+
+    if(request_number == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&streamer->mutex);
+    memcpy(&streamer->requests[streamer->request_number], requests, request_number * sizeof(*requests));
+    streamer->request_number += request_number;
+    pthread_cond_signal(&streamer->condition);
+    pthread_mutex_unlock(&streamer->mutex);
+}
+
+int stage_texture_levels(PTextureStream* stream, const KTX2Image* ktx2_image, uint32_t first_level, uint32_t level_count, VkBuffer* staging_buffer, VkDeviceMemory* staging_buffer_memory, VkDeviceSize* level_offsets, PDevice* device)
+{
+    if(ktx2_image->level_count != stream->level_count || ktx2_image->width != stream->full_width || ktx2_image->height != stream->full_height)
+    {
+        fprintf(stderr, "Texture %s changed on disk, cannot stream its mip levels!\n", stream->path);
+        return PIGMENT_ERROR;
+    }
+
+    // Levels are stored largest first, the missing ones form a single contiguous range
+    uint64_t first_offset = ktx2_image->levels[first_level].offset;
+    uint64_t last_offset  = ktx2_image->levels[first_level + level_count - 1].offset + ktx2_image->levels[first_level + level_count - 1].size;
+    VkDeviceSize size     = last_offset - first_offset;
+
+    if(create_buffer(staging_buffer, staging_buffer_memory, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    void* staging_data;
+    vkMapMemory(device->logical_device, *staging_buffer_memory, 0, size, 0, &staging_data);
+    memcpy(staging_data, ktx2_image->data + first_offset, (size_t) size);
+    vkUnmapMemory(device->logical_device, *staging_buffer_memory);
+
+    for(uint32_t i = 0; i < level_count; i++)
+    {
+        level_offsets[i] = ktx2_image->levels[first_level + i].offset - first_offset;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+// The copies are recorded into the next frame, the previous image is retired once the frames reading it are done
+int resize_streamed_texture(PTextureList* texture_list, PTexture* texture, uint32_t base_level, const KTX2Image* ktx2_image, PDevice* device)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+    PTextureStream* stream     = texture->stream;
+    PTexture resized           = *texture;
+
+    VkBuffer staging_buffer              = VK_NULL_HANDLE;
+    VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
+    VkDeviceSize level_offsets[MAX_TEXTURE_MIP_LEVELS];
+
+    uint32_t loaded_levels = base_level < stream->base_level ? stream->base_level - base_level : 0;
+    uint32_t first_kept    = base_level > stream->base_level ? base_level : stream->base_level;
+
+    resized.width      = get_level_extent(stream->full_width, base_level);
+    resized.height     = get_level_extent(stream->full_height, base_level);
+    resized.mip_levels = stream->level_count - base_level;
+
+    if(loaded_levels > 0 && (ktx2_image == NULL || stage_texture_levels(stream, ktx2_image, base_level, loaded_levels, &staging_buffer, &staging_buffer_memory, level_offsets, device) != PIGMENT_SUCCESS))
+    {
+        return PIGMENT_ERROR;
+    }
+
+    if(reserve_array((void**) &streamer->transfers, &streamer->transfer_size, streamer->transfer_number + 1, sizeof(*streamer->transfers)) != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+
+    // The allocation may run the evictor, which must leave this texture alone
+    streamer->resizing = texture;
+    int result         = create_image(&resized.image, &resized.image_memory, resized.width, resized.height, resized.mip_levels, 1, resized.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device);
+    streamer->resizing = NULL;
+
+    if(result != PIGMENT_SUCCESS)
+    {
+        goto ERROR;
+    }
+
+    PStreamingTransfer transfer = {
+        .source_image           = texture->image,
+        .source_mip_levels      = texture->mip_levels,
+        .destination_image      = resized.image,
+        .destination_mip_levels = resized.mip_levels,
+        .staging_buffer         = staging_buffer,
+        .region_count           = loaded_levels
+    };
+
+    for(uint32_t i = 0; i < loaded_levels; i++)
+    {
+        transfer.regions[i] = (VkBufferImageCopy) {
+            .bufferOffset                    = level_offsets[i],
+            .bufferRowLength                 = 0,
+            .bufferImageHeight               = 0,
+            .imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .imageSubresource.mipLevel       = i,
+            .imageSubresource.baseArrayLayer = 0,
+            .imageSubresource.layerCount     = 1,
+            .imageOffset                     = {0, 0, 0},
+            .imageExtent                     = {get_level_extent(stream->full_width, base_level + i), get_level_extent(stream->full_height, base_level + i), 1}
+        };
+    }
+
+    // Levels already resident are copied on the GPU instead of being read from disk again
+    for(uint32_t level = first_kept; level < stream->level_count; level++)
+    {
+        transfer.copies[transfer.copy_count++] = (VkImageCopy) {
+            .srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .srcSubresource.mipLevel       = level - stream->base_level,
+            .srcSubresource.baseArrayLayer = 0,
+            .srcSubresource.layerCount     = 1,
+            .srcOffset                     = {0, 0, 0},
+            .dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .dstSubresource.mipLevel       = level - base_level,
+            .dstSubresource.baseArrayLayer = 0,
+            .dstSubresource.layerCount     = 1,
+            .dstOffset                     = {0, 0, 0},
+            .extent                        = {get_level_extent(stream->full_width, level), get_level_extent(stream->full_height, level), 1}
+        };
+    }
+
+    resized.image_view = create_texture_view(resized.image, resized.format, resized.mip_levels, 1, device->logical_device);
+    if(resized.image_view == NULL || publish_texture(texture_list, &resized, device) != PIGMENT_SUCCESS || retire_texture(texture_list, texture, UINT32_MAX) != PIGMENT_SUCCESS)
+    {
+        vkDestroyImageView(device->logical_device, resized.image_view, NULL);
+        vkDestroyImage(device->logical_device, resized.image, NULL);
+        free_device_memory(resized.image_memory, device);
+        goto ERROR;
+    }
+
+    // No table points to the new descriptor before the frame that records the copies
+    streamer->transfers[streamer->transfer_number++] = transfer;
+    defer_destroy_buffer(staging_buffer, device);
+    defer_free_memory(staging_buffer_memory, device);
+
+    stream->memory_size = get_image_memory_size(resized.image, device->logical_device);
+    stream->base_level  = base_level;
+
+    resized.pending_table_frames = (1u << texture_list->frame_count) - 1u;
+    *texture                     = resized;
+
+    return PIGMENT_SUCCESS;
+
+ERROR:
+    vkDestroyBuffer(device->logical_device, staging_buffer, NULL);
+    free_device_memory(staging_buffer_memory, device);
+    return PIGMENT_ERROR;
+}
+
+void record_texture_transfers(VkCommandBuffer command_buffer, PTextureList* texture_list)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+    if(streamer == NULL)
+    {
+        return;
+    }
+
+    // Transfers are recorded in the order they were made, a texture resized twice copies from its intermediate image
+    for(uint32_t i = 0; i < streamer->transfer_number; i++)
+    {
+        const PStreamingTransfer* transfer = &streamer->transfers[i];
+
+        VkImageMemoryBarrier barriers[2] = {
+            {
+                .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask                   = VK_ACCESS_SHADER_READ_BIT,
+                .dstAccessMask                   = VK_ACCESS_TRANSFER_READ_BIT,
+                .oldLayout                       = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+                .image                           = transfer->source_image,
+                .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .subresourceRange.baseMipLevel   = 0,
+                .subresourceRange.levelCount     = transfer->source_mip_levels,
+                .subresourceRange.baseArrayLayer = 0,
+                .subresourceRange.layerCount     = 1
+            },
+            {
+                .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask                   = 0,
+                .dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+                .image                           = transfer->destination_image,
+                .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .subresourceRange.baseMipLevel   = 0,
+                .subresourceRange.levelCount     = transfer->destination_mip_levels,
+                .subresourceRange.baseArrayLayer = 0,
+                .subresourceRange.layerCount     = 1
+            }
+        };
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 2, barriers);
+
+        if(transfer->region_count > 0)
+        {
+            vkCmdCopyBufferToImage(command_buffer, transfer->staging_buffer, transfer->destination_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, transfer->region_count, transfer->regions);
+        }
+        vkCmdCopyImage(command_buffer, transfer->source_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, transfer->destination_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, transfer->copy_count, transfer->copies);
+
+        // The previous image goes back to its sampled layout, frames still in flight keep reading it
+        barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[0].oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[1].oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 2, barriers);
+    }
+
+    streamer->transfer_number = 0;
+}
+
+PTexture* find_eviction_victim(PTextureList* texture_list, uint64_t min_age)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+
+    PTexture* victim = NULL;
+    for(uint32_t i = 0; i < texture_list->texture_number; i++)
+    {
+        PTextureStream* stream = texture_list->textures[i].stream;
+        if(stream == NULL || &texture_list->textures[i] == streamer->resizing || stream->base_level >= stream->level_count - STREAMING_RESIDENT_LEVELS || texture_list->frame - stream->last_request_frame < min_age)
+        {
+            continue;
+        }
+
+        if(victim == NULL || stream->last_request_frame < victim->stream->last_request_frame)
+        {
+            victim = &texture_list->textures[i];
+        }
+    }
+
+    return victim;
+}
+
+// The smaller images are copied by the next frame, the previous ones are released once the frames in flight are done with them
+uint64_t evict_streamed_textures(void* context, uint64_t size, bool out_of_memory, PDevice* device)
+{
+    PTextureList* texture_list = context;
+
+    // Descriptor sets are only known once the first frame went through the texture list
+    if(texture_list->descriptor == NULL)
+    {
+        return 0;
+    }
+
+    // The smaller images could not be allocated, and the larger ones would only be released after the retry
+    if(out_of_memory)
+    {
+        return 0;
+    }
+
+    uint64_t released = 0;
+    while(released < size)
+    {
+        PTexture* victim = find_eviction_victim(texture_list, 0);
+        if(victim == NULL)
+        {
+            break;
+        }
+
+        VkDeviceSize memory_size = victim->stream->memory_size;
+        uint32_t base_level      = victim->stream->level_count - STREAMING_RESIDENT_LEVELS;
+        if(resize_streamed_texture(texture_list, victim, base_level, NULL, device) != PIGMENT_SUCCESS)
+        {
+            break;
+        }
+        victim->stream->requested_level = base_level;
+
+        released += memory_size - victim->stream->memory_size;
+    }
+
+    return released;
+}
+
+void destroy_texture_streamer(PTextureList* texture_list, PDevice* device)
+{
+    PTextureStreamer* streamer = texture_list->streamer;
+    if(streamer == NULL)
+    {
+        return;
+    }
+
+    unregister_memory_evictor(device, texture_list);
+
+    if(streamer->worker_started)
+    {
+        pthread_mutex_lock(&streamer->mutex);
+        streamer->stopping = true;
+        pthread_cond_signal(&streamer->condition);
+        pthread_mutex_unlock(&streamer->mutex);
+        pthread_join(streamer->worker, NULL);
+    }
+    pthread_mutex_destroy(&streamer->mutex);
+    pthread_cond_destroy(&streamer->condition);
+
+    for(uint32_t i = 0; i < streamer->request_number; i++)
+    {
+        release_texture_load(&streamer->requests[i]);
+    }
+    for(uint32_t i = 0; i < streamer->completed_number; i++)
+    {
+        release_texture_load(&streamer->completed[i]);
+    }
+
+    for(uint32_t i = 0; streamer->feedback_buffers != NULL && i < streamer->frame_count; i++)
+    {
+        if(streamer->feedback_buffers_mapped != NULL && streamer->feedback_buffers_mapped[i] != NULL)
+        {
+            vkUnmapMemory(device->logical_device, streamer->feedback_buffers_memory[i]);
+        }
+        vkDestroyBuffer(device->logical_device, streamer->feedback_buffers[i], NULL);
+        if(streamer->feedback_buffers_memory != NULL)
+        {
+            free_device_memory(streamer->feedback_buffers_memory[i], device);
+        }
+    }
+
+    free(streamer->feedback_buffers);
+    free(streamer->feedback_buffers_memory);
+    free(streamer->feedback_buffers_mapped);
+    free(streamer->transfers);
+    free(streamer);
+
+    texture_list->streamer = NULL;
+}
@@ -0,0 +1,31 @@
+/**
+ * Copyright 2025 Angel-Leduc TA
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STREAMING_H
+#define STREAMING_H
+#define STREAMING_RESIDENT_LEVELS 4
+#define STREAMING_FEEDBACK_LOD_BIAS 16
+#define STREAMING_RESIZES_PER_FRAME 2
+#define STREAMING_QUEUE_SIZE 8
+#define STREAMING_EVICTION_DELAY 240
+
+#include "defines.h"
+
+void enable_texture_streaming(PTextureList* texture_list, PDevice* device);
+int create_texture_streamer(PTextureList* texture_list, PDevice* device, uint32_t frame_count);
+void update_texture_streaming(PTextureList* texture_list, PDevice* device, uint32_t frame);
+void destroy_texture_streamer(PTextureList* texture_list, PDevice* device);
+#endif
@@ -19,8 +19,21 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <pthread.h>
 
 #include "defines.h"
+#include "memory_tracker.h"
+#include "descriptor.h"
+#include "depth_pyramid.h"
+#include "commands.h"
+#include "pipeline.h"
+#include "chunks.h"
+#include "mipmaps.h"
+#include "streaming.h"
+#include "texture.h"
+
+#include "lib/ktx2.h"
+#include "lib/hashmap.h"
 
 struct Pigment_T {
     PWindow* window;
@@ -38,6 +51,9 @@ struct Pigment_T {
     PBuffers* buffers;
     PCamera* camera;
     PModel* model;
+    PInstancing* instancing;
+    PCulling* culling;
+    PChunks* chunks;
     PVertexDescription* vertex_description;
     uint32_t max_frames_in_flight;
 };
@@ -46,6 +62,8 @@ struct PWindow_T {
     PWindowInfo* info;
     GLFWwindow* window;
     bool framebuffer_resized;
+    bool swapchain_out_of_date;
+    double resize_time;
     PCamera* camera;
     float last_frame_time;
     float mouse_last_x;
@@ -76,6 +94,60 @@ struct PDevice_T {
     VkQueue graphics_queue;
     VkQueue present_queue;
     ExtensionList* extensions;
+    bool direct_buffer_upload;
+    bool storage_image_dynamic_indexing;
+    bool texture_compression_bc;
+    bool fragment_stores_and_atomics;
+    bool memory_budget;
+    bool draw_indirect_count;
+    bool multi_draw_indirect;
+    bool pipeline_statistics;
+    uint32_t max_bindless_textures;
+    PMemoryTracker* memory_tracker;
+    PDeletionQueue* deletion_queue;
+};
+
+struct PDeferredResource_T {
+    uint32_t type;
+    union {
+        VkBuffer buffer;
+        VkImage image;
+        VkImageView image_view;
+        VkFramebuffer framebuffer;
+        VkDescriptorSet descriptor_set;
+        VkDeviceMemory memory;
+        VkSemaphore semaphore;
+        VkSwapchainKHR swapchain;
+    };
+    VkDescriptorPool descriptor_pool;
+    uint64_t frame;
+};
+
+struct PDeletionQueue_T {
+    PDeferredResource* resources;
+    uint32_t resource_number;
+    uint32_t resource_size;
+    uint64_t frame;
+    uint32_t frame_count;
+};
+
+struct PMemoryAllocation_T {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    MemoryCategory category;
+    uint32_t heap_index;
+};
+
+struct PMemoryTracker_T {
+    PMemoryAllocation* allocations;
+    uint32_t allocation_number;
+    uint32_t allocation_size;
+    VkDeviceSize category_usage[MEMORY_CATEGORY_COUNT];
+    VkDeviceSize heap_usage[VK_MAX_MEMORY_HEAPS];
+    PMemoryEvictor evictors[MAX_MEMORY_EVICTORS];
+    void* evictor_contexts[MAX_MEMORY_EVICTORS];
+    uint32_t evictor_number;
+    bool evicting;
 };
 
 struct QueueFamilyIndices_T {
@@ -115,22 +187,38 @@ struct PSwapchain_T {
 };
 
 struct PPipeline_T {
-    VkPipeline graphic_pipeline;
+    VkPipeline graphic_pipelines[MATERIAL_COUNT];
+    VkPipeline depth_prepass_pipelines[MATERIAL_COUNT];
+    VkPipelineLayout pipeline_layout;
+};
+
+struct PMipmapGenerator_T {
+    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorPool descriptor_pool;
     VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    VkDescriptorSet descriptor_sets[MIPMAP_BATCH_SIZE];
+    VkBuffer counter_buffer;
+    VkDeviceMemory counter_buffer_memory;
 };
 
 struct PRenderPass_T {
     VkRenderPass render_pass;
+    VkRenderPass late_render_pass;
 };
 
 struct PCommands_T {
     VkCommandPool command_pool;
     VkCommandBuffer* command_buffers;
+    VkQueryPool statistics_pool;
+    uint32_t* recorded_statistics;
+    uint64_t fragment_invocations[RENDER_STATISTIC_COUNT];
 };
 
 struct PSync_T {
     VkSemaphore* image_available_semaphores;
     VkSemaphore* render_finished_semaphores;
+    uint32_t render_finished_number;
     VkFence* in_flight_fences;
 };
 
@@ -141,34 +229,184 @@ struct PVertexDescription_T {
 };
 
 struct PBuffers_T {
-    VkBuffer vertex_buffer;
-    VkBuffer index_buffer;
-    VkBuffer* uniform_buffers;
-    VkDeviceMemory vertex_buffer_memory;
-    VkDeviceMemory index_buffer_memory;
-    VkDeviceMemory* uniform_buffers_memory;
-    uint32_t vertices_size;
-    uint32_t indices_size;
-    void** uniform_buffers_mapped;
+    PGeometryPool* geometry_pool;
+    uint32_t static_geometry;
+    uint32_t* mesh_geometries;
+    VkBuffer uniform_buffer;
+    VkDeviceMemory uniform_buffer_memory;
+    void* uniform_buffer_mapped;
+    VkDeviceSize uniform_alignment;
+    VkDeviceSize uniform_arena_size;
+    VkDeviceSize uniform_arena_start;
+    VkDeviceSize uniform_arena_used;
+    uint32_t uniform_offset;
+    vec4 frustum_planes[6];
+    vec3 camera_position;
+    float lod_scale;
+    mat4 model_matrix;
+    PMesh* meshes;
+    uint32_t mesh_number;
+    uint32_t mesh_capacity;
+    uint32_t* free_meshes;
+    uint32_t free_mesh_number;
+    uint32_t free_mesh_size;
+    PMeshlet* meshlets;
+    uint32_t meshlet_number;
+    uint32_t opaque_meshlet_number;
+    VkBuffer* meshlet_draw_buffers;
+    VkDeviceMemory* meshlet_draw_buffers_memory;
+    void** meshlet_draw_buffers_mapped;
+    uint32_t meshlet_draw_counts[MATERIAL_COUNT];
+    bool multi_draw_indirect;
 };
 
 struct PDescriptor_T {
-    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorSetLayout set_layouts[DESCRIPTOR_SET_COUNT];
     VkDescriptorPool descriptor_pool;
-    VkDescriptorSet* descriptor_sets;
+    VkDescriptorSet texture_set;
+    VkDescriptorSet* frame_sets;
+    bool texture_feedback;
+    bool gpu_culling;
 };
 
 struct PTexture_T {
     VkImage image;
     VkImageView image_view;
     VkDeviceMemory image_memory;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
     uint32_t mip_levels;
+    uint32_t layer_count;
+    uint32_t descriptor_index;
+    uint32_t pending_table_frames;
+    bool mipmaps_pending;
+    bool alpha_tested;
+    PTextureStream* stream;
+};
+
+struct PTextureContent_T {
+    struct {
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mip_levels;
+        uint32_t level_count;
+        uint32_t mipmaps_pending;
+    } shape;
+    uint64_t hash;
+    VkDeviceSize size;
+    char* path;
+    uint32_t texture_index;
+};
+
+struct PTextureContents_T {
+    PTextureContent* contents;
+    uint32_t content_number;
+    uint32_t content_size;
+    ContentHashMap* content_indices;
+    PTextureContent pending;
+    uint32_t shared_texture;
 };
 
 struct PTextureList_T {
     PTexture* textures;
     uint32_t texture_number;
     uint32_t texture_size;
+    PTextureSlot* slots;
+    uint32_t slot_number;
+    uint32_t slot_size;
+    uint32_t* free_slots;
+    uint32_t free_slot_number;
+    uint32_t free_slot_size;
+    bool stream_mips;
+    char* cooked_texture_directory;
+    PTextureStreamer* streamer;
+    PMipmapGenerator* mipmap_generator;
+    bool blit_mipmaps;
+    PTextureContents* contents;
+    uint32_t* free_indices;
+    uint32_t free_index_number;
+    uint32_t free_index_size;
+    uint32_t* free_descriptor_indices;
+    uint32_t free_descriptor_index_number;
+    uint32_t free_descriptor_index_size;
+    uint32_t descriptor_index_number;
+    VkBuffer* table_buffers;
+    VkDeviceMemory* table_buffers_memory;
+    uint32_t** table_buffers_mapped;
+    PRetiredTexture* retired_textures;
+    uint32_t retired_number;
+    uint32_t retired_size;
+    uint32_t frame_count;
+    uint64_t frame;
+    PDescriptor* descriptor;
+};
+
+struct PRetiredTexture_T {
+    PTexture texture;
+    uint64_t frame;
+    uint32_t free_index;
+};
+
+struct PTextureSlot_T {
+    uint32_t texture_index;
+    uint32_t layer;
+};
+
+struct PTextureStream_T {
+    char* path;
+    uint32_t base_level;
+    uint32_t level_count;
+    uint32_t full_width;
+    uint32_t full_height;
+    uint32_t requested_level;
+    uint64_t last_request_frame;
+    VkDeviceSize memory_size;
+    bool loading;
+    bool orphaned;
+};
+
+struct PStreamingLoad_T {
+    PTextureStream* stream;
+    uint32_t texture_index;
+    uint32_t base_level;
+    uint32_t previous_base_level;
+    KTX2Image* ktx2_image;
+};
+
+struct PStreamingTransfer_T {
+    VkImage source_image;
+    uint32_t source_mip_levels;
+    VkImage destination_image;
+    uint32_t destination_mip_levels;
+    VkBuffer staging_buffer;
+    VkBufferImageCopy regions[MAX_TEXTURE_MIP_LEVELS];
+    uint32_t region_count;
+    VkImageCopy copies[MAX_TEXTURE_MIP_LEVELS];
+    uint32_t copy_count;
+};
+
+struct PTextureStreamer_T {
+    VkBuffer* feedback_buffers;
+    VkDeviceMemory* feedback_buffers_memory;
+    uint32_t** feedback_buffers_mapped;
+    uint32_t feedback_size;
+    uint32_t frame_count;
+    PTexture* resizing;
+    PStreamingLoad requests[STREAMING_QUEUE_SIZE];
+    uint32_t request_number;
+    PStreamingLoad completed[STREAMING_QUEUE_SIZE];
+    uint32_t completed_number;
+    uint32_t pending_number;
+    PStreamingTransfer* transfers;
+    uint32_t transfer_number;
+    uint32_t transfer_size;
+    pthread_t worker;
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    bool worker_started;
+    bool stopping;
 };
 
 struct PSampler_T {
@@ -188,6 +426,223 @@ struct PModel_T {
     uint32_t* indices;
     uint32_t indices_number;
     uint32_t indices_size;
+    uint32_t opaque_indices_number;
+    Vertex* mesh_vertices;
+    uint32_t mesh_vertices_number;
+    uint32_t mesh_vertices_size;
+    uint32_t* mesh_indices;
+    uint32_t mesh_indices_number;
+    uint32_t mesh_indices_size;
+    PMesh* meshes;
+    uint32_t mesh_number;
+    uint32_t mesh_size;
+};
+
+struct PMeshLod_T {
+    uint32_t first_index;
+    uint32_t index_count;
+    float error;
+};
+
+struct PMesh_T {
+    PMeshLod lods[MAX_MESH_LODS];
+    uint32_t lod_count;
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+    vec4 bounds;
+};
+
+struct PMeshlet_T {
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t material;
+    vec4 bounds;
+    vec4 cone;
+};
+
+struct PCulling_T {
+    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet* descriptor_sets;
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    VkBuffer mesh_buffer;
+    VkDeviceMemory mesh_buffer_memory;
+    void* mesh_buffer_mapped;
+    VkBuffer meshlet_buffer;
+    VkDeviceMemory meshlet_buffer_memory;
+    void* meshlet_buffer_mapped;
+    VkBuffer* meshlet_visibility_buffers;
+    VkDeviceMemory* meshlet_visibility_buffers_memory;
+    VkBuffer* chunk_buffers;
+    VkDeviceMemory* chunk_buffers_memory;
+    void** chunk_buffers_mapped;
+    VkBuffer* batch_buffers;
+    VkDeviceMemory* batch_buffers_memory;
+    VkBuffer* draw_buffers;
+    VkDeviceMemory* draw_buffers_memory;
+    PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count;
+    PDepthPyramid* depth_pyramid;
+    uint32_t reset_visibility;
+    uint32_t reset_meshlet_visibility;
+    uint32_t resized_pyramid_frames;
+    uint32_t* pending_meshes;
+    uint32_t pending_mesh_number;
+    uint32_t pending_mesh_size;
+    uint32_t mesh_number;
+    uint32_t meshlet_number;
+    uint32_t opaque_meshlet_number;
+    uint32_t chunk_number;
+    uint32_t chunk_entry_number;
+    uint32_t meshlet_draw_capacity;
+    uint32_t frame_count;
+};
+
+struct PDepthPyramid_T {
+    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet descriptor_sets[MAX_DEPTH_PYRAMID_LEVELS];
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    VkSampler sampler;
+    VkImage image;
+    VkDeviceMemory image_memory;
+    VkImageView image_view;
+    VkImageView level_views[MAX_DEPTH_PYRAMID_LEVELS];
+    VkImage depth_image;
+    VkImageAspectFlags depth_aspect;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+};
+
+struct PInstanceBuffer_T {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    InstanceData* mapped;
+    VkBuffer visible_buffer;
+    VkDeviceMemory visible_memory;
+    VkBuffer visibility_buffer;
+    VkDeviceMemory visibility_memory;
+    uint32_t capacity;
+};
+
+struct PInstancing_T {
+    InstanceData* instances;
+    uint32_t instance_number;
+    uint32_t instance_size;
+    uint32_t* free_instances;
+    uint32_t free_instance_number;
+    uint32_t free_instance_size;
+    uint32_t* instance_lods;
+    uint32_t* batch_offsets;
+    uint32_t* batch_counts;
+    uint32_t mesh_number;
+    uint32_t packed_number;
+    PInstanceBuffer* frame_buffers;
+    uint32_t pending_frames;
+    uint32_t resized_frames;
+    uint32_t frame_count;
+    bool gpu_culling;
+};
+
+struct PGeometryRange_T {
+    uint32_t offset;
+    uint32_t count;
+};
+
+struct PGeometryFreeList_T {
+    PGeometryRange* ranges;
+    uint32_t range_number;
+    uint32_t range_size;
+    uint32_t capacity;
+    uint32_t free_count;
+};
+
+struct PGeometryAllocation_T {
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+    bool live;
+    bool movable;
+    bool uploaded;
+};
+
+struct PGeometryUpload_T {
+    uint32_t allocation;
+    void* data;
+};
+
+struct PRetiredGeometry_T {
+    PGeometryRange vertices;
+    PGeometryRange indices;
+    uint64_t frame;
+};
+
+struct PGeometryPool_T {
+    VkBuffer vertex_buffer;
+    VkDeviceMemory vertex_buffer_memory;
+    void* vertex_buffer_mapped;
+    VkBuffer index_buffer;
+    VkDeviceMemory index_buffer_memory;
+    void* index_buffer_mapped;
+    PGeometryFreeList vertex_space;
+    PGeometryFreeList index_space;
+    PGeometryAllocation* allocations;
+    uint32_t allocation_number;
+    uint32_t allocation_size;
+    uint32_t* free_allocations;
+    uint32_t free_allocation_number;
+    uint32_t free_allocation_size;
+    PGeometryUpload* uploads;
+    uint32_t upload_number;
+    uint32_t upload_size;
+    PRetiredGeometry* retired;
+    uint32_t retired_number;
+    uint32_t retired_size;
+    VkBuffer* staging_buffers;
+    VkDeviceMemory* staging_buffers_memory;
+    void** staging_buffers_mapped;
+    VkBufferCopy* vertex_copies;
+    VkBufferCopy* index_copies;
+    uint32_t copy_size;
+    uint32_t frame_count;
+    uint64_t frame;
+};
+
+struct PChunk_T {
+    vec4 bounds;
+    long file_offset;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t opaque_index_count;
+    uint32_t geometry;
+    uint32_t state;
+    void* data;
+};
+
+struct PChunks_T {
+    PChunk* chunks;
+    uint32_t chunk_number;
+    FILE* file;
+    float radius;
+    uint32_t* visible_chunks;
+    uint32_t visible_chunk_number;
+    ChunkCandidate* candidates;
+    float* distances;
+    uint32_t pending_number;
+    ChunkCandidate requests[CHUNK_QUEUE_SIZE];
+    uint32_t request_number;
+    uint32_t* completed;
+    uint32_t completed_number;
+    vec3 last_position;
+    bool has_position;
+    pthread_t worker;
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    bool worker_started;
+    bool stopping;
 };
 
 struct PCamera_T {
@@ -198,6 +653,10 @@ struct PCamera_T {
     float roll;
     float pitch;
     float yaw;
+    float fov;
+    float projection_fov;
+    float projection_aspect;
+    mat4 projection;
 };
 
 #endif
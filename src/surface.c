@@ -20,6 +20,9 @@
 #include "lib/math.h"
 
 extern void destroy_depth_resources(PSwapchain* swapchain, PDevice* device);
+extern void defer_destroy_image_view(VkImageView image_view, PDevice* device);
+extern void defer_destroy_framebuffer(VkFramebuffer framebuffer, PDevice* device);
+extern void defer_destroy_swapchain(VkSwapchainKHR swapchain, PDevice* device);
 extern QueueFamilyIndices* find_queue_families(VkPhysicalDevice device, VkSurfaceKHR surface);
 
 void destroy_image_views(PSwapchain* swapchain, PDevice* device);
@@ -146,7 +149,7 @@ VkExtent2D choose_swap_extent(const VkSurfaceCapabilitiesKHR capabilities, GLFWw
     return actual_extent;
 }
 
-PSwapchain* create_swapchain(PDevice* device, PSurface* surface, PWindow* window)
+PSwapchain* create_swapchain(PDevice* device, PSurface* surface, PWindow* window, PSwapchain* previous_swapchain)
 {
     PSwapchain* swapchain = NULL;
     QueueFamilyIndices* indices = NULL;
@@ -210,7 +213,8 @@ PSwapchain* create_swapchain(PDevice* device, PSurface* surface, PWindow* window
     create_info.presentMode    = present_mode;
     create_info.clipped        = VK_TRUE;
 
-    create_info.oldSwapchain = VK_NULL_HANDLE;
+    // The previous swapchain is retired, images it already handed out can still be presented
+    create_info.oldSwapchain = previous_swapchain != NULL ? previous_swapchain->swapchain : VK_NULL_HANDLE;
 
     if(vkCreateSwapchainKHR(device->logical_device, &create_info, NULL, &(swapchain->swapchain)) != VK_SUCCESS)
     {
@@ -257,7 +261,7 @@ void destroy_swapchain(PSwapchain* swapchain, PDevice* device)
         destroy_depth_resources(swapchain, device);
         destroy_framebuffers(swapchain, device);
         destroy_image_views(swapchain, device);
-        vkDestroySwapchainKHR(device->logical_device, swapchain->swapchain, NULL);
+        defer_destroy_swapchain(swapchain->swapchain, device);
         free(swapchain);
     }
 }
@@ -313,7 +317,7 @@ void destroy_image_views(PSwapchain* swapchain, PDevice* device)
     }
     for(size_t i = 0; i < swapchain->image_count; i++)
     {
-        vkDestroyImageView(device->logical_device, swapchain->image_views[i], NULL);
+        defer_destroy_image_view(swapchain->image_views[i], device);
     }
 
     free(swapchain->image_views);
@@ -367,13 +371,13 @@ void destroy_framebuffers(PSwapchain* swapchain, PDevice* device)
     }
     for(size_t i = 0; i < swapchain->image_count; i++)
     {
-        vkDestroyFramebuffer(device->logical_device, swapchain->framebuffers[i], NULL);
+        defer_destroy_framebuffer(swapchain->framebuffers[i], device);
     }
 
     free(swapchain->framebuffers);
 }
 
-PSwapchain* recreate_swapchain(PSwapchain* previous_swapchain, PCommands* commands, PDevice* device, PSurface* surface, PWindow* window, PRenderPass* render_pass)
+PSwapchain* recreate_swapchain(PSwapchain* previous_swapchain, PDevice* device, PSurface* surface, PWindow* window, PRenderPass* render_pass)
 {
     PSwapchain* swapchain;
 
@@ -385,11 +389,13 @@ PSwapchain* recreate_swapchain(PSwapchain* previous_swapchain, PCommands* comman
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(device->logical_device);
-
+    // Frames in flight keep drawing to the previous images, which are destroyed once their fences have been waited on
+    swapchain = create_swapchain(device, surface, window, previous_swapchain);
+    if(swapchain != NULL && previous_swapchain != NULL)
+    {
+        swapchain->current_frame = previous_swapchain->current_frame;
+    }
     destroy_swapchain(previous_swapchain, device);
-
-    swapchain = create_swapchain(device, surface, window);
     if(swapchain == NULL)
     {
         goto ERROR;
@@ -398,7 +404,7 @@ PSwapchain* recreate_swapchain(PSwapchain* previous_swapchain, PCommands* comman
     {
         goto ERROR;
     }
-    if(create_depth_resources(swapchain, commands, device) != PIGMENT_SUCCESS)
+    if(create_depth_resources(swapchain, device) != PIGMENT_SUCCESS)
     {
         goto ERROR;
     }
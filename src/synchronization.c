@@ -18,6 +18,7 @@
 #include "structs.h"
 VkSemaphore create_semaphore(VkDevice device);
 VkFence create_fence(VkDevice device);
+void defer_destroy_semaphore(VkSemaphore semaphore, PDevice* device);
 
 PSync* create_sync(PDevice* device, const uint32_t max_frame, const uint32_t swapchain_image_count)
 {
@@ -69,6 +70,7 @@ PSync* create_sync(PDevice* device, const uint32_t max_frame, const uint32_t swa
             goto ERROR;
         }
     }
+    sync->render_finished_number = swapchain_image_count;
 
     return sync;
 
@@ -83,9 +85,9 @@ ERROR:
     }
     return NULL;
 }
-void destroy_sync(PSync* sync, PDevice* device, PSwapchain* swapchain, const uint32_t max_frame)
+void destroy_sync(PSync* sync, PDevice* device, const uint32_t max_frame)
 {
-    if(sync == NULL || swapchain == NULL)
+    if(sync == NULL)
     {
         return;
     }
@@ -96,7 +98,7 @@ void destroy_sync(PSync* sync, PDevice* device, PSwapchain* swapchain, const uin
         vkDestroyFence(device->logical_device, sync->in_flight_fences[i], NULL);
     }
 
-    for(size_t i = 0; i < swapchain->image_count; i++)
+    for(size_t i = 0; i < sync->render_finished_number; i++)
     {
         vkDestroySemaphore(device->logical_device, sync->render_finished_semaphores[i], NULL);
     }
@@ -107,6 +109,41 @@ void destroy_sync(PSync* sync, PDevice* device, PSwapchain* swapchain, const uin
     free(sync);
 }
 
+// The previous semaphores may still be waited on by presentations of the previous swapchain
+int replace_render_semaphores(PSync* sync, PDevice* device, const uint32_t swapchain_image_count)
+{
+    VkSemaphore* render_finished_semaphores = malloc(swapchain_image_count * sizeof(*render_finished_semaphores));
+    if(render_finished_semaphores == NULL)
+    {
+        perror("replace_render_semaphores");
+        return PIGMENT_ERROR;
+    }
+
+    for(size_t i = 0; i < swapchain_image_count; i++)
+    {
+        render_finished_semaphores[i] = create_semaphore(device->logical_device);
+        if(render_finished_semaphores[i] == NULL)
+        {
+            for(size_t j = 0; j < i; j++)
+            {
+                vkDestroySemaphore(device->logical_device, render_finished_semaphores[j], NULL);
+            }
+            free(render_finished_semaphores);
+            return PIGMENT_ERROR;
+        }
+    }
+
+    for(size_t i = 0; i < sync->render_finished_number; i++)
+    {
+        defer_destroy_semaphore(sync->render_finished_semaphores[i], device);
+    }
+    free(sync->render_finished_semaphores);
+    sync->render_finished_semaphores = render_finished_semaphores;
+    sync->render_finished_number     = swapchain_image_count;
+
+    return PIGMENT_SUCCESS;
+}
+
 VkSemaphore create_semaphore(VkDevice device)
 {
     VkSemaphore semaphore;
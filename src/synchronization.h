@@ -20,6 +20,7 @@
 #include "defines.h"
 
 PSync* create_sync(PDevice* device, const uint32_t max_frame, const uint32_t swapchain_image_count);
-void destroy_sync(PSync* sync, PDevice* device, PSwapchain* swapchain, const uint32_t max_frame);
+void destroy_sync(PSync* sync, PDevice* device, const uint32_t max_frame);
+int replace_render_semaphores(PSync* sync, PDevice* device, const uint32_t swapchain_image_count);
 
 #endif
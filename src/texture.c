@@ -16,23 +16,54 @@
 
 #include "texture.h"
 #include "structs.h"
+#include "streaming.h"
+#include "mipmaps.h"
 
+#include "lib/array.h"
+#include "lib/cooker.h"
+#include "lib/hashmap.h"
+#include "lib/ktx2.h"
 #include "lib/math.h"
 #include "lib/stb_image.h"
 
 extern int create_buffer(VkBuffer* buffer, VkDeviceMemory* buffer_memory, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
 extern VkCommandBuffer start_single_usage_commands(VkCommandPool command_pool, PDevice* device);
 extern void end_single_usage_commands(VkCommandBuffer* command_buffer, VkCommandPool command_pool, PDevice* device);
-extern VkImageView create_image_view(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels, VkDevice device);
-extern uint32_t find_memory_type(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties);
-
-int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device);
-int create_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PCommands* commands, PDevice* device);
-void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkCommandPool command_pool, PDevice* device);
+extern int allocate_device_memory(const VkMemoryRequirements* memory_requirements, VkMemoryPropertyFlags properties, MemoryCategory category, VkDeviceMemory* memory, PDevice* device);
+extern void free_device_memory(VkDeviceMemory memory, PDevice* device);
+extern MemoryCategory get_image_memory_category(VkImageUsageFlags usage);
+extern bool use_compute_mipmaps(PDevice* device, VkFormat format, uint32_t mip_levels);
+extern VkDeviceSize get_image_memory_size(VkImage image, VkDevice device);
+extern bool is_opaque(const unsigned char* rgba, uint32_t width, uint32_t height);
+
+int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t array_layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkMemoryPropertyFlags properties, PDevice* device);
+VkImageView create_texture_view(VkImage image, VkFormat format, uint32_t mip_levels, uint32_t layer_count, VkDevice device);
+int create_texture(PTexture* texture, const char* texture_path, PTextureList* texture_list, PCommands* commands, PDevice* device);
+int create_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, PCommands* commands, PDevice* device);
+int create_ktx2_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, PCommands* commands, PDevice* device);
+int create_cooked_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, PCommands* commands, PDevice* device);
+PTextureStream* create_texture_stream(const char* texture_path, const KTX2Image* ktx2_image);
+void destroy_texture_stream(PTextureStream* stream);
+int upload_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, const void* data, VkDeviceSize data_size, const VkDeviceSize* level_offsets, uint32_t level_count, PCommands* commands, PDevice* device);
+int retire_texture(PTextureList* texture_list, const PTexture* texture, uint32_t free_index);
+void release_retired_textures(PTextureList* texture_list, PDevice* device, bool release_all);
+void write_texture_descriptor(VkDescriptorSet descriptor_set, uint32_t descriptor_index, VkImageView image_view, VkDevice device);
+void destroy_texture_table(PTextureList* texture_list, PDevice* device);
+int publish_texture(PTextureList* texture_list, PTexture* texture, PDevice* device);
+uint32_t get_texture_number(const PTextureList* texture_list);
+int enable_texture_sharing(PTextureList* texture_list);
+void disable_texture_sharing(PTextureList* texture_list);
+uint32_t get_shared_texture(const PTextureList* texture_list);
+bool share_texture_content(PTextureContents* contents, const PTexture* texture, const char* texture_path, const void* data, VkDeviceSize data_size, uint32_t level_count);
+bool same_texture_content(const PTextureContent* content, const void* data);
+void get_texture_slot(const PTextureList* texture_list, uint32_t slot, uint32_t* texture_index, uint32_t* layer);
+bool same_texture_layout(const PTexture* texture, const PTexture* other);
+bool is_texture_alpha_tested(const PTextureList* texture_list, uint32_t texture_index);
+int create_texture_array(PTexture* texture_array, const PTexture* textures, const uint32_t* members, uint32_t member_number, PCommands* commands, PDevice* device);
+void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, const VkDeviceSize* level_offsets, uint32_t level_count, VkCommandPool command_pool, PDevice* device);
 int create_sampler(PSampler* sampler, FilteringMode filtering_mode, PDevice* device);
 bool has_stencil_component(VkFormat format);
 int transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels, VkCommandPool command_pool, PDevice* device);
-int generate_mipmaps(VkImage image, VkFormat image_format, int32_t texture_width, int32_t texture_height, uint32_t mip_levels, VkCommandPool command_pool, PDevice* device);
 
 void texture_list_append(PTextureList* texture_list, PTexture texture)
 {
@@ -50,7 +81,7 @@ void texture_list_append(PTextureList* texture_list, PTexture texture)
     texture_list->texture_number++;
 }
 
-PTextureList* create_textures(void)
+PTextureList* create_textures(uint32_t frame_count)
 {
     PTextureList* texture_list = calloc(1, sizeof(*texture_list));
     if(texture_list == NULL)
@@ -65,6 +96,7 @@ PTextureList* create_textures(void)
     }
 
     texture_list->texture_size = 1;
+    texture_list->frame_count  = frame_count;
 
     return texture_list;
 
@@ -74,29 +106,432 @@ ERROR:
     return NULL;
 }
 
+// Cooking is lossy and writes a cache, it only happens when the application asks for it
+void enable_texture_cooking(PTextureList* texture_list, const char* directory)
+{
+    if(directory == NULL)
+    {
+        directory = COOKED_TEXTURE_DIRECTORY;
+    }
+
+    size_t directory_size = strlen(directory) + 1;
+    char* copy            = malloc(directory_size);
+    if(copy == NULL)
+    {
+        perror("enable_texture_cooking");
+        return;
+    }
+    memcpy(copy, directory, directory_size);
+
+    free(texture_list->cooked_texture_directory);
+    texture_list->cooked_texture_directory = copy;
+}
+
+int create_texture(PTexture* texture, const char* texture_path, PTextureList* texture_list, PCommands* commands, PDevice* device)
+{
+    *texture = (PTexture) {0};
+
+    if(create_texture_image(texture, texture_path, &texture->image_memory, texture_list, commands, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    // The content is already uploaded for another texture, see share_texture_content
+    if(texture->image == VK_NULL_HANDLE)
+    {
+        destroy_texture_stream(texture->stream);
+        texture->stream = NULL;
+        return PIGMENT_SUCCESS;
+    }
+
+    texture->layer_count = 1;
+    texture->image_view  = create_texture_view(texture->image, texture->format, texture->mip_levels, texture->layer_count, device->logical_device);
+    if(texture->image_view == NULL)
+    {
+        destroy_texture_stream(texture->stream);
+        vkDestroyImage(device->logical_device, texture->image, NULL);
+        free_device_memory(texture->image_memory, device);
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
 int add_texture(PTextureList* texture_list, const char* texture_path, PCommands* commands, PDevice* device)
 {
     PTexture texture;
 
-    if(create_texture_image(&texture, texture_path, &texture.image_memory, commands, device) != PIGMENT_SUCCESS)
+    if(create_texture(&texture, texture_path, texture_list, commands, device) != PIGMENT_SUCCESS)
     {
-        goto ERROR;
+        fprintf(stderr, "Failed to add a texture.\n");
+        return PIGMENT_ERROR;
     }
 
-    texture.image_view = create_image_view(texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, texture.mip_levels, device->logical_device);
-    if(texture.image_view == NULL)
+    if(texture.image == VK_NULL_HANDLE)
     {
-        goto ERROR;
+        return PIGMENT_SUCCESS;
     }
 
-
     texture_list_append(texture_list, texture);
 
+    // The content uploaded for this texture can now be shared by the next ones
+    PTextureContents* contents = texture_list->contents;
+    if(contents != NULL && contents->pending.path != NULL)
+    {
+        // Without room for the content the texture is simply not shared
+        if(reserve_array((void**) &contents->contents, &contents->content_size, contents->content_number + 1, sizeof(*contents->contents)) == PIGMENT_SUCCESS &&
+           content_hashmap_set_value(contents->content_indices, contents->pending.hash, contents->content_number))
+        {
+            contents->pending.texture_index                = texture_list->texture_number - 1;
+            contents->contents[contents->content_number++] = contents->pending;
+        }
+        else
+        {
+            free(contents->pending.path);
+        }
+        contents->pending = (PTextureContent) {0};
+    }
+
     return PIGMENT_SUCCESS;
+}
 
-ERROR:
-    fprintf(stderr, "Failed to add a texture.\n");
-    return PIGMENT_ERROR;
+int create_texture_table(PTextureList* texture_list, PDevice* device)
+{
+    uint32_t frame_count = texture_list->frame_count;
+
+    texture_list->table_buffers        = calloc(frame_count, sizeof(*texture_list->table_buffers));
+    texture_list->table_buffers_memory = calloc(frame_count, sizeof(*texture_list->table_buffers_memory));
+    texture_list->table_buffers_mapped = calloc(frame_count, sizeof(*texture_list->table_buffers_mapped));
+    if(texture_list->table_buffers == NULL || texture_list->table_buffers_memory == NULL || texture_list->table_buffers_mapped == NULL)
+    {
+        perror("create_texture_table");
+        return PIGMENT_ERROR;
+    }
+
+    // Loaded textures keep their index in the descriptor array, later images get a free one
+    for(uint32_t i = 0; i < texture_list->texture_number; i++)
+    {
+        texture_list->textures[i].descriptor_index = i;
+    }
+    texture_list->descriptor_index_number = texture_list->texture_number;
+
+    VkDeviceSize table_size = device->max_bindless_textures * sizeof(**texture_list->table_buffers_mapped);
+
+    for(uint32_t i = 0; i < frame_count; i++)
+    {
+        if(create_buffer(&texture_list->table_buffers[i], &texture_list->table_buffers_memory[i], table_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+        {
+            return PIGMENT_ERROR;
+        }
+
+        if(vkMapMemory(device->logical_device, texture_list->table_buffers_memory[i], 0, table_size, 0, (void**) &texture_list->table_buffers_mapped[i]) != VK_SUCCESS)
+        {
+            fprintf(stderr, "Failed to map texture table!\n");
+            return PIGMENT_ERROR;
+        }
+
+        for(uint32_t j = 0; j < texture_list->texture_number; j++)
+        {
+            texture_list->table_buffers_mapped[i][j] = j;
+        }
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+void destroy_texture_table(PTextureList* texture_list, PDevice* device)
+{
+    for(uint32_t i = 0; texture_list->table_buffers != NULL && i < texture_list->frame_count; i++)
+    {
+        if(texture_list->table_buffers_mapped != NULL && texture_list->table_buffers_mapped[i] != NULL)
+        {
+            vkUnmapMemory(device->logical_device, texture_list->table_buffers_memory[i]);
+        }
+        vkDestroyBuffer(device->logical_device, texture_list->table_buffers[i], NULL);
+        if(texture_list->table_buffers_memory != NULL)
+        {
+            free_device_memory(texture_list->table_buffers_memory[i], device);
+        }
+    }
+
+    free(texture_list->table_buffers);
+    free(texture_list->table_buffers_memory);
+    free(texture_list->table_buffers_mapped);
+}
+
+int publish_texture(PTextureList* texture_list, PTexture* texture, PDevice* device)
+{
+    if(texture_list->free_descriptor_index_number > 0)
+    {
+        texture->descriptor_index = texture_list->free_descriptor_indices[--texture_list->free_descriptor_index_number];
+    }
+    else if(texture_list->descriptor_index_number < device->max_bindless_textures)
+    {
+        texture->descriptor_index = texture_list->descriptor_index_number++;
+    }
+    else
+    {
+        fprintf(stderr, "Failed to publish texture, all %u descriptors are used!\n", device->max_bindless_textures);
+        return PIGMENT_ERROR;
+    }
+
+    // A free descriptor is not read by any frame in flight, it can be written while they are pending
+    write_texture_descriptor(texture_list->descriptor->texture_set, texture->descriptor_index, texture->image_view, device->logical_device);
+
+    return PIGMENT_SUCCESS;
+}
+
+// Once textures are packed into arrays, the new texture gets a slot of its own, the returned index is always a slot
+int insert_texture(PTextureList* texture_list, const char* texture_path, PCommands* commands, PDevice* device, uint32_t* slot)
+{
+    if(texture_list->free_index_number == 0 && texture_list->texture_number >= device->max_bindless_textures)
+    {
+        fprintf(stderr, "Failed to load texture, all %u texture indices are used!\n", device->max_bindless_textures);
+        return PIGMENT_ERROR;
+    }
+
+    // Room for the slot is made first so that nothing fails once the texture is published
+    if(texture_list->slots != NULL && texture_list->free_slot_number == 0 &&
+       reserve_array((void**) &texture_list->slots, &texture_list->slot_size, texture_list->slot_number + 1, sizeof(*texture_list->slots)) != PIGMENT_SUCCESS)
+    {
+        perror("insert_texture");
+        return PIGMENT_ERROR;
+    }
+
+    PTexture texture;
+    if(create_texture(&texture, texture_path, texture_list, commands, device) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to load texture %s!\n", texture_path);
+        return PIGMENT_ERROR;
+    }
+
+    if(publish_texture(texture_list, &texture, device) != PIGMENT_SUCCESS)
+    {
+        destroy_texture_stream(texture.stream);
+        vkDestroyImageView(device->logical_device, texture.image_view, NULL);
+        vkDestroyImage(device->logical_device, texture.image, NULL);
+        free_device_memory(texture.image_memory, device);
+        return PIGMENT_ERROR;
+    }
+
+    if(texture.stream != NULL)
+    {
+        texture.stream->memory_size = get_image_memory_size(texture.image, device->logical_device);
+    }
+
+    uint32_t texture_index;
+    if(texture_list->free_index_number > 0)
+    {
+        texture_index                         = texture_list->free_indices[--texture_list->free_index_number];
+        texture_list->textures[texture_index] = texture;
+    }
+    else
+    {
+        texture_index = texture_list->texture_number;
+        texture_list_append(texture_list, texture);
+    }
+
+    // A recycled index is only handed out once no frame in flight reads it, so every table can be written right away
+    for(uint32_t frame = 0; frame < texture_list->frame_count; frame++)
+    {
+        texture_list->table_buffers_mapped[frame][texture_index] = texture.descriptor_index;
+    }
+
+    *slot = texture_index;
+    if(texture_list->slots != NULL)
+    {
+        *slot                      = texture_list->free_slot_number > 0 ? texture_list->free_slots[--texture_list->free_slot_number] : texture_list->slot_number++;
+        texture_list->slots[*slot] = (PTextureSlot) {texture_index, 0};
+    }
+
+    generate_pending_mipmaps(texture_list, commands, device);
+
+    return PIGMENT_SUCCESS;
+}
+
+int replace_texture(PTextureList* texture_list, uint32_t slot, const char* texture_path, PCommands* commands, PDevice* device)
+{
+    uint32_t texture_index;
+    uint32_t layer;
+    get_texture_slot(texture_list, slot, &texture_index, &layer);
+
+    if((texture_list->slots != NULL && slot >= texture_list->slot_number) || texture_index >= texture_list->texture_number || texture_list->textures[texture_index].image == VK_NULL_HANDLE)
+    {
+        fprintf(stderr, "Failed to replace texture %u, it does not exist!\n", slot);
+        return PIGMENT_ERROR;
+    }
+
+    // The other layers of the array belong to other textures
+    if(texture_list->textures[texture_index].layer_count > 1)
+    {
+        fprintf(stderr, "Failed to replace texture %u, it is packed into a texture array!\n", slot);
+        return PIGMENT_ERROR;
+    }
+
+    PTexture texture;
+    if(create_texture(&texture, texture_path, texture_list, commands, device) != PIGMENT_SUCCESS)
+    {
+        fprintf(stderr, "Failed to load texture %s!\n", texture_path);
+        return PIGMENT_ERROR;
+    }
+
+    PTexture* previous = &texture_list->textures[texture_index];
+    if(publish_texture(texture_list, &texture, device) != PIGMENT_SUCCESS || retire_texture(texture_list, previous, UINT32_MAX) != PIGMENT_SUCCESS)
+    {
+        destroy_texture_stream(texture.stream);
+        vkDestroyImageView(device->logical_device, texture.image_view, NULL);
+        vkDestroyImage(device->logical_device, texture.image, NULL);
+        free_device_memory(texture.image_memory, device);
+        return PIGMENT_ERROR;
+    }
+    destroy_texture_stream(previous->stream);
+
+    if(texture.stream != NULL)
+    {
+        texture.stream->memory_size = get_image_memory_size(texture.image, device->logical_device);
+    }
+
+    // Frames in flight still sample the previous image, each table switches once its fence has signaled
+    texture.pending_table_frames = (1u << texture_list->frame_count) - 1u;
+    *previous                    = texture;
+
+    generate_pending_mipmaps(texture_list, commands, device);
+
+    return PIGMENT_SUCCESS;
+}
+
+void remove_texture(PTextureList* texture_list, uint32_t slot)
+{
+    uint32_t texture_index;
+    uint32_t layer;
+    get_texture_slot(texture_list, slot, &texture_index, &layer);
+
+    // The default texture at index 0 is the fallback of every material
+    if(slot == 0 || (texture_list->slots != NULL && slot >= texture_list->slot_number) || texture_index == 0 || texture_index >= texture_list->texture_number || texture_list->textures[texture_index].image == VK_NULL_HANDLE)
+    {
+        fprintf(stderr, "Failed to remove texture %u!\n", slot);
+        return;
+    }
+
+    // A texture packed into an array only gives its slot back, the array stays for the other layers
+    PTexture* texture = &texture_list->textures[texture_index];
+    if(texture->layer_count <= 1)
+    {
+        if(retire_texture(texture_list, texture, texture_index) != PIGMENT_SUCCESS)
+        {
+            return;
+        }
+
+        destroy_texture_stream(texture->stream);
+        *texture = (PTexture) {0};
+    }
+
+    // Stale slots show the default texture until they are handed out again
+    if(texture_list->slots != NULL)
+    {
+        texture_list->slots[slot] = (PTextureSlot) {0, 0};
+        if(push_free_index(&texture_list->free_slots, &texture_list->free_slot_number, &texture_list->free_slot_size, slot) != PIGMENT_SUCCESS)
+        {
+            perror("remove_texture");
+        }
+    }
+}
+
+int retire_texture(PTextureList* texture_list, const PTexture* texture, uint32_t free_index)
+{
+    if(texture_list->retired_number >= texture_list->retired_size)
+    {
+        uint32_t retired_size    = texture_list->retired_size > 0 ? texture_list->retired_size * 2 : 4;
+        PRetiredTexture* retired = realloc(texture_list->retired_textures, retired_size * sizeof(*retired));
+        if(retired == NULL)
+        {
+            perror("retire_texture");
+            return PIGMENT_ERROR;
+        }
+        texture_list->retired_textures = retired;
+        texture_list->retired_size     = retired_size;
+    }
+
+    PRetiredTexture* retired = &texture_list->retired_textures[texture_list->retired_number];
+    retired->texture         = *texture;
+    retired->texture.stream  = NULL;
+    retired->frame           = texture_list->frame;
+    retired->free_index      = free_index;
+    texture_list->retired_number++;
+
+    return PIGMENT_SUCCESS;
+}
+
+void release_retired_textures(PTextureList* texture_list, PDevice* device, bool release_all)
+{
+    // Once every frame went through its fence, no table points to the old descriptor anymore
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < texture_list->retired_number; i++)
+    {
+        PRetiredTexture* retired = &texture_list->retired_textures[i];
+        if(!release_all && texture_list->frame < retired->frame + texture_list->frame_count)
+        {
+            texture_list->retired_textures[kept++] = *retired;
+            continue;
+        }
+
+        vkDestroyImageView(device->logical_device, retired->texture.image_view, NULL);
+        vkDestroyImage(device->logical_device, retired->texture.image, NULL);
+        free_device_memory(retired->texture.image_memory, device);
+
+        // A failed push leaks the index, the list keeps working with one slot less
+        push_free_index(&texture_list->free_descriptor_indices, &texture_list->free_descriptor_index_number, &texture_list->free_descriptor_index_size, retired->texture.descriptor_index);
+        if(retired->free_index != UINT32_MAX)
+        {
+            push_free_index(&texture_list->free_indices, &texture_list->free_index_number, &texture_list->free_index_size, retired->free_index);
+        }
+    }
+    texture_list->retired_number = kept;
+}
+
+void write_texture_descriptor(VkDescriptorSet descriptor_set, uint32_t descriptor_index, VkImageView image_view, VkDevice device)
+{
+    VkDescriptorImageInfo image_info = {
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .imageView   = image_view
+    };
+
+    VkWriteDescriptorSet descriptor_write = {
+        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet          = descriptor_set,
+        .dstBinding      = 1,
+        .dstArrayElement = descriptor_index,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        .descriptorCount = 1,
+        .pImageInfo      = &image_info
+    };
+
+    vkUpdateDescriptorSets(device, 1, &descriptor_write, 0, NULL);
+}
+
+void update_textures(PTextureList* texture_list, PDevice* device, uint32_t frame)
+{
+    release_retired_textures(texture_list, device, false);
+
+    update_texture_streaming(texture_list, device, frame);
+
+    // Only the table of this frame is idle, the others switch to the new descriptors when their turn comes
+    for(uint32_t i = 0; i < texture_list->texture_number; i++)
+    {
+        PTexture* texture = &texture_list->textures[i];
+        if(!(texture->pending_table_frames & (1u << frame)))
+        {
+            continue;
+        }
+
+        texture_list->table_buffers_mapped[frame][i] = texture->descriptor_index;
+        texture->pending_table_frames               &= ~(1u << frame);
+    }
+}
+
+void advance_texture_frame(PTextureList* texture_list)
+{
+    texture_list->frame++;
 }
 
 unsigned char* create_default_texture(int* texture_width, int* texture_height)
@@ -144,15 +579,24 @@ stbi_uc* load_texture_file(const char* texture_path, int* texture_width, int* te
     return pixels;
 }
 
-int create_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PCommands* commands, PDevice* device)
+int create_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, PCommands* commands, PDevice* device)
 {
     int texture_width, texture_height;
     unsigned char* pixels;
 
+    if(ktx2_is_file(texture_path))
+    {
+        return create_ktx2_texture_image(texture, texture_path, image_memory, texture_list, commands, device);
+    }
+
     if(strncmp(texture_path, "default", 8) == 0)
     {
         pixels = create_default_texture(&texture_width, &texture_height);
     }
+    else if(create_cooked_texture_image(texture, texture_path, image_memory, texture_list, commands, device) == PIGMENT_SUCCESS)
+    {
+        return PIGMENT_SUCCESS;
+    }
     else
     {
         pixels = load_texture_file(texture_path, &texture_width, &texture_height);
@@ -163,170 +607,219 @@ int create_texture_image(PTexture* texture, const char* texture_path, VkDeviceMe
         goto ERROR;
     }
 
-    VkDeviceSize image_size = (uint64_t) (texture_width * texture_height * 4);
-    texture->mip_levels     = (uint32_t) (floor(log2(imax(texture_width, texture_height)))) + 1;
+    texture->format          = VK_FORMAT_R8G8B8A8_SRGB;
+    texture->width           = (uint32_t) texture_width;
+    texture->height          = (uint32_t) texture_height;
+    texture->mip_levels      = (uint32_t) (floor(log2(imax(texture_width, texture_height)))) + 1;
+    texture->alpha_tested    = !is_opaque(pixels, texture->width, texture->height);
+    // Mip levels are built later for every pending texture in a single submit, see generate_pending_mipmaps
+    texture->mipmaps_pending = true;
 
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
+    VkDeviceSize level_offset = 0;
+    int result = upload_texture_image(texture, texture_path, image_memory, texture_list, pixels, (VkDeviceSize) texture_width * (VkDeviceSize) texture_height * 4, &level_offset, 1, commands, device);
 
-    create_buffer(&staging_buffer, &staging_buffer_memory, image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device);
+    free(pixels);
 
-    void* data;
-    vkMapMemory(device->logical_device, staging_buffer_memory, 0, image_size, 0, &data);
-    memcpy(data, pixels, (size_t) image_size);
-    vkUnmapMemory(device->logical_device, staging_buffer_memory);
+    return result;
 
-    free(pixels);
+ERROR:
+    fprintf(stderr, "Failed to create texture image!\n");
+    return PIGMENT_ERROR;
+}
+
+int create_ktx2_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, PCommands* commands, PDevice* device)
+{
+    KTX2Image* ktx2_image = ktx2_load(texture_path);
+    if(ktx2_image == NULL)
+    {
+        goto ERROR;
+    }
 
-    create_image(&texture->image, image_memory, (uint32_t) texture_width, (uint32_t) texture_height, texture->mip_levels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device);
+    if(ktx2_image->level_count > MAX_TEXTURE_MIP_LEVELS)
+    {
+        fprintf(stderr, "Too many mip levels in %s!\n", texture_path);
+        goto ERROR;
+    }
 
-    transition_image_layout(texture->image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->mip_levels, commands->command_pool, device);
-    copy_buffer_to_image(staging_buffer, texture->image, (uint32_t) texture_width, (uint32_t) texture_height, commands->command_pool, device);
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(device->physical_device, (VkFormat) ktx2_image->vk_format, &format_properties);
+    if(!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+    {
+        fprintf(stderr, "Texture format of %s is not supported by the device!\n", texture_path);
+        goto ERROR;
+    }
 
-    vkDestroyBuffer(device->logical_device, staging_buffer, NULL);
-    vkFreeMemory(device->logical_device, staging_buffer_memory, NULL);
+    texture->format          = (VkFormat) ktx2_image->vk_format;
+    texture->width           = ktx2_image->width;
+    texture->height          = ktx2_image->height;
+    texture->mipmaps_pending = ktx2_image->needs_mipmaps;
+    texture->mip_levels      = ktx2_image->level_count;
+    // Compressed blocks are not scanned, BC1 is the only format known to have no alpha
+    texture->alpha_tested    = texture->format != VK_FORMAT_BC1_RGB_SRGB_BLOCK && texture->format != VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    if(ktx2_image->needs_mipmaps)
+    {
+        texture->mip_levels = (uint32_t) (floor(log2(imax((int) texture->width, (int) texture->height)))) + 1;
+    }
+
+    // Streamed textures start with their coarsest levels only, finer ones are uploaded on demand by update_texture_streaming
+    uint32_t base_level = 0;
+    if(texture_list->stream_mips && !ktx2_image->needs_mipmaps && ktx2_image->level_count > STREAMING_RESIDENT_LEVELS)
+    {
+        texture->stream = create_texture_stream(texture_path, ktx2_image);
+        if(texture->stream == NULL)
+        {
+            goto ERROR;
+        }
+
+        base_level          = texture->stream->base_level;
+        texture->width      = imax((int) (texture->width >> base_level), 1);
+        texture->height     = imax((int) (texture->height >> base_level), 1);
+        texture->mip_levels = ktx2_image->level_count - base_level;
+    }
+
+    uint64_t base_offset = ktx2_image->levels[base_level].offset;
+
+    VkDeviceSize level_offsets[MAX_TEXTURE_MIP_LEVELS];
+    for(uint32_t i = base_level; i < ktx2_image->level_count; i++)
+    {
+        level_offsets[i - base_level] = ktx2_image->levels[i].offset - base_offset;
+    }
+
+    if(upload_texture_image(texture, texture_path, image_memory, texture_list, ktx2_image->data + base_offset, ktx2_image->data_size - base_offset, level_offsets, ktx2_image->level_count - base_level, commands, device) != PIGMENT_SUCCESS)
+    {
+        destroy_texture_stream(texture->stream);
+        texture->stream = NULL;
+        goto ERROR;
+    }
 
-    generate_mipmaps(texture->image, VK_FORMAT_R8G8B8A8_SRGB, texture_width, texture_height, texture->mip_levels, commands->command_pool, device);
+    ktx2_destroy(ktx2_image);
 
     return PIGMENT_SUCCESS;
 
 ERROR:
     fprintf(stderr, "Failed to create texture image!\n");
+    ktx2_destroy(ktx2_image);
     return PIGMENT_ERROR;
 }
 
-int generate_mipmaps(VkImage image, VkFormat image_format, int32_t texture_width, int32_t texture_height, uint32_t mip_levels, VkCommandPool command_pool, PDevice* device)
+int create_cooked_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, PCommands* commands, PDevice* device)
 {
-    VkFormatProperties format_properties;
-    vkGetPhysicalDeviceFormatProperties(device->physical_device, image_format, &format_properties);
-
-    VkCommandBuffer command_buffer = start_single_usage_commands(command_pool, device);
+    if(texture_list->cooked_texture_directory == NULL || !device->texture_compression_bc)
+    {
+        return PIGMENT_ERROR;
+    }
 
-    if(!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+    char* cooked_path = get_cooked_texture_path(texture_list->cooked_texture_directory, texture_path);
+    if(cooked_path == NULL)
     {
-        fprintf(stderr, "Texture image format does not support linear blitting!\n");
         return PIGMENT_ERROR;
     }
 
-    VkImageMemoryBarrier barrier = {
-        .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .image                           = image,
-        .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
-        .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-        .subresourceRange.baseArrayLayer = 0,
-        .subresourceRange.layerCount     = 1,
-        .subresourceRange.levelCount     = 1
-    };
+    // Source images are encoded to BC1/BC7 once and the result is cached in the cooked texture directory
+    int result = PIGMENT_ERROR;
+    if(cooked_texture_is_fresh(texture_path, cooked_path) || cook_texture(texture_path, cooked_path) == PIGMENT_SUCCESS)
+    {
+        result = create_ktx2_texture_image(texture, cooked_path, image_memory, texture_list, commands, device);
+    }
 
-    int32_t mip_width  = texture_width;
-    int32_t mip_height = texture_height;
-
-    for(uint32_t i = 1; i < mip_levels; i++)
-    {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
-
-        vkCmdPipelineBarrier(
-            command_buffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
-            0,
-            NULL,
-            0,
-            NULL,
-            1,
-            &barrier
-        );
-
-        VkOffset3D src_offsets[] = {
-            {        0,          0, 0},
-            {mip_width, mip_height, 1}
-        };
+    free(cooked_path);
 
-        VkOffset3D dst_offsets[] = {
-            {                                0,                                   0, 0},
-            {mip_width > 1 ? mip_width / 2 : 1, mip_height > 1 ? mip_height / 2 : 1, 1}
-        };
+    return result;
+}
 
-        VkImageBlit blit = {
-            .srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .srcSubresource.mipLevel       = i - 1,
-            .srcSubresource.baseArrayLayer = 0,
-            .srcSubresource.layerCount     = 1,
-            .dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-            .dstSubresource.mipLevel       = i,
-            .dstSubresource.baseArrayLayer = 0,
-            .dstSubresource.layerCount     = 1
-        };
+PTextureStream* create_texture_stream(const char* texture_path, const KTX2Image* ktx2_image)
+{
+    PTextureStream* stream = calloc(1, sizeof(*stream));
+    if(stream == NULL)
+    {
+        perror("create_texture_stream");
+        return NULL;
+    }
 
-        memcpy(blit.srcOffsets, src_offsets, 2 * sizeof(*src_offsets));
-        memcpy(blit.dstOffsets, dst_offsets, 2 * sizeof(*dst_offsets));
-
-        vkCmdBlitImage(
-            command_buffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &blit,
-            VK_FILTER_LINEAR
-        );
-
-        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    size_t path_size = strlen(texture_path) + 1;
+    stream->path     = malloc(path_size);
+    if(stream->path == NULL)
+    {
+        perror("create_texture_stream");
+        free(stream);
+        return NULL;
+    }
+    memcpy(stream->path, texture_path, path_size);
 
-        vkCmdPipelineBarrier(
-            command_buffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0,
-            NULL,
-            0,
-            NULL,
-            1,
-            &barrier
-        );
-
-        if(mip_width > 1)
-        {
-            mip_width /= 2;
-        }
+    stream->level_count     = ktx2_image->level_count;
+    stream->base_level      = ktx2_image->level_count - STREAMING_RESIDENT_LEVELS;
+    stream->requested_level = stream->base_level;
+    stream->full_width      = ktx2_image->width;
+    stream->full_height     = ktx2_image->height;
 
-        if(mip_height > 1)
-        {
-            mip_height /= 2;
-        }
+    return stream;
+}
+
+void destroy_texture_stream(PTextureStream* stream)
+{
+    if(stream == NULL)
+    {
+        return;
     }
 
-    barrier.subresourceRange.baseMipLevel = mip_levels - 1;
-    barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+    // The streaming thread may still be reading the file, the streamer frees the stream once the load comes back
+    if(stream->loading)
+    {
+        stream->orphaned = true;
+        return;
+    }
 
-    vkCmdPipelineBarrier(
-        command_buffer,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-        0,
-        0,
-        NULL,
-        0,
-        NULL,
-        1,
-        &barrier
-    );
+    free(stream->path);
+    free(stream);
+}
 
-    end_single_usage_commands(&command_buffer, command_pool, device);
+int upload_texture_image(PTexture* texture, const char* texture_path, VkDeviceMemory* image_memory, PTextureList* texture_list, const void* data, VkDeviceSize data_size, const VkDeviceSize* level_offsets, uint32_t level_count, PCommands* commands, PDevice* device)
+{
+    if(texture_list->contents != NULL && share_texture_content(texture_list->contents, texture, texture_path, data, data_size, level_count))
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    VkBuffer staging_buffer;
+    VkDeviceMemory staging_buffer_memory;
+
+    if(create_buffer(&staging_buffer, &staging_buffer_memory, data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    void* staging_data;
+    vkMapMemory(device->logical_device, staging_buffer_memory, 0, data_size, 0, &staging_data);
+    memcpy(staging_data, data, (size_t) data_size);
+    vkUnmapMemory(device->logical_device, staging_buffer_memory);
+
+    // Mip levels are written through UNORM storage views when the compute generator can handle the texture
+    // Transfer source is also needed to copy the texture into a packed array, see pack_texture_arrays
+    VkImageUsageFlags usage  = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    VkImageCreateFlags flags = 0;
+    if(texture->mipmaps_pending && use_compute_mipmaps(device, texture->format, texture->mip_levels))
+    {
+        usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+    }
+
+    if(create_image(&texture->image, image_memory, texture->width, texture->height, texture->mip_levels, 1, texture->format, VK_IMAGE_TILING_OPTIMAL, usage, flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        vkDestroyBuffer(device->logical_device, staging_buffer, NULL);
+        free_device_memory(staging_buffer_memory, device);
+        return PIGMENT_ERROR;
+    }
+
+    transition_image_layout(texture->image, texture->format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture->mip_levels, commands->command_pool, device);
+    copy_buffer_to_image(staging_buffer, texture->image, texture->width, texture->height, level_offsets, level_count, commands->command_pool, device);
+
+    if(!texture->mipmaps_pending)
+    {
+        transition_image_layout(texture->image, texture->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture->mip_levels, commands->command_pool, device);
+    }
+
+    vkDestroyBuffer(device->logical_device, staging_buffer, NULL);
+    free_device_memory(staging_buffer_memory, device);
 
     return PIGMENT_SUCCESS;
 }
@@ -408,33 +901,393 @@ void destroy_samplers(PSamplerList* sampler_list, PDevice* device)
     }
 }
 
+uint32_t get_texture_number(const PTextureList* texture_list)
+{
+    return (uint32_t) texture_list->texture_number;
+}
+
+int enable_texture_sharing(PTextureList* texture_list)
+{
+    texture_list->contents = calloc(1, sizeof(*texture_list->contents));
+    if(texture_list->contents == NULL)
+    {
+        perror("enable_texture_sharing");
+        return PIGMENT_ERROR;
+    }
+
+    texture_list->contents->content_indices = content_hashmap_create();
+    if(texture_list->contents->content_indices == NULL)
+    {
+        free(texture_list->contents);
+        texture_list->contents = NULL;
+        return PIGMENT_ERROR;
+    }
+
+    texture_list->contents->shared_texture = UINT32_MAX;
+
+    return PIGMENT_SUCCESS;
+}
+
+void disable_texture_sharing(PTextureList* texture_list)
+{
+    PTextureContents* contents = texture_list->contents;
+    if(contents == NULL)
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; i < contents->content_number; i++)
+    {
+        free(contents->contents[i].path);
+    }
+    free(contents->pending.path);
+    free(contents->contents);
+    content_hashmap_free(&contents->content_indices);
+    free(contents);
+    texture_list->contents = NULL;
+}
+
+uint32_t get_shared_texture(const PTextureList* texture_list)
+{
+    return texture_list->contents != NULL ? texture_list->contents->shared_texture : UINT32_MAX;
+}
+
+// Returns true when a texture with the same shape and bytes was already uploaded, its index is then kept in shared_texture
+// Otherwise the hash and source path are kept as pending, and add_texture records them once the texture is in the list
+bool share_texture_content(PTextureContents* contents, const PTexture* texture, const char* texture_path, const void* data, VkDeviceSize data_size, uint32_t level_count)
+{
+    PTextureContent content = {
+        .shape = {
+            .format          = (uint32_t) texture->format,
+            .width           = texture->width,
+            .height          = texture->height,
+            .mip_levels      = texture->mip_levels,
+            .level_count     = level_count,
+            .mipmaps_pending = texture->mipmaps_pending
+        },
+        .size = data_size
+    };
+    content.hash = content_hash_append(content_hash(&content.shape, sizeof(content.shape)), data, (size_t) data_size);
+
+    contents->shared_texture = UINT32_MAX;
+    free(contents->pending.path);
+    contents->pending.path = NULL;
+
+    // A colliding hash keeps the first content in the map, the texture is then uploaded on its own
+    int64_t content_index = content_hashmap_get_value(contents->content_indices, content.hash);
+    if(content_index != -1)
+    {
+        const PTextureContent* other = &contents->contents[content_index];
+        if(other->size == content.size && memcmp(&other->shape, &content.shape, sizeof(content.shape)) == 0 && same_texture_content(other, data))
+        {
+            contents->shared_texture = other->texture_index;
+            return true;
+        }
+        return false;
+    }
+
+    // Without a path the texture is simply not shared
+    size_t path_size = strlen(texture_path) + 1;
+    content.path     = malloc(path_size);
+    if(content.path != NULL)
+    {
+        memcpy(content.path, texture_path, path_size);
+        contents->pending = content;
+    }
+
+    return false;
+}
+
+// A hash hit is confirmed by decoding the earlier source again, the same way it was decoded for its upload
+bool same_texture_content(const PTextureContent* content, const void* data)
+{
+    bool same = false;
+
+    if(ktx2_is_file(content->path))
+    {
+        KTX2Image* ktx2_image = ktx2_load(content->path);
+        // Streamed textures only uploaded their coarsest levels
+        if(ktx2_image != NULL && ktx2_image->level_count >= content->shape.level_count)
+        {
+            uint64_t base_offset = ktx2_image->levels[ktx2_image->level_count - content->shape.level_count].offset;
+            same = ktx2_image->data_size - base_offset == content->size && memcmp(ktx2_image->data + base_offset, data, (size_t) content->size) == 0;
+        }
+        ktx2_destroy(ktx2_image);
+        return same;
+    }
+
+    int texture_width, texture_height;
+    unsigned char* pixels = strcmp(content->path, "default") == 0 ? create_default_texture(&texture_width, &texture_height) : load_texture_file(content->path, &texture_width, &texture_height);
+    if(pixels != NULL)
+    {
+        same = (VkDeviceSize) texture_width * (VkDeviceSize) texture_height * 4 == content->size && memcmp(pixels, data, (size_t) content->size) == 0;
+    }
+    free(pixels);
+
+    return same;
+}
+
+// Before textures are packed, slots and texture indices are the same, indices past the table such as INSTANCE_TEXTURE_FROM_VERTEX are kept as is
+void get_texture_slot(const PTextureList* texture_list, uint32_t slot, uint32_t* texture_index, uint32_t* layer)
+{
+    if(texture_list->slots == NULL || slot >= texture_list->slot_number)
+    {
+        *texture_index = slot;
+        *layer         = 0;
+        return;
+    }
+
+    *texture_index = texture_list->slots[slot].texture_index;
+    *layer         = texture_list->slots[slot].layer;
+}
+
+bool is_texture_alpha_tested(const PTextureList* texture_list, uint32_t texture_index)
+{
+    return texture_index >= texture_list->texture_number || texture_list->textures[texture_index].alpha_tested;
+}
+
+bool same_texture_layout(const PTexture* texture, const PTexture* other)
+{
+    return texture->format == other->format && texture->width == other->width && texture->height == other->height && texture->mip_levels == other->mip_levels;
+}
+
+int create_texture_array(PTexture* texture_array, const PTexture* textures, const uint32_t* members, uint32_t member_number, PCommands* commands, PDevice* device)
+{
+    *texture_array             = textures[members[0]];
+    texture_array->layer_count = member_number;
+
+    for(uint32_t i = 1; i < member_number; i++)
+    {
+        texture_array->alpha_tested = texture_array->alpha_tested || textures[members[i]].alpha_tested;
+    }
+
+    if(create_image(&texture_array->image, &texture_array->image_memory, texture_array->width, texture_array->height, texture_array->mip_levels, member_number, texture_array->format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device) != PIGMENT_SUCCESS)
+    {
+        return PIGMENT_ERROR;
+    }
+
+    VkImageMemoryBarrier* barriers = malloc((member_number + 1) * sizeof(*barriers));
+    if(barriers == NULL)
+    {
+        perror("create_texture_array");
+        vkDestroyImage(device->logical_device, texture_array->image, NULL);
+        free_device_memory(texture_array->image_memory, device);
+        return PIGMENT_ERROR;
+    }
+
+    VkImageMemoryBarrier barrier = {
+        .sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask                   = VK_ACCESS_SHADER_READ_BIT,
+        .dstAccessMask                   = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout                       = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED,
+        .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseMipLevel   = 0,
+        .subresourceRange.levelCount     = texture_array->mip_levels,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount     = 1
+    };
+
+    for(uint32_t i = 0; i < member_number; i++)
+    {
+        barriers[i]       = barrier;
+        barriers[i].image = textures[members[i]].image;
+    }
+
+    barriers[member_number]                             = barrier;
+    barriers[member_number].image                       = texture_array->image;
+    barriers[member_number].srcAccessMask               = 0;
+    barriers[member_number].dstAccessMask               = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[member_number].oldLayout                   = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[member_number].newLayout                   = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[member_number].subresourceRange.layerCount = member_number;
+
+    VkCommandBuffer command_buffer = start_single_usage_commands(commands->command_pool, device);
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, member_number + 1, barriers);
+
+    VkImageCopy regions[MAX_TEXTURE_MIP_LEVELS];
+    for(uint32_t i = 0; i < member_number; i++)
+    {
+        for(uint32_t level = 0; level < texture_array->mip_levels; level++)
+        {
+            VkExtent3D extent = {texture_array->width >> level, texture_array->height >> level, 1};
+            extent.width      = extent.width > 0 ? extent.width : 1;
+            extent.height     = extent.height > 0 ? extent.height : 1;
+
+            regions[level] = (VkImageCopy) {
+                .srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .srcSubresource.mipLevel       = level,
+                .srcSubresource.baseArrayLayer = 0,
+                .srcSubresource.layerCount     = 1,
+                .srcOffset                     = {0, 0, 0},
+                .dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .dstSubresource.mipLevel       = level,
+                .dstSubresource.baseArrayLayer = i,
+                .dstSubresource.layerCount     = 1,
+                .dstOffset                     = {0, 0, 0},
+                .extent                        = extent
+            };
+        }
+
+        vkCmdCopyImage(command_buffer, textures[members[i]].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture_array->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture_array->mip_levels, regions);
+    }
+
+    barrier               = barriers[member_number];
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+    end_single_usage_commands(&command_buffer, commands->command_pool, device);
+
+    free(barriers);
+
+    texture_array->image_view = create_texture_view(texture_array->image, texture_array->format, texture_array->mip_levels, member_number, device->logical_device);
+    if(texture_array->image_view == NULL)
+    {
+        vkDestroyImage(device->logical_device, texture_array->image, NULL);
+        free_device_memory(texture_array->image_memory, device);
+        return PIGMENT_ERROR;
+    }
+
+    return PIGMENT_SUCCESS;
+}
+
+int pack_texture_arrays(PTextureList* texture_list, PCommands* commands, PDevice* device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device->physical_device, &properties);
+
+    uint32_t texture_number = texture_list->texture_number;
+    if(texture_number <= 1)
+    {
+        return PIGMENT_SUCCESS;
+    }
+
+    PTexture* packed_textures = malloc(texture_number * sizeof(*packed_textures));
+    PTextureSlot* slots       = malloc(texture_number * sizeof(*slots));
+    uint32_t* members         = malloc(texture_number * sizeof(*members));
+    bool* packed              = calloc(texture_number, sizeof(*packed));
+    if(packed_textures == NULL || slots == NULL || members == NULL || packed == NULL)
+    {
+        perror("pack_texture_arrays");
+        goto ERROR;
+    }
+
+    uint32_t packed_number = 0;
+    for(uint32_t i = 0; i < texture_number; i++)
+    {
+        if(packed[i])
+        {
+            continue;
+        }
+
+        // The default texture keeps slot 0 on its own, the fragment shader picks its sampler from that index.
+        // Streamed textures are resized independently and cannot share an image either.
+        bool packable = i != 0 && texture_list->textures[i].stream == NULL;
+
+        uint32_t member_number = 0;
+        members[member_number++] = i;
+        for(uint32_t j = i + 1; packable && j < texture_number && member_number < properties.limits.maxImageArrayLayers; j++)
+        {
+            if(!packed[j] && texture_list->textures[j].stream == NULL && same_texture_layout(&texture_list->textures[i], &texture_list->textures[j]))
+            {
+                members[member_number++] = j;
+            }
+        }
+
+        if(member_number == 1 || create_texture_array(&packed_textures[packed_number], texture_list->textures, members, member_number, commands, device) != PIGMENT_SUCCESS)
+        {
+            packed_textures[packed_number] = texture_list->textures[i];
+            slots[i]                       = (PTextureSlot) {packed_number, 0};
+            packed[i]                      = true;
+            packed_number++;
+            continue;
+        }
+
+        for(uint32_t j = 0; j < member_number; j++)
+        {
+            PTexture* texture = &texture_list->textures[members[j]];
+            vkDestroyImageView(device->logical_device, texture->image_view, NULL);
+            vkDestroyImage(device->logical_device, texture->image, NULL);
+            free_device_memory(texture->image_memory, device);
+
+            slots[members[j]]  = (PTextureSlot) {packed_number, j};
+            packed[members[j]] = true;
+        }
+        packed_number++;
+    }
+
+    free(texture_list->textures);
+    free(texture_list->slots);
+    texture_list->textures       = packed_textures;
+    texture_list->texture_number = packed_number;
+    texture_list->texture_size   = texture_number;
+    texture_list->slots          = slots;
+    texture_list->slot_number    = texture_number;
+    texture_list->slot_size      = texture_number;
+
+    free(members);
+    free(packed);
+
+    return PIGMENT_SUCCESS;
+
+ERROR:
+    free(packed_textures);
+    free(slots);
+    free(members);
+    free(packed);
+    return PIGMENT_ERROR;
+}
+
 void destroy_textures(PTextureList* texture_list, PDevice* device)
 {
     if(texture_list != NULL)
     {
+        destroy_texture_streamer(texture_list, device);
+        destroy_mipmap_generator(texture_list->mipmap_generator, device);
+        disable_texture_sharing(texture_list);
+        release_retired_textures(texture_list, device, true);
+        destroy_texture_table(texture_list, device);
+
         for(size_t i = 0; i < texture_list->texture_number; i++)
         {
+            destroy_texture_stream(texture_list->textures[i].stream);
             vkDestroyImageView(device->logical_device, texture_list->textures[i].image_view, NULL);
             vkDestroyImage(device->logical_device, texture_list->textures[i].image, NULL);
-            vkFreeMemory(device->logical_device, texture_list->textures[i].image_memory, NULL);
+            free_device_memory(texture_list->textures[i].image_memory, device);
         }
 
         free(texture_list->textures);
+        free(texture_list->slots);
+        free(texture_list->free_slots);
+        free(texture_list->free_indices);
+        free(texture_list->free_descriptor_indices);
+        free(texture_list->retired_textures);
+        free(texture_list->cooked_texture_directory);
 
         free(texture_list);
     }
 }
 
-int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, PDevice* device)
+int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, uint32_t height, uint32_t mip_levels, uint32_t array_layers, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkImageCreateFlags flags, VkMemoryPropertyFlags properties, PDevice* device)
 {
+    *image_memory = VK_NULL_HANDLE;
+
     VkImageCreateInfo image_create_info = {
         .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .flags         = flags,
         .imageType     = VK_IMAGE_TYPE_2D,
         .extent.width  = width,
         .extent.height = height,
         .extent.depth  = 1,
         .mipLevels     = mip_levels,
-        .arrayLayers   = 1,
+        .arrayLayers   = array_layers,
         .format        = format,
         .tiling        = tiling,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -452,13 +1305,7 @@ int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, u
     VkMemoryRequirements memory_requirements;
     vkGetImageMemoryRequirements(device->logical_device, *image, &memory_requirements);
 
-    VkMemoryAllocateInfo alloc_info = {
-        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize  = memory_requirements.size,
-        .memoryTypeIndex = find_memory_type(device->physical_device, memory_requirements.memoryTypeBits, properties)
-    };
-
-    if(vkAllocateMemory(device->logical_device, &alloc_info, NULL, image_memory) != VK_SUCCESS)
+    if(allocate_device_memory(&memory_requirements, properties, get_image_memory_category(usage), image_memory, device) != PIGMENT_SUCCESS)
     {
         fprintf(stderr, "Failed to allocate image memory!\n");
         goto ERROR;
@@ -473,11 +1320,44 @@ int create_image(VkImage* image, VkDeviceMemory* image_memory, uint32_t width, u
     return PIGMENT_SUCCESS;
 
 ERROR:
-    vkFreeMemory(device->logical_device, *image_memory, NULL);
+    free_device_memory(*image_memory, device);
     vkDestroyImage(device->logical_device, *image, NULL);
     return PIGMENT_ERROR;
 }
 
+VkImageView create_texture_view(VkImage image, VkFormat format, uint32_t mip_levels, uint32_t layer_count, VkDevice device)
+{
+    VkImageView image_view;
+
+    // Images written by the mipmap generator also have storage usage, which their sRGB format may not support
+    VkImageViewUsageCreateInfo usage_create_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT
+    };
+
+    // Every texture is viewed as an array so single and packed textures share the same shader binding
+    VkImageViewCreateInfo view_create_info = {
+        .sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext                           = &usage_create_info,
+        .image                           = image,
+        .viewType                        = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        .format                          = format,
+        .subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .subresourceRange.baseMipLevel   = 0,
+        .subresourceRange.levelCount     = mip_levels,
+        .subresourceRange.baseArrayLayer = 0,
+        .subresourceRange.layerCount     = layer_count
+    };
+
+    if(vkCreateImageView(device, &view_create_info, NULL, &image_view) != VK_SUCCESS)
+    {
+        fprintf(stderr, "Failed to create texture image view!\n");
+        return NULL;
+    }
+
+    return image_view;
+}
+
 int transition_image_layout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels, VkCommandPool command_pool, PDevice* device)
 {
     VkCommandBuffer command_buffer = start_single_usage_commands(command_pool, device);
@@ -564,26 +1444,33 @@ ERROR:
     return PIGMENT_ERROR;
 }
 
-void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkCommandPool command_pool, PDevice* device)
+void copy_buffer_to_image(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, const VkDeviceSize* level_offsets, uint32_t level_count, VkCommandPool command_pool, PDevice* device)
 {
     VkCommandBuffer command_buffer = start_single_usage_commands(command_pool, device);
 
-    VkOffset3D image_offset = {0, 0, 0};
-    VkExtent3D image_extent = {width, height, 1};
-
-    VkBufferImageCopy region = {
-        .bufferOffset                    = 0,
-        .bufferRowLength                 = 0,
-        .bufferImageHeight               = 0,
-        .imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-        .imageSubresource.mipLevel       = 0,
-        .imageSubresource.baseArrayLayer = 0,
-        .imageSubresource.layerCount     = 1,
-        .imageOffset                     = image_offset,
-        .imageExtent                     = image_extent
-    };
+    VkBufferImageCopy regions[MAX_TEXTURE_MIP_LEVELS];
+
+    for(uint32_t i = 0; i < level_count; i++)
+    {
+        VkOffset3D image_offset = {0, 0, 0};
+        VkExtent3D image_extent = {width >> i, height >> i, 1};
+        image_extent.width      = image_extent.width > 0 ? image_extent.width : 1;
+        image_extent.height     = image_extent.height > 0 ? image_extent.height : 1;
+
+        regions[i] = (VkBufferImageCopy) {
+            .bufferOffset                    = level_offsets[i],
+            .bufferRowLength                 = 0,
+            .bufferImageHeight               = 0,
+            .imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .imageSubresource.mipLevel       = i,
+            .imageSubresource.baseArrayLayer = 0,
+            .imageSubresource.layerCount     = 1,
+            .imageOffset                     = image_offset,
+            .imageExtent                     = image_extent
+        };
+    }
 
-    vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, level_count, regions);
 
     end_single_usage_commands(&command_buffer, command_pool, device);
 }
@@ -17,11 +17,21 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 #define MAX_SAMPLERS 2
+#define MAX_TEXTURE_MIP_LEVELS 16
+#define MAX_BINDLESS_TEXTURES 16384
 
 #include "defines.h"
 
-PTextureList* create_textures(void);
+PTextureList* create_textures(uint32_t frame_count);
+void enable_texture_cooking(PTextureList* texture_list, const char* directory);
 int add_texture(PTextureList* texture_list, const char* texture_path, PCommands* commands, PDevice* device);
+int insert_texture(PTextureList* texture_list, const char* texture_path, PCommands* commands, PDevice* device, uint32_t* slot);
+int replace_texture(PTextureList* texture_list, uint32_t slot, const char* texture_path, PCommands* commands, PDevice* device);
+void remove_texture(PTextureList* texture_list, uint32_t slot);
+void update_textures(PTextureList* texture_list, PDevice* device, uint32_t frame);
+void advance_texture_frame(PTextureList* texture_list);
+int pack_texture_arrays(PTextureList* texture_list, PCommands* commands, PDevice* device);
+int create_texture_table(PTextureList* texture_list, PDevice* device);
 void destroy_textures(PTextureList* texture, PDevice* device);
 PSamplerList* create_samplers(PDevice* device);
 void destroy_samplers(PSamplerList* sampler_list, PDevice* device);
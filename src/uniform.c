@@ -18,27 +18,72 @@
 #include "structs.h"
 
 extern void get_view_matrix(PCamera* camera, UniformBufferObject* ubo);
+extern float get_lod_scale(PCamera* camera, float viewport_height);
 
-void update_uniform_buffer(PBuffers* buffers, PSwapchain* swapchain, PCamera* camera)
+void reset_uniform_arena(PBuffers* buffers, uint32_t frame);
+void* allocate_uniforms(PBuffers* buffers, VkDeviceSize size, uint32_t* offset);
+void update_projection(PCamera* camera, float aspect);
+
+void reset_uniform_arena(PBuffers* buffers, uint32_t frame)
+{
+    buffers->uniform_arena_start = frame * buffers->uniform_arena_size;
+    buffers->uniform_arena_used  = 0;
+}
+
+void* allocate_uniforms(PBuffers* buffers, VkDeviceSize size, uint32_t* offset)
 {
-    mat4 model = GLM_MAT4_IDENTITY_INIT;
-    vec3 rotation_axis = {0.0f, 1.0f, 0.0f};
-    vec3 pivot = {0.0f, 0.0f, 0.0f};
+    VkDeviceSize aligned_size = (size + buffers->uniform_alignment - 1) & ~(buffers->uniform_alignment - 1);
+
+    if(buffers->uniform_arena_used + aligned_size > buffers->uniform_arena_size)
+    {
+        fprintf(stderr, "Failed to allocate uniforms, frame arena is full!\n");
+        return NULL;
+    }
 
-    glm_rotate_at(model, pivot, glm_rad(90.0f), rotation_axis);
+    *offset = (uint32_t) (buffers->uniform_arena_start + buffers->uniform_arena_used);
+    buffers->uniform_arena_used += aligned_size;
+
+    return (char*) buffers->uniform_buffer_mapped + *offset;
+}
 
-    vec3 rotation_axis2 = {0.0f, 0.0f, 1.0f};
-    glm_rotate_at(model, pivot, glm_rad(90.0f), rotation_axis2);
+void update_projection(PCamera* camera, float aspect)
+{
+    if(camera->projection_aspect == aspect && camera->projection_fov == camera->fov)
+    {
+        return;
+    }
 
     mat4 projection;
-    glm_perspective(glm_rad(45.0f), (float) swapchain->extent.width / (float) swapchain->extent.height, 0.1f, 1000.0f, projection);
+    glm_perspective(glm_rad(camera->fov), aspect, 0.1f, 1000.0f, projection);
+    projection[1][1] *= -1;
+
+    glm_mat4_ucopy(projection, camera->projection);
+    camera->projection_aspect = aspect;
+    camera->projection_fov    = camera->fov;
+}
+
+void update_uniform_buffer(PBuffers* buffers, PSwapchain* swapchain, PCamera* camera)
+{
+    update_projection(camera, (float) swapchain->extent.width / (float) swapchain->extent.height);
+
+    reset_uniform_arena(buffers, swapchain->current_frame);
+
+    UniformBufferObject* ubo = allocate_uniforms(buffers, sizeof(*ubo), &buffers->uniform_offset);
+    if(ubo == NULL)
+    {
+        return;
+    }
 
-    UniformBufferObject ubo;
-    glm_mat4_copy(model, ubo.model);
-    get_view_matrix(camera, &ubo);
-    glm_mat4_copy(projection, ubo.projection);
+    UniformBufferObject frame_ubo;
+    get_view_matrix(camera, &frame_ubo);
+    glm_mat4_ucopy(camera->projection, frame_ubo.projection);
 
-    ubo.projection[1][1] *= -1;
+    memcpy(ubo, &frame_ubo, sizeof(frame_ubo));
 
-    memcpy(buffers->uniform_buffers_mapped[swapchain->current_frame], &ubo, sizeof(ubo));
+    // Planes for the instance culling, in world space since they come from the view projection
+    mat4 view_projection;
+    glm_mat4_mul(frame_ubo.projection, frame_ubo.view, view_projection);
+    glm_frustum_planes(view_projection, buffers->frustum_planes);
+    glm_vec3_copy(camera->position, buffers->camera_position);
+    buffers->lod_scale = get_lod_scale(camera, (float) swapchain->extent.height);
 }
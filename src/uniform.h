@@ -16,6 +16,7 @@
 
 #ifndef UNIFORM_H
 #define UNIFORM_H
+#define UNIFORM_ARENA_SIZE 65536
 
 #include "defines.h"
 
@@ -30,7 +30,7 @@ PVertexDescription* create_vertex_description(void)
     }
 
     vertex_description->binding_description         = get_binding_description();
-    vertex_description->attribute_descriptions_size = 5;
+    vertex_description->attribute_descriptions_size = VERTEX_ATTRIBUTE_COUNT;
     vertex_description->attribute_descriptions      = get_attribute_descriptions();
 
     return vertex_description;
@@ -59,7 +59,7 @@ static VkVertexInputBindingDescription get_binding_description(void)
 
 static VkVertexInputAttributeDescription* get_attribute_descriptions(void)
 {
-    const uint32_t attr_count = 5;
+    const uint32_t attr_count = VERTEX_ATTRIBUTE_COUNT;
     VkVertexInputAttributeDescription* attribute_descriptions = calloc(attr_count, sizeof(*attribute_descriptions));
     if(attribute_descriptions == NULL)
     {
@@ -92,5 +92,10 @@ static VkVertexInputAttributeDescription* get_attribute_descriptions(void)
     attribute_descriptions[4].format   = VK_FORMAT_R32_SINT;
     attribute_descriptions[4].offset   = offsetof(Vertex, sampler_index);
 
+    attribute_descriptions[5].binding  = 0;
+    attribute_descriptions[5].location = 5;
+    attribute_descriptions[5].format   = VK_FORMAT_R32_SINT;
+    attribute_descriptions[5].offset   = offsetof(Vertex, texture_layer);
+
     return attribute_descriptions;
 }
@@ -16,6 +16,8 @@
 
 #ifndef VERTEX_H
 #define VERTEX_H
+#define VERTEX_ATTRIBUTE_COUNT 6
+#define VERTEX_COLOR_LOCATION 1
 
 #include "defines.h"
 
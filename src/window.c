@@ -34,7 +34,9 @@ PWindow* create_window(PWindowInfo* window_info)
         goto ERROR;
     }
 
-    window->framebuffer_resized = false;
+    window->framebuffer_resized   = false;
+    window->swapchain_out_of_date = false;
+    window->resize_time           = 0.0;
 
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -99,8 +101,9 @@ static void framebuffer_resize_callback(GLFWwindow* window, int width __attribut
 {
     PWindow* pigment_window             = glfwGetWindowUserPointer(window);
     pigment_window->framebuffer_resized = true;
-    pigment_window->info->width          = width;
-    pigment_window->info->height         = height;
+    pigment_window->resize_time         = glfwGetTime();
+    pigment_window->info->width         = width;
+    pigment_window->info->height        = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -16,6 +16,7 @@
 
 #ifndef WINDOW_H
 #define WINDOW_H
+#define RESIZE_SETTLE_TIME 0.1
 
 #include "defines.h"
 